@@ -19,6 +19,7 @@ LOCAL_LDLIBS += \
   -lm \
   -ldl \
   -landroid \
+  -lz \
 
 LOCAL_SHARED_LIBRARIES += \
   libhiai_ir \
@@ -28,9 +29,53 @@ LOCAL_SHARED_LIBRARIES += \
 CPPFLAGS=-stdlib=libstdc++
 LDLIBS=-lstdc++
 LOCAL_CFLAGS += -std=c++14 -frtti
+# keys the .irpb cache of test_single_op on the graph builder sources instead of the build time; shape_inference
+# and the kernel headers it reads write the output descs of the graphs
+GRAPH_SOURCE_HASH := $(shell cat $(LOCAL_PATH)/test_single_op.cpp $(LOCAL_PATH)/typed_graph.h \
+  $(LOCAL_PATH)/host_graph.h $(LOCAL_PATH)/test_util.h $(LOCAL_PATH)/shape_inference.h \
+  $(LOCAL_PATH)/host_kernel/nn.h $(LOCAL_PATH)/host_kernel/resize.h | cksum | cut -d' ' -f1)
+LOCAL_CFLAGS += -DGRAPH_SOURCE_HASH=\"$(GRAPH_SOURCE_HASH)\"
 
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_host_kernel
+LOCAL_SRC_FILES := bench_host_kernel.cpp \
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../ddk/ai_ddk_lib/include \
+					$(LOCAL_PATH)/../ddk/ai_ddk_lib/include/graph \
+					$(LOCAL_PATH)/ \
+
+LOCAL_ALLOW_UNDEFINED_SYMBOLS := true
+LOCAL_LDLIBS += \
+  -llog \
+  -lc \
+  -lm \
+  -ldl \
+  -landroid \
+  -lz \
+
+LOCAL_SHARED_LIBRARIES += \
+  libhiai_ir \
+  libhiai_ir_build \
+  libhiai \
+
+LOCAL_CFLAGS += -std=c++14 -frtti -O3
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := bench_model_residency
+LOCAL_SRC_FILES := bench_model_residency.cpp \
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/../ddk/ai_ddk_lib/include \
+					$(LOCAL_PATH)/ \
+
+LOCAL_LDLIBS += \
+  -llog \
+
+LOCAL_CFLAGS += -std=c++14 -O2
+include $(BUILD_EXECUTABLE)
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := libhiai_ir
 LOCAL_SRC_FILES := $(DDK_LIBRARY_PATH)/lib64/libhiai_ir.so
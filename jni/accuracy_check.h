@@ -0,0 +1,390 @@
+#ifndef BUILD_IR_MODEL_ACCURACY_CHECK_H
+#define BUILD_IR_MODEL_ACCURACY_CHECK_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "graph/types.h"
+#include "log_util.h"
+#include "npy_io.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Compares model outputs with reference tensors. Elements are checked against |out - ref| <= absTol +
+// relTol * |ref|, the whole tensor against a minimum cosine similarity; max abs / relative error, ULP
+// distance and RMSE are reported, in total and per channel. Data is consumed in order and in any chunk size,
+// so outputs of hundreds of MB are compared in one pass without a float copy of the reference:
+//
+//     accuracy_check::Checker checker("output_0", {1, 64, 112, 112}, accuracy_check::GetTolerance(ge::DT_FLOAT16));
+//     checker.Feed(ref, out, num);        // as often as needed
+//     accuracy_check::Report report;
+//     checker.Finish(report);
+//     accuracy_check::PrintReport(report);
+namespace accuracy_check {
+struct Tolerance {
+    float absTol = 1e-5f;
+    float relTol = 1e-4f;
+    float minCosine = 0.99999f;
+    // max ULP distance between out and ref in units of epsilon, see GetUlp; 0 does not check it
+    float maxUlp = 0;
+    // unit roundoff of the precision the device computes in
+    float epsilon = 1.1920929e-7f;
+};
+
+// Tolerances for outputs computed in `computeType`: the NPU runs float models in FP16 by default, its errors
+// are about a thousand times those of an FP32 reference.
+inline Tolerance GetTolerance(ge::DataType computeType) {
+    Tolerance tolerance;
+    if (computeType == ge::DT_FLOAT16) {
+        tolerance.epsilon = 9.765625e-4f;
+        tolerance.absTol = 1e-3f;
+        tolerance.relTol = 4 * tolerance.epsilon;
+        tolerance.minCosine = 0.999f;
+    } else if (computeType == ge::DT_INT8 || computeType == ge::DT_UINT8) {
+        tolerance.epsilon = 1.0f / 128;
+        tolerance.absTol = 1e-2f;
+        tolerance.relTol = 5e-2f;
+        tolerance.minCosine = 0.99f;
+    }
+    return tolerance;
+}
+
+struct Stats {
+    size_t count = 0;
+    // elements beyond absTol + relTol * |ref|, non-finite ones included
+    size_t mismatchNum = 0;
+    // NaN / Inf where the reference differs
+    size_t nonFiniteNum = 0;
+    float maxAbs = 0;
+    size_t maxAbsIndex = 0;
+    float maxAbsRef = 0;
+    float maxAbsOut = 0;
+    float maxRel = 0;
+    // float32 values between out and ref, finite elements only
+    uint32_t maxUlp32 = 0;
+    double sumSqDiff = 0;
+    double dot = 0;
+    double refSq = 0;
+    double outSq = 0;
+
+    // `other` covers elements after the ones of this, ties of maxAbs keep the first index
+    void Merge(const Stats& other) {
+        count += other.count;
+        mismatchNum += other.mismatchNum;
+        nonFiniteNum += other.nonFiniteNum;
+        if (other.maxAbs > maxAbs) {
+            maxAbs = other.maxAbs;
+            maxAbsIndex = other.maxAbsIndex;
+            maxAbsRef = other.maxAbsRef;
+            maxAbsOut = other.maxAbsOut;
+        }
+        maxRel = std::max(maxRel, other.maxRel);
+        maxUlp32 = std::max(maxUlp32, other.maxUlp32);
+        sumSqDiff += other.sumSqDiff;
+        dot += other.dot;
+        refSq += other.refSq;
+        outSq += other.outSq;
+    }
+
+    double GetCosine() const {
+        if (refSq == 0 || outSq == 0) {
+            return refSq == outSq ? 1.0 : 0.0;
+        }
+        return dot / (std::sqrt(refSq) * std::sqrt(outSq));
+    }
+
+    double GetRmse() const {
+        return count > 0 ? std::sqrt(sumSqDiff / count) : 0.0;
+    }
+
+    // ULP distance in the precision of `epsilon`: the float32 distance over the float32 ULPs in one of epsilon,
+    // exact for float32 and for values in the normal range of a narrower float.
+    double GetUlp(float epsilon) const {
+        return maxUlp32 * (static_cast<double>(FLT_EPSILON) / epsilon);
+    }
+};
+
+struct Report {
+    std::string name;
+    std::vector<int64_t> dims;
+    Tolerance tolerance;
+    Stats total;
+    // along the channel axis, empty for tensors of fewer than two dimensions
+    std::vector<Stats> channels;
+    bool passed = false;
+};
+
+namespace detail {
+// elements per SIMD block, float partial sums over a block lose nothing measurable before going to double
+const size_t BLOCK_SIZE = 1024;
+// elements below which a run is not split across threads
+const size_t PARALLEL_GRAIN = 1 << 18;
+
+// Float bits mapped to an unsigned integer that orders like the floats, -0 and +0 alike. The distance of two
+// finite floats is then the number of float32 values between them.
+inline uint32_t OrderedBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // all ones for negative values, which count down from the sign bit instead of up
+    uint32_t negative = static_cast<uint32_t>(static_cast<int32_t>(bits) >> 31);
+    const uint32_t sign = 0x80000000u;
+    return sign + (((bits & ~sign) ^ negative) - negative);
+}
+
+inline uint32_t UlpDistance(float a, float b) {
+    uint32_t x = OrderedBits(a);
+    uint32_t y = OrderedBits(b);
+    return std::max(x, y) - std::min(x, y);
+}
+
+// Element by element, also the path for blocks holding NaN / Inf.
+inline void AccumulateScalar(const float* ref, const float* out, size_t num, size_t offset, const Tolerance& tol,
+                             Stats& stats) {
+    for (size_t i = 0; i < num; i++) {
+        float r = ref[i];
+        float o = out[i];
+        stats.count++;
+        if (!std::isfinite(r) || !std::isfinite(o)) {
+            bool same = (std::isnan(r) && std::isnan(o)) || r == o;
+            stats.nonFiniteNum += same ? 0 : 1;
+            stats.mismatchNum += same ? 0 : 1;
+            continue;
+        }
+        float diff = std::fabs(o - r);
+        if (diff > tol.absTol + tol.relTol * std::fabs(r)) {
+            stats.mismatchNum++;
+        }
+        if (diff > stats.maxAbs) {
+            stats.maxAbs = diff;
+            stats.maxAbsIndex = offset + i;
+            stats.maxAbsRef = r;
+            stats.maxAbsOut = o;
+        }
+        stats.maxRel = std::max(stats.maxRel, diff / std::max(std::fabs(r), tol.absTol));
+        stats.maxUlp32 = std::max(stats.maxUlp32, UlpDistance(r, o));
+        stats.sumSqDiff += static_cast<double>(diff) * diff;
+        stats.dot += static_cast<double>(r) * o;
+        stats.refSq += static_cast<double>(r) * r;
+        stats.outSq += static_cast<double>(o) * o;
+    }
+}
+
+// One block with SIMD. Mismatches and the index of the max error are found by a scalar rescan of the few
+// blocks that have any; a non-finite sum sends the block to the scalar path. The ULP distance works on the bit
+// patterns, in a separate integer loop the compiler vectorizes.
+inline void AccumulateBlock(const float* ref, const float* out, size_t num, size_t offset, const Tolerance& tol,
+                            Stats& stats) {
+    using namespace simd_util;
+    const Float4 vAbsTol = Set4(tol.absTol);
+    const Float4 vRelTol = Set4(tol.relTol);
+    Float4 maxAbs = Set4(0.0f);
+    Float4 maxRatio = Set4(0.0f);
+    Float4 maxRel = Set4(0.0f);
+    Float4 sumSqDiff = Set4(0.0f);
+    Float4 dot = Set4(0.0f);
+    Float4 refSq = Set4(0.0f);
+    Float4 outSq = Set4(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= num; i += 4) {
+        Float4 r = Load4(ref + i);
+        Float4 o = Load4(out + i);
+        Float4 diff = Sub4(o, r);
+        Float4 absDiff = Abs4(diff);
+        Float4 absRef = Abs4(r);
+        maxAbs = Max4(maxAbs, absDiff);
+        maxRatio = Max4(maxRatio, Div4(absDiff, Fma4(vRelTol, absRef, vAbsTol)));
+        maxRel = Max4(maxRel, Div4(absDiff, Max4(absRef, vAbsTol)));
+        sumSqDiff = Fma4(diff, diff, sumSqDiff);
+        dot = Fma4(r, o, dot);
+        refSq = Fma4(r, r, refSq);
+        outSq = Fma4(o, o, outSq);
+    }
+    float blockSumSqDiff = ReduceSum4(sumSqDiff);
+    float blockRefSq = ReduceSum4(refSq);
+    float blockOutSq = ReduceSum4(outSq);
+    if (!std::isfinite(blockSumSqDiff) || !std::isfinite(blockRefSq) || !std::isfinite(blockOutSq)) {
+        AccumulateScalar(ref, out, num, offset, tol, stats);
+        return;
+    }
+    Stats block;
+    block.count = i;
+    block.maxRel = ReduceMax4(maxRel);
+    for (size_t k = 0; k < i; k++) {
+        block.maxUlp32 = std::max(block.maxUlp32, UlpDistance(ref[k], out[k]));
+    }
+    block.sumSqDiff = blockSumSqDiff;
+    block.dot = ReduceSum4(dot);
+    block.refSq = blockRefSq;
+    block.outSq = blockOutSq;
+    float blockMaxAbs = ReduceMax4(maxAbs);
+    if (ReduceMax4(maxRatio) > 1.0f || blockMaxAbs > stats.maxAbs) {
+        for (size_t k = 0; k < i; k++) {
+            float absRef = std::fabs(ref[k]);
+            float diff = std::fabs(out[k] - ref[k]);
+            block.mismatchNum += diff > tol.absTol + tol.relTol * absRef ? 1 : 0;
+            if (diff > block.maxAbs) {
+                block.maxAbs = diff;
+                block.maxAbsIndex = offset + k;
+                block.maxAbsRef = ref[k];
+                block.maxAbsOut = out[k];
+            }
+        }
+    }
+    stats.Merge(block);
+    AccumulateScalar(ref + i, out + i, num - i, offset + i, tol, stats);
+}
+
+inline Stats AccumulateRun(const float* ref, const float* out, size_t num, size_t offset, const Tolerance& tol) {
+    auto run = [&](size_t begin, size_t end, Stats& stats) {
+        for (size_t block = begin; block < end; block += BLOCK_SIZE) {
+            size_t count = std::min(BLOCK_SIZE, end - block);
+            AccumulateBlock(ref + block, out + block, count, offset + block, tol, stats);
+        }
+    };
+    Stats stats;
+    if (num < 2 * PARALLEL_GRAIN) {
+        run(0, num, stats);
+        return stats;
+    }
+    size_t parts = std::min<size_t>(parallel_util::GetThreadNum(), num / PARALLEL_GRAIN);
+    size_t step = (num / parts + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    std::vector<Stats> partial((num + step - 1) / step);
+    parallel_util::ParallelFor(0, partial.size(), [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            run(p * step, std::min(num, (p + 1) * step), partial[p]);
+        }
+    }, static_cast<int>(partial.size()));
+    for (const auto& part : partial) {
+        stats.Merge(part);
+    }
+    return stats;
+}
+}
+
+// Streaming comparison of one tensor. Channels are along `channelAxis` (1 for NCHW).
+class Checker {
+public:
+    Checker(const std::string& name, const std::vector<int64_t>& dims, const Tolerance& tolerance,
+            int channelAxis = 1) {
+        report_.name = name;
+        report_.dims = dims;
+        report_.tolerance = tolerance;
+        for (auto dim : dims) {
+            expected_ *= static_cast<size_t>(std::max<int64_t>(dim, 0));
+        }
+        if (dims.size() >= 2 && channelAxis >= 0 && channelAxis < static_cast<int>(dims.size())) {
+            channelNum_ = static_cast<size_t>(dims[channelAxis]);
+            for (size_t i = channelAxis + 1; i < dims.size(); i++) {
+                inner_ *= static_cast<size_t>(dims[i]);
+            }
+            report_.channels.resize(channelNum_);
+        }
+    }
+
+    // Compares the next `num` elements.
+    void Feed(const float* ref, const float* out, size_t num) {
+        while (num > 0) {
+            size_t run = num;
+            Stats* channel = nullptr;
+            if (channelNum_ > 0 && inner_ > 0) {
+                run = std::min(num, inner_ - position_ % inner_);
+                channel = &report_.channels[(position_ / inner_) % channelNum_];
+            }
+            Stats stats = detail::AccumulateRun(ref, out, run, position_, report_.tolerance);
+            if (channel != nullptr) {
+                channel->Merge(stats);
+            }
+            report_.total.Merge(stats);
+            ref += run;
+            out += run;
+            position_ += run;
+            num -= run;
+        }
+    }
+
+    bool Finish(Report& report) {
+        const Tolerance& tol = report_.tolerance;
+        const Stats& total = report_.total;
+        bool ulpOk = tol.maxUlp <= 0 || total.GetUlp(tol.epsilon) <= tol.maxUlp;
+        report_.passed = total.count == expected_ && total.mismatchNum == 0 && total.nonFiniteNum == 0 &&
+                         total.GetCosine() >= tol.minCosine && ulpOk;
+        if (total.count != expected_) {
+            ALOGE("[ACCURACY] %s: compared %zu elements, the shape has %zu.\n", report_.name.c_str(), total.count,
+                  expected_);
+        }
+        report = report_;
+        return report.passed;
+    }
+
+private:
+    Report report_;
+    size_t expected_ = 1;
+    size_t channelNum_ = 0;
+    size_t inner_ = 1;
+    size_t position_ = 0;
+};
+
+// Compares `out` with a reference read by npy_io. References that are not float32 are converted chunk by
+// chunk, a mmapped reference is paged in once.
+inline bool CheckTensor(const std::string& name, const float* out, size_t num, const npy_io::NpyArray& ref,
+                        const Tolerance& tolerance, Report& report) {
+    if (ref.GetElementNum() != num) {
+        ALOGE("[ACCURACY] %s: the output has %zu elements, the reference %zu.\n", name.c_str(), num,
+              ref.GetElementNum());
+        report = Report();
+        report.name = name;
+        return false;
+    }
+    Checker checker(name, ref.GetShape(), tolerance);
+    const float* data = ref.Data<float>();
+    if (data != nullptr) {
+        checker.Feed(data, out, num);
+        return checker.Finish(report);
+    }
+    const size_t chunk = 1 << 20;
+    std::vector<float> buffer(std::min(chunk, num));
+    for (size_t begin = 0; begin < num; begin += chunk) {
+        size_t count = std::min(chunk, num - begin);
+        if (!ref.ToFloat(begin, count, buffer.data())) {
+            return false;
+        }
+        checker.Feed(buffer.data(), out + begin, count);
+    }
+    return checker.Finish(report);
+}
+
+inline void PrintReport(const Report& report, size_t worstChannelNum = 4) {
+    const Stats& total = report.total;
+    const Tolerance& tol = report.tolerance;
+    ALOGI("[ACCURACY] %s %s: %zu elements, max abs %.4g at %zu (ref %.6g, out %.6g), max rel %.4g, %.1f ulp, "
+          "cosine %.7f, rmse %.4g, %zu mismatches, %zu non-finite\n", report.name.c_str(),
+          report.passed ? "PASSED" : "FAILED", total.count, total.maxAbs, total.maxAbsIndex, total.maxAbsRef,
+          total.maxAbsOut, total.maxRel, total.GetUlp(tol.epsilon), total.GetCosine(), total.GetRmse(),
+          total.mismatchNum, total.nonFiniteNum);
+    std::vector<size_t> order(report.channels.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&report](size_t a, size_t b) {
+        const Stats& sa = report.channels[a];
+        const Stats& sb = report.channels[b];
+        return sa.mismatchNum != sb.mismatchNum ? sa.mismatchNum > sb.mismatchNum : sa.maxAbs > sb.maxAbs;
+    });
+    for (size_t i = 0; i < std::min(worstChannelNum, order.size()); i++) {
+        const Stats& channel = report.channels[order[i]];
+        if (channel.maxAbs == 0 && channel.mismatchNum == 0) {
+            break;
+        }
+        ALOGI("[ACCURACY]     channel %zu: max abs %.4g at %zu, max rel %.4g, cosine %.7f, %zu mismatches\n",
+              order[i], channel.maxAbs, channel.maxAbsIndex, channel.maxRel, channel.GetCosine(),
+              channel.mismatchNum);
+    }
+}
+}
+
+#endif //BUILD_IR_MODEL_ACCURACY_CHECK_H
@@ -0,0 +1,1218 @@
+#include "test_util.h"
+#include "graph_partition.h"
+#include "host_executor.h"
+#include "host_kernel/builtin_kernels.h"
+#include "host_kernel/conv.h"
+#include "host_kernel/conv_transpose.h"
+#include "host_kernel/detection.h"
+#include "host_kernel/gather.h"
+#include "host_kernel/gemm.h"
+#include "host_kernel/lstm.h"
+#include "host_kernel/normalization.h"
+#include "host_kernel/resize.h"
+#include "host_kernel/top_k.h"
+#include "layout_util.h"
+#include "memory_planner.h"
+#include "quant_calibration.h"
+#include "shape_inference.h"
+#include "stateful_session.h"
+#include "weight_quant.h"
+
+using namespace std;
+using namespace host_kernel;
+
+namespace bench_case {
+typedef void(* BenchFunc)(int repeats);
+
+struct BenchCase {
+    std::string caseName;
+    BenchFunc func;
+    int repeats;
+};
+
+double GetTimeMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Runs func `repeats` times after one untimed call and returns the average time in ms.
+template<typename Func>
+double TimeIt(int repeats, Func func) {
+    func();
+    double start = GetTimeMs();
+    for (int i = 0; i < repeats; i++) {
+        func();
+    }
+    return (GetTimeMs() - start) / repeats;
+}
+
+vector<float> RandomData(size_t num, float low, float high, unsigned int seed = 0) {
+    std::default_random_engine engine(seed);
+    std::uniform_real_distribution<float> uniform(low, high);
+    vector<float> data(num);
+    for (auto& v : data) {
+        v = uniform(engine);
+    }
+    return data;
+}
+
+void DecodeBoxesNaive(const float* deltas, const float* anchors, size_t num, const BoxDecodeParam& param,
+                      float* boxes) {
+    for (size_t i = 0; i < num; i++) {
+        float yc = deltas[i * 4] / param.scaleY * anchors[i * 4 + 2] + anchors[i * 4];
+        float xc = deltas[i * 4 + 1] / param.scaleX * anchors[i * 4 + 3] + anchors[i * 4 + 1];
+        float h = std::exp(deltas[i * 4 + 2] / param.scaleH) * anchors[i * 4 + 2];
+        float w = std::exp(deltas[i * 4 + 3] / param.scaleW) * anchors[i * 4 + 3];
+        boxes[i * 4] = yc - h / 2;
+        boxes[i * 4 + 1] = xc - w / 2;
+        boxes[i * 4 + 2] = yc + h / 2;
+        boxes[i * 4 + 3] = xc + w / 2;
+    }
+}
+
+void BenchDetection(int repeats) {
+    const size_t numClasses = 91;
+    for (size_t numAnchors : {1917, 8732, 20000}) {
+        vector<float> scores = RandomData(numAnchors * numClasses, 0.0f, 1.0f, 1);
+        vector<float> deltas = RandomData(numAnchors * 4, -1.0f, 1.0f, 2);
+        vector<float> anchors = RandomData(numAnchors * 4, 0.1f, 0.9f, 3);
+        vector<float> boxes(numAnchors * 4);
+        DetectionParam param;
+        param.scoreThreshold = 0.9f;
+        param.iouThreshold = 0.6f;
+
+        double naive = TimeIt(repeats, [&]() {
+            DecodeBoxesNaive(deltas.data(), anchors.data(), numAnchors, param.decode, boxes.data());
+        });
+        double simd = TimeIt(repeats, [&]() {
+            DecodeBoxes(deltas.data(), anchors.data(), numAnchors, param.decode, boxes.data());
+        });
+        ALOGI("[decode] anchors %zu: naive %.3f ms, simd %.3f ms\n", numAnchors, naive, simd);
+
+        size_t detections = 0;
+        for (bool regular : {false, true}) {
+            param.useRegularNms = regular;
+            for (int threads : {1, 0}) {
+                param.threadNum = threads;
+                double ms = TimeIt(repeats, [&]() {
+                    detections = DetectionPostprocess(scores.data(), deltas.data(), anchors.data(), numAnchors,
+                                                      numClasses, param, boxes.data()).size();
+                });
+                ALOGI("[postprocess] anchors %zu, classes %zu, regular_nms %d, threads %d: %.3f ms, %zu boxes\n",
+                      numAnchors, numClasses, regular, threads == 0 ? parallel_util::GetThreadNum() : threads, ms,
+                      detections);
+            }
+        }
+    }
+}
+
+void QuantizeWeightsNaive(const float* weight, size_t channels, size_t inner, int8_t* quantized, float* scales) {
+    for (size_t c = 0; c < channels; c++) {
+        float absMax = 0;
+        for (size_t i = 0; i < inner; i++) {
+            absMax = std::max(absMax, std::fabs(weight[c * inner + i]));
+        }
+        scales[c] = absMax > 0 ? absMax / 127.0f : 1.0f;
+        for (size_t i = 0; i < inner; i++) {
+            float q = std::round(weight[c * inner + i] / scales[c]);
+            quantized[c * inner + i] = static_cast<int8_t>(std::min(std::max(q, -127.0f), 127.0f));
+        }
+    }
+}
+
+// Reference [H, W, I, O] -> [O, I, H, W] transpose.
+vector<float> HwioToOihwNaive(const vector<float>& hwio, const vector<int64_t>& dims) {
+    int64_t h = dims[0];
+    int64_t w = dims[1];
+    int64_t ci = dims[2];
+    int64_t co = dims[3];
+    vector<float> oihw(hwio.size());
+    for (int64_t y = 0; y < h; y++) {
+        for (int64_t x = 0; x < w; x++) {
+            for (int64_t i = 0; i < ci; i++) {
+                for (int64_t o = 0; o < co; o++) {
+                    oihw[((o * ci + i) * h + y) * w + x] = hwio[((y * w + x) * ci + i) * co + o];
+                }
+            }
+        }
+    }
+    return oihw;
+}
+
+// An HWIO filter packed with HwioToOihw() must be bit identical to quantizing its reference OIHW transpose.
+void CheckHwioPacking() {
+    vector<int64_t> dims{3, 5, 7, 16};
+    vector<float> hwio = RandomData(host_graph::HostTensor::GetElementNum(dims), -0.5f, 0.5f, 6);
+    vector<float> oihw = HwioToOihwNaive(hwio, dims);
+    weight_quant::WeightQuantOptions options;
+    weight_quant::QuantizedWeight expected;
+    weight_quant::QuantizeWeights("oihw", oihw.data(), {dims[3], dims[2], dims[0], dims[1]}, options, expected);
+    options.perm = weight_quant::HwioToOihw();
+    weight_quant::QuantizedWeight packed;
+    bool ok = weight_quant::QuantizeWeights("hwio", hwio.data(), dims, options, packed) &&
+              packed.dims == expected.dims && packed.data == expected.data && packed.scales == expected.scales;
+    ALOGI("[weight_quant] HWIO -> OIHW packing %s\n", ok ? "matches the reference transpose" : "MISMATCH");
+}
+
+void BenchWeightQuant(int repeats) {
+    CheckHwioPacking();
+    for (auto dims : {vector<int64_t>{256, 256, 3, 3}, vector<int64_t>{4096, 4096}, vector<int64_t>{1000, 25088}}) {
+        size_t num = host_graph::HostTensor::GetElementNum(dims);
+        vector<float> weight = RandomData(num, -0.5f, 0.5f, 4);
+        vector<int8_t> quantized(num);
+        vector<float> scales(dims[0]);
+        double naive = TimeIt(repeats, [&]() {
+            QuantizeWeightsNaive(weight.data(), dims[0], num / dims[0], quantized.data(), scales.data());
+        });
+        weight_quant::QuantizedWeight packed;
+        weight_quant::LayerQuantError error;
+        for (int threads : {1, 0}) {
+            weight_quant::WeightQuantOptions options;
+            options.threadNum = threads;
+            double ms = TimeIt(repeats, [&]() {
+                weight_quant::QuantizeWeights("bench", weight.data(), dims, options, packed, &error);
+            });
+            ALOGI("[weight_quant] %zu params: naive %.3f ms, simd threads %d %.3f ms, sqnr %.2f dB\n", num, naive,
+                  threads == 0 ? parallel_util::GetThreadNum() : threads, ms, error.sqnrDb);
+        }
+    }
+}
+
+host_graph::TensorRef AddConv(host_graph::Graph& graph, const string& name, host_graph::TensorRef x, int64_t ci,
+                              int64_t co, int64_t k) {
+    vector<float> filter = RandomData(co * ci * k * k, -0.1f, 0.1f, 5);
+    auto w = graph.AddConst(name + "_filter", ge::TensorDesc(ge::Shape({co, ci, k, k}), ge::FORMAT_NCHW,
+                            ge::DT_FLOAT), filter.data(), filter.size() * sizeof(float));
+    auto y = graph.AddNode(hiai::op::Convolution(name), "Convolution").Input("x", x).Input("filter", w)
+        .Attr("strides", vector<int64_t>{1, 1}).Attr("pad_mode", "SAME").Output();
+    return graph.AddNode(hiai::op::Activation(name + "_relu"), "Activation").Input("x", y).Output();
+}
+
+// Runs every node of `graph` on one set of inputs and returns its outputs.
+vector<host_graph::HostTensor> RunHostGraph(const host_graph::Graph& graph,
+                                            const vector<host_graph::HostTensor>& inputs) {
+    vector<int> nodes(graph.GetNodes().size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i] = static_cast<int>(i);
+    }
+    host_graph::TensorMap tensors;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        tensors[host_graph::Executor::Ref(graph.GetInputs()[i], 0)] = inputs[i];
+    }
+    vector<host_graph::HostTensor> outputs;
+    if (host_graph::Executor(graph, GetBuiltinKernels()).Run(nodes, tensors)) {
+        for (const auto& ref : graph.GetOutputs()) {
+            outputs.push_back(tensors[ref]);
+        }
+    }
+    return outputs;
+}
+
+// Calibrates and quantizes a small conv net with each method, then compares the INT8 graph with the FP32 one.
+// One branch saturates a ReLU6, so the conv after it calibrates on a constant 6.0, a histogram of zero width.
+void BenchCalibration(int repeats) {
+    host_graph::Graph graph("calibration");
+    const vector<int64_t> dims{1, 16, 32, 32};
+    auto data = graph.AddData("data", ge::TensorDesc(ge::Shape(dims), ge::FORMAT_NCHW, ge::DT_FLOAT));
+    auto x = AddConv(graph, "conv1", data, 16, 16, 3);
+    x = AddConv(graph, "conv2", x, 16, 16, 3);
+    vector<float> filter = RandomData(16 * 16, -0.1f, 0.1f, 8);
+    vector<float> bias(16, 100.0f);
+    auto w = graph.AddConst("saturated_filter", ge::TensorDesc(ge::Shape({16, 16, 1, 1}), ge::FORMAT_NCHW,
+                            ge::DT_FLOAT), filter.data(), filter.size() * sizeof(float));
+    auto b = graph.AddConst("saturated_bias", ge::TensorDesc(ge::Shape({16}), ge::FORMAT_NCHW, ge::DT_FLOAT),
+                            bias.data(), bias.size() * sizeof(float));
+    auto y = graph.AddNode(hiai::op::Convolution("saturated"), "Convolution").Input("x", data).Input("filter", w)
+        .Input("bias", b).Attr("strides", vector<int64_t>{1, 1}).Attr("pad_mode", "SAME").Output();
+    y = graph.AddNode(hiai::op::Activation("saturated_relu6"), "Activation").Input("x", y).Attr("mode", 3)
+        .Attr("coef", 6.0f).Output();
+    y = AddConv(graph, "conv3", y, 16, 16, 3);
+    graph.SetOutputs({x, y});
+
+    vector<vector<host_graph::HostTensor>> dataset;
+    for (unsigned int seed = 0; seed < 4; seed++) {
+        host_graph::HostTensor sample(dims, ge::DT_FLOAT);
+        vector<float> values = RandomData(sample.GetElementNum(), -1.0f, 1.0f, 10 + seed);
+        std::copy(values.begin(), values.end(), sample.Data<float>());
+        dataset.push_back({sample});
+    }
+    vector<host_graph::HostTensor> expected = RunHostGraph(graph, dataset[0]);
+
+    graph_partition::CapabilityTable table;
+    const char* names[] = {"min_max", "percentile", "kl_divergence"};
+    for (auto method : {quant_calibration::MIN_MAX, quant_calibration::PERCENTILE,
+                        quant_calibration::KL_DIVERGENCE}) {
+        quant_calibration::CalibrationOptions options;
+        options.method = method;
+        host_graph::Graph quantized = graph;
+        quant_calibration::Calibrator calibrator(quantized, GetBuiltinKernels(), options);
+        bool ok = true;
+        double ms = TimeIt(repeats, [&]() {
+            ok = calibrator.Calibrate(dataset) && ok;
+        });
+        std::map<host_graph::TensorRef, quant_calibration::QuantParam> params = calibrator.GetParams();
+        for (const auto& entry : params) {
+            ok = ok && std::isfinite(entry.second.scale) && entry.second.scale > 0;
+        }
+        calibrator.Print();
+        int rewritten = quant_calibration::QuantizeGraph(quantized, params, table, "100.320.010.010");
+        vector<host_graph::HostTensor> outputs = RunHostGraph(quantized, dataset[0]);
+        ok = ok && rewritten == 4 && outputs.size() == expected.size();
+        for (size_t i = 0; ok && i < outputs.size(); i++) {
+            const float* out = outputs[i].Data<float>();
+            const float* ref = expected[i].Data<float>();
+            double errorSq = 0;
+            double refSq = 0;
+            for (size_t j = 0; j < expected[i].GetElementNum(); j++) {
+                errorSq += (out[j] - ref[j]) * (out[j] - ref[j]);
+                refSq += ref[j] * ref[j];
+            }
+            double relative = std::sqrt(errorSq / std::max(refSq, 1e-12));
+            ALOGI("[calibration] %s output %zu: relative rms error %.4f\n", names[method], i, relative);
+            ok = relative < 0.1;
+        }
+        ALOGI("[calibration] %s: calibrate %.3f ms, %d nodes quantized, %s\n", names[method], ms, rewritten,
+              ok ? "ok" : "FAILED");
+    }
+}
+
+// conv -> half pixel ResizeBilinearV2 -> conv, the upsampling head of BenchMemoryPlan at a smaller size.
+void BuildMixedGraph(host_graph::Graph& graph, const vector<int64_t>& dims) {
+    auto x = graph.AddData("data", ge::TensorDesc(ge::Shape(dims), ge::FORMAT_NCHW, ge::DT_FLOAT));
+    x = AddConv(graph, "conv1", x, dims[1], dims[1], 3);
+    vector<int32_t> size{static_cast<int32_t>(dims[2] * 2), static_cast<int32_t>(dims[3] * 2)};
+    auto sizeConst = graph.AddConst("size", ge::TensorDesc(ge::Shape({2}), ge::FORMAT_NCHW, ge::DT_INT32),
+                                    size.data(), size.size() * sizeof(int32_t));
+    x = graph.AddNode(hiai::op::ResizeBilinearV2("resize"), "ResizeBilinearV2").Input("x", x)
+        .Input("size", sizeConst).Attr("half_pixel_centers", true).Output();
+    x = AddConv(graph, "conv2", x, dims[1], 3, 1);
+    graph.SetOutputs({x});
+}
+
+// Runs the mixed graph through PartitionedGraph as NPU / CPU / NPU, the split of a ROM without half pixel
+// resize, and entirely on the CPU, and compares both with the host kernels running the graph directly. The NPU
+// split needs a device with an NPU and is skipped when its subgraphs can not be built.
+void BenchPartition(int repeats) {
+    const vector<int64_t> dims{1, 16, 64, 64};
+    host_graph::HostTensor input(dims, ge::DT_FLOAT);
+    vector<float> values = RandomData(input.GetElementNum(), -1.0f, 1.0f, 9);
+    std::copy(values.begin(), values.end(), input.Data<float>());
+    host_graph::Graph reference("mixed");
+    BuildMixedGraph(reference, dims);
+    vector<host_graph::HostTensor> expected = RunHostGraph(reference, {input});
+
+    graph_partition::CapabilityTable npuCpuNpu;
+    npuCpuNpu.Unsupported("ResizeBilinearV2");
+    graph_partition::CapabilityTable cpuOnly;
+    cpuOnly.Unsupported("Convolution").Unsupported("Activation").Unsupported("ResizeBilinearV2");
+    const pair<const char*, graph_partition::CapabilityTable> splits[] = {{"npu_cpu_npu", npuCpuNpu},
+                                                                           {"cpu_only", cpuOnly}};
+    for (const auto& split : splits) {
+        // partitioning rewires the graph, every split starts from a fresh one
+        host_graph::Graph graph("mixed");
+        BuildMixedGraph(graph, dims);
+        graph_partition::PartitionedGraph model(graph, GetBuiltinKernels());
+        if (!model.Partition(split.second, graph_partition::GetRomVersion()) ||
+            !model.Build(string("/data/local/tmp/output/bench_partition_") + split.first)) {
+            ALOGI("[partition] %s: partition or build failed, skipped\n", split.first);
+            continue;
+        }
+        vector<host_graph::HostTensor> outputs;
+        bool ok = true;
+        double ms = TimeIt(repeats, [&]() {
+            ok = model.Run({input}, outputs) && ok;
+        });
+        double maxDiff = 0;
+        double maxRef = 0;
+        ok = ok && outputs.size() == expected.size() && expected.size() == 1 &&
+             outputs[0].GetElementNum() == expected[0].GetElementNum();
+        for (size_t i = 0; ok && i < expected[0].GetElementNum(); i++) {
+            maxDiff = std::max(maxDiff, static_cast<double>(std::fabs(outputs[0].Data<float>()[i] -
+                                                                          expected[0].Data<float>()[i])));
+            maxRef = std::max(maxRef, static_cast<double>(std::fabs(expected[0].Data<float>()[i])));
+        }
+        // the NPU computes in fp16
+        ok = ok && maxDiff <= 1e-2 * std::max(maxRef, 1.0);
+        ALOGI("[partition] %s: %zu subgraphs, %.3f ms per run, %zu bytes copied at the boundary, max diff %g, %s\n",
+              split.first, model.GetSubgraphs().size(), ms, model.GetCopiedBytes(), maxDiff, ok ? "ok" : "FAILED");
+    }
+}
+
+// Plans the activations of a high resolution upsampling head around the 1x32x192x192 -> 384x384 resize.
+void BenchMemoryPlan(int repeats) {
+    host_graph::Graph graph("upsample_head");
+    auto x = graph.AddData("data", ge::TensorDesc(ge::Shape({1, 32, 192, 192}), ge::FORMAT_NCHW, ge::DT_FLOAT));
+    x = AddConv(graph, "conv1", x, 32, 32, 3);
+    x = AddConv(graph, "conv2", x, 32, 32, 3);
+    vector<int32_t> size{384, 384};
+    auto sizeConst = graph.AddConst("size", ge::TensorDesc(ge::Shape({2}), ge::FORMAT_NCHW, ge::DT_INT32),
+                                    size.data(), size.size() * sizeof(int32_t));
+    x = graph.AddNode(hiai::op::ResizeBilinearV2("resize"), "ResizeBilinearV2").Input("x", x)
+        .Input("size", sizeConst).Attr("half_pixel_centers", true).Output();
+    x = AddConv(graph, "conv3", x, 32, 16, 3);
+    x = AddConv(graph, "conv4", x, 16, 16, 3);
+    x = AddConv(graph, "conv5", x, 16, 3, 1);
+    graph.SetOutputs({x});
+
+    double inferMs = TimeIt(repeats, [&]() {
+        shape_inference::InferShapes(graph, shape_inference::GetBuiltinInferFuncs());
+    });
+    memory_planner::MemoryPlan plan;
+    double planMs = TimeIt(repeats, [&]() {
+        memory_planner::PlanMemory(graph, memory_planner::PlanOptions(), plan);
+    });
+    ALOGI("[memory_plan] shape inference %.3f ms, planning %.3f ms\n", inferMs, planMs);
+    memory_planner::PrintPlan(plan);
+}
+
+// A 2000 node conv/relu chain, the size of graph whose construction the irpb cache is meant to skip.
+bool BuildDeepGraph(ge::Graph& graph) {
+    host_graph::Graph hostGraph("deep");
+    auto x = hostGraph.AddData("data", ge::TensorDesc(ge::Shape({1, 16, 32, 32}), ge::FORMAT_NCHW, ge::DT_FLOAT));
+    for (int i = 0; i < 1000; i++) {
+        x = AddConv(hostGraph, "conv" + to_string(i), x, 16, 16, 1);
+    }
+    hostGraph.SetOutputs({x});
+    return hostGraph.ToGeGraph(graph);
+}
+
+// Output comparison of a 64x512x512 tensor (64 MB), against a scalar loop accumulating in double.
+void BenchAccuracyCheck(int repeats) {
+    vector<int64_t> dims{1, 64, 512, 512};
+    size_t num = host_graph::HostTensor::GetElementNum(dims);
+    vector<float> ref = RandomData(num, -4.0f, 4.0f, 6);
+    vector<float> out = RandomData(num, -1e-3f, 1e-3f, 7);
+    for (size_t i = 0; i < num; i++) {
+        out[i] += ref[i];
+    }
+    accuracy_check::Tolerance tolerance = accuracy_check::GetTolerance(ge::DT_FLOAT16);
+    double cosine = 0;
+    double naive = TimeIt(repeats, [&]() {
+        double dot = 0;
+        double refSq = 0;
+        double outSq = 0;
+        size_t mismatchNum = 0;
+        for (size_t i = 0; i < num; i++) {
+            double diff = std::fabs(out[i] - ref[i]);
+            mismatchNum += diff > tolerance.absTol + tolerance.relTol * std::fabs(ref[i]) ? 1 : 0;
+            dot += static_cast<double>(ref[i]) * out[i];
+            refSq += static_cast<double>(ref[i]) * ref[i];
+            outSq += static_cast<double>(out[i]) * out[i];
+        }
+        cosine = mismatchNum == 0 ? dot / std::sqrt(refSq * outSq) : 0;
+    });
+    accuracy_check::Report report;
+    double ms = TimeIt(repeats, [&]() {
+        accuracy_check::Checker checker("bench", dims, tolerance);
+        checker.Feed(ref.data(), out.data(), num);
+        checker.Finish(report);
+    });
+    double gb = 2.0 * num * sizeof(float) / 1e9;
+    ALOGI("[accuracy_check] %zu elements: naive %.3f ms (%.2f GB/s), checker %.3f ms (%.2f GB/s), cosine %.7f / %.7f\n",
+          num, naive, gb / naive * 1000, ms, gb / ms * 1000, cosine, report.total.GetCosine());
+    accuracy_check::PrintReport(report, 1);
+}
+
+void GemmNaive(int64_t batch, int64_t m, int64_t n, int64_t k, const float* a, bool transA, const float* b,
+               bool transB, float* c) {
+    for (int64_t bi = 0; bi < batch; bi++) {
+        for (int64_t i = 0; i < m; i++) {
+            for (int64_t j = 0; j < n; j++) {
+                float sum = 0;
+                for (int64_t p = 0; p < k; p++) {
+                    sum += a[bi * m * k + (transA ? p * m + i : i * k + p)] *
+                           b[bi * k * n + (transB ? j * k + p : p * n + j)];
+                }
+                c[(bi * m + i) * n + j] = sum;
+            }
+        }
+    }
+}
+
+// GFLOP/s of host_kernel::Gemm against a naive triple loop: a square product, a transformer FC layer
+// (weights [N, K] as FullyConnection stores them) and the per-head attention scores.
+void BenchGemm(int repeats) {
+    struct Shape {
+        const char* name;
+        int64_t batch, m, n, k;
+        bool transA, transB;
+    };
+    Shape shapes[] = {
+        {"square", 1, 512, 512, 512, false, false},
+        {"fc", 1, 128, 3072, 768, false, true},
+        {"attention", 12, 128, 128, 64, false, true},
+    };
+    for (const Shape& s : shapes) {
+        vector<float> a = RandomData(s.batch * s.m * s.k, -1.0f, 1.0f, 1);
+        vector<float> b = RandomData(s.batch * s.k * s.n, -1.0f, 1.0f, 2);
+        vector<float> c(s.batch * s.m * s.n);
+        vector<float> ref(c.size());
+        double naiveMs = TimeIt(1, [&]() {
+            GemmNaive(s.batch, s.m, s.n, s.k, a.data(), s.transA, b.data(), s.transB, ref.data());
+        });
+        double oneMs = TimeIt(repeats, [&]() {
+            host_kernel::Gemm(s.batch, s.m, s.n, s.k, a.data(), s.transA, b.data(), s.transB, nullptr, c.data(), 1);
+        });
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::Gemm(s.batch, s.m, s.n, s.k, a.data(), s.transA, b.data(), s.transB, nullptr, c.data());
+        });
+        double maxDiff = 0;
+        for (size_t i = 0; i < c.size(); i++) {
+            maxDiff = std::max(maxDiff, static_cast<double>(std::fabs(c[i] - ref[i])));
+        }
+        double gflop = 2.0 * s.batch * s.m * s.n * s.k / 1e9;
+        ALOGI("[gemm] %s %lldx%lldx%lldx%lld: naive %.1f GFLOP/s, 1 thread %.1f GFLOP/s, %d threads %.1f GFLOP/s "
+              "(%.1fx), max diff %g\n", s.name, static_cast<long long>(s.batch), static_cast<long long>(s.m),
+              static_cast<long long>(s.n), static_cast<long long>(s.k), gflop / naiveMs * 1000,
+              gflop / oneMs * 1000, parallel_util::GetThreadNum(), gflop / ms * 1000, naiveMs / ms, maxDiff);
+    }
+}
+
+// Typical layers through host_kernel::Convolve against the direct kernel, in effective GFLOP/s.
+void BenchConv(int repeats) {
+    struct Layer {
+        const char* name;
+        int64_t c, h, w, co, k, stride, groups;
+    };
+    Layer layers[] = {
+        {"conv3x3", 64, 56, 56, 64, 3, 1, 1},
+        {"conv3x3_s2", 64, 56, 56, 128, 3, 2, 1},
+        {"conv1x1", 128, 28, 28, 256, 1, 1, 1},
+        {"depthwise3x3", 128, 56, 56, 128, 3, 1, 128},
+    };
+    for (const Layer& l : layers) {
+        host_kernel::ConvShape s;
+        s.c = l.c;
+        s.h = l.h;
+        s.w = l.w;
+        s.co = l.co;
+        s.kh = l.k;
+        s.kw = l.k;
+        host_kernel::ConvParam param;
+        param.strideH = param.strideW = l.stride;
+        param.padTop = param.padBottom = param.padLeft = param.padRight = l.k / 2;
+        param.groups = l.groups;
+        s.oh = host_kernel::ConvOutSize(s.h, s.kh, param.strideH, 1, param.padTop, param.padBottom);
+        s.ow = host_kernel::ConvOutSize(s.w, s.kw, param.strideW, 1, param.padLeft, param.padRight);
+        vector<float> x = RandomData(s.c * s.h * s.w, -1.0f, 1.0f, 1);
+        vector<float> filter = RandomData(s.co * s.c / l.groups * s.kh * s.kw, -1.0f, 1.0f, 2);
+        vector<float> bias = RandomData(s.co, -1.0f, 1.0f, 3);
+        vector<float> y(s.co * s.oh * s.ow);
+        vector<float> ref(y.size());
+        double directMs = TimeIt(repeats, [&]() {
+            host_kernel::Conv2D(x.data(), 1, s.c, s.h, s.w, filter.data(), s.co, s.kh, s.kw, bias.data(), param,
+                                ref.data(), s.oh, s.ow);
+        });
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::Convolve(l.name, x.data(), s, filter.data(), true, bias.data(), param, y.data());
+        });
+        double maxDiff = 0;
+        for (size_t i = 0; i < y.size(); i++) {
+            maxDiff = std::max(maxDiff, static_cast<double>(std::fabs(y[i] - ref[i])));
+        }
+        double gflop = 2.0 * s.co * s.oh * s.ow * s.c / l.groups * s.kh * s.kw / 1e9;
+        ALOGI("[conv] %s: direct %.3f ms (%.1f GFLOP/s), %s %.3f ms (%.1f GFLOP/s, %.1fx), max diff %g\n", l.name,
+              directMs, gflop / directMs * 1000, host_kernel::GetConvReport()[l.name].c_str(), ms,
+              gflop / ms * 1000, directMs / ms, maxDiff);
+    }
+}
+
+// Every input pixel scattered over the zero-stuffed output, the textbook definition of ConvTranspose.
+void ConvTransposeNaive(const float* x, const host_kernel::ConvShape& s, const float* filter, const float* bias,
+                        const host_kernel::ConvParam& p, float* y) {
+    for (int64_t oc = 0; oc < s.co; oc++) {
+        std::fill_n(y + oc * s.oh * s.ow, s.oh * s.ow, bias != nullptr ? bias[oc] : 0.0f);
+    }
+    for (int64_t ic = 0; ic < s.c; ic++) {
+        for (int64_t iy = 0; iy < s.h; iy++) {
+            for (int64_t ix = 0; ix < s.w; ix++) {
+                float v = x[(ic * s.h + iy) * s.w + ix];
+                for (int64_t oc = 0; oc < s.co; oc++) {
+                    for (int64_t ky = 0; ky < s.kh; ky++) {
+                        int64_t oy = iy * p.strideH - p.padTop + ky * p.dilationH;
+                        for (int64_t kx = 0; kx < s.kw; kx++) {
+                            int64_t ox = ix * p.strideW - p.padLeft + kx * p.dilationW;
+                            if (oy >= 0 && oy < s.oh && ox >= 0 && ox < s.ow) {
+                                float weight = filter[((ic * s.co + oc) * s.kh + ky) * s.kw + kx];
+                                y[(oc * s.oh + oy) * s.ow + ox] += v * weight;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Stride-2 upsampling layers: the 4x4 SAME one of BuildConvTransposeGraph (1x8x864x480) and a 3x3 decoder stage.
+void BenchConvTranspose(int repeats) {
+    struct Layer {
+        const char* name;
+        int64_t c, h, w, co, k, pad;
+    };
+    Layer layers[] = {
+        {"deconv4x4_s2", 8, 864, 480, 8, 4, 1},
+        {"deconv3x3_s2", 64, 64, 64, 32, 3, 1},
+    };
+    for (const Layer& l : layers) {
+        host_kernel::ConvShape s;
+        s.c = l.c;
+        s.h = l.h;
+        s.w = l.w;
+        s.co = l.co;
+        s.kh = l.k;
+        s.kw = l.k;
+        host_kernel::ConvParam param;
+        param.strideH = param.strideW = 2;
+        param.padTop = param.padBottom = param.padLeft = param.padRight = l.pad;
+        s.oh = (s.h - 1) * 2 - 2 * l.pad + l.k;
+        s.ow = (s.w - 1) * 2 - 2 * l.pad + l.k;
+        vector<float> x = RandomData(s.c * s.h * s.w, -1.0f, 1.0f, 1);
+        vector<float> filter = RandomData(s.c * s.co * s.kh * s.kw, -1.0f, 1.0f, 2);
+        vector<float> bias = RandomData(s.co, -1.0f, 1.0f, 3);
+        vector<float> y(s.co * s.oh * s.ow);
+        vector<float> ref(y.size());
+        double naiveMs = TimeIt(1, [&]() {
+            ConvTransposeNaive(x.data(), s, filter.data(), bias.data(), param, ref.data());
+        });
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::ConvolveTranspose(l.name, x.data(), s, filter.data(), true, bias.data(), param, y.data());
+        });
+        double maxDiff = 0;
+        for (size_t i = 0; i < y.size(); i++) {
+            maxDiff = std::max(maxDiff, static_cast<double>(std::fabs(y[i] - ref[i])));
+        }
+        ALOGI("[conv_transpose] %s: scatter %.3f ms, sub-pixel %.3f ms (%.1fx), max diff %g\n", l.name, naiveMs, ms,
+              naiveMs / ms, maxDiff);
+    }
+}
+
+// Per-pixel bilinear resize as written in TF's resize_bilinear_op.cc: four taps and two weights per output.
+void ResizeBilinearNaive(const float* x, int64_t planes, int64_t h, int64_t w, bool halfPixel, float* y, int64_t oh,
+                         int64_t ow) {
+    float scaleH = static_cast<float>(h) / oh;
+    float scaleW = static_cast<float>(w) / ow;
+    for (int64_t p = 0; p < planes; p++) {
+        const float* in = x + p * h * w;
+        for (int64_t oy = 0; oy < oh; oy++) {
+            float fy = halfPixel ? (oy + 0.5f) * scaleH - 0.5f : oy * scaleH;
+            int64_t y0 = std::max<int64_t>(static_cast<int64_t>(std::floor(fy)), 0);
+            int64_t y1 = std::min<int64_t>(static_cast<int64_t>(std::ceil(fy)), h - 1);
+            float yLerp = fy - std::floor(fy);
+            for (int64_t ox = 0; ox < ow; ox++) {
+                float fx = halfPixel ? (ox + 0.5f) * scaleW - 0.5f : ox * scaleW;
+                int64_t x0 = std::max<int64_t>(static_cast<int64_t>(std::floor(fx)), 0);
+                int64_t x1 = std::min<int64_t>(static_cast<int64_t>(std::ceil(fx)), w - 1);
+                float xLerp = fx - std::floor(fx);
+                float top = in[y0 * w + x0] + (in[y0 * w + x1] - in[y0 * w + x0]) * xLerp;
+                float bottom = in[y1 * w + x0] + (in[y1 * w + x1] - in[y1 * w + x0]) * xLerp;
+                y[(p * oh + oy) * ow + ox] = top + (bottom - top) * yLerp;
+            }
+        }
+    }
+}
+
+// The 1x32x192x192 -> 384x384 upsampling of BenchMemoryPlan, and a 2x downscale, against the per-pixel formula.
+void BenchResize(int repeats) {
+    struct Case {
+        const char* name;
+        int64_t c, h, w, oh, ow;
+        bool halfPixel;
+    };
+    Case cases[] = {
+        {"upsample_half_pixel", 32, 192, 192, 384, 384, true},
+        {"upsample_legacy", 32, 192, 192, 384, 384, false},
+        {"downsample_half_pixel", 3, 1080, 1920, 540, 960, true},
+    };
+    for (const Case& c : cases) {
+        vector<float> x = RandomData(c.c * c.h * c.w, -1.0f, 1.0f, 1);
+        vector<float> y(c.c * c.oh * c.ow);
+        vector<float> ref(y.size());
+        double naiveMs = TimeIt(repeats, [&]() {
+            ResizeBilinearNaive(x.data(), c.c, c.h, c.w, c.halfPixel, ref.data(), c.oh, c.ow);
+        });
+        host_kernel::ResizeMode mode =
+            c.halfPixel ? host_kernel::ResizeMode::BILINEAR_HALF_PIXEL : host_kernel::ResizeMode::BILINEAR;
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::Resize(x.data(), c.c, c.h, c.w, mode, y.data(), c.oh, c.ow);
+        });
+        // the same formula, only fused multiply-adds the compiler forms differently may move the last bit
+        size_t mismatches = 0;
+        for (size_t i = 0; i < y.size(); i++) {
+            mismatches += std::fabs(y[i] - ref[i]) > 1e-6f ? 1 : 0;
+        }
+        ALOGI("[resize] %s: per-pixel %.3f ms, separable %.3f ms (%.1fx), %zu of %zu values differ, %s\n", c.name,
+              naiveMs, ms, naiveMs / ms, mismatches, y.size(), mismatches == 0 ? "ok" : "FAILED");
+    }
+}
+
+// Unfused LSTM step by step: a [4H, X + H] product with [x_t, h_{t-1}] per time step, then the gates.
+void LstmNaive(const float* x, int64_t t, int64_t xSize, int64_t hidden, const float* wx, const float* bias,
+               const float* wh, float* y) {
+    vector<float> h(hidden, 0.0f);
+    vector<float> c(hidden, 0.0f);
+    vector<float> gates(4 * hidden);
+    auto sigmoid = [](float v) { return 1.0f / (1.0f + std::exp(-v)); };
+    for (int64_t step = 0; step < t; step++) {
+        for (int64_t g = 0; g < 4 * hidden; g++) {
+            float sum = bias[g];
+            for (int64_t i = 0; i < xSize; i++) {
+                sum += wx[g * xSize + i] * x[step * xSize + i];
+            }
+            for (int64_t i = 0; i < hidden; i++) {
+                sum += wh[g * hidden + i] * h[i];
+            }
+            gates[g] = sum;
+        }
+        for (int64_t j = 0; j < hidden; j++) {
+            c[j] = sigmoid(gates[hidden + j]) * c[j] + sigmoid(gates[j]) * std::tanh(gates[3 * hidden + j]);
+            h[j] = sigmoid(gates[2 * hidden + j]) * std::tanh(c[j]);
+        }
+        std::copy(h.begin(), h.end(), y + step * hidden);
+    }
+}
+
+// A 2 s utterance of 80-dim features at 100 frames/s through a 256-unit LSTM, whole and as 10-frame chunks
+// with streaming state.
+void BenchLstm(int repeats) {
+    const int64_t t = 200;
+    const int64_t xSize = 80;
+    const int64_t hidden = 256;
+    vector<float> x = RandomData(t * xSize, -1.0f, 1.0f, 1);
+    vector<float> wx = RandomData(4 * hidden * xSize, -0.1f, 0.1f, 2);
+    vector<float> wh = RandomData(4 * hidden * hidden, -0.1f, 0.1f, 3);
+    vector<float> bias = RandomData(4 * hidden, -0.1f, 0.1f, 4);
+    vector<float> ref(t * hidden);
+    vector<float> y(ref.size());
+    vector<float> hT(hidden);
+    vector<float> cT(hidden);
+    double naiveMs = TimeIt(repeats, [&]() {
+        LstmNaive(x.data(), t, xSize, hidden, wx.data(), bias.data(), wh.data(), ref.data());
+    });
+    host_kernel::LstmArgs args;
+    args.b = 1;
+    args.x = xSize;
+    args.hidden = hidden;
+    args.wx = wx.data();
+    args.bias = bias.data();
+    args.wh = wh.data();
+    args.t = t;
+    args.input = x.data();
+    double fusedMs = TimeIt(repeats, [&]() {
+        host_kernel::Lstm("bench_lstm", args, y.data(), hT.data(), cT.data());
+    });
+    double maxDiff = 0;
+    for (size_t i = 0; i < y.size(); i++) {
+        maxDiff = std::max(maxDiff, static_cast<double>(std::fabs(y[i] - ref[i])));
+    }
+    const int64_t chunk = 10;
+    host_kernel::GetLstmOptions().streaming = true;
+    double streamMs = TimeIt(repeats, [&]() {
+        host_kernel::ResetLstmStates();
+        for (int64_t step = 0; step < t; step += chunk) {
+            args.t = chunk;
+            args.input = x.data() + step * xSize;
+            host_kernel::Lstm("bench_lstm_stream", args, y.data() + step * hidden, hT.data(), cT.data());
+        }
+    });
+    host_kernel::GetLstmOptions().streaming = false;
+    double streamDiff = 0;
+    for (size_t i = 0; i < y.size(); i++) {
+        streamDiff = std::max(streamDiff, static_cast<double>(std::fabs(y[i] - ref[i])));
+    }
+    ALOGI("[lstm] T=%lld H=%lld: step by step %.3f ms, fused %.3f ms (%.1fx, max diff %g), %lld-frame stream "
+          "%.3f ms (max diff %g)\n", static_cast<long long>(t), static_cast<long long>(hidden), naiveMs, fusedMs,
+          naiveMs / fusedMs, maxDiff, static_cast<long long>(chunk), streamMs, streamDiff);
+}
+
+shared_ptr<hiai::AiTensor> CreateAiTensor(uint32_t n, uint32_t c, uint32_t h, uint32_t w) {
+    hiai::TensorDimension dims(n, c, h, w);
+    auto tensor = make_shared<hiai::AiTensor>();
+    tensor->Init(&dims);
+    return tensor;
+}
+
+// Drives a StatefulSession with a fake streaming model over 20 hops and checks every output against a plain
+// recurrence: state_out = 0.5 * state_in + x is carried by swap (same dims), acc_out = acc_in + x[0] by copy
+// (same size, other dims). Rolling back to a snapshot and replaying must give identical outputs, and Reset()
+// must start over from zero. The timing is per run with one swapped and one copied 64 KB state.
+void BenchStatefulSession(int repeats) {
+    const uint32_t width = 16;
+    auto process = [](stateful_session::VecAiTensor& inputs, stateful_session::VecAiTensor& outputs) {
+        const float* x = static_cast<const float*>(inputs[0]->GetBuffer());
+        const float* state = static_cast<const float*>(inputs[1]->GetBuffer());
+        const float* acc = static_cast<const float*>(inputs[2]->GetBuffer());
+        float* y = static_cast<float*>(outputs[0]->GetBuffer());
+        float* stateOut = static_cast<float*>(outputs[1]->GetBuffer());
+        float* accOut = static_cast<float*>(outputs[2]->GetBuffer());
+        size_t num = inputs[1]->GetSize() / sizeof(float);
+        for (size_t i = 0; i < num; i++) {
+            stateOut[i] = 0.5f * state[i] + x[i % width];
+            accOut[i] = acc[i] + x[0];
+            y[i] = stateOut[i] + accOut[i];
+        }
+        return true;
+    };
+    auto createSession = [&](uint32_t channels) {
+        stateful_session::VecAiTensor inputs{CreateAiTensor(1, width, 1, 1), CreateAiTensor(1, channels, 1, 1),
+                                             CreateAiTensor(1, channels, 1, 1)};
+        stateful_session::VecAiTensor outputs{CreateAiTensor(1, channels, 1, 1), CreateAiTensor(1, channels, 1, 1),
+                                              CreateAiTensor(1, 1, channels, 1)};
+        stateful_session::StatefulSession session(process, inputs, outputs);
+        session.Bind(1, 1, "state");
+        session.Bind(2, 2, "acc");
+        return session;
+    };
+    auto feed = [&](stateful_session::StatefulSession& session, int hop) {
+        float* x = static_cast<float*>(session.GetInputs()[0]->GetBuffer());
+        for (uint32_t i = 0; i < width; i++) {
+            x[i] = static_cast<float>((hop * 7 + i) % 11) - 5.0f;
+        }
+    };
+    auto output = [](stateful_session::StatefulSession& session) {
+        const auto& y = session.GetOutputs()[0];
+        const float* data = static_cast<const float*>(y->GetBuffer());
+        return vector<float>(data, data + y->GetSize() / sizeof(float));
+    };
+
+    const uint32_t channels = 64;
+    const int hops = 20;
+    stateful_session::StatefulSession session = createSession(channels);
+    vector<float> state(channels, 0.0f);
+    vector<float> acc(channels, 0.0f);
+    vector<vector<float>> outputs;
+    bool carried = true;
+    for (int hop = 0; hop < hops; hop++) {
+        feed(session, hop);
+        const float* x = static_cast<const float*>(session.GetInputs()[0]->GetBuffer());
+        carried = session.Run() && carried;
+        outputs.push_back(output(session));
+        for (uint32_t i = 0; i < channels; i++) {
+            state[i] = 0.5f * state[i] + x[i % width];
+            acc[i] += x[0];
+            carried = carried && outputs.back()[i] == state[i] + acc[i];
+        }
+    }
+    stateful_session::SessionStat stat = session.GetStat();
+    carried = carried && stat.runs == hops && stat.swaps == hops && stat.copies == hops;
+
+    // roll back to the state after hop 9 and replay hops 10..19
+    session.Reset();
+    bool restored = true;
+    stateful_session::StateSnapshot snapshot;
+    for (int hop = 0; hop < hops; hop++) {
+        if (hop == hops / 2) {
+            snapshot = session.Snapshot();
+        }
+        feed(session, hop);
+        restored = session.Run() && output(session) == outputs[hop] && restored;
+    }
+    restored = session.Restore(snapshot) && restored;
+    for (int hop = hops / 2; hop < hops; hop++) {
+        feed(session, hop);
+        restored = session.Run() && output(session) == outputs[hop] && restored;
+    }
+    ALOGI("[stateful_session] state carried %s, reset + snapshot / restore %s\n", carried ? "ok" : "FAILED",
+          restored ? "ok" : "FAILED");
+
+    // one swapped and one copied 64 KB state per run
+    stateful_session::StatefulSession large = createSession(16384);
+    feed(large, 0);
+    double ms = TimeIt(repeats, [&]() {
+        for (int hop = 0; hop < 100; hop++) {
+            large.Run();
+        }
+    });
+    stat = large.GetStat();
+    ALOGI("[stateful_session] %.3f us per run, %llu swaps, %llu copies (%.1f MB)\n", ms * 10,
+          static_cast<unsigned long long>(stat.swaps), static_cast<unsigned long long>(stat.copies),
+          stat.bytesCopied / 1048576.0);
+}
+
+// Softmax / LayerNorm over contiguous rows the way the multi-pass loops did it: max, exp, sum and divide, or
+// mean, variance and normalize, one scalar pass each.
+void SoftmaxNaive(const float* x, int64_t rows, int64_t size, float* y) {
+    for (int64_t r = 0; r < rows; r++) {
+        const float* in = x + r * size;
+        float* out = y + r * size;
+        float max = *std::max_element(in, in + size);
+        for (int64_t i = 0; i < size; i++) {
+            out[i] = std::exp(in[i] - max);
+        }
+        float sum = 0.0f;
+        for (int64_t i = 0; i < size; i++) {
+            sum += out[i];
+        }
+        for (int64_t i = 0; i < size; i++) {
+            out[i] /= sum;
+        }
+    }
+}
+
+void LayerNormNaive(const float* x, int64_t rows, int64_t size, const float* gamma, const float* beta, float* y) {
+    for (int64_t r = 0; r < rows; r++) {
+        const float* in = x + r * size;
+        float mean = 0.0f;
+        for (int64_t i = 0; i < size; i++) {
+            mean += in[i];
+        }
+        mean /= size;
+        float variance = 0.0f;
+        for (int64_t i = 0; i < size; i++) {
+            variance += (in[i] - mean) * (in[i] - mean);
+        }
+        variance /= size;
+        for (int64_t i = 0; i < size; i++) {
+            y[r * size + i] = (in[i] - mean) / std::sqrt(variance + 1e-5f) * gamma[i] + beta[i];
+        }
+    }
+}
+
+// 1M values as rows of 128 to 32k, then the per-pixel softmax over the 21 classes of a 1x21x128x128 segmentation
+// output (strided axis).
+void BenchNormalization(int repeats) {
+    const int64_t total = 1 << 20;
+    vector<float> x = RandomData(total, -8.0f, 8.0f, 1);
+    vector<float> gamma = RandomData(1 << 15, 0.5f, 1.5f, 2);
+    vector<float> beta = RandomData(1 << 15, -0.5f, 0.5f, 3);
+    vector<float> ref(total);
+    vector<float> y(total);
+    auto maxDiff = [&]() {
+        double diff = 0;
+        for (int64_t i = 0; i < total; i++) {
+            diff = std::max(diff, static_cast<double>(std::fabs(y[i] - ref[i])));
+        }
+        return diff;
+    };
+    for (int64_t size : {128, 1024, 4096, 32768}) {
+        int64_t rows = total / size;
+        double naiveMs = TimeIt(repeats, [&]() { SoftmaxNaive(x.data(), rows, size, ref.data()); });
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::Softmax(x.data(), rows, size, 1, host_kernel::SoftmaxMode::SOFTMAX, y.data());
+        });
+        double logMs = TimeIt(repeats, [&]() {
+            host_kernel::Softmax(x.data(), rows, size, 1, host_kernel::SoftmaxMode::LOG_SOFTMAX, y.data());
+        });
+        ALOGI("[normalization] softmax %lldx%lld: multi-pass %.3f ms, fused %.3f ms (%.1fx), log softmax %.3f ms\n",
+              static_cast<long long>(rows), static_cast<long long>(size), naiveMs, ms, naiveMs / ms, logMs);
+        host_kernel::Softmax(x.data(), rows, size, 1, host_kernel::SoftmaxMode::SOFTMAX, y.data());
+        double softmaxDiff = maxDiff();
+        naiveMs = TimeIt(repeats, [&]() {
+            LayerNormNaive(x.data(), rows, size, gamma.data(), beta.data(), ref.data());
+        });
+        ms = TimeIt(repeats, [&]() {
+            host_kernel::LayerNorm(x.data(), rows, size, gamma.data(), beta.data(), size, 1e-5f, y.data(), nullptr,
+                                   nullptr);
+        });
+        double l2Ms = TimeIt(repeats, [&]() {
+            host_kernel::L2Normalize(x.data(), rows, size, 1, 1e-4f, y.data());
+        });
+        host_kernel::LayerNorm(x.data(), rows, size, gamma.data(), beta.data(), size, 1e-5f, y.data(), nullptr,
+                               nullptr);
+        ALOGI("[normalization] layer norm %lldx%lld: multi-pass %.3f ms, fused %.3f ms (%.1fx), l2 normalize %.3f ms, "
+              "max diff softmax %g layer norm %g\n", static_cast<long long>(rows), static_cast<long long>(size),
+              naiveMs, ms, naiveMs / ms, l2Ms, softmaxDiff, maxDiff());
+    }
+    const int64_t classes = 21;
+    const int64_t pixels = 128 * 128;
+    double naiveMs = TimeIt(repeats, [&]() {
+        vector<float> column(classes);
+        for (int64_t p = 0; p < pixels; p++) {
+            for (int64_t k = 0; k < classes; k++) {
+                column[k] = x[k * pixels + p];
+            }
+            SoftmaxNaive(column.data(), 1, classes, column.data());
+            for (int64_t k = 0; k < classes; k++) {
+                ref[k * pixels + p] = column[k];
+            }
+        }
+    });
+    double ms = TimeIt(repeats, [&]() {
+        host_kernel::Softmax(x.data(), 1, classes, pixels, host_kernel::SoftmaxMode::SOFTMAX, y.data());
+    });
+    double diff = 0;
+    for (int64_t i = 0; i < classes * pixels; i++) {
+        diff = std::max(diff, static_cast<double>(std::fabs(y[i] - ref[i])));
+    }
+    ALOGI("[normalization] channel softmax 1x%lldx128x128: per-pixel %.3f ms, column tiles %.3f ms (%.1fx, max diff "
+          "%g)\n", static_cast<long long>(classes), naiveMs, ms, naiveMs / ms, diff);
+}
+
+// Per-element conversion through the logical (n, c, h, w) index, what the per-frame CPU transposes did.
+void ConvertNaive(const float* x, ge::Format from, float* y, ge::Format to, const layout_util::Shape4& s) {
+    auto offset = [&s](ge::Format format, int64_t n, int64_t c, int64_t h, int64_t w) {
+        int64_t c0 = layout_util::GetC0(format);
+        if (c0 > 1) {
+            return (((n * ((s.c + c0 - 1) / c0) + c / c0) * s.h + h) * s.w + w) * c0 + c % c0;
+        }
+        return format == ge::FORMAT_NHWC ? ((n * s.h + h) * s.w + w) * s.c + c : ((n * s.c + c) * s.h + h) * s.w + w;
+    };
+    std::fill_n(y, layout_util::GetElementNum(to, s), 0.0f);
+    for (int64_t n = 0; n < s.n; n++) {
+        for (int64_t c = 0; c < s.c; c++) {
+            for (int64_t h = 0; h < s.h; h++) {
+                for (int64_t w = 0; w < s.w; w++) {
+                    y[offset(to, n, c, h, w)] = x[offset(from, n, c, h, w)];
+                }
+            }
+        }
+    }
+}
+
+// A 1080p NHWC camera frame into an NCHW input, and NCHW activations into the blocked formats.
+void BenchLayout(int repeats) {
+    struct Case {
+        const char* name;
+        ge::Format from;
+        ge::Format to;
+        int64_t c, h, w;
+    };
+    Case cases[] = {
+        {"camera_nhwc_to_nchw", ge::FORMAT_NHWC, ge::FORMAT_NCHW, 3, 1080, 1920},
+        {"nchw_to_nhwc", ge::FORMAT_NCHW, ge::FORMAT_NHWC, 64, 112, 112},
+        {"nchw_to_nc4hw4", ge::FORMAT_NCHW, ge::FORMAT_NC4HW4, 64, 112, 112},
+        {"nc1hwc0_to_nchw", ge::FORMAT_NC1HWC0, ge::FORMAT_NCHW, 24, 112, 112},
+        {"nhwc_to_nc8hw8", ge::FORMAT_NHWC, ge::FORMAT_NC8HW8, 3, 1080, 1920},
+    };
+    for (const Case& c : cases) {
+        layout_util::Shape4 shape;
+        shape.c = c.c;
+        shape.h = c.h;
+        shape.w = c.w;
+        vector<float> x = RandomData(layout_util::GetElementNum(c.from, shape), -1.0f, 1.0f, 1);
+        vector<float> ref(layout_util::GetElementNum(c.to, shape));
+        vector<float> y(ref.size());
+        double naiveMs = TimeIt(repeats, [&]() { ConvertNaive(x.data(), c.from, ref.data(), c.to, shape); });
+        double ms = TimeIt(repeats, [&]() { layout_util::Convert(x.data(), c.from, y.data(), c.to, shape); });
+        ALOGI("[layout] %s: per-element %.3f ms, blocked %.3f ms (%.1fx), %s\n", c.name, naiveMs, ms, naiveMs / ms,
+              y == ref ? "identical" : "MISMATCH");
+    }
+}
+
+// Top k through an index array and std::partial_sort, how the classification demos pick their labels.
+void TopKNaive(const float* x, int64_t rows, int64_t num, int64_t k, float* values, int32_t* indices) {
+    vector<int32_t> order(num);
+    for (int64_t r = 0; r < rows; r++) {
+        const float* row = x + r * num;
+        for (int64_t i = 0; i < num; i++) {
+            order[i] = static_cast<int32_t>(i);
+        }
+        std::partial_sort(order.begin(), order.begin() + k, order.end(), [row](int32_t a, int32_t b) {
+            return row[a] > row[b] || (row[a] == row[b] && a < b);
+        });
+        for (int64_t i = 0; i < k; i++) {
+            values[r * k + i] = row[order[i]];
+            indices[r * k + i] = order[i];
+        }
+    }
+}
+
+// Truncating float -> half for the scores of the bench, |v| < 2^-14 flushes to zero.
+uint16_t FloatToHalf(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 112;
+    if (exponent <= 0) {
+        return static_cast<uint16_t>(sign);
+    }
+    return static_cast<uint16_t>(sign | (static_cast<uint32_t>(exponent) << 10) | ((bits >> 13) & 0x3ff));
+}
+
+// A 100k-class retrieval head (FP32 and FP16 output buffers) and a batch of 32 ImageNet-sized rows.
+void BenchTopK(int repeats) {
+    struct Case {
+        int64_t rows, num, k;
+    };
+    Case cases[] = {{1, 100000, 1}, {1, 100000, 5}, {1, 100000, 100}, {1, 1000000, 10}, {32, 1000, 5}};
+    for (const Case& c : cases) {
+        vector<float> x = RandomData(c.rows * c.num, -10.0f, 10.0f, 1);
+        vector<float> refValues(c.rows * c.k);
+        vector<int32_t> refIndices(c.rows * c.k);
+        vector<float> values(refValues.size());
+        vector<int32_t> indices(refIndices.size());
+        double naiveMs = TimeIt(repeats, [&]() {
+            TopKNaive(x.data(), c.rows, c.num, c.k, refValues.data(), refIndices.data());
+        });
+        double ms = TimeIt(repeats, [&]() {
+            host_kernel::TopK(x.data(), c.rows, c.num, c.k, true, values.data(), indices.data());
+        });
+        bool same = values == refValues && indices == refIndices;
+        // the same scores as FP16, read in place
+        vector<uint16_t> half(x.size());
+        std::transform(x.begin(), x.end(), half.begin(), FloatToHalf);
+        double halfMs = TimeIt(repeats, [&]() {
+            host_kernel::TopKHalf(half.data(), c.rows, c.num, c.k, true, values.data(), indices.data());
+        });
+        ALOGI("[top_k] %lldx%lld k=%lld: partial_sort %.3f ms, filtered %.3f ms (%.1fx), fp16 %.3f ms, %s\n",
+              static_cast<long long>(c.rows), static_cast<long long>(c.num), static_cast<long long>(c.k), naiveMs, ms,
+              naiveMs / ms, halfMs, same ? "identical" : "MISMATCH");
+    }
+}
+
+// Skewed embedding ids, a few rows take most lookups as in recommendation traffic. The multiplicative hash
+// scatters the hot rows over the table.
+vector<int64_t> EmbeddingIds(size_t num, int64_t rowNum, unsigned int seed) {
+    std::default_random_engine engine(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    vector<int64_t> ids(num);
+    for (auto& id : ids) {
+        double u = uniform(engine);
+        uint64_t rank = static_cast<uint64_t>(static_cast<double>(rowNum) * u * u * u);
+        id = static_cast<int64_t>(rank * 2654435761ull % static_cast<uint64_t>(rowNum));
+    }
+    return ids;
+}
+
+// Lookups per second from a mmapped .npy table of 32 floats per row, 10^5 to 10^7 rows, in batches of 4096
+// skewed ids: a memcpy per id vs GatherRows.
+void BenchGather(int repeats) {
+    const string path = "/data/local/tmp/output/bench_embedding.npy";
+    const int64_t rowSize = 32;
+    const int64_t batch = 4096;
+    const int batches = 64;
+    for (int64_t rowNum : {100000, 1000000, 10000000}) {
+        {
+            vector<float> table = RandomData(rowNum * rowSize, -1.0f, 1.0f, 1);
+            if (!npy_io::WriteNpy<float>(path, {rowNum, rowSize}, table.data())) {
+                return;
+            }
+        }
+        npy_io::NpyArray array;
+        if (!npy_io::ReadNpy(path, array, true)) {
+            return;
+        }
+        const float* table = array.Data<float>();
+        vector<vector<int64_t>> ids;
+        size_t unique = 0;
+        for (int b = 0; b < batches; b++) {
+            ids.push_back(EmbeddingIds(batch, rowNum, b));
+            vector<int64_t> sorted = ids.back();
+            std::sort(sorted.begin(), sorted.end());
+            unique += std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+        }
+        vector<float> ref(batch * rowSize);
+        vector<float> y(ref.size());
+        double naiveMs = TimeIt(repeats, [&]() {
+            for (const auto& batchIds : ids) {
+                for (int64_t i = 0; i < batch; i++) {
+                    memcpy(&ref[i * rowSize], table + batchIds[i] * rowSize, rowSize * sizeof(float));
+                }
+            }
+        });
+        double ms = TimeIt(repeats, [&]() {
+            for (const auto& batchIds : ids) {
+                host_kernel::GatherRows(table, 1, rowNum, rowSize * sizeof(float), batchIds.data(), batch, y.data());
+            }
+        });
+        bool same = y == ref;
+        double lookups = static_cast<double>(batch) * batches;
+        ALOGI("[gather] %lld rows (%.0f MB), %.0f%% distinct ids per batch: per-id copy %.2f M lookups/s, GatherRows "
+              "%.2f M lookups/s (%.1fx), %s\n", static_cast<long long>(rowNum),
+              rowNum * rowSize * sizeof(float) / 1048576.0, 100.0 * unique / lookups, lookups / naiveMs / 1000.0,
+              lookups / ms / 1000.0, naiveMs / ms, same ? "identical" : "MISMATCH");
+    }
+    remove(path.c_str());
+}
+
+// Inference-thread cost of dumping 4 outputs per run: a synchronous WriteFile per tensor vs the background writer.
+void BenchDumpWriter(int repeats) {
+    const string dir = "/data/local/tmp/output";
+    const int runs = 200;
+    vector<vector<int64_t>> shapes = {{1, 1000}, {1, 256, 7, 7}, {1, 64, 28, 28}, {1, 16}};
+    vector<vector<float>> outputs;
+    for (size_t i = 0; i < shapes.size(); i++) {
+        outputs.push_back(RandomData(host_graph::HostTensor::GetElementNum(shapes[i]), -1.0f, 1.0f, i));
+    }
+    double syncMs = TimeIt(repeats, [&]() {
+        for (int run = 0; run < runs; run++) {
+            for (size_t i = 0; i < outputs.size(); i++) {
+                test_util::WriteFile(outputs[i].data(), outputs[i].size() * sizeof(float),
+                                     dir + "/bench_sync_" + to_string(i) + "_" + to_string(run) + ".bin");
+            }
+        }
+    });
+    dump_writer::DumpStat stat;
+    double drainMs = 0;
+    TimeIt(repeats, [&]() {
+        dump_writer::DumpWriter writer;
+        for (int run = 0; run < runs; run++) {
+            for (size_t i = 0; i < outputs.size(); i++) {
+                writer.AppendNpyFrame(dir + "/bench_async_" + to_string(i) + ".npy", "<f4", shapes[i],
+                                      outputs[i].data(), outputs[i].size() * sizeof(float));
+            }
+        }
+        double start = GetTimeMs();
+        writer.Close();
+        drainMs = GetTimeMs() - start;
+        stat = writer.GetStat();
+    });
+    size_t tensors = runs * outputs.size();
+    ALOGI("[dump_writer] %zu tensors: sync %.1f us/tensor, async submit %.1f us/tensor (max %.1f us, %zu over "
+          "budget), drain %.3f ms\n", tensors, syncMs * 1000 / tensors, stat.totalSubmitUs / stat.submitted,
+          stat.maxSubmitUs, stat.overBudgetNum, drainMs);
+    dump_writer::PrintStat(stat);
+}
+
+void BenchIrpb(int repeats) {
+    const string path = "/data/local/tmp/output/bench_deep.irpb";
+    ge::Model model("model", "bench_deep");
+    double buildMs = TimeIt(repeats, [&]() {
+        ge::Graph graph("ir_graph");
+        BuildDeepGraph(graph);
+        model.SetGraph(graph);
+    });
+    ge::Buffer buffer;
+    double saveMs = TimeIt(repeats, [&]() {
+        model.Save(buffer);
+    });
+    double parseMs = TimeIt(repeats, [&]() {
+        ge::Model loaded;
+        ge::Model::Load(buffer.GetData(), buffer.GetSize(), loaded);
+    });
+    ir_model::SaveIrpb(model, path, "bench");
+    ir_model::IrpbStat stat;
+    double loadMs = TimeIt(repeats, [&]() {
+        ge::Model loaded;
+        ir_model::LoadIrpb(path, loaded, "bench", &stat);
+    });
+    double mb = buffer.GetSize() / 1048576.0;
+    ALOGI("[irpb] %.2f MB: construct %.3f ms, save %.3f ms (%.1f MB/s), parse %.3f ms (%.1f MB/s)\n", mb, buildMs,
+          saveMs, mb / saveMs * 1000, parseMs, mb / parseMs * 1000);
+    ALOGI("[irpb] mmap + crc + parse %.3f ms (map %.3f, parse %.3f), %.1fx faster than construction\n", loadMs,
+          stat.mapMs, stat.parseMs, buildMs / loadMs);
+}
+}
+
+using namespace bench_case;
+
+int main() {
+    ALOGE("=========== RUN BenchCase ===========\n");
+    BenchCase caseList[] = {
+        {"detection_postprocess", BenchDetection, 20},
+        {"partition", BenchPartition, 10},
+        {"weight_quant", BenchWeightQuant, 5},
+        {"calibration", BenchCalibration, 2},
+        {"memory_plan", BenchMemoryPlan, 20},
+        {"irpb_roundtrip", BenchIrpb, 5},
+        {"accuracy_check", BenchAccuracyCheck, 5},
+        {"dump_writer", BenchDumpWriter, 3},
+        {"gemm", BenchGemm, 10},
+        {"conv", BenchConv, 5},
+        {"conv_transpose", BenchConvTranspose, 5},
+        {"resize", BenchResize, 10},
+        {"lstm", BenchLstm, 5},
+        {"stateful_session", BenchStatefulSession, 10},
+        {"normalization", BenchNormalization, 10},
+        {"layout", BenchLayout, 10},
+        {"top_k", BenchTopK, 20},
+        {"gather", BenchGather, 5},
+    };
+    for (const BenchCase& bc : caseList) {
+        cout << "============= CaseName: " << bc.caseName << endl;
+        bc.func(bc.repeats);
+    }
+    ALOGE("=========== ALL DONE ===========\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Residency policy bench on SimulatedModelBackend. It needs only the DDK headers, not the device libraries, so
+// it also builds and runs on a Linux host, from the repo root:
+//   g++ -std=c++14 -O2 -pthread -Ijni -Iddk/ai_ddk_lib/include jni/bench_model_residency.cpp
+#include <iostream>
+#include <string>
+#include <sys/time.h>
+#include <thread>
+
+#include "log_util.h"
+#include "model_residency.h"
+
+using namespace std;
+
+namespace {
+double GetTimeMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Replays a cyclic access trace over more models than fit in the budget, with and without prefetching
+// the next model of the trace. A second caller runs the hot models meanwhile, so the manager and the backend
+// are used from the caller threads and the prefetch thread at once.
+bool BenchModelResidency(int repeats) {
+    const int modelNum = 6;
+    const size_t modelBytes = 8u << 20;
+    bool ok = true;
+    for (bool prefetch : {false, true}) {
+        auto backend = std::make_shared<model_residency::SimulatedModelBackend>(2.0, 4.0);
+        model_residency::ResidencyManager manager(backend, 3 * modelBytes);
+        for (int i = 0; i < modelNum; i++) {
+            string name = "model_" + to_string(i);
+            backend->SetModelSize(name + ".om", modelBytes);
+            manager.Register(name, name + ".om");
+        }
+        int failures = 0;
+        int otherFailures = 0;
+        thread other([&]() {
+            model_residency::VecAiTensor inputs;
+            model_residency::VecAiTensor outputs;
+            for (int r = 0; r < repeats * (modelNum - 2); r++) {
+                otherFailures += manager.Process("model_" + to_string(r % 2), inputs, outputs) ? 0 : 1;
+            }
+        });
+        model_residency::VecAiTensor inputs;
+        model_residency::VecAiTensor outputs;
+        double start = GetTimeMs();
+        for (int r = 0; r < repeats; r++) {
+            // two hot models between each of the cold ones
+            for (int i = 2; i < modelNum; i++) {
+                for (int name : {0, 1, i}) {
+                    if (prefetch && name == 1) {
+                        manager.Prefetch({"model_" + to_string(i)});
+                    }
+                    if (!manager.Process("model_" + to_string(name), inputs, outputs)) {
+                        failures++;
+                    }
+                }
+            }
+        }
+        double ms = GetTimeMs() - start;
+        other.join();
+        failures += otherFailures;
+        model_residency::ResidencyStats stats = manager.GetStats();
+        ALOGI("[residency] prefetch %d: %.3f ms per trace, %d loads\n", prefetch, ms / repeats,
+               backend->GetLoadCount());
+        manager.PrintStats();
+        // once nothing is pinned, the resident set is back within the budget
+        if (failures != 0 || stats.residentBytes > 3 * modelBytes) {
+            ALOGI("[residency] FAILED: %d failed calls, %zu bytes resident\n", failures, stats.residentBytes);
+            ok = false;
+        }
+    }
+    return ok;
+}
+}
+
+int main() {
+    cout << "============= CaseName: model_residency" << endl;
+    if (!BenchModelResidency(5)) {
+        return 1;
+    }
+    cout << "=========== ALL DONE ===========" << endl;
+    return 0;
+}
@@ -0,0 +1,491 @@
+#ifndef BUILD_IR_MODEL_DUMP_WRITER_H
+#define BUILD_IR_MODEL_DUMP_WRITER_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+#include "log_util.h"
+#include "npy_io.h"
+
+// Tensor dumps written by a background thread, so that dumping outputs inside an inference loop costs the
+// inference thread a memcpy into a recycled buffer and a queue push. Records of one batch that go to the same
+// file are written with a single writev; multi-frame .npy streams get their header rewritten once per batch.
+//
+//     dump_writer::DumpWriter writer;                  // drops records when 64 MB are pending
+//     for (...) {
+//         client->Process(context, inputs, outputs, 1000, istamp);
+//         writer.AppendNpyFrame("/data/local/tmp/output/output_0.npy", "<f4", {1, 1000},
+//                               outputs[0]->GetBuffer(), outputs[0]->GetSize());
+//     }
+//     writer.Close();
+//     dump_writer::PrintStat(writer.GetStat());
+//
+// Passing a `holder` skips the copy: the writer keeps it alive and the data must not change until written,
+// the way to stay within the submit budget for tensors of more than a few hundred KB.
+namespace dump_writer {
+enum class Backpressure {
+    DROP,   // a record that does not fit the queue is dropped and counted
+    BLOCK,  // the caller waits for room
+};
+
+struct WriterOptions {
+    // bound on the bytes submitted and not yet written, copies and held buffers alike
+    size_t maxQueueBytes = 64u << 20;
+    size_t maxQueueRecords = 1024;
+    Backpressure backpressure = Backpressure::DROP;
+    // gzip the single file records (WriteFile / WriteNpy), ".gz" is appended to their paths
+    bool compress = false;
+    int level = 1;
+    // nice value of the writer thread
+    int workerNice = 10;
+    // submits slower than this are counted in DumpStat::overBudgetNum
+    double submitBudgetUs = 50;
+};
+
+struct DumpStat {
+    size_t submitted = 0;
+    size_t written = 0;
+    size_t dropped = 0;
+    size_t failed = 0;
+    size_t bytes = 0;
+    // write / writev / pwrite calls, fewer than records once batches coalesce
+    size_t writeCalls = 0;
+    double totalSubmitUs = 0;
+    double maxSubmitUs = 0;
+    size_t overBudgetNum = 0;
+};
+
+class DumpWriter {
+public:
+    explicit DumpWriter(const WriterOptions& options = WriterOptions())
+        : options_(options), worker_([this]() { Work(); }) {}
+
+    DumpWriter(const DumpWriter&) = delete;
+    DumpWriter& operator=(const DumpWriter&) = delete;
+
+    ~DumpWriter() { Close(); }
+
+    // Replaces `path` with `data`.
+    bool WriteFile(const std::string& path, const void* data, size_t bytes,
+                   std::shared_ptr<const void> holder = nullptr) {
+        return Submit(Record::FILE, path, "", {}, data, bytes, holder);
+    }
+
+    // Replaces `path` with an .npy of `shape`.
+    bool WriteNpy(const std::string& path, const std::string& descr, const std::vector<int64_t>& shape,
+                  const void* data, size_t bytes, std::shared_ptr<const void> holder = nullptr) {
+        return Submit(Record::FILE, path, npy_io::BuildHeader(descr, shape), {}, data, bytes, holder);
+    }
+
+    // Appends raw bytes, the file is truncated by the first append of this writer.
+    bool Append(const std::string& path, const void* data, size_t bytes,
+                std::shared_ptr<const void> holder = nullptr) {
+        return Submit(Record::APPEND, path, "", {}, data, bytes, holder);
+    }
+
+    // Appends a frame to the .npy stream at `path`, whose shape is [frames, frameShape...] like npy_io::NpyWriter.
+    bool AppendNpyFrame(const std::string& path, const std::string& descr, const std::vector<int64_t>& frameShape,
+                        const void* data, size_t bytes, std::shared_ptr<const void> holder = nullptr) {
+        return Submit(Record::NPY_FRAME, path, descr, frameShape, data, bytes, holder);
+    }
+
+    // Pre-faults `count` buffers of `bytes`, the first submits then do not pay for page faults either.
+    void Prewarm(size_t bytes, int count) {
+        for (int i = 0; i < count; i++) {
+            Buffer buffer(bytes);
+            memset(buffer.data.get(), 0, bytes);
+            std::lock_guard<std::mutex> lock(mutex_);
+            pool_.push_back(std::move(buffer));
+        }
+    }
+
+    // Waits until every record submitted so far is written.
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = submittedSeq_;
+        drained_.wait(lock, [this, target]() { return writtenSeq_ >= target; });
+    }
+
+    // Writes what is queued, finalizes the .npy streams and stops the worker. Later submits fail.
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            stopping_ = true;
+        }
+        pending_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+        for (auto& stream : streams_) {
+            FinishStream(stream.first, stream.second);
+        }
+        streams_.clear();
+    }
+
+    DumpStat GetStat() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stat_;
+    }
+
+private:
+    // uninitialized, unlike a vector the first copy into it is the only pass over the memory
+    struct Buffer {
+        Buffer() = default;
+        explicit Buffer(size_t bytes) : data(new uint8_t[bytes]), size(bytes) {}
+        std::unique_ptr<uint8_t[]> data;
+        size_t size = 0;
+    };
+
+    struct Record {
+        enum Kind { FILE, APPEND, NPY_FRAME } kind = FILE;
+        std::string path;
+        // .npy header of FILE records, descr of NPY_FRAME records
+        std::string header;
+        std::vector<int64_t> frameShape;
+        const void* data = nullptr;
+        size_t bytes = 0;
+        Buffer copy;
+        std::shared_ptr<const void> holder;
+    };
+
+    struct Stream {
+        int fd = -1;
+        std::string descr;
+        std::vector<int64_t> frameShape;
+        size_t headerSize = 0;
+        size_t frameBytes = 0;
+        int64_t frames = 0;
+        bool failed = false;
+    };
+
+    bool Submit(Record::Kind kind, const std::string& path, const std::string& header,
+                const std::vector<int64_t>& frameShape, const void* data, size_t bytes,
+                std::shared_ptr<const void> holder) {
+        auto start = std::chrono::steady_clock::now();
+        Record record;
+        record.kind = kind;
+        record.path = path;
+        record.header = header;
+        record.frameShape = frameShape;
+        record.bytes = bytes;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto fits = [this, bytes]() {
+                return queue_.empty() || (queuedBytes_ + bytes <= options_.maxQueueBytes &&
+                                          queue_.size() < options_.maxQueueRecords);
+            };
+            if (!stopping_ && !fits()) {
+                if (options_.backpressure == Backpressure::DROP) {
+                    stat_.dropped++;
+                    return false;
+                }
+                space_.wait(lock, [this, &fits]() { return stopping_ || fits(); });
+            }
+            if (stopping_) {
+                return false;
+            }
+            queuedBytes_ += bytes;
+            if (holder == nullptr) {
+                record.copy = TakeBuffer(bytes);
+            }
+        }
+        if (holder == nullptr) {
+            if (record.copy.size < bytes) {
+                record.copy = Buffer(bytes);
+            }
+            memcpy(record.copy.data.get(), data, bytes);
+            record.data = record.copy.data.get();
+        } else {
+            record.data = data;
+            record.holder = holder;
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(record));
+            submittedSeq_++;
+            stat_.submitted++;
+            stat_.totalSubmitUs += us;
+            stat_.maxSubmitUs = std::max(stat_.maxSubmitUs, us);
+            stat_.overBudgetNum += us > options_.submitBudgetUs ? 1 : 0;
+        }
+        pending_.notify_one();
+        return true;
+    }
+
+    // The smallest pooled buffer that is large enough, an empty one when there is none; the caller allocates
+    // outside the lock.
+    Buffer TakeBuffer(size_t bytes) {
+        auto best = pool_.end();
+        for (auto it = pool_.begin(); it != pool_.end(); ++it) {
+            if (it->size >= bytes && (best == pool_.end() || it->size < best->size)) {
+                best = it;
+            }
+        }
+        if (best == pool_.end()) {
+            return Buffer();
+        }
+        Buffer buffer = std::move(*best);
+        pool_.erase(best);
+        return buffer;
+    }
+
+    void Work() {
+        // below the inference thread, which otherwise gets preempted by the writer on a busy core
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), options_.workerNice);
+        std::vector<Record> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                pending_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty()) {
+                    return;
+                }
+                batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end()));
+                queue_.clear();
+            }
+            WriteBatch(batch);
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t pooledBytes = 0;
+            for (const auto& buffer : pool_) {
+                pooledBytes += buffer.size;
+            }
+            for (auto& record : batch) {
+                queuedBytes_ -= record.bytes;
+                if (record.copy.size > 0 && pooledBytes + record.copy.size <= options_.maxQueueBytes) {
+                    pooledBytes += record.copy.size;
+                    pool_.push_back(std::move(record.copy));
+                }
+            }
+            writtenSeq_ += batch.size();
+            batch.clear();
+            space_.notify_all();
+            drained_.notify_all();
+        }
+    }
+
+    // Records are grouped by file in order of first appearance, the order within a file is kept.
+    void WriteBatch(std::vector<Record>& batch) {
+        std::vector<std::string> order;
+        std::map<std::string, std::vector<Record*>> files;
+        for (auto& record : batch) {
+            auto& list = files[record.path];
+            if (list.empty()) {
+                order.push_back(record.path);
+            }
+            list.push_back(&record);
+        }
+        DumpStat local;
+        for (const auto& path : order) {
+            const auto& records = files[path];
+            size_t begin = 0;
+            while (begin < records.size()) {
+                // FILE records are written one by one, runs of appends to the same stream in one go
+                size_t end = begin + 1;
+                if (records[begin]->kind != Record::FILE) {
+                    while (end < records.size() && records[end]->kind == records[begin]->kind) {
+                        end++;
+                    }
+                }
+                std::vector<Record*> run(records.begin() + begin, records.begin() + end);
+                bool ok = records[begin]->kind == Record::FILE ? WriteWholeFile(*run[0], local) :
+                          AppendRun(path, run, local);
+                local.written += ok ? run.size() : 0;
+                local.failed += ok ? 0 : run.size();
+                begin = end;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        stat_.written += local.written;
+        stat_.failed += local.failed;
+        stat_.bytes += local.bytes;
+        stat_.writeCalls += local.writeCalls;
+    }
+
+    static bool WriteAll(int fd, std::vector<struct iovec>& iov, DumpStat& stat) {
+        size_t index = 0;
+        while (index < iov.size()) {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - index, IOV_MAX));
+            ssize_t written = writev(fd, iov.data() + index, count);
+            stat.writeCalls++;
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            stat.bytes += static_cast<size_t>(written);
+            size_t left = static_cast<size_t>(written);
+            while (index < iov.size() && left >= iov[index].iov_len) {
+                left -= iov[index].iov_len;
+                index++;
+            }
+            if (left > 0) {
+                iov[index].iov_base = static_cast<uint8_t*>(iov[index].iov_base) + left;
+                iov[index].iov_len -= left;
+            }
+        }
+        return true;
+    }
+
+    bool WriteWholeFile(const Record& record, DumpStat& stat) {
+        std::vector<uint8_t> gz;
+        std::vector<struct iovec> iov;
+        if (options_.compress) {
+            if (!Gzip(record, gz)) {
+                ALOGE("[DUMP_WRITER] compress %s failed.\n", record.path.c_str());
+                return false;
+            }
+            iov.push_back({gz.data(), gz.size()});
+        } else {
+            if (!record.header.empty()) {
+                iov.push_back({const_cast<char*>(record.header.data()), record.header.size()});
+            }
+            iov.push_back({const_cast<void*>(record.data), record.bytes});
+        }
+        std::string path = options_.compress ? record.path + ".gz" : record.path;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            ALOGE("[DUMP_WRITER] open %s failed: %s.\n", path.c_str(), strerror(errno));
+            return false;
+        }
+        bool ok = WriteAll(fd, iov, stat);
+        ok = close(fd) == 0 && ok;
+        if (!ok) {
+            ALOGE("[DUMP_WRITER] write %s failed.\n", path.c_str());
+        }
+        return ok;
+    }
+
+    bool Gzip(const Record& record, std::vector<uint8_t>& out) const {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, options_.level, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        out.resize(deflateBound(&stream, static_cast<uLong>(record.header.size() + record.bytes)) + 32);
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(record.header.data()));
+        stream.avail_in = static_cast<uInt>(record.header.size());
+        int ret = deflate(&stream, Z_NO_FLUSH);
+        stream.next_in = static_cast<Bytef*>(const_cast<void*>(record.data));
+        stream.avail_in = static_cast<uInt>(record.bytes);
+        ret = ret == Z_OK ? deflate(&stream, Z_FINISH) : ret;
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return ret == Z_STREAM_END;
+    }
+
+    bool AppendRun(const std::string& path, const std::vector<Record*>& run, DumpStat& stat) {
+        Stream& stream = streams_[path];
+        const Record& first = *run[0];
+        if (stream.fd < 0 && !stream.failed) {
+            stream.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (stream.fd < 0) {
+                ALOGE("[DUMP_WRITER] open %s failed: %s.\n", path.c_str(), strerror(errno));
+                stream.failed = true;
+            } else if (first.kind == Record::NPY_FRAME) {
+                stream.descr = first.header;
+                stream.frameShape = first.frameShape;
+                stream.frameBytes = npy_io::GetItemSize(first.header);
+                for (auto dim : first.frameShape) {
+                    stream.frameBytes *= static_cast<size_t>(dim);
+                }
+                std::vector<int64_t> widest = first.frameShape;
+                widest.insert(widest.begin(), INT64_MAX);
+                stream.headerSize = npy_io::BuildHeader(first.header, widest).size();
+                stream.failed = !WriteStreamHeader(stream, stat);
+            }
+        }
+        if (stream.failed) {
+            return false;
+        }
+        std::vector<struct iovec> iov;
+        for (const Record* record : run) {
+            if (record->kind == Record::NPY_FRAME && (record->bytes != stream.frameBytes ||
+                                                      record->header != stream.descr)) {
+                ALOGE("[DUMP_WRITER] %s: frame of %zu bytes %s, the stream has %zu bytes %s.\n", path.c_str(),
+                      record->bytes, record->header.c_str(), stream.frameBytes, stream.descr.c_str());
+                return false;
+            }
+            iov.push_back({const_cast<void*>(record->data), record->bytes});
+        }
+        if (!WriteAll(stream.fd, iov, stat)) {
+            ALOGE("[DUMP_WRITER] append to %s failed: %s.\n", path.c_str(), strerror(errno));
+            stream.failed = true;
+            return false;
+        }
+        if (first.kind == Record::NPY_FRAME) {
+            stream.frames += static_cast<int64_t>(run.size());
+            // the file is a valid .npy after every batch
+            return WriteStreamHeader(stream, stat);
+        }
+        return true;
+    }
+
+    static bool WriteStreamHeader(const Stream& stream, DumpStat& stat) {
+        std::vector<int64_t> shape = stream.frameShape;
+        shape.insert(shape.begin(), stream.frames);
+        std::string header = npy_io::BuildHeader(stream.descr, shape, stream.headerSize);
+        stat.writeCalls++;
+        if (stream.frames == 0) {
+            // the frames follow the header, the offset has to move past it
+            return write(stream.fd, header.data(), header.size()) == static_cast<ssize_t>(header.size());
+        }
+        return pwrite(stream.fd, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size());
+    }
+
+    static void FinishStream(const std::string& path, Stream& stream) {
+        if (stream.fd >= 0 && close(stream.fd) != 0) {
+            ALOGE("[DUMP_WRITER] close %s failed: %s.\n", path.c_str(), strerror(errno));
+        }
+        stream.fd = -1;
+    }
+
+    WriterOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable pending_;
+    std::condition_variable space_;
+    std::condition_variable drained_;
+    std::deque<Record> queue_;
+    std::vector<Buffer> pool_;
+    size_t queuedBytes_ = 0;
+    uint64_t submittedSeq_ = 0;
+    uint64_t writtenSeq_ = 0;
+    bool stopping_ = false;
+    DumpStat stat_;
+    // owned by the worker thread until Close() joins it
+    std::map<std::string, Stream> streams_;
+    std::thread worker_;
+};
+
+inline void PrintStat(const DumpStat& stat) {
+    ALOGI("[DUMP_WRITER] %zu submitted, %zu written, %zu dropped, %zu failed, %.2f MB in %zu write calls; "
+          "submit avg %.1f us, max %.1f us, %zu over budget\n", stat.submitted, stat.written, stat.dropped,
+          stat.failed, stat.bytes / 1048576.0, stat.writeCalls,
+          stat.submitted > 0 ? stat.totalSubmitUs / stat.submitted : 0.0, stat.maxSubmitUs, stat.overBudgetNum);
+}
+}
+
+#endif //BUILD_IR_MODEL_DUMP_WRITER_H
@@ -0,0 +1,426 @@
+#ifndef BUILD_IR_MODEL_GRAPH_PARTITION_H
+#define BUILD_IR_MODEL_GRAPH_PARTITION_H
+
+#include <cstring>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+#include "check.h"
+#include "host_executor.h"
+#include "host_graph.h"
+#include "shape_inference.h"
+
+// Splits a host_graph::Graph into NPU and CPU subgraphs according to a per-ROM capability table, so that a
+// single model variant runs everywhere: NPU subgraphs are compiled through HiaiIrBuild (ir_model::Build), the
+// rest runs on the host kernels, and tensors cross the boundary as views over the AiTensor buffers.
+//
+//     graph_partition::PartitionedGraph model(graph, host_kernel::GetBuiltinKernels());
+//     model.Partition(graph_partition::DefaultCapabilityTable(), graph_partition::GetRomVersion());
+//     model.Build("/data/local/tmp/output/" + caseName);
+//     model.Run(inputs, outputs);
+//
+// Partitioning rewires the ge::Operator inputs at the NPU/CPU boundary, the original graph can not be built
+// as a whole afterwards.
+namespace graph_partition {
+using host_graph::HostTensor;
+using host_graph::Node;
+using host_graph::TensorRef;
+
+// Compares dotted HiAI versions ("100.320.010.010") segment by segment.
+inline int CompareVersion(const std::string& a, const std::string& b) {
+    std::istringstream sa(a);
+    std::istringstream sb(b);
+    std::string ta;
+    std::string tb;
+    while (true) {
+        bool hasA = static_cast<bool>(std::getline(sa, ta, '.'));
+        bool hasB = static_cast<bool>(std::getline(sb, tb, '.'));
+        if (!hasA && !hasB) {
+            return 0;
+        }
+        long va = hasA ? std::strtol(ta.c_str(), nullptr, 10) : 0;
+        long vb = hasB ? std::strtol(tb.c_str(), nullptr, 10) : 0;
+        if (va != vb) {
+            return va < vb ? -1 : 1;
+        }
+    }
+}
+
+inline std::string GetRomVersion() {
+    std::array<char, PROP_VALUE_MAX> version{0};
+    if (__system_property_get("ro.vendor.hiaiversion", version.data()) <= 0) {
+        return "";
+    }
+    return std::string(version.data());
+}
+
+class CapabilityTable {
+public:
+    using Predicate = std::function<bool(const Node& node, const std::string& romVersion)>;
+
+    // Op types that are not listed are assumed to be supported on the NPU.
+    CapabilityTable& Require(const std::string& type, const std::string& minRomVersion) {
+        minVersions_[type] = minRomVersion;
+        return *this;
+    }
+
+    CapabilityTable& Require(const std::string& type, const Predicate& predicate) {
+        predicates_[type] = predicate;
+        return *this;
+    }
+
+    CapabilityTable& Unsupported(const std::string& type) {
+        unsupported_.insert(type);
+        return *this;
+    }
+
+    bool IsSupported(const Node& node, const std::string& romVersion) const {
+        if (unsupported_.count(node.type) != 0) {
+            return false;
+        }
+        auto version = minVersions_.find(node.type);
+        if (version != minVersions_.end() && (romVersion.empty() || CompareVersion(romVersion, version->second) < 0)) {
+            return false;
+        }
+        auto predicate = predicates_.find(node.type);
+        return predicate == predicates_.end() || predicate->second(node, romVersion);
+    }
+
+private:
+    std::map<std::string, std::string> minVersions_;
+    std::map<std::string, Predicate> predicates_;
+    std::set<std::string> unsupported_;
+};
+
+// Versions come from the "Added in HiAI version" notes of graph/op/*.h.
+inline CapabilityTable DefaultCapabilityTable() {
+    CapabilityTable table;
+    table.Require("FSRDetectionOutput", "100.320.010.010")
+        .Require("DetectionPostprocessing", "100.320.010.010")
+        .Require("NonMaxSuppressionV3D", "100.320.010.010")
+        .Require("QuantizedConvolution", "100.310.010.015")
+        .Require("QuantizedConvolutionDepthwise", "100.310.010.015")
+        .Require("QuantizedFullyConnection", "100.310.010.015")
+        .Unsupported("SSDDetectionOutput"); // CPUCL only
+    bool halfPixel = hiai_check::Check();
+    table.Require("ResizeBilinearV2", [halfPixel](const Node& node, const std::string&) {
+        return halfPixel || !node.GetBool("half_pixel_centers", false);
+    });
+    return table;
+}
+
+struct Subgraph {
+    bool onNpu = false;
+    int stage = 0;
+    std::vector<int> nodes;
+    // boundary tensors read from / produced for other subgraphs and graph outputs, in model IO order
+    std::vector<TensorRef> inputs;
+    std::vector<TensorRef> outputs;
+
+    std::string modelName;
+    std::shared_ptr<hiai::AiModelMngerClient> client;
+    std::vector<std::shared_ptr<hiai::AiTensor>> inputTensors;
+    std::vector<std::shared_ptr<hiai::AiTensor>> outputTensors;
+};
+
+class PartitionedGraph {
+public:
+    PartitionedGraph(host_graph::Graph& graph, const host_graph::KernelRegistry& registry)
+        : graph_(graph), registry_(registry), executor_(graph, registry) {}
+
+    bool Partition(const CapabilityTable& table, const std::string& romVersion) {
+        const auto& nodes = graph_.GetNodes();
+        // 0: Data/Const, 1: NPU, 2: CPU
+        std::vector<int> device(nodes.size(), 0);
+        std::vector<int> stage(nodes.size(), 0);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const Node& node = nodes[i];
+            if (node.type == "Data" || node.type == "Const") {
+                continue;
+            }
+            if (table.IsSupported(node, romVersion)) {
+                device[i] = 1;
+            } else if (registry_.Has(node.type)) {
+                device[i] = 2;
+            } else {
+                ALOGE("[PARTITION] %s(%s) is supported neither by the NPU nor by the host.\n", node.name.c_str(),
+                      node.type.c_str());
+                return false;
+            }
+            // A node starts a new stage whenever it consumes a tensor produced on the other device, so
+            // subgraphs of the same stage never depend on each other.
+            for (const auto& input : node.inputs) {
+                int producer = device[input.node];
+                stage[i] = std::max(stage[i], stage[input.node] + ((producer != 0 && producer != device[i]) ? 1 : 0));
+            }
+        }
+
+        std::map<std::pair<int, int>, size_t> groups;
+        subgraphs_.clear();
+        std::vector<int> owner(nodes.size(), -1);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (device[i] == 0) {
+                continue;
+            }
+            auto key = std::make_pair(stage[i], device[i]);
+            if (groups.count(key) == 0) {
+                groups[key] = subgraphs_.size();
+                Subgraph subgraph;
+                subgraph.onNpu = device[i] == 1;
+                subgraph.stage = stage[i];
+                subgraphs_.push_back(subgraph);
+            }
+            owner[i] = static_cast<int>(groups[key]);
+            subgraphs_[groups[key]].nodes.push_back(static_cast<int>(i));
+        }
+        std::stable_sort(subgraphs_.begin(), subgraphs_.end(), [](const Subgraph& a, const Subgraph& b) {
+            return a.stage < b.stage;
+        });
+        for (size_t s = 0; s < subgraphs_.size(); s++) {
+            for (int node : subgraphs_[s].nodes) {
+                owner[node] = static_cast<int>(s);
+            }
+        }
+
+        std::set<TensorRef> graphOutputs(graph_.GetOutputs().begin(), graph_.GetOutputs().end());
+        for (size_t s = 0; s < subgraphs_.size(); s++) {
+            Subgraph& subgraph = subgraphs_[s];
+            std::set<TensorRef> produced;
+            for (int index : subgraph.nodes) {
+                for (const auto& input : nodes[index].inputs) {
+                    if (owner[input.node] != static_cast<int>(s) && nodes[input.node].type != "Const" &&
+                        std::find(subgraph.inputs.begin(), subgraph.inputs.end(), input) == subgraph.inputs.end()) {
+                        subgraph.inputs.push_back(input);
+                    }
+                }
+            }
+            for (size_t consumer = 0; consumer < nodes.size(); consumer++) {
+                if (owner[consumer] == static_cast<int>(s)) {
+                    continue;
+                }
+                for (const auto& input : nodes[consumer].inputs) {
+                    if (owner[input.node] == static_cast<int>(s)) {
+                        produced.insert(input);
+                    }
+                }
+            }
+            for (const auto& ref : graphOutputs) {
+                if (owner[ref.node] == static_cast<int>(s)) {
+                    produced.insert(ref);
+                }
+            }
+            if (subgraph.onNpu) {
+                // the model exposes every output of an output op
+                std::set<int> ops;
+                for (const auto& ref : produced) {
+                    ops.insert(ref.node);
+                }
+                for (int op : ops) {
+                    for (size_t i = 0; i < nodes[op].GetOutputNum(); i++) {
+                        subgraph.outputs.push_back(host_graph::Executor::Ref(op, static_cast<int>(i)));
+                    }
+                }
+            } else {
+                subgraph.outputs.assign(produced.begin(), produced.end());
+            }
+        }
+        Print();
+        return true;
+    }
+
+    // Compiles and loads every NPU subgraph, the om files are written as <prefix>_<index>.om.
+    bool Build(const std::string& prefix) {
+        // fills the boundary TensorDescs and catches shape errors before the first compile
+        if (!shape_inference::InferShapes(graph_, shape_inference::GetBuiltinInferFuncs())) {
+            return false;
+        }
+        for (size_t s = 0; s < subgraphs_.size(); s++) {
+            Subgraph& subgraph = subgraphs_[s];
+            if (!subgraph.onNpu) {
+                continue;
+            }
+            subgraph.modelName = prefix + "_" + std::to_string(s) + ".om";
+            ge::Graph irGraph(graph_.GetName() + "_" + std::to_string(s));
+            if (!BuildNpuGraph(subgraph, irGraph)) {
+                return false;
+            }
+            ge::Model irModel("model", subgraph.modelName);
+            irModel.SetGraph(irGraph);
+            subgraph.client = ir_model::Build(subgraph.modelName, irModel, &subgraph.inputTensors,
+                                              &subgraph.outputTensors);
+            if (subgraph.client == nullptr) {
+                ALOGE("[PARTITION] build subgraph %zu failed.\n", s);
+                return false;
+            }
+            if (subgraph.inputTensors.size() != subgraph.inputs.size() ||
+                subgraph.outputTensors.size() != subgraph.outputs.size()) {
+                ALOGE("[PARTITION] subgraph %zu IO mismatch: %zu/%zu inputs, %zu/%zu outputs.\n", s,
+                      subgraph.inputTensors.size(), subgraph.inputs.size(), subgraph.outputTensors.size(),
+                      subgraph.outputs.size());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Run(const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+        const auto& dataNodes = graph_.GetInputs();
+        if (inputs.size() != dataNodes.size()) {
+            ALOGE("[PARTITION] expect %zu inputs, got %zu.\n", dataNodes.size(), inputs.size());
+            return false;
+        }
+        copiedBytes_ = 0;
+        host_graph::TensorMap tensors;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            tensors[host_graph::Executor::Ref(dataNodes[i], 0)] = inputs[i];
+        }
+        BindNpuInputs(tensors);
+        for (auto& subgraph : subgraphs_) {
+            bool ret = subgraph.onNpu ? RunNpu(subgraph, tensors) : executor_.Run(subgraph.nodes, tensors);
+            if (!ret) {
+                return false;
+            }
+        }
+        outputs.clear();
+        for (const auto& ref : graph_.GetOutputs()) {
+            outputs.push_back(tensors[ref]);
+        }
+        return true;
+    }
+
+    const std::vector<Subgraph>& GetSubgraphs() const { return subgraphs_; }
+
+    // bytes memcpy'd at the NPU/CPU boundary during the last Run
+    size_t GetCopiedBytes() const { return copiedBytes_; }
+
+    void Print() const {
+        for (size_t s = 0; s < subgraphs_.size(); s++) {
+            const Subgraph& subgraph = subgraphs_[s];
+            ALOGI("[PARTITION] subgraph %zu: %s, stage %d, %zu nodes, %zu inputs, %zu outputs\n", s,
+                  subgraph.onNpu ? "NPU" : "CPU", subgraph.stage, subgraph.nodes.size(), subgraph.inputs.size(),
+                  subgraph.outputs.size());
+        }
+    }
+
+private:
+    bool BuildNpuGraph(Subgraph& subgraph, ge::Graph& irGraph) {
+        if (graph_.GetBrokenInputNum() > 0) {
+            ALOGE("[PARTITION] %s: %zu inputs read unnamed outputs, set OutputNames on their producers.\n",
+                  graph_.GetName().c_str(), graph_.GetBrokenInputNum());
+            return false;
+        }
+        std::vector<ge::Operator> inputOps;
+        for (const auto& ref : subgraph.inputs) {
+            if (!graph_.HasOutputDesc(ref)) {
+                ALOGE("[PARTITION] boundary tensor %s:%d has no TensorDesc, its producer can not be inferred; set it with OutputDesc().\n",
+                      graph_.GetNode(ref.node).name.c_str(), ref.index);
+                return false;
+            }
+            const Node& producer = graph_.GetNode(ref.node);
+            if (producer.type == "Data") {
+                inputOps.push_back(producer.op);
+                continue;
+            }
+            auto data = ge::op::Data(producer.name + "_" + std::to_string(ref.index) + "_boundary");
+            data.update_input_desc_x(producer.outputDescs[ref.index]);
+            for (int index : subgraph.nodes) {
+                Node& node = graph_.MutableNode(index);
+                for (size_t i = 0; i < node.inputs.size(); i++) {
+                    if (node.inputs[i] == ref) {
+                        node.op.SetInput(node.inputNames[i], data);
+                    }
+                }
+            }
+            inputOps.push_back(data);
+        }
+        std::vector<ge::Operator> outputOps;
+        for (const auto& ref : subgraph.outputs) {
+            if (ref.index == 0) {
+                outputOps.push_back(graph_.GetNode(ref.node).op);
+            }
+        }
+        irGraph.SetInputs(inputOps).SetOutputs(outputOps);
+        return true;
+    }
+
+    // A CPU produced tensor that feeds exactly one NPU input is written by the kernel straight into the
+    // AiTensor buffer.
+    void BindNpuInputs(host_graph::TensorMap& tensors) {
+        std::map<TensorRef, int> uses;
+        for (const auto& subgraph : subgraphs_) {
+            for (const auto& ref : subgraph.inputs) {
+                uses[ref]++;
+            }
+        }
+        for (const auto& ref : graph_.GetOutputs()) {
+            uses[ref]++;
+        }
+        for (auto& subgraph : subgraphs_) {
+            if (!subgraph.onNpu) {
+                continue;
+            }
+            for (size_t i = 0; i < subgraph.inputs.size(); i++) {
+                const TensorRef& ref = subgraph.inputs[i];
+                if (uses[ref] != 1 || graph_.GetNode(ref.node).type == "Data" || tensors.count(ref) != 0) {
+                    continue;
+                }
+                tensors[ref] = HostTensor::View(subgraph.inputTensors[i], GetDims(ref, subgraph.inputTensors[i]));
+            }
+        }
+    }
+
+    bool RunNpu(Subgraph& subgraph, host_graph::TensorMap& tensors) {
+        for (size_t i = 0; i < subgraph.inputs.size(); i++) {
+            auto it = tensors.find(subgraph.inputs[i]);
+            if (it == tensors.end()) {
+                ALOGE("[PARTITION] %s: NPU input %zu is missing.\n", subgraph.modelName.c_str(), i);
+                return false;
+            }
+            auto& aiTensor = subgraph.inputTensors[i];
+            if (it->second.GetData() == aiTensor->GetBuffer()) {
+                continue;
+            }
+            if (it->second.GetByteSize() != aiTensor->GetSize()) {
+                ALOGE("[PARTITION] %s: input %zu size %zu != %u.\n", subgraph.modelName.c_str(), i,
+                      it->second.GetByteSize(), aiTensor->GetSize());
+                return false;
+            }
+            memcpy(aiTensor->GetBuffer(), it->second.GetData(), aiTensor->GetSize());
+            copiedBytes_ += aiTensor->GetSize();
+        }
+        hiai::AiContext context;
+        context.AddPara("model_name", subgraph.modelName);
+        int istamp;
+        int ret = subgraph.client->Process(context, subgraph.inputTensors, subgraph.outputTensors, 1000, istamp);
+        if (ret != hiai::AI_SUCCESS) {
+            ALOGE("[PARTITION] %s: Process failed, ret=%d.\n", subgraph.modelName.c_str(), ret);
+            return false;
+        }
+        for (size_t i = 0; i < subgraph.outputs.size(); i++) {
+            const TensorRef& ref = subgraph.outputs[i];
+            tensors[ref] = HostTensor::View(subgraph.outputTensors[i], GetDims(ref, subgraph.outputTensors[i]));
+        }
+        return true;
+    }
+
+    std::vector<int64_t> GetDims(const TensorRef& ref, const std::shared_ptr<hiai::AiTensor>& tensor) const {
+        if (graph_.HasOutputDesc(ref)) {
+            return host_graph::GetDescDims(graph_.GetNode(ref.node).outputDescs[ref.index]);
+        }
+        auto dims = tensor->GetTensorDimension();
+        return {dims.GetNumber(), dims.GetChannel(), dims.GetHeight(), dims.GetWidth()};
+    }
+
+    host_graph::Graph& graph_;
+    const host_graph::KernelRegistry& registry_;
+    host_graph::Executor executor_;
+    std::vector<Subgraph> subgraphs_;
+    size_t copiedBytes_ = 0;
+};
+}
+
+#endif //BUILD_IR_MODEL_GRAPH_PARTITION_H
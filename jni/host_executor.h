@@ -0,0 +1,256 @@
+#ifndef BUILD_IR_MODEL_HOST_EXECUTOR_H
+#define BUILD_IR_MODEL_HOST_EXECUTOR_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HiAiModelManagerType.h"
+#include "host_graph.h"
+#include "log_util.h"
+#include "npy_io.h"
+
+namespace host_graph {
+// Dense row-major tensor used on the host path. It either owns its storage or is a view over a buffer owned
+// by someone else (an AiTensor, a Const payload, an arena slice), which is how tensors cross the NPU/CPU
+// boundary without copies.
+class HostTensor {
+public:
+    HostTensor() = default;
+
+    HostTensor(const std::vector<int64_t>& dims, ge::DataType dataType) : dims_(dims), dataType_(dataType) {
+        auto storage = std::make_shared<std::vector<uint8_t>>(GetByteSize());
+        data_ = storage->data();
+        holder_ = storage;
+    }
+
+    static HostTensor View(void* data, const std::vector<int64_t>& dims, ge::DataType dataType,
+                           std::shared_ptr<void> holder = nullptr) {
+        HostTensor tensor;
+        tensor.dims_ = dims;
+        tensor.dataType_ = dataType;
+        tensor.data_ = data;
+        tensor.holder_ = holder;
+        return tensor;
+    }
+
+    // View of a Const payload. It is immutable and lives as long as the graph, so kernels may cache data
+    // derived from it (pre-transformed weights) keyed by its address. `holder` keeps an external payload alive,
+    // e.g. a table mmapped from a weight file.
+    static HostTensor ConstView(const void* data, const std::vector<int64_t>& dims, ge::DataType dataType,
+                                std::shared_ptr<void> holder = nullptr) {
+        HostTensor tensor = View(const_cast<void*>(data), dims, dataType, holder);
+        tensor.constant_ = true;
+        return tensor;
+    }
+
+    // The view keeps the AiTensor alive.
+    static HostTensor View(const std::shared_ptr<hiai::AiTensor>& tensor, const std::vector<int64_t>& dims,
+                           ge::DataType dataType = ge::DT_FLOAT) {
+        return View(tensor->GetBuffer(), dims, dataType, tensor);
+    }
+
+    bool IsValid() const { return data_ != nullptr; }
+    bool IsConstant() const { return constant_; }
+    const std::vector<int64_t>& GetDims() const { return dims_; }
+    int64_t GetDim(size_t index) const { return index < dims_.size() ? dims_[index] : 1; }
+    size_t GetDimNum() const { return dims_.size(); }
+    ge::DataType GetDataType() const { return dataType_; }
+    void* GetData() const { return data_; }
+
+    template<typename T>
+    T* Data() const {
+        return static_cast<T*>(data_);
+    }
+
+    size_t GetElementNum() const { return GetElementNum(dims_); }
+
+    size_t GetByteSize() const { return GetElementNum() * GetDataTypeSize(dataType_); }
+
+    static size_t GetElementNum(const std::vector<int64_t>& dims) {
+        size_t num = 1;
+        for (auto dim : dims) {
+            num *= static_cast<size_t>(dim);
+        }
+        return num;
+    }
+
+    // Reuses the bound buffer when it has the right byte size (pre-bound AiTensor or arena slice),
+    // otherwise allocates a fresh one.
+    void Prepare(const std::vector<int64_t>& dims, ge::DataType dataType) {
+        if (IsValid() && !constant_ && GetElementNum(dims) * GetDataTypeSize(dataType) == GetByteSize()) {
+            dims_ = dims;
+            dataType_ = dataType;
+            return;
+        }
+        *this = HostTensor(dims, dataType);
+    }
+
+private:
+    std::vector<int64_t> dims_;
+    ge::DataType dataType_ = ge::DT_FLOAT;
+    void* data_ = nullptr;
+    std::shared_ptr<void> holder_;
+    bool constant_ = false;
+};
+
+inline std::vector<int64_t> GetDescDims(const ge::TensorDesc& desc) {
+    return desc.GetShape().GetDims();
+}
+
+// Inputs of a kernel are read only. outputs[i] may already be bound to a buffer, kernels go through
+// HostTensor::Prepare so that they write into it in place.
+using KernelFunc = std::function<bool(const Node& node, const std::vector<HostTensor>& inputs,
+                                      std::vector<HostTensor>& outputs)>;
+
+class KernelRegistry {
+public:
+    void Register(const std::string& type, const KernelFunc& func) { kernels_[type] = func; }
+
+    const KernelFunc* Find(const std::string& type) const {
+        auto it = kernels_.find(type);
+        return it == kernels_.end() ? nullptr : &it->second;
+    }
+
+    bool Has(const std::string& type) const { return kernels_.count(type) != 0; }
+
+private:
+    std::map<std::string, KernelFunc> kernels_;
+};
+
+using TensorMap = std::map<TensorRef, HostTensor>;
+
+class Executor {
+public:
+    Executor(const Graph& graph, const KernelRegistry& registry) : graph_(graph), registry_(registry) {}
+
+    // Runs `nodes` in the given (topological) order. Every input that is not produced by one of `nodes`
+    // must already be in `tensors`, except Const outputs which are served from the node payload unless
+    // `tensors` already binds them (see BindConstFromNpy). Entries of `tensors` for outputs of `nodes` are used
+    // as pre-bound output buffers when present.
+    bool Run(const std::vector<int>& nodes, TensorMap& tensors) const {
+        for (int index : nodes) {
+            const Node& node = graph_.GetNode(index);
+            if (node.type == "Const") {
+                if (tensors.count(Ref(index, 0)) == 0) {
+                    tensors[Ref(index, 0)] = ConstTensor(node);
+                }
+                continue;
+            }
+            if (node.type == "Data") {
+                if (tensors.count(Ref(index, 0)) == 0) {
+                    ALOGE("[HOST_EXECUTOR] input %s is not fed.\n", node.name.c_str());
+                    return false;
+                }
+                continue;
+            }
+            const KernelFunc* kernel = registry_.Find(node.type);
+            if (kernel == nullptr) {
+                ALOGE("[HOST_EXECUTOR] no host kernel for %s(%s).\n", node.name.c_str(), node.type.c_str());
+                return false;
+            }
+            std::vector<HostTensor> inputs;
+            for (const auto& input : node.inputs) {
+                auto it = tensors.find(input);
+                if (it == tensors.end()) {
+                    if (graph_.GetNode(input.node).type != "Const") {
+                        ALOGE("[HOST_EXECUTOR] %s: input from %s is missing.\n", node.name.c_str(),
+                              graph_.GetNode(input.node).name.c_str());
+                        return false;
+                    }
+                    it = tensors.emplace(input, ConstTensor(graph_.GetNode(input.node))).first;
+                }
+                inputs.push_back(it->second);
+            }
+            std::vector<HostTensor> outputs(node.GetOutputNum());
+            for (size_t i = 0; i < outputs.size(); i++) {
+                auto it = tensors.find(Ref(index, static_cast<int>(i)));
+                if (it != tensors.end()) {
+                    outputs[i] = it->second;
+                }
+            }
+            if (!(*kernel)(node, inputs, outputs)) {
+                ALOGE("[HOST_EXECUTOR] kernel %s(%s) failed.\n", node.name.c_str(), node.type.c_str());
+                return false;
+            }
+            for (size_t i = 0; i < outputs.size(); i++) {
+                tensors[Ref(index, static_cast<int>(i))] = outputs[i];
+            }
+        }
+        return true;
+    }
+
+    // Runs the whole graph, inputs are given in graph input order. `bound` pre-binds output buffers of
+    // intermediate tensors, e.g. the views of a memory_planner::Arena.
+    bool Run(const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs,
+             const TensorMap& bound = TensorMap()) const {
+        const auto& dataNodes = graph_.GetInputs();
+        if (inputs.size() != dataNodes.size()) {
+            ALOGE("[HOST_EXECUTOR] expect %zu inputs, got %zu.\n", dataNodes.size(), inputs.size());
+            return false;
+        }
+        TensorMap tensors = bound;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            tensors[Ref(dataNodes[i], 0)] = inputs[i];
+        }
+        std::vector<int> nodes(graph_.GetNodes().size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i] = static_cast<int>(i);
+        }
+        if (!Run(nodes, tensors)) {
+            return false;
+        }
+        outputs.clear();
+        for (const auto& ref : graph_.GetOutputs()) {
+            outputs.push_back(tensors[ref]);
+        }
+        return true;
+    }
+
+    static TensorRef Ref(int node, int index) {
+        TensorRef ref;
+        ref.node = node;
+        ref.index = index;
+        return ref;
+    }
+
+    static HostTensor ConstTensor(const Node& node) {
+        const ge::TensorDesc& desc = node.outputDescs[0];
+        return HostTensor::ConstView(node.constData.data(), GetDescDims(desc), desc.GetDataType());
+    }
+
+private:
+    const Graph& graph_;
+    const KernelRegistry& registry_;
+};
+
+// Serves the Const `name` from an .npy mapped for random access instead of its payload, for embedding tables
+// too large to copy into the graph: add the Const with an empty payload and pass `bound` to Executor::Run.
+// The array must match the Const's dims and data type.
+inline bool BindConstFromNpy(const Graph& graph, const std::string& name, const std::string& path,
+                             TensorMap& bound) {
+    int index = graph.FindNode(name);
+    if (index < 0 || graph.GetNode(index).type != "Const") {
+        ALOGE("[HOST_EXECUTOR] %s is not a Const.\n", name.c_str());
+        return false;
+    }
+    npy_io::NpyArray array;
+    if (!npy_io::ReadNpy(path, array, true)) {
+        return false;
+    }
+    const ge::TensorDesc& desc = graph.GetNode(index).outputDescs[0];
+    const char* descr = npy_io::GetDescr(desc.GetDataType());
+    if (array.GetShape() != GetDescDims(desc) || descr == nullptr || array.GetDescr() != descr) {
+        ALOGE("[HOST_EXECUTOR] %s: %s does not match the Const's dims or data type.\n", name.c_str(),
+              path.c_str());
+        return false;
+    }
+    bound[Executor::Ref(index, 0)] = HostTensor::ConstView(array.GetData(), GetDescDims(desc), desc.GetDataType(),
+                                                           array.GetHolder());
+    return true;
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_EXECUTOR_H
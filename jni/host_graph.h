@@ -0,0 +1,395 @@
+#ifndef BUILD_IR_MODEL_HOST_GRAPH_H
+#define BUILD_IR_MODEL_HOST_GRAPH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "graph/graph.h"
+#include "graph/op/all_ops.h"
+#include "graph/compatible/all_ops.h"
+#include "log_util.h"
+
+// ge::Graph does not expose its topology, so graphs that need host side analysis (partitioning, host
+// execution, ...) are described through host_graph::Graph. It wires the real ge::Operator objects exactly
+// like the generated set_input_xxx/set_attr_xxx setters do and keeps a copy of the topology and attributes.
+//
+//     host_graph::Graph graph("ir_graph");
+//     auto x = graph.AddData("data", ge::TensorDesc(ge::Shape({1, 32, 192, 192})));
+//     auto size = graph.AddConst("size", sizeDesc, sizeData.data(), sizeBytes);
+//     auto y = graph.AddNode(hiai::op::ResizeBilinearV2("resize"), "ResizeBilinearV2")
+//         .Input("x", x).Input("size", size).Attr("half_pixel_centers", true).Output();
+//     graph.SetOutputs({y});
+//
+// Nodes can only consume nodes added before them, so node order is always a topological order.
+namespace host_graph {
+struct TensorRef {
+    int node = -1;
+    int index = 0;
+
+    bool operator==(const TensorRef& other) const { return node == other.node && index == other.index; }
+    bool operator<(const TensorRef& other) const {
+        return node < other.node || (node == other.node && index < other.index);
+    }
+};
+
+struct Attr {
+    std::vector<int64_t> ints;
+    std::vector<float> floats;
+    std::string str;
+};
+
+inline size_t GetDataTypeSize(ge::DataType dataType) {
+    switch (dataType) {
+        case ge::DT_FLOAT:
+        case ge::DT_INT32:
+        case ge::DT_UINT32:
+            return 4;
+        case ge::DT_FLOAT16:
+        case ge::DT_INT16:
+        case ge::DT_UINT16:
+            return 2;
+        case ge::DT_INT64:
+        case ge::DT_UINT64:
+        case ge::DT_DOUBLE:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+struct Node {
+    std::string name;
+    std::string type;
+    ge::Operator op;
+    std::vector<std::string> inputNames;
+    std::vector<TensorRef> inputs;
+    std::vector<std::string> outputNames;
+    std::vector<ge::TensorDesc> outputDescs;
+    std::map<std::string, Attr> attrs;
+    // Const payload, kept on the host side so that host kernels can read weights without going through ge::Tensor
+    std::vector<uint8_t> constData;
+
+    bool HasAttr(const std::string& key) const { return attrs.count(key) != 0; }
+
+    int64_t GetInt(const std::string& key, int64_t defaultValue = 0) const {
+        auto it = attrs.find(key);
+        return (it == attrs.end() || it->second.ints.empty()) ? defaultValue : it->second.ints[0];
+    }
+
+    bool GetBool(const std::string& key, bool defaultValue = false) const {
+        return GetInt(key, defaultValue ? 1 : 0) != 0;
+    }
+
+    float GetFloat(const std::string& key, float defaultValue = 0.0f) const {
+        auto it = attrs.find(key);
+        return (it == attrs.end() || it->second.floats.empty()) ? defaultValue : it->second.floats[0];
+    }
+
+    std::vector<int64_t> GetInts(const std::string& key, const std::vector<int64_t>& defaultValue = {}) const {
+        auto it = attrs.find(key);
+        return it == attrs.end() ? defaultValue : it->second.ints;
+    }
+
+    std::vector<float> GetFloats(const std::string& key) const {
+        auto it = attrs.find(key);
+        return it == attrs.end() ? std::vector<float>() : it->second.floats;
+    }
+
+    std::string GetString(const std::string& key, const std::string& defaultValue = "") const {
+        auto it = attrs.find(key);
+        return it == attrs.end() ? defaultValue : it->second.str;
+    }
+
+    int FindInput(const std::string& inputName) const {
+        for (size_t i = 0; i < inputNames.size(); i++) {
+            if (inputNames[i] == inputName) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    size_t GetOutputNum() const {
+        return std::max<size_t>(1, std::max(outputNames.size(), outputDescs.size()));
+    }
+};
+
+class Graph;
+
+class NodeBuilder {
+public:
+    NodeBuilder(Graph& graph, int node) : graph_(graph), node_(node) {}
+
+    NodeBuilder& Input(const std::string& inputName, const TensorRef& src);
+    NodeBuilder& Attr(const std::string& key, int64_t value);
+    NodeBuilder& Attr(const std::string& key, int value) { return Attr(key, static_cast<int64_t>(value)); }
+    NodeBuilder& Attr(const std::string& key, bool value);
+    NodeBuilder& Attr(const std::string& key, float value);
+    NodeBuilder& Attr(const std::string& key, const std::string& value);
+    NodeBuilder& Attr(const std::string& key, const char* value) { return Attr(key, std::string(value)); }
+    NodeBuilder& Attr(const std::string& key, const std::vector<int64_t>& value);
+    NodeBuilder& Attr(const std::string& key, const std::vector<float>& value);
+    // Output names are only needed to consume outputs other than the first one.
+    NodeBuilder& OutputNames(const std::vector<std::string>& names);
+    NodeBuilder& OutputDesc(int index, const ge::TensorDesc& desc);
+
+    TensorRef Output(int index = 0) const {
+        TensorRef ref;
+        ref.node = node_;
+        ref.index = index;
+        return ref;
+    }
+
+    int GetNodeIndex() const { return node_; }
+
+private:
+    Node& GetNode();
+
+    Graph& graph_;
+    int node_;
+};
+
+class Graph {
+public:
+    explicit Graph(const std::string& name) : name_(name) {}
+
+    const std::string& GetName() const { return name_; }
+
+    TensorRef AddData(const std::string& name, const ge::TensorDesc& desc) {
+        auto data = ge::op::Data(name);
+        data.update_input_desc_x(desc);
+        Node node;
+        node.name = name;
+        node.type = "Data";
+        node.op = data;
+        node.outputDescs.push_back(desc);
+        nodes_.push_back(node);
+        inputs_.push_back(static_cast<int>(nodes_.size()) - 1);
+        TensorRef ref;
+        ref.node = static_cast<int>(nodes_.size()) - 1;
+        return ref;
+    }
+
+    TensorRef AddConst(const std::string& name, const ge::TensorDesc& desc, const void* data, size_t size) {
+        auto constOp = hiai::op::Const(name);
+        ge::TensorPtr weight = std::make_shared<ge::Tensor>();
+        weight->SetTensorDesc(desc);
+        weight->SetData(static_cast<const uint8_t*>(data), size);
+        constOp.set_attr_value(weight);
+        Node node;
+        node.name = name;
+        node.type = "Const";
+        node.op = constOp;
+        node.outputDescs.push_back(desc);
+        node.constData.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        nodes_.push_back(node);
+        TensorRef ref;
+        ref.node = static_cast<int>(nodes_.size()) - 1;
+        return ref;
+    }
+
+    // `type` is the REG_OP name of the operator, e.g. "Convolution" for hiai::op::Convolution.
+    NodeBuilder AddNode(const ge::Operator& op, const std::string& type) {
+        Node node;
+        node.name = op.GetName();
+        node.type = type;
+        node.op = op;
+        nodes_.push_back(node);
+        return NodeBuilder(*this, static_cast<int>(nodes_.size()) - 1);
+    }
+
+    // Swaps the operator of a node in place, e.g. Convolution -> QuantizedConvolution. Inputs and attributes
+    // start empty and are set again through the returned builder; consumers are rewired to the new operator.
+    NodeBuilder ReplaceNode(int index, const ge::Operator& op, const std::string& type);
+
+    // Replaces the payload of a Const node, consumers keep reading the same operator.
+    void SetConst(int index, const ge::TensorDesc& desc, const void* data, size_t size) {
+        Node& node = nodes_[index];
+        ge::TensorPtr weight = std::make_shared<ge::Tensor>();
+        weight->SetTensorDesc(desc);
+        weight->SetData(static_cast<const uint8_t*>(data), size);
+        node.op.SetAttr("value", ge::AttrValue::CreateFrom<ge::AttrValue::TENSOR>(weight));
+        node.outputDescs.assign(1, desc);
+        node.constData.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    }
+
+    Graph& SetOutputs(const std::vector<TensorRef>& outputs) {
+        outputs_ = outputs;
+        return *this;
+    }
+
+    const std::vector<Node>& GetNodes() const { return nodes_; }
+    std::vector<Node>& MutableNodes() { return nodes_; }
+    const Node& GetNode(int index) const { return nodes_[index]; }
+    Node& MutableNode(int index) { return nodes_[index]; }
+    const std::vector<int>& GetInputs() const { return inputs_; }
+    const std::vector<TensorRef>& GetOutputs() const { return outputs_; }
+
+    int FindNode(const std::string& name) const {
+        for (size_t i = 0; i < nodes_.size(); i++) {
+            if (nodes_[i].name == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // consumers[node] lists the indices of the nodes reading any output of `node`
+    std::vector<std::vector<int>> GetConsumers() const {
+        std::vector<std::vector<int>> consumers(nodes_.size());
+        for (size_t i = 0; i < nodes_.size(); i++) {
+            for (const auto& input : nodes_[i].inputs) {
+                auto& list = consumers[input.node];
+                if (list.empty() || list.back() != static_cast<int>(i)) {
+                    list.push_back(static_cast<int>(i));
+                }
+            }
+        }
+        return consumers;
+    }
+
+    bool HasOutputDesc(const TensorRef& ref) const {
+        return ref.node >= 0 && ref.node < static_cast<int>(nodes_.size()) &&
+               ref.index < static_cast<int>(nodes_[ref.node].outputDescs.size());
+    }
+
+    // Inputs that could not be wired to their ge producer, see Connect.
+    size_t GetBrokenInputNum() const { return brokenInputNum_; }
+
+    // False when an input could not be wired; the ge graph would not compute what the host one does.
+    bool ToGeGraph(ge::Graph& graph) const {
+        if (brokenInputNum_ > 0) {
+            ALOGE("[HOST_GRAPH] %s: %zu inputs read unnamed outputs, set OutputNames on their producers.\n",
+                  name_.c_str(), brokenInputNum_);
+            return false;
+        }
+        std::vector<ge::Operator> inputs;
+        for (int index : inputs_) {
+            inputs.push_back(nodes_[index].op);
+        }
+        std::vector<ge::Operator> outputs;
+        std::vector<int> added;
+        for (const auto& ref : outputs_) {
+            if (std::find(added.begin(), added.end(), ref.node) == added.end()) {
+                added.push_back(ref.node);
+                outputs.push_back(nodes_[ref.node].op);
+            }
+        }
+        graph.SetInputs(inputs).SetOutputs(outputs);
+        return true;
+    }
+
+private:
+    friend class NodeBuilder;
+
+    std::string name_;
+    std::vector<Node> nodes_;
+    std::vector<int> inputs_;
+    std::vector<TensorRef> outputs_;
+    size_t brokenInputNum_ = 0;
+};
+
+inline Node& NodeBuilder::GetNode() {
+    return graph_.MutableNode(node_);
+}
+
+// False, leaving the ge input unset, when output srcIndex > 0 has no name: ge would read output 0 while the
+// host executor reads srcIndex.
+inline bool Connect(Node& node, const std::string& inputName, const Node& srcNode, int srcIndex) {
+    if (srcIndex == 0) {
+        node.op.SetInput(inputName, srcNode.op);
+        return true;
+    }
+    if (srcIndex < 0 || static_cast<size_t>(srcIndex) >= srcNode.outputNames.size()) {
+        ALOGE("[HOST_GRAPH] %s: input %s reads output %d of %s, which has %zu output names.\n", node.name.c_str(),
+              inputName.c_str(), srcIndex, srcNode.name.c_str(), srcNode.outputNames.size());
+        return false;
+    }
+    node.op.SetInput(inputName, srcNode.op, srcNode.outputNames[srcIndex]);
+    return true;
+}
+
+inline NodeBuilder Graph::ReplaceNode(int index, const ge::Operator& op, const std::string& type) {
+    Node& node = nodes_[index];
+    node.name = op.GetName();
+    node.type = type;
+    node.op = op;
+    node.inputNames.clear();
+    node.inputs.clear();
+    node.attrs.clear();
+    for (auto& consumer : nodes_) {
+        for (size_t i = 0; i < consumer.inputs.size(); i++) {
+            if (consumer.inputs[i].node == index &&
+                !Connect(consumer, consumer.inputNames[i], node, consumer.inputs[i].index)) {
+                brokenInputNum_++;
+            }
+        }
+    }
+    return NodeBuilder(*this, index);
+}
+
+inline NodeBuilder& NodeBuilder::Input(const std::string& inputName, const TensorRef& src) {
+    Node& node = GetNode();
+    if (!Connect(node, inputName, graph_.GetNode(src.node), src.index)) {
+        graph_.brokenInputNum_++;
+    }
+    node.inputNames.push_back(inputName);
+    node.inputs.push_back(src);
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, int64_t value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::INT>(value));
+    GetNode().attrs[key].ints = {value};
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, bool value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::BOOL>(value));
+    GetNode().attrs[key].ints = {value ? 1 : 0};
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, float value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::FLOAT>(value));
+    GetNode().attrs[key].floats = {value};
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, const std::string& value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::STR>(value));
+    GetNode().attrs[key].str = value;
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, const std::vector<int64_t>& value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::LIST_INT>(value));
+    GetNode().attrs[key].ints = value;
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::Attr(const std::string& key, const std::vector<float>& value) {
+    GetNode().op.SetAttr(key, ge::AttrValue::CreateFrom<ge::AttrValue::LIST_FLOAT>(value));
+    GetNode().attrs[key].floats = value;
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::OutputNames(const std::vector<std::string>& names) {
+    GetNode().outputNames = names;
+    return *this;
+}
+
+inline NodeBuilder& NodeBuilder::OutputDesc(int index, const ge::TensorDesc& desc) {
+    auto& descs = GetNode().outputDescs;
+    if (descs.size() <= static_cast<size_t>(index)) {
+        descs.resize(index + 1);
+    }
+    descs[index] = desc;
+    return *this;
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_GRAPH_H
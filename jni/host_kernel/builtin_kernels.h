@@ -0,0 +1,501 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_BUILTIN_KERNELS_H
+#define BUILD_IR_MODEL_HOST_KERNEL_BUILTIN_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "host_executor.h"
+#include "host_kernel/detection.h"
+#include "host_kernel/gather.h"
+#include "host_kernel/nn.h"
+#include "host_kernel/normalization.h"
+#include "host_kernel/resize.h"
+#include "host_kernel/top_k.h"
+#include "layout_util.h"
+#include "weight_quant.h"
+
+// Adapters from host_graph nodes to the host kernels. Attribute names and defaults follow the REG_OP
+// definitions in graph/op/*.h.
+namespace host_kernel {
+using host_graph::HostTensor;
+using host_graph::Node;
+
+inline bool SqrtKernel(const Node&, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    const float* src = x.Data<float>();
+    float* dst = outputs[0].Data<float>();
+    parallel_util::ParallelFor(0, x.GetElementNum(), [src, dst](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            dst[i] = std::sqrt(src[i]);
+        }
+    }, 0, 1 << 16);
+    return true;
+}
+
+// Outputs: detect_scores [1, N], rois [1, N, 4], detect_class [1, N] (int32), actual_rois_num [1] (int32)
+// with N = max_num_detections * max_classes_per_detection. Unused slots are zero.
+inline bool DetectionPostprocessingKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                          std::vector<HostTensor>& outputs) {
+    const HostTensor& score = inputs[0];
+    const HostTensor& delta = inputs[1];
+    const HostTensor& anchors = inputs[2];
+    // Executor gives one output slot per name, only one when OutputNames was not set
+    if (outputs.size() < 4) {
+        ALOGE("[HOST_KERNEL] %s: needs 4 outputs, the node has %zu.\n", node.name.c_str(), outputs.size());
+        return false;
+    }
+    size_t numAnchors = delta.GetElementNum() / 4;
+    if (numAnchors == 0 || anchors.GetElementNum() != numAnchors * 4) {
+        return false;
+    }
+    size_t numClasses = score.GetElementNum() / numAnchors;
+    DetectionParam param;
+    param.decode.scaleY = node.GetFloat("scale_y");
+    param.decode.scaleX = node.GetFloat("scale_x");
+    param.decode.scaleH = node.GetFloat("scale_h");
+    param.decode.scaleW = node.GetFloat("scale_w");
+    param.maxNumDetections = static_cast<int>(node.GetInt("max_num_detections"));
+    param.scoreThreshold = node.GetFloat("score_threshold");
+    param.iouThreshold = node.GetFloat("iou_threshold");
+    param.useRegularNms = node.GetBool("use_regular_nms", false);
+    param.maxClassesPerDetection = static_cast<int>(node.GetInt("max_classes_per_detection", 1));
+    param.maxDetectionsPerClass = static_cast<int>(node.GetInt("max_detections_per_class", 1));
+    param.isBgInLabel = node.GetBool("is_bg_in_label", false);
+
+    std::vector<float> boxes(numAnchors * 4);
+    std::vector<Detection> detections = DetectionPostprocess(score.Data<float>(), delta.Data<float>(),
+        anchors.Data<float>(), numAnchors, numClasses, param, boxes.data());
+
+    int64_t slots = param.maxNumDetections * (param.useRegularNms ? 1 : std::max(param.maxClassesPerDetection, 1));
+    outputs[0].Prepare({1, slots}, ge::DT_FLOAT);
+    outputs[1].Prepare({1, slots, 4}, ge::DT_FLOAT);
+    outputs[2].Prepare({1, slots}, ge::DT_INT32);
+    outputs[3].Prepare({1}, ge::DT_INT32);
+    for (size_t i = 0; i < 3; i++) {
+        std::fill_n(static_cast<uint8_t*>(outputs[i].GetData()), outputs[i].GetByteSize(), 0);
+    }
+    size_t num = std::min<size_t>(detections.size(), static_cast<size_t>(slots));
+    for (size_t i = 0; i < num; i++) {
+        outputs[0].Data<float>()[i] = detections[i].score;
+        std::copy(detections[i].box, detections[i].box + 4, outputs[1].Data<float>() + i * 4);
+        outputs[2].Data<int32_t>()[i] = detections[i].classId;
+    }
+    outputs[3].Data<int32_t>()[0] = static_cast<int32_t>(num);
+    return true;
+}
+
+// MatMul (transpose_x1 / transpose_x2, 2D, optional bias per column) and BatchMatMul (adj_x1 / adj_x2, equal
+// leading dims), the same shape rules as shape_inference::InferMatMul.
+inline bool MatMulKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& a = inputs[0];
+    const HostTensor& b = inputs[1];
+    bool batched = node.type == "BatchMatMul";
+    bool transA = node.GetBool(batched ? "adj_x1" : "transpose_x1");
+    bool transB = node.GetBool(batched ? "adj_x2" : "transpose_x2");
+    size_t r = a.GetDimNum();
+    if (r < 2 || b.GetDimNum() != r || (!batched && r != 2) ||
+        !std::equal(a.GetDims().begin(), a.GetDims().end() - 2, b.GetDims().begin())) {
+        ALOGE("[HOST_KERNEL] %s: can not multiply the inputs.\n", node.name.c_str());
+        return false;
+    }
+    int64_t m = transA ? a.GetDim(r - 1) : a.GetDim(r - 2);
+    int64_t k = transA ? a.GetDim(r - 2) : a.GetDim(r - 1);
+    int64_t n = transB ? b.GetDim(r - 2) : b.GetDim(r - 1);
+    int biasIndex = batched ? -1 : node.FindInput("bias");
+    if ((transB ? b.GetDim(r - 1) : b.GetDim(r - 2)) != k ||
+        (biasIndex >= 0 && inputs[biasIndex].GetElementNum() != static_cast<size_t>(n))) {
+        ALOGE("[HOST_KERNEL] %s: inner dims or bias do not match.\n", node.name.c_str());
+        return false;
+    }
+    std::vector<int64_t> dims(a.GetDims().begin(), a.GetDims().end() - 2);
+    int64_t batch = static_cast<int64_t>(HostTensor::GetElementNum(dims));
+    dims.push_back(m);
+    dims.push_back(n);
+    outputs[0].Prepare(dims, ge::DT_FLOAT);
+    Gemm(batch, m, n, k, a.Data<float>(), transA, b.Data<float>(), transB,
+         biasIndex >= 0 ? inputs[biasIndex].Data<float>() : nullptr, outputs[0].Data<float>());
+    return true;
+}
+
+// ResizeBilinear(V2) / ResizeNearestNeighbor: size is [out_h, out_w]. Interp takes its size from attributes.
+inline bool ResizeKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    if (x.GetDimNum() != 4) {
+        ALOGE("[HOST_KERNEL] %s: only 4D NCHW resize is supported.\n", node.name.c_str());
+        return false;
+    }
+    int64_t oh = 0;
+    int64_t ow = 0;
+    InterpParam interp;
+    if (node.type == "Interp") {
+        interp = GetInterpParam(node);
+        if (!InterpOutSize(interp, x.GetDim(2), x.GetDim(3), oh, ow)) {
+            ALOGE("[HOST_KERNEL] %s: bad Interp factors or pads.\n", node.name.c_str());
+            return false;
+        }
+    } else {
+        if (inputs.size() < 2 || inputs[1].GetElementNum() != 2 || inputs[1].GetDataType() != ge::DT_INT32) {
+            ALOGE("[HOST_KERNEL] %s: size must be 2 INT32 values.\n", node.name.c_str());
+            return false;
+        }
+        oh = inputs[1].Data<int32_t>()[0];
+        ow = inputs[1].Data<int32_t>()[1];
+    }
+    if (oh <= 0 || ow <= 0 || x.GetDim(2) <= 0 || x.GetDim(3) <= 0) {
+        ALOGE("[HOST_KERNEL] %s: can not resize to %lldx%lld.\n", node.name.c_str(), static_cast<long long>(oh),
+              static_cast<long long>(ow));
+        return false;
+    }
+    outputs[0].Prepare({x.GetDim(0), x.GetDim(1), oh, ow}, ge::DT_FLOAT);
+    Resize(x.Data<float>(), x.GetDim(0) * x.GetDim(1), x.GetDim(2), x.GetDim(3), GetResizeMode(node),
+           outputs[0].Data<float>(), oh, ow, interp.padBegin, interp.padEnd);
+    return true;
+}
+
+inline bool ResolveAxis(const Node& node, int64_t& axis, size_t rank) {
+    int64_t r = static_cast<int64_t>(rank);
+    if (axis < -r || axis >= r) {
+        ALOGE("[HOST_KERNEL] %s: axis %lld is out of range for rank %zu.\n", node.name.c_str(),
+              static_cast<long long>(axis), rank);
+        return false;
+    }
+    axis = axis < 0 ? axis + r : axis;
+    return true;
+}
+
+// order lists the x axis of every y axis, as in shape_inference::InferPermute.
+inline bool PermuteKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    std::vector<int64_t> order = node.GetInts("order", {0});
+    if (order.size() != x.GetDimNum()) {
+        ALOGE("[HOST_KERNEL] %s: order has %zu axes, x %zu.\n", node.name.c_str(), order.size(), x.GetDimNum());
+        return false;
+    }
+    std::vector<bool> used(order.size(), false);
+    std::vector<int64_t> dims(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        if (!ResolveAxis(node, order[i], x.GetDimNum()) || used[order[i]]) {
+            ALOGE("[HOST_KERNEL] %s: order is not a permutation.\n", node.name.c_str());
+            return false;
+        }
+        used[order[i]] = true;
+        dims[i] = x.GetDim(order[i]);
+    }
+    outputs[0].Prepare(dims, ge::DT_FLOAT);
+    layout_util::Permute(x.Data<float>(), x.GetDims(), order, outputs[0].Data<float>());
+    return true;
+}
+
+// Product of the dims [begin, end) of x.
+inline int64_t DimProduct(const HostTensor& x, size_t begin, size_t end) {
+    int64_t product = 1;
+    for (size_t i = begin; i < end; i++) {
+        product *= x.GetDim(i);
+    }
+    return product;
+}
+
+// Softmax / LogSoftmax along `axis`, which defaults to 0 for Softmax and -1 for LogSoftmax as in REG_OP.
+inline bool SoftmaxKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    bool logSoftmax = node.type == "LogSoftmax";
+    int64_t axis = node.GetInt("axis", logSoftmax ? -1 : 0);
+    if (!ResolveAxis(node, axis, x.GetDimNum())) {
+        return false;
+    }
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    Softmax(x.Data<float>(), DimProduct(x, 0, axis), x.GetDim(axis), DimProduct(x, axis + 1, x.GetDimNum()),
+            logSoftmax ? SoftmaxMode::LOG_SOFTMAX : SoftmaxMode::SOFTMAX, outputs[0].Data<float>());
+    return true;
+}
+
+// `axis` lists consecutive dims, normalized together.
+inline bool L2NormalizeKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                              std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    std::vector<int64_t> axes = node.GetInts("axis", {1});
+    for (auto& axis : axes) {
+        if (!ResolveAxis(node, axis, x.GetDimNum())) {
+            return false;
+        }
+    }
+    std::sort(axes.begin(), axes.end());
+    if (axes.empty() || axes.back() - axes.front() + 1 != static_cast<int64_t>(axes.size()) ||
+        std::adjacent_find(axes.begin(), axes.end()) != axes.end()) {
+        ALOGE("[HOST_KERNEL] %s: axis must list consecutive dims.\n", node.name.c_str());
+        return false;
+    }
+    size_t first = static_cast<size_t>(axes.front());
+    size_t last = static_cast<size_t>(axes.back()) + 1;
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    L2Normalize(x.Data<float>(), DimProduct(x, 0, first), DimProduct(x, first, last),
+                DimProduct(x, last, x.GetDimNum()), node.GetFloat("eps", 1e-4f), outputs[0].Data<float>());
+    return true;
+}
+
+// Normalizes over the dims from begin_norm_axis on. gamma / beta cover the trailing dims from begin_params_axis
+// on; their size is checked against the trailing dims rather than the attribute, which converters often leave
+// at 0. The optional mean / variance outputs are shaped as in shape_inference::InferLayerNorm.
+inline bool LayerNormKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                            std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    int64_t axis = node.GetInt("begin_norm_axis", 0);
+    int gammaIndex = node.FindInput("gamma");
+    int betaIndex = node.FindInput("beta");
+    if (!ResolveAxis(node, axis, x.GetDimNum())) {
+        return false;
+    }
+    if (gammaIndex < 0 || betaIndex < 0) {
+        ALOGE("[HOST_KERNEL] %s: gamma and beta are required.\n", node.name.c_str());
+        return false;
+    }
+    int64_t paramNum = static_cast<int64_t>(inputs[gammaIndex].GetElementNum());
+    bool trailing = false;
+    for (size_t i = 0; i <= x.GetDimNum(); i++) {
+        trailing = trailing || DimProduct(x, i, x.GetDimNum()) == paramNum;
+    }
+    if (paramNum == 0 || !trailing || inputs[betaIndex].GetElementNum() != inputs[gammaIndex].GetElementNum()) {
+        ALOGE("[HOST_KERNEL] %s: gamma / beta do not cover trailing dims of x.\n", node.name.c_str());
+        return false;
+    }
+    std::vector<int64_t> statDims = x.GetDims();
+    std::fill(statDims.begin() + axis, statDims.end(), 1);
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    for (size_t i = 1; i < outputs.size() && i < 3; i++) {
+        outputs[i].Prepare(statDims, ge::DT_FLOAT);
+    }
+    LayerNorm(x.Data<float>(), DimProduct(x, 0, axis), DimProduct(x, axis, x.GetDimNum()),
+              inputs[gammaIndex].Data<float>(), inputs[betaIndex].Data<float>(), paramNum,
+              node.GetFloat("epsilon", 1e-7f), outputs[0].Data<float>(),
+              outputs.size() > 1 ? outputs[1].Data<float>() : nullptr,
+              outputs.size() > 2 ? outputs[2].Data<float>() : nullptr);
+    return true;
+}
+
+// TopK along the last dimension of x; k is the scalar int32 input.
+inline bool TopKKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    if (x.GetDimNum() == 0 || inputs[1].GetElementNum() != 1 || inputs[1].GetDataType() != ge::DT_INT32) {
+        ALOGE("[HOST_KERNEL] %s: x needs a rank and k must be an int32 scalar.\n", node.name.c_str());
+        return false;
+    }
+    // the op also takes int32 / uint8 x, which the float selection would misread
+    if (x.GetDataType() != ge::DT_FLOAT) {
+        ALOGE("[HOST_KERNEL] %s: x has data type %d, only float is supported.\n", node.name.c_str(),
+              static_cast<int>(x.GetDataType()));
+        return false;
+    }
+    int64_t num = x.GetDim(x.GetDimNum() - 1);
+    int64_t k = inputs[1].Data<int32_t>()[0];
+    if (k < 1 || k > num) {
+        ALOGE("[HOST_KERNEL] %s: k %lld is out of range for %lld values.\n", node.name.c_str(),
+              static_cast<long long>(k), static_cast<long long>(num));
+        return false;
+    }
+    std::vector<int64_t> dims = x.GetDims();
+    dims.back() = k;
+    outputs[0].Prepare(dims, ge::DT_FLOAT);
+    // the indices go to a scratch buffer when the node does not expose them
+    std::vector<int32_t> localIndices;
+    int32_t* indices = nullptr;
+    if (outputs.size() > 1) {
+        outputs[1].Prepare(dims, ge::DT_INT32);
+        indices = outputs[1].Data<int32_t>();
+    } else {
+        localIndices.resize(HostTensor::GetElementNum(dims));
+        indices = localIndices.data();
+    }
+    TopK(x.Data<float>(), DimProduct(x, 0, x.GetDimNum() - 1), num, k, node.GetBool("sorted", true),
+         outputs[0].Data<float>(), indices);
+    return true;
+}
+
+// ArgMaxExt2 with the supported attributes: int32 output, outmaxval false, topk 1.
+inline bool ArgMaxKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    if (inputs[1].GetElementNum() != 1 || inputs[1].GetDataType() != ge::DT_INT32) {
+        ALOGE("[HOST_KERNEL] %s: axis must be an int32 scalar.\n", node.name.c_str());
+        return false;
+    }
+    if (x.GetDataType() != ge::DT_FLOAT) {
+        ALOGE("[HOST_KERNEL] %s: x has data type %d, only float is supported.\n", node.name.c_str(),
+              static_cast<int>(x.GetDataType()));
+        return false;
+    }
+    if (node.GetInt("output_type", ge::DT_INT32) != ge::DT_INT32 || node.GetBool("outmaxval") ||
+        node.GetInt("topk", 1) != 1) {
+        ALOGE("[HOST_KERNEL] %s: only int32 indices of the max are supported.\n", node.name.c_str());
+        return false;
+    }
+    int64_t axis = inputs[1].Data<int32_t>()[0];
+    if (!ResolveAxis(node, axis, x.GetDimNum())) {
+        return false;
+    }
+    std::vector<int64_t> dims = x.GetDims();
+    if (node.GetBool("keep_dims")) {
+        dims[axis] = 1;
+    } else {
+        dims.erase(dims.begin() + axis);
+    }
+    outputs[0].Prepare(dims, ge::DT_INT32);
+    ArgMax(x.Data<float>(), DimProduct(x, 0, axis), x.GetDim(axis), DimProduct(x, axis + 1, x.GetDimNum()),
+           outputs[0].Data<int32_t>());
+    return true;
+}
+
+// Gather (params, indices, axis 0 by default) and GatherV2D (x, indices, required axis):
+// y.dims = x.dims[:axis] + indices.dims + x.dims[axis + 1:]. Rows are copied as bytes, float and int32 tables alike.
+inline bool GatherKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    const HostTensor& indices = inputs[1];
+    int64_t axis = node.GetInt("axis", 0);
+    if (!ResolveAxis(node, axis, x.GetDimNum())) {
+        return false;
+    }
+    if (indices.GetDataType() != ge::DT_INT32) {
+        ALOGE("[HOST_KERNEL] %s: indices must be int32.\n", node.name.c_str());
+        return false;
+    }
+    std::vector<int64_t> rows(indices.Data<int32_t>(), indices.Data<int32_t>() + indices.GetElementNum());
+    std::vector<int64_t> dims(x.GetDims().begin(), x.GetDims().begin() + axis);
+    dims.insert(dims.end(), indices.GetDims().begin(), indices.GetDims().end());
+    dims.insert(dims.end(), x.GetDims().begin() + axis + 1, x.GetDims().end());
+    outputs[0].Prepare(dims, x.GetDataType());
+    int64_t rowBytes = DimProduct(x, axis + 1, x.GetDimNum()) *
+                       static_cast<int64_t>(host_graph::GetDataTypeSize(x.GetDataType()));
+    if (!GatherRows(x.GetData(), DimProduct(x, 0, axis), x.GetDim(axis), rowBytes, rows.data(),
+                    static_cast<int64_t>(rows.size()), outputs[0].GetData())) {
+        ALOGE("[HOST_KERNEL] %s: an index is out of range for %lld rows.\n", node.name.c_str(),
+              static_cast<long long>(x.GetDim(axis)));
+        return false;
+    }
+    return true;
+}
+
+// Flat rows of the index tuples of indices [..., depth] into the leading dims of `dims`. Float indices are
+// accepted as GatherNd declares them.
+inline bool IndexTupleRows(const Node& node, const HostTensor& indices, const std::vector<int64_t>& dims,
+                           std::vector<int64_t>& rows) {
+    int64_t depth = indices.GetDimNum() == 0 ? 0 : indices.GetDim(indices.GetDimNum() - 1);
+    if (depth < 1 || depth > static_cast<int64_t>(dims.size())) {
+        ALOGE("[HOST_KERNEL] %s: index depth %lld does not fit rank %zu.\n", node.name.c_str(),
+              static_cast<long long>(depth), dims.size());
+        return false;
+    }
+    int64_t num = static_cast<int64_t>(indices.GetElementNum()) / depth;
+    bool ok = indices.GetDataType() == ge::DT_FLOAT ?
+        gather::NdRows(indices.Data<float>(), num, depth, dims, rows) :
+        indices.GetDataType() == ge::DT_INT32 && gather::NdRows(indices.Data<int32_t>(), num, depth, dims, rows);
+    if (!ok) {
+        ALOGE("[HOST_KERNEL] %s: indices are not int32 / float or out of range.\n", node.name.c_str());
+    }
+    return ok;
+}
+
+// y.dims = indices.dims[:-1] + x.dims[depth:].
+inline bool GatherNdKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                           std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    const HostTensor& indices = inputs[1];
+    std::vector<int64_t> rows;
+    if (!IndexTupleRows(node, indices, x.GetDims(), rows)) {
+        return false;
+    }
+    size_t depth = static_cast<size_t>(indices.GetDim(indices.GetDimNum() - 1));
+    std::vector<int64_t> dims(indices.GetDims().begin(), indices.GetDims().end() - 1);
+    dims.insert(dims.end(), x.GetDims().begin() + depth, x.GetDims().end());
+    outputs[0].Prepare(dims, x.GetDataType());
+    int64_t rowBytes = DimProduct(x, depth, x.GetDimNum()) *
+                       static_cast<int64_t>(host_graph::GetDataTypeSize(x.GetDataType()));
+    return GatherRows(x.GetData(), 1, DimProduct(x, 0, depth), rowBytes, rows.data(),
+                      static_cast<int64_t>(rows.size()), outputs[0].GetData());
+}
+
+// y = zeros(shape) with the rows of x (updates) added at the index tuples; repeated tuples sum up.
+inline bool ScatterNdKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                            std::vector<HostTensor>& outputs) {
+    const HostTensor& indices = inputs[0];
+    const HostTensor& x = inputs[1];
+    const HostTensor& shape = inputs[2];
+    if (shape.GetDataType() != ge::DT_INT32) {
+        ALOGE("[HOST_KERNEL] %s: shape must be int32.\n", node.name.c_str());
+        return false;
+    }
+    std::vector<int64_t> dims(shape.Data<int32_t>(), shape.Data<int32_t>() + shape.GetElementNum());
+    std::vector<int64_t> rows;
+    if (!IndexTupleRows(node, indices, dims, rows)) {
+        return false;
+    }
+    size_t depth = static_cast<size_t>(indices.GetDim(indices.GetDimNum() - 1));
+    int64_t rowNum = static_cast<int64_t>(HostTensor::GetElementNum({dims.begin(), dims.begin() + depth}));
+    int64_t rowSize = static_cast<int64_t>(HostTensor::GetElementNum({dims.begin() + depth, dims.end()}));
+    if (x.GetElementNum() != rows.size() * static_cast<size_t>(rowSize)) {
+        ALOGE("[HOST_KERNEL] %s: %zu updates for %zu rows of %lld.\n", node.name.c_str(), x.GetElementNum(),
+              rows.size(), static_cast<long long>(rowSize));
+        return false;
+    }
+    outputs[0].Prepare(dims, ge::DT_FLOAT);
+    return ScatterAddRows(x.Data<float>(), rows.data(), static_cast<int64_t>(rows.size()), rowSize,
+                          outputs[0].Data<float>(), rowNum);
+}
+
+// Channels are the last dimension of x, min / max hold one value per channel.
+inline bool FakeQuantWithMinMaxVarsPerChannelKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                                    std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    size_t channels = static_cast<size_t>(x.GetDim(x.GetDimNum() - 1));
+    if (x.GetDimNum() == 0 || inputs[1].GetElementNum() != channels || inputs[2].GetElementNum() != channels) {
+        return false;
+    }
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    weight_quant::FakeQuantPerChannel(x.Data<float>(), x.GetElementNum() / channels, channels,
+                                      inputs[1].Data<float>(), inputs[2].Data<float>(),
+                                      static_cast<int>(node.GetInt("num_bits", 8)), node.GetBool("narrow_range"),
+                                      outputs[0].Data<float>());
+    return true;
+}
+
+inline void RegisterBuiltinKernels(host_graph::KernelRegistry& registry) {
+    registry.Register("Sqrt", SqrtKernel);
+    registry.Register("DetectionPostprocessing", DetectionPostprocessingKernel);
+    registry.Register("Convolution", ConvolutionKernel);
+    registry.Register("ConvolutionDepthwise", ConvolutionKernel);
+    registry.Register("FullyConnection", FullyConnectionKernel);
+    registry.Register("Activation", ActivationKernel);
+    registry.Register("QuantizedConvolution", QuantizedConvolutionKernel);
+    registry.Register("QuantizedConvolutionDepthwise", QuantizedConvolutionKernel);
+    registry.Register("QuantizedFullyConnection", QuantizedFullyConnectionKernel);
+    registry.Register("FakeQuantWithMinMaxVarsPerChannel", FakeQuantWithMinMaxVarsPerChannelKernel);
+    registry.Register("MatMul", MatMulKernel);
+    registry.Register("BatchMatMul", MatMulKernel);
+    registry.Register("ConvTranspose", ConvTransposeKernel);
+    registry.Register("LSTM", LstmKernel);
+    registry.Register("BidirectionLSTM", BidirectionLstmKernel);
+    registry.Register("Softmax", SoftmaxKernel);
+    registry.Register("LogSoftmax", SoftmaxKernel);
+    registry.Register("L2Normalize", L2NormalizeKernel);
+    registry.Register("LayerNorm", LayerNormKernel);
+    registry.Register("Permute", PermuteKernel);
+    registry.Register("TopK", TopKKernel);
+    registry.Register("ArgMaxExt2", ArgMaxKernel);
+    registry.Register("Gather", GatherKernel);
+    registry.Register("GatherV2D", GatherKernel);
+    registry.Register("GatherNd", GatherNdKernel);
+    registry.Register("ScatterNd", ScatterNdKernel);
+    for (const char* type : {"ResizeBilinear", "ResizeBilinearV2", "ResizeNearestNeighbor", "Interp"}) {
+        registry.Register(type, ResizeKernel);
+    }
+}
+
+inline const host_graph::KernelRegistry& GetBuiltinKernels() {
+    static host_graph::KernelRegistry registry = []() {
+        host_graph::KernelRegistry builtin;
+        RegisterBuiltinKernels(builtin);
+        return builtin;
+    }();
+    return registry;
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_BUILTIN_KERNELS_H
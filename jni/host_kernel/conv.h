@@ -0,0 +1,543 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_CONV_H
+#define BUILD_IR_MODEL_HOST_KERNEL_CONV_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "log_util.h"
+#include "host_kernel/gemm.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// FP32 NCHW convolution engine of the host path. Convolve() picks an algorithm per layer from its attributes:
+//   direct       depthwise (one input channel per group) and anything the others do not cover cheaply
+//   gemm_1x1     1x1, stride 1, no padding: the input planes already are the B matrix
+//   im2col       generic, the patch matrix is built in column chunks so its size stays bounded
+//   winograd_f43 3x3, stride 1, dilation 1, no groups: F(4x4, 3x3), 36 GEMMs over 6x6 input tiles
+// Winograd weights are transformed once per Const filter and cached; the choice is logged once per layer
+// and kept in GetConvReport().
+namespace host_kernel {
+struct ConvParam {
+    int64_t strideH = 1;
+    int64_t strideW = 1;
+    int64_t dilationH = 1;
+    int64_t dilationW = 1;
+    int64_t padTop = 0;
+    int64_t padBottom = 0;
+    int64_t padLeft = 0;
+    int64_t padRight = 0;
+    int64_t groups = 1;
+};
+
+inline int64_t ConvOutSize(int64_t in, int64_t kernel, int64_t stride, int64_t dilation, int64_t padHead,
+                           int64_t padTail) {
+    return (in + padHead + padTail - (kernel - 1) * dilation - 1) / stride + 1;
+}
+
+// x [N, C, H, W], filter [Co, C / groups, Kh, Kw], bias [Co] or null, y [N, Co, OH, OW].
+struct ConvShape {
+    int64_t n = 1;
+    int64_t c = 0;
+    int64_t h = 0;
+    int64_t w = 0;
+    int64_t co = 0;
+    int64_t kh = 0;
+    int64_t kw = 0;
+    int64_t oh = 0;
+    int64_t ow = 0;
+};
+
+// Direct convolution, one task per output plane.
+inline void Conv2D(const float* x, int64_t n, int64_t c, int64_t h, int64_t w, const float* filter, int64_t co,
+                   int64_t kh, int64_t kw, const float* bias, const ConvParam& param, float* y, int64_t oh,
+                   int64_t ow, int threadNum = 0) {
+    const int64_t cig = c / param.groups;
+    const int64_t cog = co / param.groups;
+    parallel_util::ParallelFor(0, static_cast<size_t>(n * co), [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; task++) {
+            int64_t b = static_cast<int64_t>(task) / co;
+            int64_t oc = static_cast<int64_t>(task) % co;
+            int64_t g = oc / cog;
+            float* out = y + (b * co + oc) * oh * ow;
+            std::fill_n(out, oh * ow, bias != nullptr ? bias[oc] : 0.0f);
+            for (int64_t ic = 0; ic < cig; ic++) {
+                const float* in = x + (b * c + g * cig + ic) * h * w;
+                const float* wk = filter + (oc * cig + ic) * kh * kw;
+                for (int64_t ky = 0; ky < kh; ky++) {
+                    for (int64_t kx = 0; kx < kw; kx++) {
+                        float weight = wk[ky * kw + kx];
+                        simd_util::Float4 weight4 = simd_util::Set4(weight);
+                        int64_t offX = kx * param.dilationW - param.padLeft;
+                        // ow range with 0 <= ox * stride + offX < w
+                        int64_t oxBegin = offX >= 0 ? 0 : (-offX + param.strideW - 1) / param.strideW;
+                        int64_t oxEnd = w - offX <= 0 ? 0 : std::min(ow, (w - offX - 1) / param.strideW + 1);
+                        for (int64_t oy = 0; oy < oh; oy++) {
+                            int64_t iy = oy * param.strideH - param.padTop + ky * param.dilationH;
+                            if (iy < 0 || iy >= h) {
+                                continue;
+                            }
+                            const float* row = in + iy * w + offX;
+                            float* dst = out + oy * ow;
+                            int64_t ox = oxBegin;
+                            if (param.strideW == 1) {
+                                for (; ox + 4 <= oxEnd; ox += 4) {
+                                    simd_util::Store4(dst + ox, simd_util::Fma4(weight4, simd_util::Load4(row + ox),
+                                                                                simd_util::Load4(dst + ox)));
+                                }
+                            }
+                            for (; ox < oxEnd; ox++) {
+                                dst[ox] += weight * row[ox * param.strideW];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }, threadNum);
+}
+
+enum class ConvAlgo {
+    DIRECT,
+    GEMM_1X1,
+    IM2COL,
+    WINOGRAD_F43,
+    TRANSPOSE_SUBPIXEL,  // ConvTranspose only, see host_kernel::ConvolveTranspose
+};
+
+inline const char* GetConvAlgoName(ConvAlgo algo) {
+    switch (algo) {
+        case ConvAlgo::GEMM_1X1: return "gemm_1x1";
+        case ConvAlgo::IM2COL: return "im2col";
+        case ConvAlgo::WINOGRAD_F43: return "winograd_f43";
+        case ConvAlgo::TRANSPOSE_SUBPIXEL: return "transpose_subpixel";
+        default: return "direct";
+    }
+}
+
+struct ConvOptions {
+    // Winograd F(4x4, 3x3) loses a few bits against direct summation (~1e-5 relative), switch it off for
+    // bit-level comparisons
+    bool winograd = true;
+};
+
+inline ConvOptions& GetConvOptions() {
+    static ConvOptions options;
+    return options;
+}
+
+inline ConvAlgo SelectConvAlgo(const ConvShape& s, const ConvParam& p) {
+    int64_t cig = s.c / p.groups;
+    bool unit = p.strideH == 1 && p.strideW == 1 && p.dilationH == 1 && p.dilationW == 1;
+    bool noPad = p.padTop == 0 && p.padBottom == 0 && p.padLeft == 0 && p.padRight == 0;
+    if (cig == 1) {
+        return ConvAlgo::DIRECT;
+    }
+    if (s.kh == 1 && s.kw == 1 && p.strideH == 1 && p.strideW == 1 && noPad) {
+        return ConvAlgo::GEMM_1X1;
+    }
+    if (GetConvOptions().winograd && s.kh == 3 && s.kw == 3 && unit && p.groups == 1 && cig >= 8 &&
+        s.co >= 8 && s.oh >= 4 && s.ow >= 4) {
+        return ConvAlgo::WINOGRAD_F43;
+    }
+    return ConvAlgo::IM2COL;
+}
+
+namespace conv {
+// the patch matrix / Winograd tile buffers of one step stay around this many floats
+const int64_t CHUNK_FLOATS = 1 << 20;
+
+// y[b, oc] += bias[oc]
+inline void AddBias(float* y, int64_t n, int64_t co, int64_t plane, const float* bias, int threadNum) {
+    if (bias == nullptr) {
+        return;
+    }
+    parallel_util::ParallelFor(0, static_cast<size_t>(n * co), [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; task++) {
+            float value = bias[task % co];
+            float* out = y + task * plane;
+            for (int64_t i = 0; i < plane; i++) {
+                out[i] += value;
+            }
+        }
+    }, threadNum);
+}
+
+inline void Conv1x1(const float* x, const ConvShape& s, const float* filter, const ConvParam& param, float* y,
+                    int threadNum) {
+    int64_t cig = s.c / param.groups;
+    int64_t cog = s.co / param.groups;
+    int64_t plane = s.h * s.w;
+    std::vector<gemm::Problem> problems;
+    for (int64_t b = 0; b < s.n; b++) {
+        for (int64_t g = 0; g < param.groups; g++) {
+            gemm::Problem pr;
+            pr.m = cog;
+            pr.n = plane;
+            pr.k = cig;
+            pr.a = filter + g * cog * cig;
+            pr.lda = cig;
+            pr.b = x + (b * s.c + g * cig) * plane;
+            pr.ldb = plane;
+            pr.c = y + (b * s.co + g * cog) * plane;
+            pr.ldc = plane;
+            problems.push_back(pr);
+        }
+    }
+    gemm::Run(problems, threadNum);
+}
+
+// Rows (ic, ky, kx) of the patch matrix of group input `in`, for output pixels [col0, col0 + cols). Each output
+// row is a run with one valid input range, the rest is padding.
+inline void Im2Col(const float* in, const ConvShape& s, const ConvParam& p, int64_t cig, int64_t col0, int64_t cols,
+                   float* col) {
+    for (int64_t r = 0; r < cig * s.kh * s.kw; r++) {
+        int64_t ic = r / (s.kh * s.kw);
+        int64_t ky = r / s.kw % s.kh;
+        int64_t kx = r % s.kw;
+        const float* plane = in + ic * s.h * s.w;
+        float* dst = col + r * cols;
+        int64_t oy = col0 / s.ow;
+        int64_t ox = col0 % s.ow;
+        for (int64_t i = 0; i < cols; ox = 0, oy++) {
+            int64_t run = std::min(s.ow - ox, cols - i);
+            int64_t iy = oy * p.strideH - p.padTop + ky * p.dilationH;
+            int64_t ix0 = ox * p.strideW - p.padLeft + kx * p.dilationW;
+            // j in [begin, end) reads ix0 + j * stride inside the row
+            int64_t begin = ix0 >= 0 ? 0 : std::min(run, (-ix0 + p.strideW - 1) / p.strideW);
+            int64_t end = ix0 >= s.w ? 0 : std::min(run, (s.w - 1 - ix0) / p.strideW + 1);
+            if (iy < 0 || iy >= s.h || end <= begin) {
+                begin = end = 0;
+            }
+            float* out = dst + i;
+            std::fill(out, out + begin, 0.0f);
+            const float* src = plane + iy * s.w + ix0;
+            if (p.strideW == 1) {
+                std::copy(src + begin, src + end, out + begin);
+            } else {
+                for (int64_t j = begin; j < end; j++) {
+                    out[j] = src[j * p.strideW];
+                }
+            }
+            std::fill(out + std::max(begin, end), out + run, 0.0f);
+            i += run;
+        }
+    }
+}
+
+inline void ConvIm2Col(const float* x, const ConvShape& s, const float* filter, const ConvParam& param, float* y,
+                       int threadNum) {
+    int64_t cig = s.c / param.groups;
+    int64_t cog = s.co / param.groups;
+    int64_t k = cig * s.kh * s.kw;
+    int64_t plane = s.oh * s.ow;
+    int64_t step = std::min(plane, std::max<int64_t>(gemm::NR, CHUNK_FLOATS / (k * param.groups)));
+    std::unique_ptr<float[]> col(new float[param.groups * k * step]);
+    for (int64_t b = 0; b < s.n; b++) {
+        for (int64_t col0 = 0; col0 < plane; col0 += step) {
+            int64_t cols = std::min(step, plane - col0);
+            parallel_util::ParallelFor(0, static_cast<size_t>(param.groups), [&](size_t begin, size_t end) {
+                for (size_t g = begin; g < end; g++) {
+                    Im2Col(x + (b * s.c + g * cig) * s.h * s.w, s, param, cig, col0, cols, col.get() + g * k * cols);
+                }
+            }, threadNum);
+            std::vector<gemm::Problem> problems(static_cast<size_t>(param.groups));
+            for (int64_t g = 0; g < param.groups; g++) {
+                gemm::Problem& pr = problems[g];
+                pr.m = cog;
+                pr.n = cols;
+                pr.k = k;
+                pr.a = filter + g * cog * k;
+                pr.lda = k;
+                pr.b = col.get() + g * k * cols;
+                pr.ldb = cols;
+                pr.c = y + (b * s.co + g * cog) * plane + col0;
+                pr.ldc = plane;
+            }
+            gemm::Run(problems, threadNum);
+        }
+    }
+}
+
+// Winograd F(4x4, 3x3): Y = A^T [(G g G^T) . (B^T d B)] A over 6x6 input tiles with stride 4.
+// U = G g G^T for every (oc, ic), stored as 36 matrices [co, c].
+inline std::vector<float> WinogradWeights(const float* filter, int64_t co, int64_t c) {
+    std::vector<float> u(static_cast<size_t>(36 * co * c));
+    for (int64_t oc = 0; oc < co; oc++) {
+        for (int64_t ic = 0; ic < c; ic++) {
+            const float* g = filter + (oc * c + ic) * 9;
+            float t[6][3];
+            for (int j = 0; j < 3; j++) {
+                float g0 = g[j];
+                float g1 = g[3 + j];
+                float g2 = g[6 + j];
+                t[0][j] = g0 / 4;
+                t[1][j] = -(g0 + g1 + g2) / 6;
+                t[2][j] = -(g0 - g1 + g2) / 6;
+                t[3][j] = g0 / 24 + g1 / 12 + g2 / 6;
+                t[4][j] = g0 / 24 - g1 / 12 + g2 / 6;
+                t[5][j] = g2;
+            }
+            for (int i = 0; i < 6; i++) {
+                float g0 = t[i][0];
+                float g1 = t[i][1];
+                float g2 = t[i][2];
+                float row[6] = {g0 / 4, -(g0 + g1 + g2) / 6, -(g0 - g1 + g2) / 6, g0 / 24 + g1 / 12 + g2 / 6,
+                                g0 / 24 - g1 / 12 + g2 / 6, g2};
+                for (int j = 0; j < 6; j++) {
+                    u[((i * 6 + j) * co + oc) * c + ic] = row[j];
+                }
+            }
+        }
+    }
+    return u;
+}
+
+// B^T d B of a 6x6 tile, d and v are row-major.
+inline void WinogradInputTile(const float* d, float* v) {
+    float t[36];
+    for (int j = 0; j < 6; j++) {
+        float d0 = d[j];
+        float d1 = d[6 + j];
+        float d2 = d[12 + j];
+        float d3 = d[18 + j];
+        float d4 = d[24 + j];
+        float d5 = d[30 + j];
+        t[j] = 4 * d0 - 5 * d2 + d4;
+        t[6 + j] = -4 * (d1 + d2) + d3 + d4;
+        t[12 + j] = 4 * (d1 - d2) - d3 + d4;
+        t[18 + j] = 2 * (d3 - d1) - d2 + d4;
+        t[24 + j] = 2 * (d1 - d3) - d2 + d4;
+        t[30 + j] = 4 * d1 - 5 * d3 + d5;
+    }
+    for (int i = 0; i < 6; i++) {
+        const float* r = t + i * 6;
+        float* o = v + i * 6;
+        o[0] = 4 * r[0] - 5 * r[2] + r[4];
+        o[1] = -4 * (r[1] + r[2]) + r[3] + r[4];
+        o[2] = 4 * (r[1] - r[2]) - r[3] + r[4];
+        o[3] = 2 * (r[3] - r[1]) - r[2] + r[4];
+        o[4] = 2 * (r[1] - r[3]) - r[2] + r[4];
+        o[5] = 4 * r[1] - 5 * r[3] + r[5];
+    }
+}
+
+// A^T m A of a 6x6 tile into a 4x4 one.
+inline void WinogradOutputTile(const float* m, float* out) {
+    float t[24];
+    for (int j = 0; j < 6; j++) {
+        float m0 = m[j];
+        float m1 = m[6 + j];
+        float m2 = m[12 + j];
+        float m3 = m[18 + j];
+        float m4 = m[24 + j];
+        float m5 = m[30 + j];
+        t[j] = m0 + m1 + m2 + m3 + m4;
+        t[6 + j] = m1 - m2 + 2 * (m3 - m4);
+        t[12 + j] = m1 + m2 + 4 * (m3 + m4);
+        t[18 + j] = m1 - m2 + 8 * (m3 - m4) + m5;
+    }
+    for (int i = 0; i < 4; i++) {
+        const float* r = t + i * 6;
+        out[i * 4] = r[0] + r[1] + r[2] + r[3] + r[4];
+        out[i * 4 + 1] = r[1] - r[2] + 2 * (r[3] - r[4]);
+        out[i * 4 + 2] = r[1] + r[2] + 4 * (r[3] + r[4]);
+        out[i * 4 + 3] = r[1] - r[2] + 8 * (r[3] - r[4]) + r[5];
+    }
+}
+
+inline void ConvWinograd(const float* x, const ConvShape& s, const float* u, const float* bias, const ConvParam& param,
+                         float* y, int threadNum) {
+    int64_t tilesH = (s.oh + 3) / 4;
+    int64_t tilesW = (s.ow + 3) / 4;
+    int64_t tiles = tilesH * tilesW;
+    int64_t step = std::min(tiles, std::max<int64_t>(gemm::NR, CHUNK_FLOATS / (36 * std::max(s.c, s.co))));
+    std::unique_ptr<float[]> v(new float[36 * s.c * step]);
+    std::unique_ptr<float[]> m(new float[36 * s.co * step]);
+    for (int64_t b = 0; b < s.n; b++) {
+        for (int64_t t0 = 0; t0 < tiles; t0 += step) {
+            int64_t count = std::min(step, tiles - t0);
+            // v[xi][ic][t]
+            parallel_util::ParallelFor(0, static_cast<size_t>(s.c), [&](size_t begin, size_t end) {
+                float d[36];
+                float tile[36];
+                for (size_t ic = begin; ic < end; ic++) {
+                    const float* in = x + (b * s.c + static_cast<int64_t>(ic)) * s.h * s.w;
+                    for (int64_t t = 0; t < count; t++) {
+                        int64_t y0 = (t0 + t) / tilesW * 4 - param.padTop;
+                        int64_t x0 = (t0 + t) % tilesW * 4 - param.padLeft;
+                        if (y0 >= 0 && y0 + 6 <= s.h && x0 >= 0 && x0 + 6 <= s.w) {
+                            for (int i = 0; i < 6; i++) {
+                                std::copy(in + (y0 + i) * s.w + x0, in + (y0 + i) * s.w + x0 + 6, d + i * 6);
+                            }
+                        } else {
+                            for (int i = 0; i < 6; i++) {
+                                for (int j = 0; j < 6; j++) {
+                                    int64_t iy = y0 + i;
+                                    int64_t ix = x0 + j;
+                                    bool inside = iy >= 0 && iy < s.h && ix >= 0 && ix < s.w;
+                                    d[i * 6 + j] = inside ? in[iy * s.w + ix] : 0.0f;
+                                }
+                            }
+                        }
+                        WinogradInputTile(d, tile);
+                        for (int xi = 0; xi < 36; xi++) {
+                            v[(xi * s.c + static_cast<int64_t>(ic)) * count + t] = tile[xi];
+                        }
+                    }
+                }
+            }, threadNum);
+            Gemm(36, s.co, count, s.c, u, false, v.get(), false, nullptr, m.get(), threadNum);
+            parallel_util::ParallelFor(0, static_cast<size_t>(s.co), [&](size_t begin, size_t end) {
+                float tile[36];
+                float out[16];
+                for (size_t oc = begin; oc < end; oc++) {
+                    float* dst = y + (b * s.co + static_cast<int64_t>(oc)) * s.oh * s.ow;
+                    float offset = bias != nullptr ? bias[oc] : 0.0f;
+                    for (int64_t t = 0; t < count; t++) {
+                        for (int xi = 0; xi < 36; xi++) {
+                            tile[xi] = m[(xi * s.co + static_cast<int64_t>(oc)) * count + t];
+                        }
+                        WinogradOutputTile(tile, out);
+                        int64_t y0 = (t0 + t) / tilesW * 4;
+                        int64_t x0 = (t0 + t) % tilesW * 4;
+                        for (int64_t i = 0; i < 4 && y0 + i < s.oh; i++) {
+                            for (int64_t j = 0; j < 4 && x0 + j < s.ow; j++) {
+                                dst[(y0 + i) * s.ow + x0 + j] = out[i * 4 + j] + offset;
+                            }
+                        }
+                    }
+                }
+            }, threadNum);
+        }
+    }
+}
+
+// Transformed weights of Const filters. The key holds the filter address and size, a sampled fingerprint
+// guards against a new payload reusing the address of a released one.
+class WeightCache {
+public:
+    using Key = std::tuple<std::string, const void*, size_t, int>;
+
+    std::shared_ptr<const std::vector<float>> Find(const Key& key, uint64_t fingerprint) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        return it != entries_.end() && it->second.first == fingerprint ? it->second.second : nullptr;
+    }
+
+    void Insert(const Key& key, uint64_t fingerprint, const std::shared_ptr<const std::vector<float>>& data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[key] = std::make_pair(fingerprint, data);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<Key, std::pair<uint64_t, std::shared_ptr<const std::vector<float>>>> entries_;
+};
+
+inline WeightCache& GetWeightCache() {
+    static WeightCache cache;
+    return cache;
+}
+
+// FNV-1a over 64 evenly spaced values.
+inline uint64_t Fingerprint(const float* data, size_t num) {
+    uint64_t hash = 1469598103934665603ull;
+    size_t samples = std::min<size_t>(num, 64);
+    for (size_t i = 0; i < samples; i++) {
+        uint32_t bits;
+        std::memcpy(&bits, data + i * num / samples, sizeof(bits));
+        hash = (hash ^ bits) * 1099511628211ull;
+    }
+    return hash;
+}
+
+class Report {
+public:
+    void Record(const std::string& name, const ConvShape& s, const ConvParam& p, ConvAlgo algo) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = algos_.find(name);
+        if (it != algos_.end() && it->second == GetConvAlgoName(algo)) {
+            return;
+        }
+        algos_[name] = GetConvAlgoName(algo);
+        ALOGI("[CONV] %s: %s, %lldx%lld stride %lldx%lld groups %lld, %lld -> %lld channels, %lldx%lld\n",
+              name.c_str(), GetConvAlgoName(algo), static_cast<long long>(s.kh), static_cast<long long>(s.kw),
+              static_cast<long long>(p.strideH), static_cast<long long>(p.strideW),
+              static_cast<long long>(p.groups), static_cast<long long>(s.c), static_cast<long long>(s.co),
+              static_cast<long long>(s.oh), static_cast<long long>(s.ow));
+    }
+
+    std::map<std::string, std::string> Get() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return algos_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, std::string> algos_;
+};
+
+inline Report& GetReport() {
+    static Report report;
+    return report;
+}
+}
+
+// Algorithm selected for each convolution layer run so far, by layer name.
+inline std::map<std::string, std::string> GetConvReport() {
+    return conv::GetReport().Get();
+}
+
+inline void ClearConvWeightCache() {
+    conv::GetWeightCache().Clear();
+}
+
+// `name` identifies the layer in the report and the weight cache; only a constant filter (a Const payload,
+// see HostTensor::IsConstant) gets its transformed weights cached.
+inline void Convolve(const std::string& name, const float* x, const ConvShape& s, const float* filter,
+                     bool constantFilter, const float* bias, const ConvParam& param, float* y, int threadNum = 0) {
+    ConvAlgo algo = SelectConvAlgo(s, param);
+    conv::GetReport().Record(name, s, param, algo);
+    switch (algo) {
+        case ConvAlgo::GEMM_1X1:
+            conv::Conv1x1(x, s, filter, param, y, threadNum);
+            break;
+        case ConvAlgo::IM2COL:
+            conv::ConvIm2Col(x, s, filter, param, y, threadNum);
+            break;
+        case ConvAlgo::WINOGRAD_F43: {
+            size_t num = static_cast<size_t>(s.co * s.c * 9);
+            conv::WeightCache::Key key(name, filter, num, static_cast<int>(algo));
+            uint64_t fingerprint = conv::Fingerprint(filter, num);
+            std::shared_ptr<const std::vector<float>> u =
+                constantFilter ? conv::GetWeightCache().Find(key, fingerprint) : nullptr;
+            if (u == nullptr) {
+                u = std::make_shared<const std::vector<float>>(conv::WinogradWeights(filter, s.co, s.c));
+                if (constantFilter) {
+                    conv::GetWeightCache().Insert(key, fingerprint, u);
+                }
+            }
+            conv::ConvWinograd(x, s, u->data(), bias, param, y, threadNum);
+            return;
+        }
+        default:
+            Conv2D(x, s.n, s.c, s.h, s.w, filter, s.co, s.kh, s.kw, bias, param, y, s.oh, s.ow, threadNum);
+            return;
+    }
+    conv::AddBias(y, s.n, s.co, s.oh * s.ow, bias, threadNum);
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_CONV_H
@@ -0,0 +1,180 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_CONV_TRANSPOSE_H
+#define BUILD_IR_MODEL_HOST_KERNEL_CONV_TRANSPOSE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "host_kernel/conv.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Transposed convolution as stride^2 sub-pixel convolutions. Output pixel oy only receives the filter taps
+// with (oy + padTop - ky * dilationH) divisible by strideH, so the output splits into strideH x strideW
+// phases, each a stride-1 correlation of x with the taps of its phase. Every output is computed once from
+// the taps that reach it (gather), instead of scattering every input over a zero-stuffed output.
+namespace host_kernel {
+namespace deconv {
+// Taps of one output phase along one axis: the kernel positions k with k * dilation == phase (mod stride).
+inline std::vector<int64_t> PhaseTaps(int64_t kernel, int64_t stride, int64_t dilation, int64_t phase) {
+    std::vector<int64_t> taps;
+    for (int64_t k = 0; k < kernel; k++) {
+        if (k * dilation % stride == phase) {
+            taps.push_back(k);
+        }
+    }
+    return taps;
+}
+
+// Filter [C, Co / groups, Kh, Kw] regrouped by phase: for phase (ry, rx) a block [co, cig, tapsY, tapsX] at
+// Layout::offsets[ry * strideW + rx], so the taps a phase reads are contiguous per (oc, ic).
+struct Layout {
+    std::vector<std::vector<int64_t>> tapsY;
+    std::vector<std::vector<int64_t>> tapsX;
+    std::vector<size_t> offsets;
+};
+
+inline Layout GetLayout(const ConvShape& s, const ConvParam& p) {
+    Layout layout;
+    for (int64_t ry = 0; ry < p.strideH; ry++) {
+        layout.tapsY.push_back(PhaseTaps(s.kh, p.strideH, p.dilationH, ry));
+    }
+    for (int64_t rx = 0; rx < p.strideW; rx++) {
+        layout.tapsX.push_back(PhaseTaps(s.kw, p.strideW, p.dilationW, rx));
+    }
+    size_t offset = 0;
+    for (int64_t ry = 0; ry < p.strideH; ry++) {
+        for (int64_t rx = 0; rx < p.strideW; rx++) {
+            layout.offsets.push_back(offset);
+            offset += static_cast<size_t>(s.co * (s.c / p.groups)) * layout.tapsY[ry].size() *
+                      layout.tapsX[rx].size();
+        }
+    }
+    return layout;
+}
+
+inline std::vector<float> PhaseWeights(const float* filter, const ConvShape& s, const ConvParam& p,
+                                       const Layout& layout) {
+    const int64_t cig = s.c / p.groups;
+    const int64_t cog = s.co / p.groups;
+    std::vector<float> packed(static_cast<size_t>(s.co * cig * s.kh * s.kw));
+    for (int64_t ry = 0; ry < p.strideH; ry++) {
+        for (int64_t rx = 0; rx < p.strideW; rx++) {
+            const std::vector<int64_t>& tapsY = layout.tapsY[ry];
+            const std::vector<int64_t>& tapsX = layout.tapsX[rx];
+            float* dst = packed.data() + layout.offsets[ry * p.strideW + rx];
+            for (int64_t oc = 0; oc < s.co; oc++) {
+                int64_t g = oc / cog;
+                for (int64_t ic = 0; ic < cig; ic++) {
+                    const float* src = filter + ((g * cig + ic) * cog + oc % cog) * s.kh * s.kw;
+                    for (int64_t ky : tapsY) {
+                        for (int64_t kx : tapsX) {
+                            *dst++ = src[ky * s.kw + kx];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return packed;
+}
+
+// acc[j] += weight * row[j] for j in [0, num)
+inline void AxpyRow(float weight, const float* row, float* acc, int64_t num) {
+    simd_util::Float4 weight4 = simd_util::Set4(weight);
+    int64_t j = 0;
+    for (; j + 4 <= num; j += 4) {
+        simd_util::Store4(acc + j, simd_util::Fma4(weight4, simd_util::Load4(row + j), simd_util::Load4(acc + j)));
+    }
+    for (; j < num; j++) {
+        acc[j] += weight * row[j];
+    }
+}
+
+// x [N, C, H, W] as in ConvShape, s.co / s.oh / s.ow describe y. One task per output row; with strideW > 1
+// each phase of the row is accumulated contiguously and then interleaved into y.
+inline void ConvTransposeSubPixel(const float* x, const ConvShape& s, const float* packed, const Layout& layout,
+                                  const float* bias, const ConvParam& p, float* y, int threadNum) {
+    const int64_t cig = s.c / p.groups;
+    const int64_t cog = s.co / p.groups;
+    const int64_t phaseWidth = (s.ow + p.strideW - 1) / p.strideW;
+    size_t rows = static_cast<size_t>(s.n * s.co * s.oh);
+    parallel_util::ParallelFor(0, rows, [&](size_t begin, size_t end) {
+        std::unique_ptr<float[]> acc(new float[phaseWidth + 4]);
+        for (size_t task = begin; task < end; task++) {
+            int64_t oy = static_cast<int64_t>(task) % s.oh;
+            int64_t oc = static_cast<int64_t>(task) / s.oh % s.co;
+            int64_t b = static_cast<int64_t>(task) / s.oh / s.co;
+            const float* in = x + (b * s.c + oc / cog * cig) * s.h * s.w;
+            float* out = y + task * s.ow;
+            float biasValue = bias != nullptr ? bias[oc] : 0.0f;
+            int64_t ry = (oy + p.padTop) % p.strideH;
+            const std::vector<int64_t>& tapsY = layout.tapsY[ry];
+            for (int64_t rx = 0; rx < p.strideW; rx++) {
+                // outputs ox0 + j * strideW of this row read input column ixBase(kx) + j
+                int64_t ox0 = ((rx - p.padLeft) % p.strideW + p.strideW) % p.strideW;
+                if (ox0 >= s.ow) {
+                    continue;
+                }
+                int64_t count = (s.ow - ox0 + p.strideW - 1) / p.strideW;
+                const std::vector<int64_t>& tapsX = layout.tapsX[rx];
+                float* dst = p.strideW == 1 ? out : acc.get();
+                std::fill_n(dst, count, biasValue);
+                const float* w = packed + layout.offsets[ry * p.strideW + rx] +
+                                 static_cast<size_t>(oc * cig) * tapsY.size() * tapsX.size();
+                for (int64_t ic = 0; ic < cig; ic++) {
+                    const float* plane = in + ic * s.h * s.w;
+                    for (int64_t ky : tapsY) {
+                        int64_t iy = (oy + p.padTop - ky * p.dilationH) / p.strideH;
+                        if (iy < 0 || iy >= s.h) {
+                            w += tapsX.size();
+                            continue;
+                        }
+                        for (int64_t kx : tapsX) {
+                            int64_t ixBase = (ox0 + p.padLeft - kx * p.dilationW) / p.strideW;
+                            int64_t jBegin = std::max<int64_t>(0, -ixBase);
+                            int64_t jEnd = std::min(count, s.w - ixBase);
+                            if (jBegin < jEnd) {
+                                AxpyRow(*w, plane + iy * s.w + ixBase + jBegin, dst + jBegin, jEnd - jBegin);
+                            }
+                            w++;
+                        }
+                    }
+                }
+                if (p.strideW != 1) {
+                    for (int64_t j = 0; j < count; j++) {
+                        out[ox0 + j * p.strideW] = dst[j];
+                    }
+                }
+            }
+        }
+    }, threadNum, static_cast<size_t>(std::max<int64_t>(1, (1 << 14) / std::max<int64_t>(s.ow, 1))));
+}
+}
+
+// Transposed convolution of x [N, C, H, W] (s.c, s.h, s.w) with filter [C, Co / groups, Kh, Kw] into
+// y [N, Co, OH, OW] (s.co, s.oh, s.ow); param holds the pads resolved against the output size. The regrouped
+// weights of a constant filter are cached like the Winograd ones of Convolve().
+inline void ConvolveTranspose(const std::string& name, const float* x, const ConvShape& s, const float* filter,
+                              bool constantFilter, const float* bias, const ConvParam& param, float* y,
+                              int threadNum = 0) {
+    conv::GetReport().Record(name, s, param, ConvAlgo::TRANSPOSE_SUBPIXEL);
+    deconv::Layout layout = deconv::GetLayout(s, param);
+    size_t num = static_cast<size_t>(s.co * (s.c / param.groups) * s.kh * s.kw);
+    conv::WeightCache::Key key(name, filter, num, static_cast<int>(ConvAlgo::TRANSPOSE_SUBPIXEL));
+    uint64_t fingerprint = conv::Fingerprint(filter, num);
+    std::shared_ptr<const std::vector<float>> packed =
+        constantFilter ? conv::GetWeightCache().Find(key, fingerprint) : nullptr;
+    if (packed == nullptr) {
+        packed = std::make_shared<const std::vector<float>>(deconv::PhaseWeights(filter, s, param, layout));
+        if (constantFilter) {
+            conv::GetWeightCache().Insert(key, fingerprint, packed);
+        }
+    }
+    deconv::ConvTransposeSubPixel(x, s, packed->data(), layout, bias, param, y, threadNum);
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_CONV_TRANSPOSE_H
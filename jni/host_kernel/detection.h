@@ -0,0 +1,347 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_DETECTION_H
+#define BUILD_IR_MODEL_HOST_KERNEL_DETECTION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "HiAiModelManagerType.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Host fallback for SSDDetectionOutput / DetectionPostprocessing (graph/op/detection_defs.h) on ROMs
+// that do not support them. All kernels read the raw NPU output buffers in place.
+//
+// Layouts (single image, batch is handled by the caller offsetting the pointers):
+//   score      [numAnchors, numClasses]
+//   bbox_delta [numAnchors, 4]  (dy, dx, dh, dw), or (dx, dy, dw, dh) when xFirst is set
+//   anchors    [numAnchors, 4]  (yc, xc, h, w),   or (xc, yc, w, h)   when xFirst is set
+//   boxes      [numAnchors, 4]  (ymin, xmin, ymax, xmax), or x first when xFirst is set
+namespace host_kernel {
+struct BoxDecodeParam {
+    float scaleY = 10.0f;
+    float scaleX = 10.0f;
+    float scaleH = 5.0f;
+    float scaleW = 5.0f;
+    bool xFirst = false;
+};
+
+struct NmsParam {
+    int maxOutputSize = 100;
+    float iouThreshold = 0.5f;
+    float scoreThreshold = 0.0f;
+    // only the topK best candidates enter NMS (SSDDetectionOutput top_k), <= 0 keeps all
+    int topK = 0;
+};
+
+struct DetectionParam {
+    BoxDecodeParam decode;
+    int maxNumDetections = 100;
+    float scoreThreshold = 0.0f;
+    float iouThreshold = 0.5f;
+    bool useRegularNms = false;
+    int maxClassesPerDetection = 1;
+    int maxDetectionsPerClass = 100;
+    int topK = 0;
+    bool isBgInLabel = false;
+    int threadNum = 0;
+};
+
+struct Detection {
+    int anchor;
+    int classId;
+    float score;
+    float box[4];
+};
+
+// DecodeBBox with CENTER_SIZE coding. For SSD priors pass scale = 1 / variance.
+inline void DecodeBoxes(const float* deltas, const float* anchors, size_t num, const BoxDecodeParam& param,
+                        float* boxes) {
+    using namespace simd_util;
+    // the math is symmetric in y/x, only the scales follow the layout
+    const float scale[4] = {
+        1.0f / (param.xFirst ? param.scaleX : param.scaleY), 1.0f / (param.xFirst ? param.scaleY : param.scaleX),
+        1.0f / (param.xFirst ? param.scaleW : param.scaleH), 1.0f / (param.xFirst ? param.scaleH : param.scaleW)};
+    const Float4 invScaleY = Set4(scale[0]);
+    const Float4 invScaleX = Set4(scale[1]);
+    const Float4 invScaleH = Set4(scale[2]);
+    const Float4 invScaleW = Set4(scale[3]);
+    const Float4 half = Set4(0.5f);
+    size_t i = 0;
+    // Four anchors per iteration: AoS -> SoA, decode, SoA -> AoS.
+    for (; i + 4 <= num; i += 4) {
+        Float4 dy = Load4(deltas + i * 4);
+        Float4 dx = Load4(deltas + i * 4 + 4);
+        Float4 dh = Load4(deltas + i * 4 + 8);
+        Float4 dw = Load4(deltas + i * 4 + 12);
+        Transpose4x4(dy, dx, dh, dw);
+        Float4 ay = Load4(anchors + i * 4);
+        Float4 ax = Load4(anchors + i * 4 + 4);
+        Float4 ah = Load4(anchors + i * 4 + 8);
+        Float4 aw = Load4(anchors + i * 4 + 12);
+        Transpose4x4(ay, ax, ah, aw);
+        Float4 yc = Fma4(Mul4(dy, invScaleY), ah, ay);
+        Float4 xc = Fma4(Mul4(dx, invScaleX), aw, ax);
+        Float4 halfH = Mul4(Mul4(Exp4(Mul4(dh, invScaleH)), ah), half);
+        Float4 halfW = Mul4(Mul4(Exp4(Mul4(dw, invScaleW)), aw), half);
+        Float4 ymin = Sub4(yc, halfH);
+        Float4 xmin = Sub4(xc, halfW);
+        Float4 ymax = Add4(yc, halfH);
+        Float4 xmax = Add4(xc, halfW);
+        Transpose4x4(ymin, xmin, ymax, xmax);
+        Store4(boxes + i * 4, ymin);
+        Store4(boxes + i * 4 + 4, xmin);
+        Store4(boxes + i * 4 + 8, ymax);
+        Store4(boxes + i * 4 + 12, xmax);
+    }
+    for (; i < num; i++) {
+        const float* d = deltas + i * 4;
+        const float* a = anchors + i * 4;
+        float yc = d[0] * scale[0] * a[2] + a[0];
+        float xc = d[1] * scale[1] * a[3] + a[1];
+        float halfH = std::exp(d[2] * scale[2]) * a[2] * 0.5f;
+        float halfW = std::exp(d[3] * scale[3]) * a[3] * 0.5f;
+        float* b = boxes + i * 4;
+        b[0] = yc - halfH;
+        b[1] = xc - halfW;
+        b[2] = yc + halfH;
+        b[3] = xc + halfW;
+    }
+}
+
+// SSD priorbox tensors store corner boxes; converts them to the center-size anchors DecodeBoxes expects.
+inline void CornerToCenterSize(const float* corners, size_t num, float* anchors) {
+    for (size_t i = 0; i < num; i++) {
+        const float* c = corners + i * 4;
+        float* a = anchors + i * 4;
+        a[0] = (c[0] + c[2]) * 0.5f;
+        a[1] = (c[1] + c[3]) * 0.5f;
+        a[2] = c[2] - c[0];
+        a[3] = c[3] - c[1];
+    }
+}
+
+// Candidate boxes gathered in score order and stored as SoA so that IoU is computed four at a time.
+class NmsWorkspace {
+public:
+    void Gather(const float* boxes, const std::vector<int>& order) {
+        size_t padded = (order.size() + 3) / 4 * 4;
+        ymin_.assign(padded, 0.0f);
+        xmin_.assign(padded, 0.0f);
+        ymax_.assign(padded, 0.0f);
+        xmax_.assign(padded, 0.0f);
+        area_.assign(padded, 0.0f);
+        for (size_t i = 0; i < order.size(); i++) {
+            const float* b = boxes + static_cast<size_t>(order[i]) * 4;
+            // NonMaxSuppressionV3D accepts either corner order
+            ymin_[i] = std::min(b[0], b[2]);
+            xmin_[i] = std::min(b[1], b[3]);
+            ymax_[i] = std::max(b[0], b[2]);
+            xmax_[i] = std::max(b[1], b[3]);
+            area_[i] = (ymax_[i] - ymin_[i]) * (xmax_[i] - xmin_[i]);
+        }
+    }
+
+    // Suppresses every alive candidate after `index` whose IoU with it is above the threshold.
+    void Suppress(size_t index, size_t count, float iouThreshold, std::vector<uint8_t>& alive) const {
+        using namespace simd_util;
+        const Float4 y0 = Set4(ymin_[index]);
+        const Float4 x0 = Set4(xmin_[index]);
+        const Float4 y1 = Set4(ymax_[index]);
+        const Float4 x1 = Set4(xmax_[index]);
+        const Float4 area = Set4(area_[index]);
+        const Float4 zero = Set4(0.0f);
+        const Float4 threshold = Set4(iouThreshold);
+        float iouOverThreshold[4];
+        size_t j = (index + 1) / 4 * 4;
+        for (; j < count; j += 4) {
+            Float4 h = Max4(Sub4(Min4(y1, Load4(&ymax_[j])), Max4(y0, Load4(&ymin_[j]))), zero);
+            Float4 w = Max4(Sub4(Min4(x1, Load4(&xmax_[j])), Max4(x0, Load4(&xmin_[j]))), zero);
+            Float4 inter = Mul4(h, w);
+            Float4 uni = Sub4(Add4(area, Load4(&area_[j])), inter);
+            // iou > t  <=>  inter > t * union, avoids the division and the union == 0 case
+            Store4(iouOverThreshold, Sub4(inter, Mul4(threshold, uni)));
+            for (size_t k = 0; k < 4 && j + k < count; k++) {
+                if (j + k > index && iouOverThreshold[k] > 0.0f) {
+                    alive[j + k] = 0;
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<float> ymin_;
+    std::vector<float> xmin_;
+    std::vector<float> ymax_;
+    std::vector<float> xmax_;
+    std::vector<float> area_;
+};
+
+// Greedy hard NMS with NonMaxSuppressionV3D semantics: candidates with score > scoreThreshold are visited in
+// descending score order and a box is dropped when its IoU with an already selected box exceeds iouThreshold.
+// `scores` is read with the given stride so that one class column of an anchor-major score tensor can be
+// used directly. Selected anchor indices are returned in score order.
+inline std::vector<int> NonMaxSuppression(const float* boxes, const float* scores, size_t num, size_t scoreStride,
+                                          const NmsParam& param) {
+    std::vector<int> order;
+    for (size_t i = 0; i < num; i++) {
+        if (scores[i * scoreStride] > param.scoreThreshold) {
+            order.push_back(static_cast<int>(i));
+        }
+    }
+    auto byScore = [scores, scoreStride](int a, int b) {
+        float sa = scores[static_cast<size_t>(a) * scoreStride];
+        float sb = scores[static_cast<size_t>(b) * scoreStride];
+        return sa > sb || (sa == sb && a < b);
+    };
+    if (param.topK > 0 && order.size() > static_cast<size_t>(param.topK)) {
+        std::partial_sort(order.begin(), order.begin() + param.topK, order.end(), byScore);
+        order.resize(param.topK);
+    } else {
+        std::sort(order.begin(), order.end(), byScore);
+    }
+
+    NmsWorkspace workspace;
+    workspace.Gather(boxes, order);
+    std::vector<uint8_t> alive(order.size(), 1);
+    std::vector<int> selected;
+    for (size_t i = 0; i < order.size() && static_cast<int>(selected.size()) < param.maxOutputSize; i++) {
+        if (!alive[i]) {
+            continue;
+        }
+        selected.push_back(order[i]);
+        workspace.Suppress(i, order.size(), param.iouThreshold, alive);
+    }
+    return selected;
+}
+
+inline void SortAndTruncate(std::vector<Detection>& detections, size_t maxNum) {
+    auto byScore = [](const Detection& a, const Detection& b) {
+        return a.score > b.score || (a.score == b.score && a.anchor < b.anchor);
+    };
+    if (detections.size() > maxNum) {
+        std::partial_sort(detections.begin(), detections.begin() + maxNum, detections.end(), byScore);
+        detections.resize(maxNum);
+    } else {
+        std::sort(detections.begin(), detections.end(), byScore);
+    }
+}
+
+// Regular multi-class NMS, one independent NMS per class spread over threads.
+inline std::vector<Detection> MultiClassNms(const float* boxes, const float* scores, size_t numAnchors,
+                                            size_t numClasses, const DetectionParam& param) {
+    const size_t firstClass = param.isBgInLabel ? 0 : 1;
+    if (numClasses <= firstClass) {
+        return {};
+    }
+    NmsParam nms;
+    nms.maxOutputSize = param.maxDetectionsPerClass;
+    nms.iouThreshold = param.iouThreshold;
+    nms.scoreThreshold = param.scoreThreshold;
+    nms.topK = param.topK;
+    std::vector<std::vector<Detection>> perClass(numClasses - firstClass);
+    parallel_util::ParallelFor(firstClass, numClasses, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            std::vector<int> keep = NonMaxSuppression(boxes, scores + c, numAnchors, numClasses, nms);
+            std::vector<Detection>& out = perClass[c - firstClass];
+            for (int anchor : keep) {
+                Detection det;
+                det.anchor = anchor;
+                det.classId = static_cast<int>(c - firstClass);
+                det.score = scores[static_cast<size_t>(anchor) * numClasses + c];
+                std::copy(boxes + static_cast<size_t>(anchor) * 4, boxes + static_cast<size_t>(anchor) * 4 + 4,
+                          det.box);
+                out.push_back(det);
+            }
+        }
+    }, param.threadNum);
+
+    std::vector<Detection> detections;
+    for (const auto& dets : perClass) {
+        detections.insert(detections.end(), dets.begin(), dets.end());
+    }
+    SortAndTruncate(detections, static_cast<size_t>(param.maxNumDetections));
+    return detections;
+}
+
+// Fast path of DetectionPostprocessing (use_regular_nms = false): a single NMS over the best class score of
+// every anchor, then up to maxClassesPerDetection labels are reported for each kept box.
+inline std::vector<Detection> FastNms(const float* boxes, const float* scores, size_t numAnchors, size_t numClasses,
+                                      const DetectionParam& param) {
+    const size_t firstClass = param.isBgInLabel ? 0 : 1;
+    if (numClasses <= firstClass) {
+        return {};
+    }
+    std::vector<float> maxScores(numAnchors);
+    parallel_util::ParallelFor(0, numAnchors, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float* row = scores + i * numClasses;
+            maxScores[i] = *std::max_element(row + firstClass, row + numClasses);
+        }
+    }, param.threadNum, 1024);
+
+    NmsParam nms;
+    nms.maxOutputSize = param.maxNumDetections;
+    nms.iouThreshold = param.iouThreshold;
+    nms.scoreThreshold = param.scoreThreshold;
+    nms.topK = param.topK;
+    std::vector<int> keep = NonMaxSuppression(boxes, maxScores.data(), numAnchors, 1, nms);
+
+    const size_t classesPerDetection = std::min<size_t>(std::max(param.maxClassesPerDetection, 1),
+                                                        numClasses - firstClass);
+    std::vector<int> classOrder(numClasses - firstClass);
+    std::vector<Detection> detections;
+    for (int anchor : keep) {
+        const float* row = scores + static_cast<size_t>(anchor) * numClasses + firstClass;
+        std::iota(classOrder.begin(), classOrder.end(), 0);
+        std::partial_sort(classOrder.begin(), classOrder.begin() + classesPerDetection, classOrder.end(),
+                          [row](int a, int b) { return row[a] > row[b]; });
+        for (size_t k = 0; k < classesPerDetection; k++) {
+            Detection det;
+            det.anchor = anchor;
+            det.classId = classOrder[k];
+            det.score = row[classOrder[k]];
+            std::copy(boxes + static_cast<size_t>(anchor) * 4, boxes + static_cast<size_t>(anchor) * 4 + 4,
+                      det.box);
+            detections.push_back(det);
+        }
+    }
+    SortAndTruncate(detections, static_cast<size_t>(param.maxNumDetections) * classesPerDetection);
+    return detections;
+}
+
+// Decode + NMS directly on the raw output buffers. `boxes` is scratch of numAnchors * 4 floats.
+inline std::vector<Detection> DetectionPostprocess(const float* scores, const float* deltas, const float* anchors,
+                                                   size_t numAnchors, size_t numClasses, const DetectionParam& param,
+                                                   float* boxes) {
+    parallel_util::ParallelFor(0, numAnchors, [&](size_t begin, size_t end) {
+        DecodeBoxes(deltas + begin * 4, anchors + begin * 4, end - begin, param.decode, boxes + begin * 4);
+    }, param.threadNum, 4096);
+    if (param.useRegularNms) {
+        return MultiClassNms(boxes, scores, numAnchors, numClasses, param);
+    }
+    return FastNms(boxes, scores, numAnchors, numClasses, param);
+}
+
+// Same as above on the model output tensors. The box count comes from the delta tensor and the class count
+// from the score tensor size.
+inline std::vector<Detection> DetectionPostprocess(const std::shared_ptr<hiai::AiTensor>& score,
+                                                   const std::shared_ptr<hiai::AiTensor>& bboxDelta,
+                                                   const std::shared_ptr<hiai::AiTensor>& anchors,
+                                                   const DetectionParam& param, std::vector<float>& boxes) {
+    size_t numAnchors = bboxDelta->GetSize() / sizeof(float) / 4;
+    if (numAnchors == 0 || anchors->GetSize() / sizeof(float) / 4 != numAnchors) {
+        return {};
+    }
+    size_t numClasses = score->GetSize() / sizeof(float) / numAnchors;
+    boxes.resize(numAnchors * 4);
+    return DetectionPostprocess(static_cast<const float*>(score->GetBuffer()),
+                                static_cast<const float*>(bboxDelta->GetBuffer()),
+                                static_cast<const float*>(anchors->GetBuffer()), numAnchors, numClasses, param,
+                                boxes.data());
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_DETECTION_H
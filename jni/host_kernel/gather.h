@@ -0,0 +1,175 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_GATHER_H
+#define BUILD_IR_MODEL_HOST_KERNEL_GATHER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "parallel_util.h"
+
+// Row gathers and scatters for embedding lookups. Gather / GatherV2D / GatherNd read rows of a table, which may
+// be a mmapped Const of hundreds of MB, in index order. The row PREFETCH_DISTANCE lookups ahead is prefetched so
+// the cache misses of a large table overlap, and threads split the lookups into contiguous chunks. Repeated
+// indices are not deduplicated here: the second read of a row hits the cache the first one filled.
+// ScatterNd sorts its indices by row once. Repeats then form runs that one thread sums in index order, and no
+// two threads write the same output row.
+namespace host_kernel {
+namespace gather {
+const size_t PREFETCH_DISTANCE = 16;
+const int64_t PREFETCH_BYTES = 256;
+const int64_t CACHE_LINE = 64;
+const int64_t MIN_TASK_BYTES = 1 << 16;
+
+struct Lookup {
+    int64_t row;
+    int64_t position;
+};
+
+// Lookups sorted by row, positions ascending within a row; false when a row is outside [0, rowNum).
+inline bool SortLookups(const int64_t* rows, int64_t num, int64_t rowNum, std::vector<Lookup>& lookups) {
+    lookups.resize(static_cast<size_t>(num));
+    for (int64_t i = 0; i < num; i++) {
+        if (rows[i] < 0 || rows[i] >= rowNum) {
+            return false;
+        }
+        lookups[i].row = rows[i];
+        lookups[i].position = i;
+    }
+    std::sort(lookups.begin(), lookups.end(), [](const Lookup& a, const Lookup& b) {
+        return a.row < b.row || (a.row == b.row && a.position < b.position);
+    });
+    return true;
+}
+
+// Start of every run of equal rows, then lookups.size().
+inline std::vector<size_t> RunStarts(const std::vector<Lookup>& lookups) {
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < lookups.size(); i++) {
+        if (i == 0 || lookups[i].row != lookups[i - 1].row) {
+            starts.push_back(i);
+        }
+    }
+    starts.push_back(lookups.size());
+    return starts;
+}
+
+inline void Prefetch(const uint8_t* row, int64_t rowBytes) {
+#if defined(__GNUC__)
+    for (int64_t offset = 0; offset < std::min(rowBytes, PREFETCH_BYTES); offset += CACHE_LINE) {
+        __builtin_prefetch(row + offset);
+    }
+#else
+    (void)row;
+    (void)rowBytes;
+#endif
+}
+
+inline size_t MinRuns(int64_t bytesPerRun) {
+    return static_cast<size_t>(std::max<int64_t>(1, MIN_TASK_BYTES / std::max<int64_t>(bytesPerRun, 1)));
+}
+
+// Flat row of every index tuple of indices [num, depth] into a tensor whose leading dims are dims[0, depth);
+// false when a component is out of range.
+template<typename T>
+inline bool NdRows(const T* indices, int64_t num, int64_t depth, const std::vector<int64_t>& dims,
+                   std::vector<int64_t>& rows) {
+    rows.resize(static_cast<size_t>(num));
+    for (int64_t i = 0; i < num; i++) {
+        int64_t row = 0;
+        for (int64_t d = 0; d < depth; d++) {
+            int64_t index = static_cast<int64_t>(indices[i * depth + d]);
+            if (index < 0 || index >= dims[d]) {
+                return false;
+            }
+            row = row * dims[d] + index;
+        }
+        rows[i] = row;
+    }
+    return true;
+}
+}
+
+namespace gather {
+// Copies the rows of lookups [begin, end). ROW_BYTES > 0 fixes the row size at compile time, so the copies of the
+// usual embedding widths are inlined instead of going through a memcpy call per row.
+template<int64_t ROW_BYTES>
+inline void GatherChunk(const uint8_t* src, int64_t outer, int64_t rowNum, int64_t rowBytes, const int64_t* rows,
+                        int64_t num, size_t begin, size_t end, uint8_t* dst) {
+    const int64_t bytes = ROW_BYTES > 0 ? ROW_BYTES : rowBytes;
+    for (size_t i = begin; i < end; i++) {
+        for (int64_t o = 0; o < outer; o++) {
+            const uint8_t* base = src + o * rowNum * bytes;
+            if (i + PREFETCH_DISTANCE < end) {
+                Prefetch(base + rows[i + PREFETCH_DISTANCE] * bytes, bytes);
+            }
+            std::memcpy(dst + (o * num + static_cast<int64_t>(i)) * bytes, base + rows[i] * bytes,
+                        static_cast<size_t>(bytes));
+        }
+    }
+}
+}
+
+// y [outer, num, rowBytes] = table [outer, rowNum, rowBytes] at rows[0, num) along the middle axis, copied as
+// raw bytes so any element type works. False when a row is outside [0, rowNum).
+inline bool GatherRows(const void* table, int64_t outer, int64_t rowNum, int64_t rowBytes, const int64_t* rows,
+                       int64_t num, void* y, int threadNum = 0) {
+    for (int64_t i = 0; i < num; i++) {
+        if (rows[i] < 0 || rows[i] >= rowNum) {
+            return false;
+        }
+    }
+    const uint8_t* src = static_cast<const uint8_t*>(table);
+    uint8_t* dst = static_cast<uint8_t*>(y);
+    parallel_util::ParallelFor(0, static_cast<size_t>(num), [&](size_t begin, size_t end) {
+        switch (rowBytes) {
+            case 64:
+                gather::GatherChunk<64>(src, outer, rowNum, rowBytes, rows, num, begin, end, dst);
+                break;
+            case 128:
+                gather::GatherChunk<128>(src, outer, rowNum, rowBytes, rows, num, begin, end, dst);
+                break;
+            case 256:
+                gather::GatherChunk<256>(src, outer, rowNum, rowBytes, rows, num, begin, end, dst);
+                break;
+            case 512:
+                gather::GatherChunk<512>(src, outer, rowNum, rowBytes, rows, num, begin, end, dst);
+                break;
+            default:
+                gather::GatherChunk<0>(src, outer, rowNum, rowBytes, rows, num, begin, end, dst);
+                break;
+        }
+    }, threadNum, gather::MinRuns(outer * rowBytes));
+    return true;
+}
+
+// y [rowNum, rowSize] = 0, then y[rows[i]] += updates[i] for updates [num, rowSize]; repeats of a row are summed
+// in index order. False when a row is outside [0, rowNum).
+inline bool ScatterAddRows(const float* updates, const int64_t* rows, int64_t num, int64_t rowSize, float* y,
+                           int64_t rowNum, int threadNum = 0) {
+    std::vector<gather::Lookup> lookups;
+    if (!gather::SortLookups(rows, num, rowNum, lookups)) {
+        return false;
+    }
+    parallel_util::ParallelFor(0, static_cast<size_t>(rowNum), [&](size_t begin, size_t end) {
+        std::memset(y + begin * rowSize, 0, (end - begin) * static_cast<size_t>(rowSize) * sizeof(float));
+    }, threadNum, gather::MinRuns(rowSize * static_cast<int64_t>(sizeof(float))));
+    std::vector<size_t> runs = gather::RunStarts(lookups);
+    parallel_util::ParallelFor(0, runs.size() - 1, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            float* out = y + lookups[runs[r]].row * rowSize;
+            std::memcpy(out, updates + lookups[runs[r]].position * rowSize,
+                        static_cast<size_t>(rowSize) * sizeof(float));
+            for (size_t i = runs[r] + 1; i < runs[r + 1]; i++) {
+                const float* in = updates + lookups[i].position * rowSize;
+                for (int64_t j = 0; j < rowSize; j++) {
+                    out[j] += in[j];
+                }
+            }
+        }
+    }, threadNum, gather::MinRuns(rowSize * static_cast<int64_t>(sizeof(float))));
+    return true;
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_GATHER_H
@@ -0,0 +1,292 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_GEMM_H
+#define BUILD_IR_MODEL_HOST_KERNEL_GEMM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define HOST_KERNEL_GEMM_AVX2 1
+#endif
+
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Cache-blocked FP32 GEMM behind MatMul, BatchMatMul and FullyConnection: C = op(A) * op(B) + bias, row-major,
+// bias per column of C. A KC x NC panel of B is packed once and reused by every MC x KC block of A; both are
+// packed in register-tile strips (MR rows of A, NR columns of B) so the micro-kernel reads them with unit
+// stride and keeps the MR x NR tile of C in registers. Batches, N blocks and M chunks run on separate threads.
+namespace host_kernel {
+namespace gemm {
+#if defined(HOST_KERNEL_GEMM_AVX2)
+const int MR = 6;
+const int NR = 16;
+#elif defined(__aarch64__)
+const int MR = 8;
+const int NR = 8;
+#else
+const int MR = 4;
+const int NR = 8;
+#endif
+// A block MC x KC stays in L2, a B strip KC x NR in L1.
+const int64_t KC = 256;
+const int64_t MC = 144;
+const int64_t NC = 512;
+
+inline int64_t RoundUp(int64_t v, int64_t unit) {
+    return (v + unit - 1) / unit * unit;
+}
+
+// a points at A(0, 0) of the block, element (i, p) is a[i * lda + p], or a[p * lda + i] when transposed.
+// dst holds ceil(mc / MR) strips of kc * MR, rows past mc are zero.
+inline void PackA(const float* a, int64_t lda, bool trans, int64_t mc, int64_t kc, float* dst) {
+    for (int64_t i0 = 0; i0 < mc; i0 += MR, dst += kc * MR) {
+        int64_t mr = std::min<int64_t>(MR, mc - i0);
+        if (trans) {
+            for (int64_t p = 0; p < kc; p++) {
+                const float* src = a + p * lda + i0;
+                std::copy(src, src + mr, dst + p * MR);
+                std::fill(dst + p * MR + mr, dst + (p + 1) * MR, 0.0f);
+            }
+            continue;
+        }
+        for (int64_t i = 0; i < MR; i++) {
+            const float* src = a + (i0 + i) * lda;
+            for (int64_t p = 0; p < kc; p++) {
+                dst[p * MR + i] = i < mr ? src[p] : 0.0f;
+            }
+        }
+    }
+}
+
+// b points at B(0, 0) of the panel, element (p, j) is b[p * ldb + j], or b[j * ldb + p] when transposed.
+// dst holds ceil(nc / NR) strips of kc * NR, columns past nc are zero.
+inline void PackB(const float* b, int64_t ldb, bool trans, int64_t kc, int64_t nc, float* dst) {
+    for (int64_t j0 = 0; j0 < nc; j0 += NR, dst += kc * NR) {
+        int64_t nr = std::min<int64_t>(NR, nc - j0);
+        if (!trans) {
+            for (int64_t p = 0; p < kc; p++) {
+                const float* src = b + p * ldb + j0;
+                std::copy(src, src + nr, dst + p * NR);
+                std::fill(dst + p * NR + nr, dst + (p + 1) * NR, 0.0f);
+            }
+            continue;
+        }
+        for (int64_t j = 0; j < NR; j++) {
+            const float* src = b + (j0 + j) * ldb;
+            for (int64_t p = 0; p < kc; p++) {
+                dst[p * NR + j] = j < nr ? src[p] : 0.0f;
+            }
+        }
+    }
+}
+
+// One MR x NR tile: c = pa * pb + (first ? bias : c). bias may be null.
+#if defined(HOST_KERNEL_GEMM_AVX2)
+inline void MicroKernel(int64_t kc, const float* pa, const float* pb, float* c, int64_t ldc, bool first,
+                        const float* bias) {
+    __m256 acc[MR][2];
+#pragma GCC unroll 6
+    for (int i = 0; i < MR; i++) {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+    for (int64_t p = 0; p < kc; p++, pa += MR, pb += NR) {
+        __m256 b0 = _mm256_loadu_ps(pb);
+        __m256 b1 = _mm256_loadu_ps(pb + 8);
+#pragma GCC unroll 6
+        for (int i = 0; i < MR; i++) {
+            __m256 a = _mm256_broadcast_ss(pa + i);
+            acc[i][0] = _mm256_fmadd_ps(a, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(a, b1, acc[i][1]);
+        }
+    }
+    __m256 bias0 = bias != nullptr ? _mm256_loadu_ps(bias) : _mm256_setzero_ps();
+    __m256 bias1 = bias != nullptr ? _mm256_loadu_ps(bias + 8) : _mm256_setzero_ps();
+#pragma GCC unroll 6
+    for (int i = 0; i < MR; i++) {
+        float* row = c + i * ldc;
+        _mm256_storeu_ps(row, _mm256_add_ps(acc[i][0], first ? bias0 : _mm256_loadu_ps(row)));
+        _mm256_storeu_ps(row + 8, _mm256_add_ps(acc[i][1], first ? bias1 : _mm256_loadu_ps(row + 8)));
+    }
+}
+#else
+inline void MicroKernel(int64_t kc, const float* pa, const float* pb, float* c, int64_t ldc, bool first,
+                        const float* bias) {
+    using simd_util::Float4;
+    const int cols = NR / 4;
+    Float4 acc[MR][cols];
+#pragma GCC unroll 8
+    for (int i = 0; i < MR; i++) {
+#pragma GCC unroll 2
+        for (int j = 0; j < cols; j++) {
+            acc[i][j] = simd_util::Set4(0.0f);
+        }
+    }
+    for (int64_t p = 0; p < kc; p++, pa += MR, pb += NR) {
+        Float4 b[cols];
+#pragma GCC unroll 2
+        for (int j = 0; j < cols; j++) {
+            b[j] = simd_util::Load4(pb + j * 4);
+        }
+#pragma GCC unroll 8
+        for (int i = 0; i < MR; i++) {
+            Float4 a = simd_util::Set4(pa[i]);
+#pragma GCC unroll 2
+            for (int j = 0; j < cols; j++) {
+                acc[i][j] = simd_util::Fma4(a, b[j], acc[i][j]);
+            }
+        }
+    }
+#pragma GCC unroll 8
+    for (int i = 0; i < MR; i++) {
+        float* row = c + i * ldc;
+#pragma GCC unroll 2
+        for (int j = 0; j < cols; j++) {
+            Float4 base = first ? (bias != nullptr ? simd_util::Load4(bias + j * 4) : simd_util::Set4(0.0f))
+                                : simd_util::Load4(row + j * 4);
+            simd_util::Store4(row + j * 4, simd_util::Add4(acc[i][j], base));
+        }
+    }
+}
+#endif
+
+// Tiles cut by the edge of C go through a local tile.
+inline void EdgeKernel(int64_t kc, const float* pa, const float* pb, float* c, int64_t ldc, int64_t mr, int64_t nr,
+                       bool first, const float* bias) {
+    float tile[MR * NR];
+    MicroKernel(kc, pa, pb, tile, NR, true, nullptr);
+    for (int64_t i = 0; i < mr; i++) {
+        for (int64_t j = 0; j < nr; j++) {
+            float base = first ? (bias != nullptr ? bias[j] : 0.0f) : c[i * ldc + j];
+            c[i * ldc + j] = tile[i * NR + j] + base;
+        }
+    }
+}
+
+inline float Dot(const float* a, const float* b, int64_t k) {
+    simd_util::Float4 acc0 = simd_util::Set4(0.0f);
+    simd_util::Float4 acc1 = simd_util::Set4(0.0f);
+    int64_t p = 0;
+    for (; p + 8 <= k; p += 8) {
+        acc0 = simd_util::Fma4(simd_util::Load4(a + p), simd_util::Load4(b + p), acc0);
+        acc1 = simd_util::Fma4(simd_util::Load4(a + p + 4), simd_util::Load4(b + p + 4), acc1);
+    }
+    float sum = simd_util::ReduceSum4(simd_util::Add4(acc0, acc1));
+    for (; p < k; p++) {
+        sum += a[p] * b[p];
+    }
+    return sum;
+}
+
+struct Problem {
+    int64_t m = 0;
+    int64_t n = 0;
+    int64_t k = 0;
+    const float* a = nullptr;
+    int64_t lda = 0;
+    bool transA = false;
+    const float* b = nullptr;
+    int64_t ldb = 0;
+    bool transB = false;
+    const float* bias = nullptr;
+    float* c = nullptr;
+    int64_t ldc = 0;
+};
+
+// Rows [m0, m1) and columns [n0, n1) of C, packA / packB hold MC x KC and KC x NC.
+inline void GemmBlock(const Problem& pr, int64_t m0, int64_t m1, int64_t n0, int64_t n1, float* packA,
+                      float* packB) {
+    for (int64_t pc = 0; pc < pr.k; pc += KC) {
+        int64_t kc = std::min(KC, pr.k - pc);
+        bool first = pc == 0;
+        const float* bPanel = pr.transB ? pr.b + n0 * pr.ldb + pc : pr.b + pc * pr.ldb + n0;
+        PackB(bPanel, pr.ldb, pr.transB, kc, n1 - n0, packB);
+        for (int64_t ic = m0; ic < m1; ic += MC) {
+            int64_t mc = std::min(MC, m1 - ic);
+            const float* aBlock = pr.transA ? pr.a + pc * pr.lda + ic : pr.a + ic * pr.lda + pc;
+            PackA(aBlock, pr.lda, pr.transA, mc, kc, packA);
+            for (int64_t jr = 0; jr < n1 - n0; jr += NR) {
+                int64_t nr = std::min<int64_t>(NR, n1 - n0 - jr);
+                const float* pb = packB + jr * kc;
+                const float* bias = pr.bias != nullptr ? pr.bias + n0 + jr : nullptr;
+                for (int64_t ir = 0; ir < mc; ir += MR) {
+                    int64_t mr = std::min<int64_t>(MR, mc - ir);
+                    float* c = pr.c + (ic + ir) * pr.ldc + n0 + jr;
+                    if (mr == MR && nr == NR) {
+                        MicroKernel(kc, packA + ir * kc, pb, c, pr.ldc, first, bias);
+                    } else {
+                        EdgeKernel(kc, packA + ir * kc, pb, c, pr.ldc, mr, nr, first, bias);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Independent problems of the same M, N and K, e.g. the batches of a BatchMatMul or the groups of a
+// convolution. All of M shares one packed B panel unless that leaves threads idle.
+inline void Run(const std::vector<Problem>& problems, int threadNum = 0) {
+    if (problems.empty() || problems[0].m <= 0 || problems[0].n <= 0) {
+        return;
+    }
+    int64_t m = problems[0].m;
+    int64_t n = problems[0].n;
+    if (problems[0].k <= 0) {
+        for (const Problem& pr : problems) {
+            for (int64_t i = 0; i < m; i++) {
+                for (int64_t j = 0; j < n; j++) {
+                    pr.c[i * pr.ldc + j] = pr.bias != nullptr ? pr.bias[j] : 0.0f;
+                }
+            }
+        }
+        return;
+    }
+    if (threadNum <= 0) {
+        threadNum = parallel_util::GetThreadNum();
+    }
+    int64_t count = static_cast<int64_t>(problems.size());
+    int64_t nBlocks = (n + NC - 1) / NC;
+    int64_t mSplits = std::min((threadNum + count * nBlocks - 1) / (count * nBlocks), (m + MR - 1) / MR);
+    int64_t mChunk = RoundUp((m + mSplits - 1) / mSplits, MR);
+    int64_t mBlocks = (m + mChunk - 1) / mChunk;
+    parallel_util::ParallelFor(0, static_cast<size_t>(count * nBlocks * mBlocks), [&](size_t begin, size_t end) {
+        std::vector<float> packA(MC * KC);
+        std::vector<float> packB(KC * NC);
+        for (size_t task = begin; task < end; task++) {
+            const Problem& pr = problems[task / (nBlocks * mBlocks)];
+            int64_t nb = static_cast<int64_t>(task) / mBlocks % nBlocks;
+            int64_t mb = static_cast<int64_t>(task) % mBlocks;
+            GemmBlock(pr, mb * mChunk, std::min(m, (mb + 1) * mChunk), nb * NC, std::min(n, (nb + 1) * NC),
+                      packA.data(), packB.data());
+        }
+    }, threadNum);
+}
+}
+
+// `batch` contiguous problems: A is [batch, M, K] ([batch, K, M] when transA), B is [batch, K, N]
+// ([batch, N, K] when transB), C is [batch, M, N]. bias is [N] or null and shared by all batches.
+inline void Gemm(int64_t batch, int64_t m, int64_t n, int64_t k, const float* a, bool transA, const float* b,
+                 bool transB, const float* bias, float* c, int threadNum = 0) {
+    std::vector<gemm::Problem> problems(static_cast<size_t>(std::max<int64_t>(batch, 0)));
+    for (int64_t bi = 0; bi < batch; bi++) {
+        gemm::Problem& pr = problems[bi];
+        pr.m = m;
+        pr.n = n;
+        pr.k = k;
+        pr.a = a + bi * m * k;
+        pr.lda = transA ? m : k;
+        pr.transA = transA;
+        pr.b = b + bi * k * n;
+        pr.ldb = transB ? k : n;
+        pr.transB = transB;
+        pr.bias = bias;
+        pr.c = c + bi * m * n;
+        pr.ldc = n;
+    }
+    gemm::Run(problems, threadNum);
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_GEMM_H
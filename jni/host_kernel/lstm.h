@@ -0,0 +1,354 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_LSTM_H
+#define BUILD_IR_MODEL_HOST_KERNEL_LSTM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "host_kernel/conv.h"
+#include "host_kernel/gemm.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Fused LSTM sequence kernel. The input projection w_x . x (+ bias, + the x_static term) of all time steps is
+// one GEMM up front; the recurrence then only adds h_{t-1} . w_h^T per step (one dot product per gate row,
+// the w_h rows stay hot in cache) and applies the gates with Sigmoid4 / Tanh4 on [B, H] state buffers.
+//   LSTM             Caffe semantics: gates i, f, o, g; cont[t, b] scales h_{t-1} and c_{t-1}, 0 starts a new
+//                    sequence
+//   BidirectionLSTM  TF LSTMCell semantics: gates i, j, f, o, forget_bias on f, `activation` in place of tanh,
+//                    no bias; steps at or past seq_len[b] output 0 and keep the state, the backward direction
+//                    walks each sequence from seq_len[b] - 1 down to 0. The directions run on two threads.
+// With LstmOptions::streaming the final state of a layer is kept by name and becomes the initial state of its
+// next run (forward direction only for BidirectionLSTM), so audio can be fed chunk by chunk; explicit h_0 / c_0
+// inputs take precedence.
+namespace host_kernel {
+enum class LstmActivation {
+    TANH,
+    SIGMOID,
+    RELU,
+    RELU1,
+    RELU6,
+};
+
+struct LstmOptions {
+    bool streaming = false;
+};
+
+inline LstmOptions& GetLstmOptions() {
+    static LstmOptions options;
+    return options;
+}
+
+namespace lstm {
+// Gate offsets in units of H within the 4H gate vector.
+struct GateOrder {
+    int64_t i;
+    int64_t f;
+    int64_t o;
+    int64_t g;
+};
+
+const GateOrder CAFFE_GATES = {0, 1, 2, 3};
+const GateOrder TF_GATES = {0, 2, 3, 1};
+
+// One direction of the recurrence. gatesX [T, B, 4H] holds the input projection and is updated in place,
+// whT [4H, H] is the recurrent weight with one row per gate unit.
+struct Direction {
+    int64_t t = 0;
+    int64_t b = 0;
+    int64_t hidden = 0;
+    float* gatesX = nullptr;
+    const float* whT = nullptr;
+    GateOrder order = CAFFE_GATES;
+    LstmActivation activation = LstmActivation::TANH;
+    float forgetBias = 0.0f;
+    const float* cont = nullptr;     // [T, B] or null
+    const int32_t* seqLen = nullptr; // [B] or null
+    bool reverse = false;
+    float* h = nullptr;              // [B, H] initial state in, final state out
+    float* c = nullptr;
+    float* y = nullptr;              // [T, B, H]
+};
+
+inline simd_util::Float4 Activate4(simd_util::Float4 x, LstmActivation activation) {
+    switch (activation) {
+        case LstmActivation::SIGMOID: return simd_util::Sigmoid4(x);
+        case LstmActivation::RELU: return simd_util::Max4(x, simd_util::Set4(0.0f));
+        case LstmActivation::RELU1:
+            return simd_util::Min4(simd_util::Max4(x, simd_util::Set4(-1.0f)), simd_util::Set4(1.0f));
+        case LstmActivation::RELU6:
+            return simd_util::Min4(simd_util::Max4(x, simd_util::Set4(0.0f)), simd_util::Set4(6.0f));
+        default: return simd_util::Tanh4(x);
+    }
+}
+
+// Applies the activation to n values in place, the tail goes through a padded Float4 as well so every unit
+// sees the same arithmetic.
+inline void ActivateRow(float* x, int64_t n, LstmActivation activation, bool sigmoid) {
+    int64_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        simd_util::Float4 v = simd_util::Load4(x + j);
+        simd_util::Store4(x + j, sigmoid ? simd_util::Sigmoid4(v) : Activate4(v, activation));
+    }
+    if (j < n) {
+        float tail[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        std::copy(x + j, x + n, tail);
+        simd_util::Float4 v = simd_util::Load4(tail);
+        simd_util::Store4(tail, sigmoid ? simd_util::Sigmoid4(v) : Activate4(v, activation));
+        std::copy(tail, tail + (n - j), x + j);
+    }
+}
+
+inline void RunDirection(const Direction& d) {
+    const int64_t hidden = d.hidden;
+    const int64_t gateNum = 4 * hidden;
+    std::vector<float> act(static_cast<size_t>(hidden));
+    for (int64_t step = 0; step < d.t; step++) {
+        for (int64_t b = 0; b < d.b; b++) {
+            int64_t len = d.seqLen != nullptr ? std::min<int64_t>(std::max(d.seqLen[b], 0), d.t) : d.t;
+            float* y = d.y + (step * d.b + b) * hidden;
+            if (step >= len) {
+                std::fill_n(y, hidden, 0.0f);
+                continue;
+            }
+            int64_t t = d.reverse ? len - 1 - step : step;
+            y = d.y + (t * d.b + b) * hidden;
+            float* h = d.h + b * hidden;
+            float* c = d.c + b * hidden;
+            if (d.cont != nullptr && d.cont[t * d.b + b] != 1.0f) {
+                float cont = d.cont[t * d.b + b];
+                for (int64_t j = 0; j < hidden; j++) {
+                    h[j] *= cont;
+                    c[j] *= cont;
+                }
+            }
+            float* gates = d.gatesX + (t * d.b + b) * gateNum;
+            for (int64_t g = 0; g < gateNum; g++) {
+                gates[g] += gemm::Dot(h, d.whT + g * hidden, hidden);
+            }
+            float* gi = gates + d.order.i * hidden;
+            float* gf = gates + d.order.f * hidden;
+            float* go = gates + d.order.o * hidden;
+            float* gg = gates + d.order.g * hidden;
+            if (d.forgetBias != 0.0f) {
+                for (int64_t j = 0; j < hidden; j++) {
+                    gf[j] += d.forgetBias;
+                }
+            }
+            ActivateRow(gi, hidden, d.activation, true);
+            ActivateRow(gf, hidden, d.activation, true);
+            ActivateRow(go, hidden, d.activation, true);
+            ActivateRow(gg, hidden, d.activation, false);
+            for (int64_t j = 0; j < hidden; j++) {
+                c[j] = gf[j] * c[j] + gi[j] * gg[j];
+            }
+            std::copy(c, c + hidden, act.data());
+            ActivateRow(act.data(), hidden, d.activation, false);
+            for (int64_t j = 0; j < hidden; j++) {
+                h[j] = go[j] * act[j];
+            }
+            std::copy(h, h + hidden, y);
+        }
+    }
+}
+
+// Final states of streaming layers, by layer name.
+class StateStore {
+public:
+    bool Load(const std::string& name, size_t num, float* h, float* c) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = states_.find(name);
+        if (it == states_.end() || it->second.first.size() != num) {
+            return false;
+        }
+        std::copy(it->second.first.begin(), it->second.first.end(), h);
+        std::copy(it->second.second.begin(), it->second.second.end(), c);
+        return true;
+    }
+
+    void Save(const std::string& name, size_t num, const float* h, const float* c) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_[name] = std::make_pair(std::vector<float>(h, h + num), std::vector<float>(c, c + num));
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_.clear();
+    }
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, std::pair<std::vector<float>, std::vector<float>>> states_;
+};
+
+inline StateStore& GetStateStore() {
+    static StateStore store;
+    return store;
+}
+
+// Initial state: explicit h0 / c0 ([B, H] or one [H] row for every batch), else the streamed state, else 0.
+inline void InitState(const std::string& name, const float* h0, size_t h0Num, const float* c0, size_t c0Num,
+                      int64_t b, int64_t hidden, bool stream, float* h, float* c) {
+    size_t num = static_cast<size_t>(b * hidden);
+    std::fill_n(h, num, 0.0f);
+    std::fill_n(c, num, 0.0f);
+    if (h0 == nullptr && c0 == nullptr) {
+        if (stream && GetLstmOptions().streaming) {
+            GetStateStore().Load(name, num, h, c);
+        }
+        return;
+    }
+    for (int64_t i = 0; i < b; i++) {
+        if (h0 != nullptr) {
+            std::copy(h0 + (h0Num == num ? i * hidden : 0), h0 + (h0Num == num ? i * hidden : 0) + hidden,
+                      h + i * hidden);
+        }
+        if (c0 != nullptr) {
+            std::copy(c0 + (c0Num == num ? i * hidden : 0), c0 + (c0Num == num ? i * hidden : 0) + hidden,
+                      c + i * hidden);
+        }
+    }
+}
+
+// w [rows, cols] row-major -> [cols, rows], cached for constant weights under (name, address, size).
+inline std::shared_ptr<const std::vector<float>> TransposedWeight(const std::string& name, const float* w,
+                                                                  int64_t rows, int64_t cols, bool constant) {
+    size_t num = static_cast<size_t>(rows * cols);
+    // -1 keeps these entries apart from the convolution algorithms sharing the cache
+    conv::WeightCache::Key key(name, w, num, -1);
+    uint64_t fingerprint = conv::Fingerprint(w, num);
+    std::shared_ptr<const std::vector<float>> cached = constant ? conv::GetWeightCache().Find(key, fingerprint) :
+                                                                  nullptr;
+    if (cached != nullptr) {
+        return cached;
+    }
+    std::vector<float> t(num);
+    for (int64_t r = 0; r < rows; r++) {
+        for (int64_t col = 0; col < cols; col++) {
+            t[col * rows + r] = w[r * cols + col];
+        }
+    }
+    auto result = std::make_shared<const std::vector<float>>(std::move(t));
+    if (constant) {
+        conv::GetWeightCache().Insert(key, fingerprint, result);
+    }
+    return result;
+}
+}
+
+inline void ResetLstmStates() {
+    lstm::GetStateStore().Clear();
+}
+
+// Caffe LSTM over x [T, B, X]: wx [4H, X], bias [4H] or null, wh [4H, H], optional xStatic [B, Xs] with
+// wxStatic [4H, Xs], cont [T, B] or null. h0 / c0 hold B * H (or H) values or are null. y [T, B, H],
+// hT / cT [B, H].
+struct LstmArgs {
+    int64_t t = 0;
+    int64_t b = 0;
+    int64_t x = 0;
+    int64_t hidden = 0;
+    const float* input = nullptr;
+    const float* cont = nullptr;
+    const float* wx = nullptr;
+    const float* bias = nullptr;
+    const float* wh = nullptr;
+    const float* xStatic = nullptr;
+    const float* wxStatic = nullptr;
+    int64_t xStaticSize = 0;
+    const float* h0 = nullptr;
+    size_t h0Num = 0;
+    const float* c0 = nullptr;
+    size_t c0Num = 0;
+};
+
+inline void Lstm(const std::string& name, const LstmArgs& a, float* y, float* hT, float* cT, int threadNum = 0) {
+    const int64_t gateNum = 4 * a.hidden;
+    std::unique_ptr<float[]> gates(new float[a.t * a.b * gateNum]);
+    Gemm(1, a.t * a.b, gateNum, a.x, a.input, false, a.wx, true, a.bias, gates.get(), threadNum);
+    if (a.xStatic != nullptr) {
+        std::vector<float> staticGates(static_cast<size_t>(a.b * gateNum));
+        Gemm(1, a.b, gateNum, a.xStaticSize, a.xStatic, false, a.wxStatic, true, nullptr, staticGates.data(),
+             threadNum);
+        for (int64_t t = 0; t < a.t; t++) {
+            float* dst = gates.get() + t * a.b * gateNum;
+            for (int64_t i = 0; i < a.b * gateNum; i++) {
+                dst[i] += staticGates[i];
+            }
+        }
+    }
+    lstm::Direction d;
+    d.t = a.t;
+    d.b = a.b;
+    d.hidden = a.hidden;
+    d.gatesX = gates.get();
+    d.whT = a.wh;
+    d.order = lstm::CAFFE_GATES;
+    d.cont = a.cont;
+    d.h = hT;
+    d.c = cT;
+    d.y = y;
+    lstm::InitState(name, a.h0, a.h0Num, a.c0, a.c0Num, a.b, a.hidden, true, hT, cT);
+    lstm::RunDirection(d);
+    if (GetLstmOptions().streaming) {
+        lstm::GetStateStore().Save(name, static_cast<size_t>(a.b * a.hidden), hT, cT);
+    }
+}
+
+// One direction of BidirectionLSTM: w [X + H, 4H] (TF kernel layout), initial state as in LstmArgs.
+struct BidirectionLstmWeights {
+    const float* w = nullptr;
+    bool constant = false;
+    const float* h0 = nullptr;
+    size_t h0Num = 0;
+    const float* c0 = nullptr;
+    size_t c0Num = 0;
+};
+
+// x [T, B, X] (time major like LSTM), seqLen [B] or null. yFw / yBw [T, B, H], states [B, H].
+inline void BidirectionLstm(const std::string& name, const float* x, int64_t t, int64_t b, int64_t xSize,
+                            int64_t hidden, const int32_t* seqLen, const BidirectionLstmWeights weights[2],
+                            float forgetBias, LstmActivation activation, float* y[2], float* hT[2], float* cT[2],
+                            int threadNum = 0) {
+    const int64_t gateNum = 4 * hidden;
+    std::unique_ptr<float[]> gates[2];
+    std::shared_ptr<const std::vector<float>> whT[2];
+    for (int dir = 0; dir < 2; dir++) {
+        gates[dir].reset(new float[t * b * gateNum]);
+        Gemm(1, t * b, gateNum, xSize, x, false, weights[dir].w, false, nullptr, gates[dir].get(), threadNum);
+        whT[dir] = lstm::TransposedWeight(name + (dir == 0 ? ":fw" : ":bw"), weights[dir].w + xSize * gateNum,
+                                          hidden, gateNum, weights[dir].constant);
+        lstm::InitState(name, weights[dir].h0, weights[dir].h0Num, weights[dir].c0, weights[dir].c0Num, b, hidden,
+                        dir == 0, hT[dir], cT[dir]);
+    }
+    parallel_util::ParallelFor(0, 2, [&](size_t begin, size_t end) {
+        for (size_t dir = begin; dir < end; dir++) {
+            lstm::Direction d;
+            d.t = t;
+            d.b = b;
+            d.hidden = hidden;
+            d.gatesX = gates[dir].get();
+            d.whT = whT[dir]->data();
+            d.order = lstm::TF_GATES;
+            d.activation = activation;
+            d.forgetBias = forgetBias;
+            d.seqLen = seqLen;
+            d.reverse = dir == 1;
+            d.h = hT[dir];
+            d.c = cT[dir];
+            d.y = y[dir];
+            lstm::RunDirection(d);
+        }
+    }, std::min(threadNum <= 0 ? parallel_util::GetThreadNum() : threadNum, 2));
+    if (GetLstmOptions().streaming) {
+        lstm::GetStateStore().Save(name, static_cast<size_t>(b * hidden), hT[0], cT[0]);
+    }
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_LSTM_H
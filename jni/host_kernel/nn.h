@@ -0,0 +1,477 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_NN_H
+#define BUILD_IR_MODEL_HOST_KERNEL_NN_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host_executor.h"
+#include "host_kernel/conv.h"
+#include "host_kernel/conv_transpose.h"
+#include "host_kernel/gemm.h"
+#include "host_kernel/lstm.h"
+#include "parallel_util.h"
+
+// FP32 reference kernels for the NN ops of graph/op/nn_defs.h (NCHW only). They are the host reference path
+// used by calibration and the CPU fallback of partitioned graphs. The Quantized* variants dequantize their
+// INT8 weights and fake-quantize the input, so they reproduce the rounding error of the NPU kernels.
+namespace host_kernel {
+using host_graph::HostTensor;
+using host_graph::Node;
+
+// Resolves SAME/VALID/SPECIFIC padding. Convolution defaults to SPECIFIC, ConvolutionDepthwise to SAME.
+inline bool GetConvParam(const Node& node, int64_t inH, int64_t inW, int64_t kernelH, int64_t kernelW,
+                         ConvParam& param) {
+    std::vector<int64_t> strides = node.GetInts("strides", {1, 1});
+    std::vector<int64_t> dilations = node.GetInts("dilations", {1, 1});
+    std::vector<int64_t> pads = node.GetInts("pads", {0, 0, 0, 0});
+    bool depthwise = node.type.find("Depthwise") != std::string::npos;
+    std::string padMode = node.GetString("pad_mode", depthwise ? "SAME" : "SPECIFIC");
+    if (strides.size() != 2 || dilations.size() != 2 || pads.size() != 4) {
+        ALOGE("[HOST_KERNEL] %s: bad strides/dilations/pads.\n", node.name.c_str());
+        return false;
+    }
+    param.strideH = strides[0];
+    param.strideW = strides[1];
+    param.dilationH = dilations[0];
+    param.dilationW = dilations[1];
+    // checked before SAME divides by the strides
+    if (param.strideH <= 0 || param.strideW <= 0 || param.dilationH <= 0 || param.dilationW <= 0) {
+        ALOGE("[HOST_KERNEL] %s: strides and dilations must be positive.\n", node.name.c_str());
+        return false;
+    }
+    if (padMode == "SAME") {
+        int64_t outH = (inH + param.strideH - 1) / param.strideH;
+        int64_t outW = (inW + param.strideW - 1) / param.strideW;
+        int64_t padH = std::max<int64_t>((outH - 1) * param.strideH + (kernelH - 1) * param.dilationH + 1 - inH, 0);
+        int64_t padW = std::max<int64_t>((outW - 1) * param.strideW + (kernelW - 1) * param.dilationW + 1 - inW, 0);
+        param.padTop = padH / 2;
+        param.padBottom = padH - padH / 2;
+        param.padLeft = padW / 2;
+        param.padRight = padW - padW / 2;
+    } else if (padMode == "VALID") {
+        param.padTop = param.padBottom = param.padLeft = param.padRight = 0;
+    } else {
+        param.padTop = pads[0];
+        param.padBottom = pads[1];
+        param.padLeft = pads[2];
+        param.padRight = pads[3];
+    }
+    return true;
+}
+
+// Shared by Convolution/ConvolutionDepthwise and their quantized variants once the weights are in FP32.
+// constantFilter lets the engine cache transformed weights, see host_kernel::Convolve.
+inline bool RunConv(const Node& node, const HostTensor& x, const float* filter, const std::vector<int64_t>& wDims,
+                    bool constantFilter, const float* bias, std::vector<HostTensor>& outputs) {
+    if (x.GetDimNum() != 4 || wDims.size() != 4) {
+        ALOGE("[HOST_KERNEL] %s: only 4D NCHW convolution is supported.\n", node.name.c_str());
+        return false;
+    }
+    ConvParam param;
+    if (!GetConvParam(node, x.GetDim(2), x.GetDim(3), wDims[2], wDims[3], param)) {
+        return false;
+    }
+    bool depthwise = node.type.find("Depthwise") != std::string::npos;
+    param.groups = depthwise ? x.GetDim(1) : node.GetInt("groups", 1);
+    if (param.groups <= 0 || x.GetDim(1) % param.groups != 0 || wDims[0] % param.groups != 0 ||
+        wDims[1] * param.groups != x.GetDim(1)) {
+        ALOGE("[HOST_KERNEL] %s: channels do not match the filter.\n", node.name.c_str());
+        return false;
+    }
+    int64_t oh = ConvOutSize(x.GetDim(2), wDims[2], param.strideH, param.dilationH, param.padTop, param.padBottom);
+    int64_t ow = ConvOutSize(x.GetDim(3), wDims[3], param.strideW, param.dilationW, param.padLeft, param.padRight);
+    outputs[0].Prepare({x.GetDim(0), wDims[0], oh, ow}, ge::DT_FLOAT);
+    ConvShape shape;
+    shape.n = x.GetDim(0);
+    shape.c = x.GetDim(1);
+    shape.h = x.GetDim(2);
+    shape.w = x.GetDim(3);
+    shape.co = wDims[0];
+    shape.kh = wDims[2];
+    shape.kw = wDims[3];
+    shape.oh = oh;
+    shape.ow = ow;
+    Convolve(node.name, x.Data<float>(), shape, filter, constantFilter, bias, param, outputs[0].Data<float>());
+    return true;
+}
+
+inline bool ConvolutionKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                              std::vector<HostTensor>& outputs) {
+    int biasIndex = node.FindInput("bias");
+    const float* bias = biasIndex >= 0 ? inputs[biasIndex].Data<float>() : nullptr;
+    return RunConv(node, inputs[0], inputs[1].Data<float>(), inputs[1].GetDims(), inputs[1].IsConstant(), bias,
+                   outputs);
+}
+
+// x [N, C, H, W], filter [C, Co / groups, Kh, Kw], optional output_shape [N, Co, OH, OW]. The output size
+// follows the rules of shape_inference::InferConvTranspose; pads are resolved against it.
+inline bool ConvTransposeKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                std::vector<HostTensor>& outputs) {
+    int xIndex = node.FindInput("x");
+    int filterIndex = node.FindInput("filter");
+    if (xIndex < 0 || filterIndex < 0 || inputs[xIndex].GetDimNum() != 4 || inputs[filterIndex].GetDimNum() != 4) {
+        ALOGE("[HOST_KERNEL] %s: only 4D NCHW transposed convolution is supported.\n", node.name.c_str());
+        return false;
+    }
+    const HostTensor& x = inputs[xIndex];
+    const HostTensor& filter = inputs[filterIndex];
+    ConvParam param;
+    param.groups = node.GetInt("groups", 1);
+    if (param.groups <= 0 || filter.GetDim(0) != x.GetDim(1) || x.GetDim(1) % param.groups != 0) {
+        ALOGE("[HOST_KERNEL] %s: channels do not match the filter.\n", node.name.c_str());
+        return false;
+    }
+    ConvShape shape;
+    shape.n = x.GetDim(0);
+    shape.c = x.GetDim(1);
+    shape.h = x.GetDim(2);
+    shape.w = x.GetDim(3);
+    shape.co = filter.GetDim(1) * param.groups;
+    shape.kh = filter.GetDim(2);
+    shape.kw = filter.GetDim(3);
+    bool same = node.GetString("pad_mode", "SPECIFIC") == "SAME";
+    int outputShapeIndex = node.FindInput("output_shape");
+    if (outputShapeIndex >= 0) {
+        const HostTensor& outputShape = inputs[outputShapeIndex];
+        if (outputShape.GetElementNum() != 4 || outputShape.GetDataType() != ge::DT_INT32) {
+            ALOGE("[HOST_KERNEL] %s: output_shape must be 4 INT32 values.\n", node.name.c_str());
+            return false;
+        }
+        const int32_t* value = outputShape.Data<int32_t>();
+        if (value[0] != shape.n || value[1] != shape.co) {
+            ALOGE("[HOST_KERNEL] %s: output_shape does not match batch and output channels.\n", node.name.c_str());
+            return false;
+        }
+        shape.oh = value[2];
+        shape.ow = value[3];
+    } else if (same) {
+        std::vector<int64_t> strides = node.GetInts("strides", {1, 1});
+        if (strides.size() != 2) {
+            ALOGE("[HOST_KERNEL] %s: bad strides.\n", node.name.c_str());
+            return false;
+        }
+        shape.oh = shape.h * strides[0];
+        shape.ow = shape.w * strides[1];
+    }
+    if (!GetConvParam(node, shape.oh, shape.ow, shape.kh, shape.kw, param)) {
+        return false;
+    }
+    if (outputShapeIndex < 0 && !same) {
+        int64_t spanH = (shape.kh - 1) * param.dilationH + 1;
+        int64_t spanW = (shape.kw - 1) * param.dilationW + 1;
+        shape.oh = (shape.h - 1) * param.strideH - param.padTop - param.padBottom + spanH;
+        shape.ow = (shape.w - 1) * param.strideW - param.padLeft - param.padRight + spanW;
+    }
+    if (param.strideH <= 0 || param.strideW <= 0 || param.dilationH <= 0 || param.dilationW <= 0 ||
+        param.padTop < 0 || param.padLeft < 0 || shape.oh <= 0 || shape.ow <= 0) {
+        ALOGE("[HOST_KERNEL] %s: bad strides/dilations/pads for output %lldx%lld.\n", node.name.c_str(),
+              static_cast<long long>(shape.oh), static_cast<long long>(shape.ow));
+        return false;
+    }
+    int biasIndex = node.FindInput("bias");
+    const float* bias = biasIndex >= 0 ? inputs[biasIndex].Data<float>() : nullptr;
+    outputs[0].Prepare({shape.n, shape.co, shape.oh, shape.ow}, ge::DT_FLOAT);
+    ConvolveTranspose(node.name, x.Data<float>(), shape, filter.Data<float>(), filter.IsConstant(), bias, param,
+                      outputs[0].Data<float>());
+    return true;
+}
+
+// x [N, K...] is flattened from axis 1, w is [num_output, K...]. y is [N, num_output] for 2D inputs and
+// [N, num_output, 1, 1] otherwise.
+inline void InnerProduct(const float* x, int64_t n, int64_t k, const float* w, int64_t m, const float* bias,
+                         float* y) {
+    if (n >= gemm::MR) {
+        Gemm(1, n, m, k, x, false, w, true, bias, y);
+        return;
+    }
+    // for a few rows packing w costs as much as the product, stream it once instead
+    parallel_util::ParallelFor(0, static_cast<size_t>(m), [&](size_t begin, size_t end) {
+        for (int64_t b = 0; b < n; b++) {
+            const float* in = x + b * k;
+            for (size_t o = begin; o < end; o++) {
+                y[b * m + o] = gemm::Dot(in, w + o * k, k) + (bias != nullptr ? bias[o] : 0.0f);
+            }
+        }
+    }, 0, 16);
+}
+
+inline bool RunFullyConnection(const Node& node, const HostTensor& x, const float* w, const std::vector<int64_t>& wDims,
+                               const float* bias, std::vector<HostTensor>& outputs) {
+    int64_t n = x.GetDim(0);
+    int64_t k = n > 0 ? static_cast<int64_t>(x.GetElementNum()) / n : 0;
+    int64_t m = node.GetInt("num_output", wDims.empty() ? 0 : wDims[0]);
+    if (m <= 0 || static_cast<int64_t>(HostTensor::GetElementNum(wDims)) != m * k) {
+        ALOGE("[HOST_KERNEL] %s: weight does not match input and num_output.\n", node.name.c_str());
+        return false;
+    }
+    if (x.GetDimNum() == 2) {
+        outputs[0].Prepare({n, m}, ge::DT_FLOAT);
+    } else {
+        outputs[0].Prepare({n, m, 1, 1}, ge::DT_FLOAT);
+    }
+    InnerProduct(x.Data<float>(), n, k, w, m, bias, outputs[0].Data<float>());
+    return true;
+}
+
+inline bool FullyConnectionKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                  std::vector<HostTensor>& outputs) {
+    int biasIndex = node.FindInput("b");
+    const float* bias = biasIndex >= 0 ? inputs[biasIndex].Data<float>() : nullptr;
+    return RunFullyConnection(node, inputs[0], inputs[1].Data<float>(), inputs[1].GetDims(), bias, outputs);
+}
+
+inline bool ActivationKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                             std::vector<HostTensor>& outputs) {
+    const HostTensor& x = inputs[0];
+    int64_t mode = node.GetInt("mode", 1);
+    float coef = node.GetFloat("coef");
+    float slope = node.GetFloat("negative_slope");
+    std::function<float(float)> func;
+    switch (mode) {
+        case 0: func = [](float v) { return 1.0f / (1.0f + std::exp(-v)); }; break;
+        case 1: func = [](float v) { return std::max(v, 0.0f); }; break;
+        case 2: func = [](float v) { return std::tanh(v); }; break;
+        case 3: func = [coef](float v) { return std::min(std::max(v, 0.0f), coef); }; break;
+        case 4: func = [coef](float v) { return v >= 0 ? v : coef * (std::exp(v) - 1.0f); }; break;
+        case 5: func = [slope](float v) { return v >= 0 ? v : slope * v; }; break;
+        case 6: func = [](float v) { return std::fabs(v); }; break;
+        case 7: func = [](float v) { return std::min(std::max(v, -1.0f), 1.0f); }; break;
+        case 13: func = [](float v) { return v; }; break;
+        case 14: func = [](float v) { return std::min(std::max(v, 0.0f), 6.0f); }; break;
+        default:
+            ALOGE("[HOST_KERNEL] %s: activation mode %lld is not supported.\n", node.name.c_str(),
+                  static_cast<long long>(mode));
+            return false;
+    }
+    outputs[0].Prepare(x.GetDims(), ge::DT_FLOAT);
+    const float* src = x.Data<float>();
+    float* dst = outputs[0].Data<float>();
+    parallel_util::ParallelFor(0, x.GetElementNum(), [src, dst, &func](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            dst[i] = func(src[i]);
+        }
+    }, 0, 1 << 16);
+    return true;
+}
+
+// Quantized ops: x is rounded to INT8 with x_quant_scale/x_quant_offset, weights are INT8 with one scale per
+// output channel (or one for all), bias is INT32 in units of x_scale * w_scale.
+inline void FakeQuantize(const float* src, size_t num, float scale, int64_t offset, float* dst) {
+    for (size_t i = 0; i < num; i++) {
+        float q = std::round(src[i] / scale) + offset;
+        q = std::min(std::max(q, -128.0f), 127.0f);
+        dst[i] = (q - offset) * scale;
+    }
+}
+
+inline bool DequantizeWeights(const Node& node, const HostTensor& w, const HostTensor* b, const char* scalesAttr,
+                              std::vector<float>& weight, std::vector<float>& bias, HostTensor& x) {
+    float xScale = node.GetFloat("x_quant_scale", 1.0f);
+    int64_t xOffset = node.GetInt("x_quant_offset", 0);
+    std::vector<float> scales = node.GetFloats(scalesAttr);
+    int64_t channels = w.GetDim(0);
+    if (w.GetDataType() != ge::DT_INT8) {
+        weight.assign(w.Data<float>(), w.Data<float>() + w.GetElementNum());
+    } else {
+        if (scales.size() != 1 && static_cast<int64_t>(scales.size()) != channels) {
+            ALOGE("[HOST_KERNEL] %s: %zu %s for %lld channels.\n", node.name.c_str(), scales.size(), scalesAttr,
+                  static_cast<long long>(channels));
+            return false;
+        }
+        size_t inner = w.GetElementNum() / channels;
+        weight.resize(w.GetElementNum());
+        for (int64_t c = 0; c < channels; c++) {
+            float scale = scales.size() == 1 ? scales[0] : scales[c];
+            for (size_t i = 0; i < inner; i++) {
+                weight[c * inner + i] = w.Data<int8_t>()[c * inner + i] * scale;
+            }
+        }
+    }
+    if (b != nullptr) {
+        if (b->GetDataType() == ge::DT_INT32) {
+            bias.resize(b->GetElementNum());
+            for (size_t c = 0; c < bias.size(); c++) {
+                float scale = scales.empty() ? 1.0f : (scales.size() == 1 ? scales[0] : scales[c]);
+                bias[c] = b->Data<int32_t>()[c] * xScale * scale;
+            }
+        } else {
+            bias.assign(b->Data<float>(), b->Data<float>() + b->GetElementNum());
+        }
+    }
+    if (node.GetInt("x_quant_type", 0) > 0) {
+        HostTensor quantized(x.GetDims(), ge::DT_FLOAT);
+        FakeQuantize(x.Data<float>(), x.GetElementNum(), xScale, xOffset, quantized.Data<float>());
+        x = quantized;
+    }
+    return true;
+}
+
+inline bool QuantizedConvolutionKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                       std::vector<HostTensor>& outputs) {
+    int biasIndex = node.FindInput("bias");
+    HostTensor x = inputs[0];
+    std::vector<float> weight;
+    std::vector<float> bias;
+    if (!DequantizeWeights(node, inputs[1], biasIndex >= 0 ? &inputs[biasIndex] : nullptr, "filter_quant_scales",
+                           weight, bias, x)) {
+        return false;
+    }
+    return RunConv(node, x, weight.data(), inputs[1].GetDims(), false, biasIndex >= 0 ? bias.data() : nullptr,
+                   outputs);
+}
+
+inline bool QuantizedFullyConnectionKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                           std::vector<HostTensor>& outputs) {
+    int biasIndex = node.FindInput("b");
+    HostTensor x = inputs[0];
+    std::vector<float> weight;
+    std::vector<float> bias;
+    if (!DequantizeWeights(node, inputs[1], biasIndex >= 0 ? &inputs[biasIndex] : nullptr, "w_quant_scales",
+                           weight, bias, x)) {
+        return false;
+    }
+    return RunFullyConnection(node, x, weight.data(), inputs[1].GetDims(), biasIndex >= 0 ? bias.data() : nullptr,
+                              outputs);
+}
+
+// Data and element count of an optional input, null when the node does not have it.
+inline const float* OptionalInput(const Node& node, const std::vector<HostTensor>& inputs, const char* name,
+                                  size_t* num = nullptr) {
+    int index = node.FindInput(name);
+    if (num != nullptr) {
+        *num = index >= 0 ? inputs[index].GetElementNum() : 0;
+    }
+    return index >= 0 ? inputs[index].Data<float>() : nullptr;
+}
+
+// Output `index` prepared with dims, or `local` when the node does not expose that output.
+inline float* StateOutput(std::vector<HostTensor>& outputs, size_t index, const std::vector<int64_t>& dims,
+                          std::vector<float>& local) {
+    if (index < outputs.size()) {
+        outputs[index].Prepare(dims, ge::DT_FLOAT);
+        return outputs[index].Data<float>();
+    }
+    local.resize(HostTensor::GetElementNum(dims));
+    return local.data();
+}
+
+// x [T, B, X], w_x [4H, X], w_h [4H, H]; outputs h [T, B, H], h_t / c_t [1, B, H]. See host_kernel::Lstm.
+inline bool LstmKernel(const Node& node, const std::vector<HostTensor>& inputs, std::vector<HostTensor>& outputs) {
+    int xIndex = node.FindInput("x");
+    int wxIndex = node.FindInput("w_x");
+    int whIndex = node.FindInput("w_h");
+    if (xIndex < 0 || wxIndex < 0 || whIndex < 0 || inputs[xIndex].GetDimNum() != 3 ||
+        inputs[wxIndex].GetDimNum() != 2 || inputs[whIndex].GetDimNum() != 2) {
+        ALOGE("[HOST_KERNEL] %s: LSTM needs x [T, B, X], w_x [4H, X] and w_h [4H, H].\n", node.name.c_str());
+        return false;
+    }
+    const HostTensor& x = inputs[xIndex];
+    LstmArgs args;
+    args.t = x.GetDim(0);
+    args.b = x.GetDim(1);
+    args.x = x.GetDim(2);
+    args.hidden = inputs[wxIndex].GetDim(0) / 4;
+    size_t biasNum = 0;
+    size_t contNum = 0;
+    size_t staticNum = 0;
+    args.input = x.Data<float>();
+    args.wx = inputs[wxIndex].Data<float>();
+    args.wh = inputs[whIndex].Data<float>();
+    args.bias = OptionalInput(node, inputs, "bias", &biasNum);
+    args.cont = OptionalInput(node, inputs, "cont", &contNum);
+    args.xStatic = OptionalInput(node, inputs, "x_static", &staticNum);
+    size_t wxStaticNum = 0;
+    args.wxStatic = OptionalInput(node, inputs, "w_x_static", &wxStaticNum);
+    args.h0 = OptionalInput(node, inputs, "h_0", &args.h0Num);
+    args.c0 = OptionalInput(node, inputs, "c_0", &args.c0Num);
+    size_t stateNum = static_cast<size_t>(args.b * args.hidden);
+    args.xStaticSize = args.b > 0 ? static_cast<int64_t>(staticNum) / args.b : 0;
+    if (args.hidden <= 0 || inputs[wxIndex].GetDim(0) != 4 * args.hidden || inputs[wxIndex].GetDim(1) != args.x ||
+        inputs[whIndex].GetDim(0) != 4 * args.hidden || inputs[whIndex].GetDim(1) != args.hidden ||
+        (args.bias != nullptr && biasNum != static_cast<size_t>(4 * args.hidden)) ||
+        (args.cont != nullptr && contNum != static_cast<size_t>(args.t * args.b)) ||
+        ((args.xStatic != nullptr) != (args.wxStatic != nullptr)) ||
+        (args.xStatic != nullptr && (args.b <= 0 || staticNum % static_cast<size_t>(args.b) != 0 ||
+                                     wxStaticNum != static_cast<size_t>(4 * args.hidden * args.xStaticSize))) ||
+        (args.h0 != nullptr && args.h0Num != stateNum && args.h0Num != static_cast<size_t>(args.hidden)) ||
+        (args.c0 != nullptr && args.c0Num != stateNum && args.c0Num != static_cast<size_t>(args.hidden))) {
+        ALOGE("[HOST_KERNEL] %s: LSTM inputs do not match x and the weights.\n", node.name.c_str());
+        return false;
+    }
+    std::vector<float> hLocal;
+    std::vector<float> cLocal;
+    outputs[0].Prepare({args.t, args.b, args.hidden}, ge::DT_FLOAT);
+    float* hT = StateOutput(outputs, 1, {1, args.b, args.hidden}, hLocal);
+    float* cT = StateOutput(outputs, 2, {1, args.b, args.hidden}, cLocal);
+    Lstm(node.name, args, outputs[0].Data<float>(), hT, cT);
+    return true;
+}
+
+// x [T, B, X], w_fw / w_bw [X + H, 4H]; outputs y_fw, y_bw [T, B, H] and the four [B, H] final states.
+// See host_kernel::BidirectionLstm.
+inline bool BidirectionLstmKernel(const Node& node, const std::vector<HostTensor>& inputs,
+                                  std::vector<HostTensor>& outputs) {
+    static const std::map<std::string, LstmActivation> activations = {
+        {"Tanh", LstmActivation::TANH}, {"Sigmoid", LstmActivation::SIGMOID}, {"ReLU", LstmActivation::RELU},
+        {"ReLU1", LstmActivation::RELU1}, {"ReLU6", LstmActivation::RELU6}};
+    auto activation = activations.find(node.GetString("activation", "Tanh"));
+    if (activation == activations.end() || node.GetInt("num_layers", 1) != 1) {
+        ALOGE("[HOST_KERNEL] %s: activation %s / num_layers %lld is not supported.\n", node.name.c_str(),
+              node.GetString("activation", "Tanh").c_str(), static_cast<long long>(node.GetInt("num_layers", 1)));
+        return false;
+    }
+    int xIndex = node.FindInput("x");
+    int wIndex[2] = {node.FindInput("w_fw"), node.FindInput("w_bw")};
+    if (xIndex < 0 || wIndex[0] < 0 || wIndex[1] < 0 || inputs[xIndex].GetDimNum() != 3 ||
+        inputs[wIndex[0]].GetDims() != inputs[wIndex[1]].GetDims() || inputs[wIndex[0]].GetDimNum() != 2) {
+        ALOGE("[HOST_KERNEL] %s: BidirectionLSTM needs x [T, B, X] and two [X + H, 4H] weights.\n",
+              node.name.c_str());
+        return false;
+    }
+    const HostTensor& x = inputs[xIndex];
+    int64_t t = x.GetDim(0);
+    int64_t b = x.GetDim(1);
+    int64_t hidden = inputs[wIndex[0]].GetDim(1) / 4;
+    size_t stateNum = static_cast<size_t>(b * hidden);
+    int seqLenIndex = node.FindInput("seq_len");
+    const int32_t* seqLen = seqLenIndex >= 0 ? inputs[seqLenIndex].Data<int32_t>() : nullptr;
+    if (hidden <= 0 || inputs[wIndex[0]].GetDim(1) != 4 * hidden ||
+        inputs[wIndex[0]].GetDim(0) != x.GetDim(2) + hidden ||
+        (seqLen != nullptr && inputs[seqLenIndex].GetElementNum() != static_cast<size_t>(b))) {
+        ALOGE("[HOST_KERNEL] %s: BidirectionLSTM weights or seq_len do not match x.\n", node.name.c_str());
+        return false;
+    }
+    BidirectionLstmWeights weights[2];
+    const char* stateNames[2][2] = {{"h_0_fw", "c_0_fw"}, {"h_0_bw", "c_0_bw"}};
+    for (int dir = 0; dir < 2; dir++) {
+        weights[dir].w = inputs[wIndex[dir]].Data<float>();
+        weights[dir].constant = inputs[wIndex[dir]].IsConstant();
+        weights[dir].h0 = OptionalInput(node, inputs, stateNames[dir][0], &weights[dir].h0Num);
+        weights[dir].c0 = OptionalInput(node, inputs, stateNames[dir][1], &weights[dir].c0Num);
+        for (size_t num : {weights[dir].h0Num, weights[dir].c0Num}) {
+            if (num != 0 && num != stateNum && num != static_cast<size_t>(hidden)) {
+                ALOGE("[HOST_KERNEL] %s: initial states must have B * H or H values.\n", node.name.c_str());
+                return false;
+            }
+        }
+    }
+    std::vector<float> local[6];
+    float* y[2];
+    float* hT[2];
+    float* cT[2];
+    for (int dir = 0; dir < 2; dir++) {
+        y[dir] = StateOutput(outputs, dir, {t, b, hidden}, local[dir]);
+        hT[dir] = StateOutput(outputs, 2 + 2 * dir, {b, hidden}, local[2 + 2 * dir]);
+        cT[dir] = StateOutput(outputs, 3 + 2 * dir, {b, hidden}, local[3 + 2 * dir]);
+    }
+    BidirectionLstm(node.name, x.Data<float>(), t, b, x.GetDim(2), hidden, seqLen, weights,
+                    node.GetFloat("forget_bias", 1.0f), activation->second, y, hT, cT);
+    return true;
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_NN_H
@@ -0,0 +1,402 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_NORMALIZATION_H
+#define BUILD_IR_MODEL_HOST_KERNEL_NORMALIZATION_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Softmax, LogSoftmax, L2Normalize and LayerNorm as reductions along one axis of x viewed as [outer, axis, inner].
+// A contiguous axis (inner == 1) is reduced row by row with 4-lane accumulators. A strided axis is reduced for a
+// tile of up to COLUMN_TILE neighbouring columns at once, so every load is a vector along the inner dimension.
+// Work is split over the outer rows and column tiles.
+namespace host_kernel {
+enum class SoftmaxMode {
+    SOFTMAX,
+    LOG_SOFTMAX,
+};
+
+namespace norm {
+const int64_t COLUMN_TILE = 64;
+const int64_t MIN_TASK_ELEMENTS = 1 << 14;
+
+inline size_t MinTasks(int64_t elementsPerTask) {
+    return static_cast<size_t>(std::max<int64_t>(1, MIN_TASK_ELEMENTS / std::max<int64_t>(elementsPerTask, 1)));
+}
+
+struct MaxSum {
+    float max;
+    float sum;
+};
+
+struct MeanVar {
+    float mean;
+    float variance;
+};
+
+inline float RowMax(const float* x, int64_t num) {
+    using namespace simd_util;
+    Float4 max0 = Set4(-FLT_MAX);
+    Float4 max1 = max0;
+    int64_t i = 0;
+    for (; i + 8 <= num; i += 8) {
+        max0 = Max4(max0, Load4(x + i));
+        max1 = Max4(max1, Load4(x + i + 4));
+    }
+    float max = ReduceMax4(Max4(max0, max1));
+    for (; i < num; i++) {
+        max = std::max(max, x[i]);
+    }
+    return max;
+}
+
+// y = e^(x - max), returns the sum of y.
+inline float ExpSumRow(const float* x, int64_t num, float max, float* y) {
+    using namespace simd_util;
+    Float4 max4 = Set4(max);
+    Float4 sum0 = Set4(0.0f);
+    Float4 sum1 = sum0;
+    int64_t i = 0;
+    for (; i + 8 <= num; i += 8) {
+        Float4 e0 = Exp4(Sub4(Load4(x + i), max4));
+        Float4 e1 = Exp4(Sub4(Load4(x + i + 4), max4));
+        Store4(y + i, e0);
+        Store4(y + i + 4, e1);
+        sum0 = Add4(sum0, e0);
+        sum1 = Add4(sum1, e1);
+    }
+    float sum = ReduceSum4(Add4(sum0, sum1));
+    for (; i < num; i++) {
+        y[i] = std::exp(x[i] - max);
+        sum += y[i];
+    }
+    return sum;
+}
+
+// Single pass over x: every lane keeps a running max m and the sum of e^(x - m), rescaled by e^(m_old - m_new)
+// once per 16 values; the lanes and the tail are merged against the overall max.
+inline MaxSum OnlineMaxSum(const float* x, int64_t num) {
+    using namespace simd_util;
+    Float4 max4 = Set4(-FLT_MAX);
+    Float4 sum4 = Set4(0.0f);
+    int64_t i = 0;
+    for (; i + 16 <= num; i += 16) {
+        Float4 a = Load4(x + i);
+        Float4 b = Load4(x + i + 4);
+        Float4 c = Load4(x + i + 8);
+        Float4 d = Load4(x + i + 12);
+        Float4 max = Max4(max4, Max4(Max4(a, b), Max4(c, d)));
+        Float4 e = Add4(Add4(Exp4(Sub4(a, max)), Exp4(Sub4(b, max))), Add4(Exp4(Sub4(c, max)), Exp4(Sub4(d, max))));
+        sum4 = Fma4(sum4, Exp4(Sub4(max4, max)), e);
+        max4 = max;
+    }
+    float laneMax[4];
+    float laneSum[4];
+    Store4(laneMax, max4);
+    Store4(laneSum, sum4);
+    MaxSum result;
+    result.max = ReduceMax4(max4);
+    for (int64_t j = i; j < num; j++) {
+        result.max = std::max(result.max, x[j]);
+    }
+    result.sum = 0.0f;
+    for (int lane = 0; lane < 4; lane++) {
+        result.sum += laneSum[lane] * std::exp(laneMax[lane] - result.max);
+    }
+    for (; i < num; i++) {
+        result.sum += std::exp(x[i] - result.max);
+    }
+    return result;
+}
+
+// y = x * scale + shift
+inline void AffineRow(const float* x, int64_t num, float scale, float shift, float* y) {
+    using namespace simd_util;
+    Float4 scale4 = Set4(scale);
+    Float4 shift4 = Set4(shift);
+    int64_t i = 0;
+    for (; i + 4 <= num; i += 4) {
+        Store4(y + i, Fma4(Load4(x + i), scale4, shift4));
+    }
+    for (; i < num; i++) {
+        y[i] = x[i] * scale + shift;
+    }
+}
+
+// Softmax makes one pass for the max and one that stores e^(x - max) and sums it, then scales y; the online
+// max/sum would need a second exp per value there. LogSoftmax only subtracts in its output pass, so it takes the
+// max and the sum in a single online pass.
+inline void SoftmaxRow(const float* x, int64_t num, SoftmaxMode mode, float* y) {
+    if (mode == SoftmaxMode::LOG_SOFTMAX) {
+        // (x - max) - log(sum): x - max is exact near the max, folding max + log(sum) first would round it
+        using namespace simd_util;
+        MaxSum maxSum = OnlineMaxSum(x, num);
+        float logSum = std::log(maxSum.sum);
+        Float4 max4 = Set4(maxSum.max);
+        Float4 logSum4 = Set4(logSum);
+        int64_t i = 0;
+        for (; i + 4 <= num; i += 4) {
+            Store4(y + i, Sub4(Sub4(Load4(x + i), max4), logSum4));
+        }
+        for (; i < num; i++) {
+            y[i] = (x[i] - maxSum.max) - logSum;
+        }
+        return;
+    }
+    float sum = ExpSumRow(x, num, RowMax(x, num), y);
+    AffineRow(y, num, 1.0f / sum, 0.0f, y);
+}
+
+// Columns [0, width) of `axis` rows `inner` apart, width <= COLUMN_TILE.
+inline void SoftmaxColumns(const float* x, int64_t axis, int64_t inner, int64_t width, SoftmaxMode mode, float* y) {
+    using namespace simd_util;
+    float max[COLUMN_TILE];
+    float sum[COLUMN_TILE];
+    std::fill_n(max, width, -FLT_MAX);
+    std::fill_n(sum, width, 0.0f);
+    int64_t vecWidth = width / 4 * 4;
+    for (int64_t k = 0; k < axis; k++) {
+        const float* row = x + k * inner;
+        int64_t j = 0;
+        for (; j < vecWidth; j += 4) {
+            Store4(max + j, Max4(Load4(max + j), Load4(row + j)));
+        }
+        for (; j < width; j++) {
+            max[j] = std::max(max[j], row[j]);
+        }
+    }
+    bool logSoftmax = mode == SoftmaxMode::LOG_SOFTMAX;
+    for (int64_t k = 0; k < axis; k++) {
+        const float* row = x + k * inner;
+        float* out = y + k * inner;
+        int64_t j = 0;
+        for (; j < vecWidth; j += 4) {
+            Float4 e = Exp4(Sub4(Load4(row + j), Load4(max + j)));
+            if (!logSoftmax) {
+                Store4(out + j, e);
+            }
+            Store4(sum + j, Add4(Load4(sum + j), e));
+        }
+        for (; j < width; j++) {
+            float e = std::exp(row[j] - max[j]);
+            if (!logSoftmax) {
+                out[j] = e;
+            }
+            sum[j] += e;
+        }
+    }
+    // softmax scales y by 1 / sum, log softmax takes (x - max) - log(sum)
+    for (int64_t j = 0; j < width; j++) {
+        sum[j] = logSoftmax ? std::log(sum[j]) : 1.0f / sum[j];
+    }
+    for (int64_t k = 0; k < axis; k++) {
+        const float* row = x + k * inner;
+        float* out = y + k * inner;
+        int64_t j = 0;
+        for (; j < vecWidth; j += 4) {
+            Store4(out + j, logSoftmax ? Sub4(Sub4(Load4(row + j), Load4(max + j)), Load4(sum + j)) :
+                                         Mul4(Load4(out + j), Load4(sum + j)));
+        }
+        for (; j < width; j++) {
+            out[j] = logSoftmax ? (row[j] - max[j]) - sum[j] : out[j] * sum[j];
+        }
+    }
+}
+
+inline float SumSquares(const float* x, int64_t num) {
+    using namespace simd_util;
+    Float4 sum0 = Set4(0.0f);
+    Float4 sum1 = sum0;
+    int64_t i = 0;
+    for (; i + 8 <= num; i += 8) {
+        Float4 a = Load4(x + i);
+        Float4 b = Load4(x + i + 4);
+        sum0 = Fma4(a, a, sum0);
+        sum1 = Fma4(b, b, sum1);
+    }
+    float sum = ReduceSum4(Add4(sum0, sum1));
+    for (; i < num; i++) {
+        sum += x[i] * x[i];
+    }
+    return sum;
+}
+
+inline void L2NormalizeColumns(const float* x, int64_t axis, int64_t inner, int64_t width, float eps, float* y) {
+    using namespace simd_util;
+    float scale[COLUMN_TILE];
+    std::fill_n(scale, width, 0.0f);
+    int64_t vecWidth = width / 4 * 4;
+    for (int64_t k = 0; k < axis; k++) {
+        const float* row = x + k * inner;
+        int64_t j = 0;
+        for (; j < vecWidth; j += 4) {
+            Float4 v = Load4(row + j);
+            Store4(scale + j, Fma4(v, v, Load4(scale + j)));
+        }
+        for (; j < width; j++) {
+            scale[j] += row[j] * row[j];
+        }
+    }
+    for (int64_t j = 0; j < width; j++) {
+        scale[j] = 1.0f / std::sqrt(std::max(scale[j], eps));
+    }
+    for (int64_t k = 0; k < axis; k++) {
+        const float* row = x + k * inner;
+        float* out = y + k * inner;
+        int64_t j = 0;
+        for (; j < vecWidth; j += 4) {
+            Store4(out + j, Mul4(Load4(row + j), Load4(scale + j)));
+        }
+        for (; j < width; j++) {
+            out[j] = row[j] * scale[j];
+        }
+    }
+}
+
+// Welford's update on two sets of 4 lanes that all see the same count, the lanes merged with Chan's formula and
+// the tail added one value at a time. The variance is the biased one.
+inline MeanVar WelfordRow(const float* x, int64_t num) {
+    using namespace simd_util;
+    Float4 mean0 = Set4(0.0f);
+    Float4 mean1 = mean0;
+    Float4 m20 = mean0;
+    Float4 m21 = mean0;
+    int64_t count = 0;
+    int64_t i = 0;
+    for (; i + 8 <= num; i += 8) {
+        count++;
+        Float4 inv = Set4(1.0f / static_cast<float>(count));
+        Float4 a = Load4(x + i);
+        Float4 b = Load4(x + i + 4);
+        Float4 deltaA = Sub4(a, mean0);
+        Float4 deltaB = Sub4(b, mean1);
+        mean0 = Fma4(deltaA, inv, mean0);
+        mean1 = Fma4(deltaB, inv, mean1);
+        m20 = Fma4(deltaA, Sub4(a, mean0), m20);
+        m21 = Fma4(deltaB, Sub4(b, mean1), m21);
+    }
+    float mean = 0.0f;
+    float m2 = 0.0f;
+    if (count > 0) {
+        float laneMean[8];
+        Store4(laneMean, mean0);
+        Store4(laneMean + 4, mean1);
+        for (int lane = 0; lane < 8; lane++) {
+            mean += laneMean[lane];
+        }
+        mean /= 8.0f;
+        float spread = 0.0f;
+        for (int lane = 0; lane < 8; lane++) {
+            spread += (laneMean[lane] - mean) * (laneMean[lane] - mean);
+        }
+        m2 = ReduceSum4(Add4(m20, m21)) + static_cast<float>(count) * spread;
+        count *= 8;
+    }
+    for (; i < num; i++) {
+        count++;
+        float delta = x[i] - mean;
+        mean += delta / static_cast<float>(count);
+        m2 += delta * (x[i] - mean);
+    }
+    MeanVar result;
+    result.mean = mean;
+    result.variance = count > 0 ? m2 / static_cast<float>(count) : 0.0f;
+    return result;
+}
+
+// y = (x - mean) * rstd * gamma + beta, gamma / beta start at `offset` and wrap around after paramNum values.
+inline void LayerNormRow(const float* x, int64_t num, float mean, float rstd, const float* gamma, const float* beta,
+                         int64_t paramNum, int64_t offset, float* y) {
+    using namespace simd_util;
+    Float4 mean4 = Set4(mean);
+    Float4 rstd4 = Set4(rstd);
+    for (int64_t i = 0; i < num; offset = 0) {
+        int64_t count = std::min(num - i, paramNum - offset);
+        const float* in = x + i;
+        const float* g = gamma + offset;
+        const float* b = beta + offset;
+        float* out = y + i;
+        int64_t j = 0;
+        for (; j + 4 <= count; j += 4) {
+            Float4 v = Mul4(Sub4(Load4(in + j), mean4), rstd4);
+            Store4(out + j, Fma4(v, Load4(g + j), Load4(b + j)));
+        }
+        for (; j < count; j++) {
+            out[j] = (in[j] - mean) * rstd * g[j] + b[j];
+        }
+        i += count;
+    }
+}
+}
+
+// x [outer, axis, inner] to y of the same shape.
+inline void Softmax(const float* x, int64_t outer, int64_t axis, int64_t inner, SoftmaxMode mode, float* y,
+                    int threadNum = 0) {
+    if (inner == 1) {
+        parallel_util::ParallelFor(0, static_cast<size_t>(outer), [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++) {
+                norm::SoftmaxRow(x + r * axis, axis, mode, y + r * axis);
+            }
+        }, threadNum, norm::MinTasks(axis));
+        return;
+    }
+    int64_t tiles = (inner + norm::COLUMN_TILE - 1) / norm::COLUMN_TILE;
+    parallel_util::ParallelFor(0, static_cast<size_t>(outer * tiles), [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; task++) {
+            int64_t column = static_cast<int64_t>(task) % tiles * norm::COLUMN_TILE;
+            size_t offset = static_cast<size_t>(static_cast<int64_t>(task) / tiles * axis * inner + column);
+            norm::SoftmaxColumns(x + offset, axis, inner, std::min(norm::COLUMN_TILE, inner - column), mode,
+                                 y + offset);
+        }
+    }, threadNum, norm::MinTasks(axis * norm::COLUMN_TILE));
+}
+
+// y = x / sqrt(max(sum(x^2), eps)) along the middle axis of x [outer, axis, inner].
+inline void L2Normalize(const float* x, int64_t outer, int64_t axis, int64_t inner, float eps, float* y,
+                        int threadNum = 0) {
+    if (inner == 1) {
+        parallel_util::ParallelFor(0, static_cast<size_t>(outer), [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++) {
+                float scale = 1.0f / std::sqrt(std::max(norm::SumSquares(x + r * axis, axis), eps));
+                norm::AffineRow(x + r * axis, axis, scale, 0.0f, y + r * axis);
+            }
+        }, threadNum, norm::MinTasks(axis));
+        return;
+    }
+    int64_t tiles = (inner + norm::COLUMN_TILE - 1) / norm::COLUMN_TILE;
+    parallel_util::ParallelFor(0, static_cast<size_t>(outer * tiles), [&](size_t begin, size_t end) {
+        for (size_t task = begin; task < end; task++) {
+            int64_t column = static_cast<int64_t>(task) % tiles * norm::COLUMN_TILE;
+            size_t offset = static_cast<size_t>(static_cast<int64_t>(task) / tiles * axis * inner + column);
+            norm::L2NormalizeColumns(x + offset, axis, inner, std::min(norm::COLUMN_TILE, inner - column), eps,
+                                     y + offset);
+        }
+    }, threadNum, norm::MinTasks(axis * norm::COLUMN_TILE));
+}
+
+// Normalizes each of the `rows` contiguous rows of `size` values of x, then applies gamma / beta, which hold
+// paramNum values for the trailing dims from begin_params_axis: value i of the flattened x uses
+// gamma[i % paramNum]. mean / variance get one value per row when not null.
+inline void LayerNorm(const float* x, int64_t rows, int64_t size, const float* gamma, const float* beta,
+                      int64_t paramNum, float epsilon, float* y, float* mean, float* variance, int threadNum = 0) {
+    parallel_util::ParallelFor(0, static_cast<size_t>(rows), [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; r++) {
+            norm::MeanVar meanVar = norm::WelfordRow(x + r * size, size);
+            float rstd = 1.0f / std::sqrt(meanVar.variance + epsilon);
+            norm::LayerNormRow(x + r * size, size, meanVar.mean, rstd, gamma, beta, paramNum,
+                               static_cast<int64_t>(r * size % paramNum), y + r * size);
+            if (mean != nullptr) {
+                mean[r] = meanVar.mean;
+            }
+            if (variance != nullptr) {
+                variance[r] = meanVar.variance;
+            }
+        }
+    }, threadNum, norm::MinTasks(size));
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_NORMALIZATION_H
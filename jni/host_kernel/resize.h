@@ -0,0 +1,350 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_RESIZE_H
+#define BUILD_IR_MODEL_HOST_KERNEL_RESIZE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "host_executor.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// FP32 NCHW resize engine for ResizeBilinear(V2), ResizeNearestNeighbor and Interp. Source coordinates are
+// tabulated once per (in, out, mode) and axis; bilinear runs as a horizontal pass per input row (kept for the
+// next output row when it is shared, as in upsampling) and a vertical pass per output row. The arithmetic is
+// the one of the reference kernels, op for op, so outputs are bit-exact with them:
+//   TF ResizeBilinear     top + (bottom - top) * lerp, lerp / indices from the align_corners / half_pixel_centers
+//                         scalers of resize_bilinear_op.cc
+//   TF ResizeNearest      floorf / roundf of the scaled coordinate, clamped
+//   Caffe Interp          h0 * (w0 * a + w1 * b) + h1 * (w0 * c + w1 * d), align-corners scale, cropped input
+// Products and sums are kept in separate statements so the scalar tails are not contracted into FMAs.
+namespace host_kernel {
+using host_graph::Node;
+
+enum class ResizeMode {
+    BILINEAR,
+    BILINEAR_ALIGN_CORNERS,
+    BILINEAR_HALF_PIXEL,
+    NEAREST,
+    NEAREST_ALIGN_CORNERS,
+    NEAREST_HALF_PIXEL,
+    INTERP,
+};
+
+inline ResizeMode GetResizeMode(const Node& node) {
+    bool alignCorners = node.GetBool("align_corners", false);
+    bool halfPixel = node.GetBool("half_pixel_centers", false);
+    if (node.type == "Interp") {
+        return ResizeMode::INTERP;
+    }
+    if (node.type == "ResizeNearestNeighbor") {
+        return alignCorners ? ResizeMode::NEAREST_ALIGN_CORNERS :
+                              halfPixel ? ResizeMode::NEAREST_HALF_PIXEL : ResizeMode::NEAREST;
+    }
+    return alignCorners ? ResizeMode::BILINEAR_ALIGN_CORNERS :
+                          halfPixel ? ResizeMode::BILINEAR_HALF_PIXEL : ResizeMode::BILINEAR;
+}
+
+// Interp attributes. pad_begin / pad_end are <= 0 and crop the input; the output size follows the precedence
+// of the Caffe layer: shrink only, zoom only, explicit height / width, then shrink followed by zoom.
+struct InterpParam {
+    int64_t height = 0;
+    int64_t width = 0;
+    int64_t shrink = 1;
+    int64_t zoom = 1;
+    int64_t padBegin = 0;
+    int64_t padEnd = 0;
+};
+
+inline InterpParam GetInterpParam(const Node& node) {
+    InterpParam param;
+    param.height = node.GetInt("height", 0);
+    param.width = node.GetInt("width", 0);
+    param.shrink = node.GetInt("shrink_factor", 1);
+    param.zoom = node.GetInt("zoom_factor", 1);
+    param.padBegin = node.GetInt("pad_begin", 0);
+    param.padEnd = node.GetInt("pad_end", 0);
+    return param;
+}
+
+// Output height / width of Interp for input h x w, false if the attributes are out of range.
+inline bool InterpOutSize(const InterpParam& p, int64_t h, int64_t w, int64_t& oh, int64_t& ow) {
+    if (p.shrink <= 0 || p.zoom <= 0 || p.padBegin > 0 || p.padEnd > 0) {
+        return false;
+    }
+    int64_t effH = h + p.padBegin + p.padEnd;
+    int64_t effW = w + p.padBegin + p.padEnd;
+    if (effH <= 0 || effW <= 0) {
+        return false;
+    }
+    if (p.shrink != 1 && p.zoom == 1) {
+        oh = (effH - 1) / p.shrink + 1;
+        ow = (effW - 1) / p.shrink + 1;
+    } else if (p.zoom != 1 && p.shrink == 1) {
+        oh = effH + (effH - 1) * (p.zoom - 1);
+        ow = effW + (effW - 1) * (p.zoom - 1);
+    } else if (p.height > 0 && p.width > 0) {
+        oh = p.height;
+        ow = p.width;
+    } else if (p.shrink != 1 && p.zoom != 1) {
+        oh = (effH - 1) / p.shrink + 1;
+        ow = (effW - 1) / p.shrink + 1;
+        oh += (oh - 1) * (p.zoom - 1);
+        ow += (ow - 1) * (p.zoom - 1);
+    } else {
+        oh = effH;
+        ow = effW;
+    }
+    return oh > 0 && ow > 0;
+}
+
+namespace resize {
+// Source coordinates of one axis: out[i] reads in[lower[i]] and in[upper[i]] with weights (keep[i], lerp[i]);
+// keep is only used by Interp, nearest modes only fill lower.
+struct AxisTable {
+    std::vector<int64_t> lower;
+    std::vector<int64_t> upper;
+    std::vector<float> lerp;
+    std::vector<float> keep;
+};
+
+// `in` is the (cropped) input extent, `offset` its first index.
+inline AxisTable BuildAxisTable(int64_t in, int64_t out, int64_t offset, ResizeMode mode) {
+    AxisTable table;
+    table.lower.resize(out);
+    table.upper.resize(out);
+    table.lerp.resize(out);
+    table.keep.resize(out);
+    bool alignCorners = mode == ResizeMode::BILINEAR_ALIGN_CORNERS || mode == ResizeMode::NEAREST_ALIGN_CORNERS;
+    float scale = alignCorners && out > 1 ? static_cast<float>(in - 1) / static_cast<float>(out - 1) :
+                                            static_cast<float>(in) / static_cast<float>(out);
+    if (mode == ResizeMode::INTERP) {
+        scale = out > 1 ? static_cast<float>(in - 1) / (out - 1) : 0.0f;
+    }
+    for (int64_t i = 0; i < out; i++) {
+        float coord = static_cast<float>(i) * scale;
+        switch (mode) {
+            case ResizeMode::BILINEAR_HALF_PIXEL:
+                coord = (static_cast<float>(i) + 0.5f) * scale - 0.5f;
+                // fall through
+            case ResizeMode::BILINEAR:
+            case ResizeMode::BILINEAR_ALIGN_CORNERS: {
+                float base = std::floor(coord);
+                table.lower[i] = std::max<int64_t>(static_cast<int64_t>(base), 0);
+                table.upper[i] = std::min<int64_t>(static_cast<int64_t>(std::ceil(coord)), in - 1);
+                table.lerp[i] = coord - base;
+                break;
+            }
+            case ResizeMode::NEAREST:
+                table.lower[i] = std::min<int64_t>(static_cast<int64_t>(std::floor(coord)), in - 1);
+                break;
+            case ResizeMode::NEAREST_ALIGN_CORNERS:
+                table.lower[i] = std::min<int64_t>(static_cast<int64_t>(std::round(coord)), in - 1);
+                break;
+            case ResizeMode::NEAREST_HALF_PIXEL:
+                coord = (static_cast<float>(i) + 0.5f) * scale;
+                table.lower[i] = std::min<int64_t>(static_cast<int64_t>(std::floor(coord)), in - 1);
+                table.lower[i] = std::max<int64_t>(table.lower[i], 0);
+                break;
+            case ResizeMode::INTERP: {
+                int64_t base = static_cast<int64_t>(coord);
+                table.lower[i] = base;
+                table.upper[i] = base + (base < in - 1 ? 1 : 0);
+                table.lerp[i] = coord - static_cast<float>(base);
+                table.keep[i] = 1.0f - table.lerp[i];
+                break;
+            }
+        }
+        table.lower[i] += offset;
+        table.upper[i] += offset;
+    }
+    return table;
+}
+
+// Tables are shared by every layer (and run) with the same geometry.
+inline std::shared_ptr<const AxisTable> GetAxisTable(int64_t in, int64_t out, int64_t offset, ResizeMode mode) {
+    using Key = std::tuple<int64_t, int64_t, int64_t, int>;
+    static std::mutex mutex;
+    static std::map<Key, std::shared_ptr<const AxisTable>> tables;
+    Key key(in, out, offset, static_cast<int>(mode));
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tables.find(key);
+    if (it != tables.end()) {
+        return it->second;
+    }
+    auto table = std::make_shared<const AxisTable>(BuildAxisTable(in, out, offset, mode));
+    tables[key] = table;
+    return table;
+}
+
+// a + (b - a) * t, or keep * a + t * b for Interp
+inline float Lerp(float a, float b, float t) {
+    float delta = (b - a) * t;
+    return a + delta;
+}
+
+inline float Blend(float a, float b, float keep, float t) {
+    float head = keep * a;
+    float tail = t * b;
+    return head + tail;
+}
+
+// Horizontal pass of one input row: dst[j] from row[lower[j]] and row[upper[j]]. The two taps are gathered
+// into a / b first so the arithmetic runs four columns at a time.
+inline void HorizontalPass(const float* row, const AxisTable& t, bool interp, int64_t ow, float* a, float* b,
+                           float* dst) {
+    const int64_t* lower = t.lower.data();
+    const int64_t* upper = t.upper.data();
+    for (int64_t j = 0; j < ow; j++) {
+        a[j] = row[lower[j]];
+        b[j] = row[upper[j]];
+    }
+    int64_t j = 0;
+    if (interp) {
+        for (; j + 4 <= ow; j += 4) {
+            simd_util::Float4 head = simd_util::Mul4(simd_util::Load4(t.keep.data() + j), simd_util::Load4(a + j));
+            simd_util::Float4 tail = simd_util::Mul4(simd_util::Load4(t.lerp.data() + j), simd_util::Load4(b + j));
+            simd_util::Store4(dst + j, simd_util::Add4(head, tail));
+        }
+        for (; j < ow; j++) {
+            dst[j] = Blend(a[j], b[j], t.keep[j], t.lerp[j]);
+        }
+        return;
+    }
+    for (; j + 4 <= ow; j += 4) {
+        simd_util::Float4 a4 = simd_util::Load4(a + j);
+        simd_util::Float4 delta = simd_util::Mul4(simd_util::Sub4(simd_util::Load4(b + j), a4),
+                                                  simd_util::Load4(t.lerp.data() + j));
+        simd_util::Store4(dst + j, simd_util::Add4(a4, delta));
+    }
+    for (; j < ow; j++) {
+        dst[j] = Lerp(a[j], b[j], t.lerp[j]);
+    }
+}
+
+// Vertical pass: dst = Lerp(top, bottom, t) or Blend(top, bottom, keep, t) for a whole output row.
+inline void VerticalPass(const float* top, const float* bottom, float keep, float t, bool interp, int64_t ow,
+                         float* dst) {
+    simd_util::Float4 t4 = simd_util::Set4(t);
+    simd_util::Float4 keep4 = simd_util::Set4(keep);
+    int64_t j = 0;
+    if (interp) {
+        for (; j + 4 <= ow; j += 4) {
+            simd_util::Float4 head = simd_util::Mul4(keep4, simd_util::Load4(top + j));
+            simd_util::Float4 tail = simd_util::Mul4(t4, simd_util::Load4(bottom + j));
+            simd_util::Store4(dst + j, simd_util::Add4(head, tail));
+        }
+        for (; j < ow; j++) {
+            dst[j] = Blend(top[j], bottom[j], keep, t);
+        }
+        return;
+    }
+    for (; j + 4 <= ow; j += 4) {
+        simd_util::Float4 top4 = simd_util::Load4(top + j);
+        simd_util::Float4 delta = simd_util::Mul4(simd_util::Sub4(simd_util::Load4(bottom + j), top4), t4);
+        simd_util::Store4(dst + j, simd_util::Add4(top4, delta));
+    }
+    for (; j < ow; j++) {
+        dst[j] = Lerp(top[j], bottom[j], t);
+    }
+}
+
+// Output rows [oy0, oy1) of one plane. The horizontal rows of the two input rows last used are kept, so an
+// upsampling pass computes each input row once.
+inline void BilinearRows(const float* in, int64_t w, const AxisTable& ty, const AxisTable& tx, bool interp,
+                         int64_t ow, int64_t oy0, int64_t oy1, float* scratch, float* out) {
+    float* a = scratch;
+    float* b = scratch + ow;
+    float* rows[2] = {scratch + 2 * ow, scratch + 3 * ow};
+    int64_t rowIndex[2] = {-1, -1};
+    for (int64_t oy = oy0; oy < oy1; oy++) {
+        int64_t top = ty.lower[oy];
+        int64_t bottom = ty.upper[oy];
+        const float* topRow = nullptr;
+        const float* bottomRow = nullptr;
+        // rows only move forward: keep the slot holding `top` or `bottom`, refill the other
+        for (int slot = 0; slot < 2; slot++) {
+            if (rowIndex[slot] == top) {
+                topRow = rows[slot];
+            }
+            if (rowIndex[slot] == bottom) {
+                bottomRow = rows[slot];
+            }
+        }
+        if (topRow == nullptr) {
+            int slot = rowIndex[0] == bottom ? 1 : 0;
+            HorizontalPass(in + top * w, tx, interp, ow, a, b, rows[slot]);
+            rowIndex[slot] = top;
+            topRow = rows[slot];
+            if (bottom == top) {
+                bottomRow = topRow;
+            }
+        }
+        if (bottomRow == nullptr) {
+            int slot = rows[0] == topRow ? 1 : 0;
+            HorizontalPass(in + bottom * w, tx, interp, ow, a, b, rows[slot]);
+            rowIndex[slot] = bottom;
+            bottomRow = rows[slot];
+        }
+        VerticalPass(topRow, bottomRow, ty.keep[oy], ty.lerp[oy], interp, ow, out + oy * ow);
+    }
+}
+
+inline void NearestRows(const float* in, int64_t w, const AxisTable& ty, const AxisTable& tx, int64_t ow,
+                        int64_t oy0, int64_t oy1, float* out) {
+    const int64_t* lower = tx.lower.data();
+    for (int64_t oy = oy0; oy < oy1; oy++) {
+        float* dst = out + oy * ow;
+        if (oy > oy0 && ty.lower[oy] == ty.lower[oy - 1]) {
+            std::memcpy(dst, dst - ow, ow * sizeof(float));
+            continue;
+        }
+        const float* row = in + ty.lower[oy] * w;
+        for (int64_t j = 0; j < ow; j++) {
+            dst[j] = row[lower[j]];
+        }
+    }
+}
+}
+
+// x [planes, h, w] -> y [planes, oh, ow]. For Interp, crop is the (non positive) pad_begin / pad_end.
+// Threads take whole planes; with fewer planes than threads the planes are split into row bands.
+inline void Resize(const float* x, int64_t planes, int64_t h, int64_t w, ResizeMode mode, float* y, int64_t oh,
+                   int64_t ow, int64_t cropBegin = 0, int64_t cropEnd = 0, int threadNum = 0) {
+    int64_t effH = h + cropBegin + cropEnd;
+    int64_t effW = w + cropBegin + cropEnd;
+    std::shared_ptr<const resize::AxisTable> ty = resize::GetAxisTable(effH, oh, -cropBegin, mode);
+    std::shared_ptr<const resize::AxisTable> tx = resize::GetAxisTable(effW, ow, -cropBegin, mode);
+    bool nearest = mode == ResizeMode::NEAREST || mode == ResizeMode::NEAREST_ALIGN_CORNERS ||
+                   mode == ResizeMode::NEAREST_HALF_PIXEL;
+    bool interp = mode == ResizeMode::INTERP;
+    if (threadNum <= 0) {
+        threadNum = parallel_util::GetThreadNum();
+    }
+    int64_t bands = std::max<int64_t>(1, std::min<int64_t>(oh / 16, (threadNum + planes - 1) / planes));
+    int64_t bandRows = (oh + bands - 1) / bands;
+    parallel_util::ParallelFor(0, static_cast<size_t>(planes * bands), [&](size_t begin, size_t end) {
+        std::unique_ptr<float[]> scratch(nearest ? nullptr : new float[4 * ow]);
+        for (size_t task = begin; task < end; task++) {
+            int64_t plane = static_cast<int64_t>(task) / bands;
+            int64_t oy0 = static_cast<int64_t>(task) % bands * bandRows;
+            int64_t oy1 = std::min(oh, oy0 + bandRows);
+            const float* in = x + plane * h * w;
+            float* out = y + plane * oh * ow;
+            if (nearest) {
+                resize::NearestRows(in, w, *ty, *tx, ow, oy0, oy1, out);
+            } else {
+                resize::BilinearRows(in, w, *ty, *tx, interp, ow, oy0, oy1, scratch.get(), out);
+            }
+        }
+    }, threadNum);
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_RESIZE_H
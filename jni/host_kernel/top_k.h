@@ -0,0 +1,276 @@
+#ifndef BUILD_IR_MODEL_HOST_KERNEL_TOP_K_H
+#define BUILD_IR_MODEL_HOST_KERNEL_TOP_K_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// TopK and ArgMax over the rows of x [rows, num], sized for classification and retrieval heads with 100k+ logits.
+// The first k values of a row seed a heap whose top is the k-th best value seen so far. After that, a block of 16
+// values is only visited one by one when its vector max beats the top, which stops happening a few thousand
+// values into the row. Long rows are split into segments scanned by different threads, and the candidates of
+// the segments are merged k-way. Ties keep the lower index first, as TF TopK does.
+namespace host_kernel {
+namespace topk {
+const int64_t BLOCK = 16;
+const int64_t HALF_BLOCK = 256;
+const int64_t MIN_SEGMENT = 1 << 15;
+const int64_t COLUMN_TILE = 64;
+
+struct Candidate {
+    float value;
+    int32_t index;
+};
+
+// Strict weak order with the better candidate first: larger value, then lower index.
+inline bool Better(const Candidate& a, const Candidate& b) {
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+}
+
+// IEEE half -> float without branches, so a block of FP16 logits converts with vector code. Subnormals are
+// exact (the float multiply rebiases them), Inf and NaN keep their class.
+inline void HalfToFloat(const uint16_t* src, int64_t num, float* dst) {
+    const float rebias = 5.192296858534828e+33f;  // 2^112
+    for (int64_t i = 0; i < num; i++) {
+        uint32_t h = src[i];
+        uint32_t bits = (h & 0x7fffu) << 13;
+        float magnitude;
+        std::memcpy(&magnitude, &bits, sizeof(magnitude));
+        magnitude *= rebias;
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= (h & 0x7c00u) == 0x7c00u ? 0x7f800000u : 0u;
+        bits |= (h & 0x8000u) << 16;
+        std::memcpy(dst + i, &bits, sizeof(bits));
+    }
+}
+
+// heap holds k candidates with the worst one on top; value / index replaces it.
+inline void Replace(std::vector<Candidate>& heap, float value, int32_t index) {
+    std::pop_heap(heap.begin(), heap.end(), Better);
+    heap.back().value = value;
+    heap.back().index = index;
+    std::push_heap(heap.begin(), heap.end(), Better);
+}
+
+// Offers x[0, num) to a full heap. A later value equal to the top is worse than it, hence the strict compare.
+inline void Filter(const float* x, int64_t num, int64_t base, std::vector<Candidate>& heap) {
+    using namespace simd_util;
+    float threshold = heap.front().value;
+    int64_t i = 0;
+    for (; i + BLOCK <= num; i += BLOCK) {
+        Float4 max = Max4(Max4(Load4(x + i), Load4(x + i + 4)), Max4(Load4(x + i + 8), Load4(x + i + 12)));
+        if (!(ReduceMax4(max) > threshold)) {
+            continue;
+        }
+        for (int64_t j = i; j < i + BLOCK; j++) {
+            if (x[j] > threshold) {
+                Replace(heap, x[j], static_cast<int32_t>(base + j));
+                threshold = heap.front().value;
+            }
+        }
+    }
+    for (; i < num; i++) {
+        if (x[i] > threshold) {
+            Replace(heap, x[i], static_cast<int32_t>(base + i));
+            threshold = heap.front().value;
+        }
+    }
+}
+
+// Adds x[0, num), the values at indices base.., to the running top k of a segment.
+inline void Accumulate(const float* x, int64_t num, int64_t base, int64_t k, std::vector<Candidate>& heap) {
+    int64_t i = 0;
+    if (static_cast<int64_t>(heap.size()) < k) {
+        for (; i < num && static_cast<int64_t>(heap.size()) < k; i++) {
+            Candidate candidate;
+            candidate.value = x[i];
+            candidate.index = static_cast<int32_t>(base + i);
+            heap.push_back(candidate);
+        }
+        if (static_cast<int64_t>(heap.size()) < k) {
+            return;
+        }
+        std::make_heap(heap.begin(), heap.end(), Better);
+    }
+    if (i < num) {
+        Filter(x + i, num - i, base + i, heap);
+    }
+}
+
+inline void SelectSegment(const float* row, int64_t begin, int64_t end, int64_t k, std::vector<Candidate>& heap) {
+    Accumulate(row + begin, end - begin, begin, k, heap);
+}
+
+// Maps half bit patterns to unsigned integers in the same order as their values (NaN aside), and back.
+inline uint16_t HalfKey(uint16_t h) {
+    return static_cast<uint16_t>(h ^ (static_cast<uint16_t>(static_cast<int16_t>(h) >> 15) | 0x8000u));
+}
+
+inline uint16_t KeyToHalf(uint16_t key) {
+    return static_cast<uint16_t>((key & 0x8000u) != 0 ? key & 0x7fffu : ~key);
+}
+
+// The fixed trip count of a full block lets the compiler vectorize the loop.
+inline uint16_t MaxKey(const uint16_t* x, int64_t num) {
+    uint16_t maxKey = 0;
+    if (num == HALF_BLOCK) {
+        for (int64_t j = 0; j < HALF_BLOCK; j++) {
+            maxKey = std::max(maxKey, HalfKey(x[j]));
+        }
+        return maxKey;
+    }
+    for (int64_t j = 0; j < num; j++) {
+        maxKey = std::max(maxKey, HalfKey(x[j]));
+    }
+    return maxKey;
+}
+
+// Once the heap is full, a block of halves is ranked by the max of its integer keys and only converted when
+// that max beats the threshold. The unordered compare also visits blocks whose max is a NaN.
+inline void SelectSegment(const uint16_t* row, int64_t begin, int64_t end, int64_t k,
+                          std::vector<Candidate>& heap) {
+    float block[HALF_BLOCK];
+    int64_t i = begin;
+    for (; i < end && static_cast<int64_t>(heap.size()) < k; i += HALF_BLOCK) {
+        int64_t num = std::min(HALF_BLOCK, end - i);
+        HalfToFloat(row + i, num, block);
+        Accumulate(block, num, i, k, heap);
+    }
+    for (; i < end; i += HALF_BLOCK) {
+        int64_t num = std::min(HALF_BLOCK, end - i);
+        uint16_t maxHalf = KeyToHalf(MaxKey(row + i, num));
+        float max;
+        HalfToFloat(&maxHalf, 1, &max);
+        if (max <= heap.front().value) {
+            continue;
+        }
+        HalfToFloat(row + i, num, block);
+        Filter(block, num, i, heap);
+    }
+}
+
+// Merges the candidates of one row's segments into its top k. Unsorted output takes whatever order is cheapest.
+inline void Merge(std::vector<Candidate>* lists, int64_t segments, int64_t k, bool sorted, float* values,
+                  int32_t* indices) {
+    std::vector<Candidate> merged;
+    if (segments == 1) {
+        merged.swap(lists[0]);
+        if (sorted) {
+            std::sort(merged.begin(), merged.end(), Better);
+        }
+    } else if (!sorted) {
+        for (int64_t s = 0; s < segments; s++) {
+            merged.insert(merged.end(), lists[s].begin(), lists[s].end());
+        }
+        std::nth_element(merged.begin(), merged.begin() + (k - 1), merged.end(), Better);
+    } else {
+        // heads of the sorted lists in a heap of `segments` entries, the best head on top
+        std::vector<std::pair<Candidate, int64_t>> heads;
+        std::vector<size_t> next(segments, 1);
+        auto worse = [](const std::pair<Candidate, int64_t>& a, const std::pair<Candidate, int64_t>& b) {
+            return Better(b.first, a.first);
+        };
+        for (int64_t s = 0; s < segments; s++) {
+            std::sort(lists[s].begin(), lists[s].end(), Better);
+            if (!lists[s].empty()) {
+                heads.emplace_back(lists[s][0], s);
+            }
+        }
+        std::make_heap(heads.begin(), heads.end(), worse);
+        while (static_cast<int64_t>(merged.size()) < k && !heads.empty()) {
+            std::pop_heap(heads.begin(), heads.end(), worse);
+            int64_t s = heads.back().second;
+            merged.push_back(heads.back().first);
+            heads.pop_back();
+            if (next[s] < lists[s].size()) {
+                heads.emplace_back(lists[s][next[s]++], s);
+                std::push_heap(heads.begin(), heads.end(), worse);
+            }
+        }
+    }
+    for (int64_t i = 0; i < k; i++) {
+        values[i] = merged[i].value;
+        indices[i] = merged[i].index;
+    }
+}
+
+template<typename T>
+inline void TopKRows(const T* x, int64_t rows, int64_t num, int64_t k, bool sorted, float* values,
+                     int32_t* indices, int threadNum) {
+    if (rows <= 0 || k <= 0) {
+        return;
+    }
+    int64_t threads = threadNum > 0 ? threadNum : parallel_util::GetThreadNum();
+    int64_t segments = std::max<int64_t>(1, std::min(threads / rows, num / MIN_SEGMENT));
+    int64_t segmentLen = (num + segments - 1) / segments;
+    std::vector<std::vector<Candidate>> lists(static_cast<size_t>(rows * segments));
+    parallel_util::ParallelFor(0, lists.size(), [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            int64_t row = static_cast<int64_t>(t) / segments;
+            int64_t first = static_cast<int64_t>(t) % segments * segmentLen;
+            lists[t].reserve(static_cast<size_t>(k));
+            SelectSegment(x + row * num, first, std::min(num, first + segmentLen), k, lists[t]);
+        }
+    }, threadNum);
+    parallel_util::ParallelFor(0, static_cast<size_t>(rows), [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; row++) {
+            Merge(&lists[row * segments], segments, k, sorted, values + row * k, indices + row * k);
+        }
+    }, threadNum, static_cast<size_t>(std::max<int64_t>(1, MIN_SEGMENT / std::max<int64_t>(k * segments, 1))));
+}
+
+// Index of the max of each column of a [axis, inner] slab for up to COLUMN_TILE columns.
+inline void ArgMaxColumns(const float* x, int64_t axis, int64_t inner, int64_t columns, int32_t* y) {
+    float best[COLUMN_TILE];
+    int32_t index[COLUMN_TILE];
+    std::copy(x, x + columns, best);
+    std::fill(index, index + columns, 0);
+    for (int64_t a = 1; a < axis; a++) {
+        const float* row = x + a * inner;
+        for (int64_t j = 0; j < columns; j++) {
+            bool greater = row[j] > best[j];
+            best[j] = greater ? row[j] : best[j];
+            index[j] = greater ? static_cast<int32_t>(a) : index[j];
+        }
+    }
+    std::copy(index, index + columns, y);
+}
+}
+
+// values / indices [rows, k] get the k largest values of every row of x [rows, num] and their positions,
+// 1 <= k <= num. sorted: best first; otherwise the order is unspecified, as for TF TopK with sorted=false.
+inline void TopK(const float* x, int64_t rows, int64_t num, int64_t k, bool sorted, float* values,
+                 int32_t* indices, int threadNum = 0) {
+    topk::TopKRows(x, rows, num, k, sorted, values, indices, threadNum);
+}
+
+// TopK of FP16 data (IEEE half bit patterns) such as a float16 NPU output, read in place.
+inline void TopKHalf(const uint16_t* x, int64_t rows, int64_t num, int64_t k, bool sorted, float* values,
+                     int32_t* indices, int threadNum = 0) {
+    topk::TopKRows(x, rows, num, k, sorted, values, indices, threadNum);
+}
+
+// y [outer, inner] = position of the max along the middle axis of x [outer, axis, inner], the first one on ties.
+inline void ArgMax(const float* x, int64_t outer, int64_t axis, int64_t inner, int32_t* y, int threadNum = 0) {
+    if (inner == 1) {
+        std::vector<float> values(static_cast<size_t>(outer));
+        TopK(x, outer, axis, 1, true, values.data(), y, threadNum);
+        return;
+    }
+    int64_t tiles = (inner + topk::COLUMN_TILE - 1) / topk::COLUMN_TILE;
+    parallel_util::ParallelFor(0, static_cast<size_t>(outer * tiles), [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            int64_t o = static_cast<int64_t>(t) / tiles;
+            int64_t j0 = static_cast<int64_t>(t) % tiles * topk::COLUMN_TILE;
+            topk::ArgMaxColumns(x + o * axis * inner + j0, axis, inner, std::min(topk::COLUMN_TILE, inner - j0),
+                                y + o * inner + j0);
+        }
+    }, threadNum, static_cast<size_t>(std::max<int64_t>(1, topk::MIN_SEGMENT / (axis * topk::COLUMN_TILE))));
+}
+}
+
+#endif //BUILD_IR_MODEL_HOST_KERNEL_TOP_K_H
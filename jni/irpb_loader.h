@@ -0,0 +1,196 @@
+#ifndef BUILD_IR_MODEL_IRPB_LOADER_H
+#define BUILD_IR_MODEL_IRPB_LOADER_H
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <sys/time.h>
+
+#include "graph/buffer.h"
+#include "graph/graph.h"
+#include "graph/model.h"
+#include "log_util.h"
+#include "mapped_file.h"
+
+// Round trip of the serialized IR (.irpb) written by ir_model::Build. Every .irpb gets a small text sidecar
+// <path>.meta holding its CRC-32, size and a cache key, so that a truncated or stale file is rejected before
+// ge::Model::Load parses it. LoadOrBuildModel turns this into a builder cache: warm starts load the mmapped
+// IR and skip the C++ graph construction entirely.
+//
+//     ge::Model model("model", modelName);
+//     bool hit = false;
+//     ir_model::LoadOrBuildModel(modelName + ".irpb", "mobilenet_v2@3", BuildMobileNet, model, &hit);
+//
+// The key has to change whenever the builder does (a version string, a hash of the builder sources, ...).
+namespace ir_model {
+struct IrpbMeta {
+    uint32_t checksum = 0;
+    size_t size = 0;
+    std::string key;
+};
+
+struct IrpbStat {
+    size_t bytes = 0;
+    double mapMs = 0;      // mmap + checksum
+    double parseMs = 0;    // ge::Model::Load
+    double buildMs = 0;    // graph construction, cache misses only
+    double saveMs = 0;     // ge::Model::Save + write, cache misses only
+};
+
+inline double IrpbNowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+inline std::string IrpbMetaPath(const std::string& path) {
+    return path + ".meta";
+}
+
+inline bool ReadIrpbMeta(const std::string& path, IrpbMeta& meta) {
+    FILE* file = fopen(IrpbMetaPath(path).c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+    unsigned int checksum = 0;
+    unsigned long long size = 0;
+    char key[256] = {0};
+    int fields = fscanf(file, "%x %llu %255[^\n]", &checksum, &size, key);
+    fclose(file);
+    if (fields < 2) {
+        ALOGE("[IRPB] %s is malformed.\n", IrpbMetaPath(path).c_str());
+        return false;
+    }
+    meta.checksum = checksum;
+    meta.size = static_cast<size_t>(size);
+    meta.key = fields == 3 ? key : "";
+    return true;
+}
+
+// Writes to a temporary file and renames it, a crash never leaves a half written file under `path`.
+inline bool WriteFileAtomic(const std::string& path, const void* data, size_t size) {
+    std::string tmp = path + ".tmp";
+    FILE* file = fopen(tmp.c_str(), "wb");
+    if (file == nullptr) {
+        ALOGE("[IRPB] open %s failed.\n", tmp.c_str());
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, file) == size;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        ALOGE("[IRPB] write %s failed.\n", path.c_str());
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// True when the file at `path` has the size and CRC-32 that `meta` records.
+inline bool IrpbMatchesMeta(const std::string& path, const IrpbMeta& meta) {
+    om_model::MappedFile file;
+    return file.Open(path) && file.GetSize() == meta.size &&
+           om_model::Crc32(file.GetData(), file.GetSize()) == meta.checksum;
+}
+
+// Serializes `model` to `path` and its sidecar. Unchanged content is not rewritten, and keeps its key when
+// `key` is empty (ir_model::Build saving a model that came from the cache). The sidecar alone does not prove
+// the data file is unchanged, a truncated or deleted .irpb under an intact sidecar is rewritten.
+inline bool SaveIrpb(const ge::Model& model, const std::string& path, const std::string& key = "") {
+    ge::Buffer buffer;
+    if (model.Save(buffer) != ge::GRAPH_SUCCESS || buffer.GetSize() == 0) {
+        ALOGE("[IRPB] serialize %s failed.\n", path.c_str());
+        return false;
+    }
+    IrpbMeta meta;
+    meta.checksum = om_model::Crc32(buffer.GetData(), buffer.GetSize());
+    meta.size = buffer.GetSize();
+    meta.key = key;
+    IrpbMeta old;
+    if (ReadIrpbMeta(path, old) && old.checksum == meta.checksum && old.size == meta.size &&
+        (key.empty() || old.key == key) && IrpbMatchesMeta(path, old)) {
+        return true;
+    }
+    char text[320];
+    int length = snprintf(text, sizeof(text), "%08x %zu %s\n", meta.checksum, meta.size, key.c_str());
+    // data first: a sidecar never describes a file that is not there yet
+    return WriteFileAtomic(path, buffer.GetData(), buffer.GetSize()) &&
+           WriteFileAtomic(IrpbMetaPath(path), text, static_cast<size_t>(length));
+}
+
+// Loads `path` into `model`. A file without sidecar is loaded unverified unless a key is required.
+inline bool LoadIrpb(const std::string& path, ge::Model& model, const std::string& key = "",
+                     IrpbStat* stat = nullptr) {
+    double start = IrpbNowMs();
+    IrpbMeta meta;
+    bool hasMeta = ReadIrpbMeta(path, meta);
+    if (!key.empty() && (!hasMeta || meta.key != key)) {
+        ALOGI("[IRPB] %s was built for key \"%s\", not \"%s\".\n", path.c_str(), hasMeta ? meta.key.c_str() : "",
+              key.c_str());
+        return false;
+    }
+    om_model::MappedFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    if (hasMeta) {
+        uint32_t checksum = om_model::Crc32(file.GetData(), file.GetSize());
+        if (file.GetSize() != meta.size || checksum != meta.checksum) {
+            ALOGE("[IRPB] %s is corrupted: %zu bytes crc %08x, expected %zu bytes crc %08x.\n", path.c_str(),
+                  file.GetSize(), checksum, meta.size, meta.checksum);
+            return false;
+        }
+    } else {
+        ALOGI("[IRPB] %s has no %s, loading it unverified.\n", path.c_str(), IrpbMetaPath(path).c_str());
+    }
+    double mapped = IrpbNowMs();
+    if (ge::Model::Load(static_cast<const uint8_t*>(file.GetData()), file.GetSize(), model) != ge::GRAPH_SUCCESS ||
+        !model.IsValid()) {
+        ALOGE("[IRPB] parse %s failed.\n", path.c_str());
+        return false;
+    }
+    if (stat != nullptr) {
+        stat->bytes = file.GetSize();
+        stat->mapMs = mapped - start;
+        stat->parseMs = IrpbNowMs() - mapped;
+    }
+    return true;
+}
+
+using GraphBuilder = std::function<bool(ge::Graph& graph)>;
+
+// Loads the model from `path` when its key matches and the checksum holds, otherwise builds the graph into
+// `model` and saves it for the next start.
+inline bool LoadOrBuildModel(const std::string& path, const std::string& key, const GraphBuilder& builder,
+                             ge::Model& model, bool* cacheHit = nullptr, IrpbStat* stat = nullptr) {
+    IrpbStat local;
+    IrpbStat& s = stat != nullptr ? *stat : local;
+    s = IrpbStat();
+    if (cacheHit != nullptr) {
+        *cacheHit = false;
+    }
+    if (LoadIrpb(path, model, key, &s)) {
+        if (cacheHit != nullptr) {
+            *cacheHit = true;
+        }
+        ALOGI("[IRPB] %s loaded from cache: %zu bytes, map %.3f ms, parse %.3f ms.\n", path.c_str(), s.bytes,
+              s.mapMs, s.parseMs);
+        return true;
+    }
+    double start = IrpbNowMs();
+    ge::Graph graph("ir_graph");
+    if (!builder(graph)) {
+        ALOGE("[IRPB] building the graph for %s failed.\n", path.c_str());
+        return false;
+    }
+    model.SetGraph(graph);
+    double built = IrpbNowMs();
+    // a failed save only costs the next warm start
+    SaveIrpb(model, path, key);
+    s.buildMs = built - start;
+    s.saveMs = IrpbNowMs() - built;
+    ALOGI("[IRPB] %s built in %.3f ms, saved in %.3f ms.\n", path.c_str(), s.buildMs, s.saveMs);
+    return true;
+}
+}
+
+#endif //BUILD_IR_MODEL_IRPB_LOADER_H
@@ -0,0 +1,373 @@
+#ifndef BUILD_IR_MODEL_LAYER_DUMP_H
+#define BUILD_IR_MODEL_LAYER_DUMP_H
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <sys/time.h>
+#include <thread>
+#include <vector>
+
+#include "accuracy_check.h"
+#include "host_executor.h"
+#include "host_graph.h"
+#include "npy_io.h"
+#include "parallel_util.h"
+#include "shape_inference.h"
+#include "test_util.h"
+
+// Accuracy bisection for models that disagree with their reference. The selected layers of a clone of the
+// graph are made extra graph outputs, the instrumented model is built and run once, and every dumped tensor is
+// compared with the host kernels in two ways:
+//  - chained: the host reference run from the graph inputs, errors accumulate like in the final outputs;
+//  - isolated: the layer's host kernel fed with the NPU's own inputs, the error the layer adds by itself.
+// Layers are compared in parallel while the NPU tensors are written to an .npz in the background.
+//
+//     layer_dump::DumpOptions options;
+//     options.types = {"Convolution", "ConvolutionDepthwise"};
+//     options.dumpPath = "/data/local/tmp/output/mobilenet_layers.npz";
+//     layer_dump::LayerDumper dumper(graph, host_kernel::GetBuiltinKernels());
+//     dumper.Build("/data/local/tmp/output/mobilenet_dump.om", options);
+//     layer_dump::DumpResult result;
+//     dumper.Run(inputs, result);
+//     layer_dump::PrintResult(result);
+//
+// Extra outputs can keep the NPU compiler from fusing a layer with its successor, so the instrumented model may
+// be slightly more accurate than the original one. Only single output layers can be dumped.
+namespace layer_dump {
+using host_graph::HostTensor;
+using host_graph::Node;
+using host_graph::TensorRef;
+
+struct DumpOptions {
+    // layers to dump by type or by name, every layer when both are empty
+    std::set<std::string> types;
+    std::set<std::string> names;
+    // every n-th selected layer, a coarse first pass over deep models
+    int stride = 1;
+    // .npz receiving the NPU tensors, none when empty
+    std::string dumpPath;
+    bool compress = true;
+    accuracy_check::Tolerance tolerance = accuracy_check::GetTolerance(ge::DT_FLOAT16);
+};
+
+struct LayerResult {
+    int node = -1;
+    std::string name;
+    std::string type;
+    accuracy_check::Report chained;
+    bool hasChained = false;
+    accuracy_check::Report isolated;
+    bool hasIsolated = false;
+    // the host reference could not run this layer and continued from the NPU tensor
+    bool reanchored = false;
+};
+
+struct DumpResult {
+    std::vector<LayerResult> layers;
+    // indices into layers, -1 when every compared layer passed
+    int firstChainedFailure = -1;
+    int firstIsolatedFailure = -1;
+    double npuMs = 0;
+    double referenceMs = 0;
+    double compareMs = 0;
+    // time the background write outlasted the comparisons
+    double writeWaitMs = 0;
+    size_t dumpBytes = 0;
+};
+
+inline double DumpNowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+class LayerDumper {
+public:
+    // The graph is cloned, `graph` itself is left untouched.
+    LayerDumper(const host_graph::Graph& graph, const host_graph::KernelRegistry& registry)
+        : graph_(graph), registry_(registry), executor_(graph_, registry) {}
+
+    LayerDumper(const LayerDumper&) = delete;
+    LayerDumper& operator=(const LayerDumper&) = delete;
+
+    // Node indices of the layers `options` selects, in node order.
+    std::vector<int> SelectLayers(const DumpOptions& options) const {
+        std::vector<int> layers;
+        int selected = 0;
+        for (size_t i = 0; i < graph_.GetNodes().size(); i++) {
+            const Node& node = graph_.GetNode(static_cast<int>(i));
+            if (node.type == "Data" || node.type == "Const" || node.GetOutputNum() != 1) {
+                continue;
+            }
+            bool all = options.types.empty() && options.names.empty();
+            if (!all && options.types.count(node.type) == 0 && options.names.count(node.name) == 0) {
+                continue;
+            }
+            if (selected++ % std::max(options.stride, 1) == 0) {
+                layers.push_back(static_cast<int>(i));
+            }
+        }
+        return layers;
+    }
+
+    bool Build(const std::string& modelName, const DumpOptions& options) {
+        options_ = options;
+        modelName_ = modelName;
+        if (!shape_inference::InferShapes(graph_, shape_inference::GetBuiltinInferFuncs())) {
+            return false;
+        }
+        layers_ = SelectLayers(options);
+        // the original outputs keep their positions, the model returns one tensor per output operator
+        outputs_.clear();
+        std::set<int> outputNodes;
+        for (const auto& ref : graph_.GetOutputs()) {
+            if (outputNodes.insert(ref.node).second) {
+                outputs_.push_back(host_graph::Executor::Ref(ref.node, 0));
+            }
+        }
+        for (int layer : layers_) {
+            if (outputNodes.insert(layer).second) {
+                outputs_.push_back(host_graph::Executor::Ref(layer, 0));
+            }
+        }
+        host_graph::Graph instrumented = graph_;
+        instrumented.SetOutputs(outputs_);
+        ge::Graph irGraph(graph_.GetName() + "_dump");
+        if (!instrumented.ToGeGraph(irGraph)) {
+            return false;
+        }
+        ge::Model irModel("model", modelName);
+        irModel.SetGraph(irGraph);
+        client_ = ir_model::Build(modelName, irModel, &inputTensors_, &outputTensors_);
+        if (client_ == nullptr) {
+            ALOGE("[LAYER_DUMP] build %s failed.\n", modelName.c_str());
+            return false;
+        }
+        if (inputTensors_.size() != graph_.GetInputs().size() || outputTensors_.size() != outputs_.size()) {
+            ALOGE("[LAYER_DUMP] %s IO mismatch: %zu/%zu inputs, %zu/%zu outputs.\n", modelName.c_str(),
+                  inputTensors_.size(), graph_.GetInputs().size(), outputTensors_.size(), outputs_.size());
+            return false;
+        }
+        ALOGI("[LAYER_DUMP] %s: %zu layers dumped as extra outputs.\n", modelName.c_str(), layers_.size());
+        return true;
+    }
+
+    bool Run(const std::vector<HostTensor>& inputs, DumpResult& result) {
+        result = DumpResult();
+        if (client_ == nullptr || inputs.size() != inputTensors_.size()) {
+            ALOGE("[LAYER_DUMP] not built or expect %zu inputs, got %zu.\n", inputTensors_.size(), inputs.size());
+            return false;
+        }
+        double start = DumpNowMs();
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (inputs[i].GetByteSize() != inputTensors_[i]->GetSize()) {
+                ALOGE("[LAYER_DUMP] input %zu size %zu != %u.\n", i, inputs[i].GetByteSize(),
+                      inputTensors_[i]->GetSize());
+                return false;
+            }
+            memcpy(inputTensors_[i]->GetBuffer(), inputs[i].GetData(), inputs[i].GetByteSize());
+        }
+        hiai::AiContext context;
+        context.AddPara("model_name", modelName_);
+        int istamp;
+        int ret = client_->Process(context, inputTensors_, outputTensors_, 1000, istamp);
+        if (ret != hiai::AI_SUCCESS) {
+            ALOGE("[LAYER_DUMP] %s: Process failed, ret=%d.\n", modelName_.c_str(), ret);
+            return false;
+        }
+        host_graph::TensorMap npu;
+        for (size_t i = 0; i < outputs_.size(); i++) {
+            npu[outputs_[i]] = HostTensor::View(outputTensors_[i], GetDims(outputs_[i], outputTensors_[i]));
+            result.dumpBytes += outputTensors_[i]->GetSize();
+        }
+        result.npuMs = DumpNowMs() - start;
+
+        // the output buffers are not touched again before the writer is joined
+        std::thread writer;
+        bool written = true;
+        if (!options_.dumpPath.empty()) {
+            writer = std::thread([this, &npu, &written]() { written = WriteDump(npu); });
+        }
+        start = DumpNowMs();
+        host_graph::TensorMap reference;
+        std::set<int> reanchored;
+        RunReference(inputs, npu, reference, reanchored);
+        result.referenceMs = DumpNowMs() - start;
+
+        start = DumpNowMs();
+        result.layers.resize(layers_.size());
+        parallel_util::ParallelFor(0, layers_.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                CompareLayer(layers_[i], npu, reference, result.layers[i]);
+                result.layers[i].reanchored = reanchored.count(layers_[i]) != 0;
+            }
+        });
+        result.compareMs = DumpNowMs() - start;
+        start = DumpNowMs();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        result.writeWaitMs = DumpNowMs() - start;
+        for (size_t i = 0; i < result.layers.size(); i++) {
+            const LayerResult& layer = result.layers[i];
+            if (result.firstChainedFailure < 0 && layer.hasChained && !layer.chained.passed) {
+                result.firstChainedFailure = static_cast<int>(i);
+            }
+            if (result.firstIsolatedFailure < 0 && layer.hasIsolated && !layer.isolated.passed) {
+                result.firstIsolatedFailure = static_cast<int>(i);
+            }
+        }
+        return written;
+    }
+
+    const std::vector<int>& GetLayers() const { return layers_; }
+
+private:
+    std::vector<int64_t> GetDims(const TensorRef& ref, const std::shared_ptr<hiai::AiTensor>& tensor) const {
+        if (graph_.HasOutputDesc(ref)) {
+            std::vector<int64_t> dims = host_graph::GetDescDims(graph_.GetNode(ref.node).outputDescs[ref.index]);
+            if (HostTensor::GetElementNum(dims) * sizeof(float) == tensor->GetSize()) {
+                return dims;
+            }
+        }
+        auto dims = tensor->GetTensorDimension();
+        return {dims.GetNumber(), dims.GetChannel(), dims.GetHeight(), dims.GetWidth()};
+    }
+
+    bool CanRun(const Node& node, const host_graph::TensorMap& tensors) const {
+        if (!registry_.Has(node.type)) {
+            return false;
+        }
+        for (const auto& input : node.inputs) {
+            if (tensors.count(input) == 0 && graph_.GetNode(input.node).type != "Const") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Host reference from the graph inputs. Layers without a host kernel continue from the NPU tensor when it
+    // was dumped, everything downstream of a gap without one has no chained reference.
+    void RunReference(const std::vector<HostTensor>& inputs, const host_graph::TensorMap& npu,
+                      host_graph::TensorMap& reference, std::set<int>& reanchored) const {
+        const auto& dataNodes = graph_.GetInputs();
+        for (size_t i = 0; i < dataNodes.size(); i++) {
+            reference[host_graph::Executor::Ref(dataNodes[i], 0)] = inputs[i];
+        }
+        for (size_t i = 0; i < graph_.GetNodes().size(); i++) {
+            int index = static_cast<int>(i);
+            const Node& node = graph_.GetNode(index);
+            if (node.type == "Data") {
+                continue;
+            }
+            if (node.type == "Const" || CanRun(node, reference)) {
+                if (executor_.Run({index}, reference)) {
+                    continue;
+                }
+            }
+            auto it = npu.find(host_graph::Executor::Ref(index, 0));
+            if (it != npu.end()) {
+                reference[it->first] = it->second;
+                reanchored.insert(index);
+            }
+        }
+    }
+
+    void CompareLayer(int index, const host_graph::TensorMap& npu, const host_graph::TensorMap& reference,
+                      LayerResult& layer) const {
+        const Node& node = graph_.GetNode(index);
+        TensorRef ref = host_graph::Executor::Ref(index, 0);
+        layer.node = index;
+        layer.name = node.name;
+        layer.type = node.type;
+        const HostTensor& out = npu.at(ref);
+        auto chained = reference.find(ref);
+        if (chained != reference.end() && chained->second.GetData() != out.GetData()) {
+            layer.hasChained = Compare(node.name, chained->second, out, layer.chained);
+        }
+        // the layer alone on the NPU's inputs; graph inputs and consts are exact, other producers that were
+        // not dumped fall back to the chained reference
+        host_graph::TensorMap local;
+        for (const auto& input : node.inputs) {
+            auto it = npu.find(input);
+            if (it != npu.end()) {
+                local[input] = it->second;
+            } else if (graph_.GetNode(input.node).type != "Const" && reference.count(input) != 0) {
+                local[input] = reference.at(input);
+            }
+        }
+        if (CanRun(node, local) && executor_.Run({index}, local)) {
+            layer.hasIsolated = Compare(node.name, local.at(ref), out, layer.isolated);
+        }
+    }
+
+    bool Compare(const std::string& name, const HostTensor& ref, const HostTensor& out,
+                 accuracy_check::Report& report) const {
+        if (ref.GetDataType() != ge::DT_FLOAT || ref.GetElementNum() != out.GetElementNum()) {
+            ALOGE("[LAYER_DUMP] %s: reference of %zu elements (type %d), NPU %zu.\n", name.c_str(),
+                  ref.GetElementNum(), ref.GetDataType(), out.GetElementNum());
+            return false;
+        }
+        accuracy_check::Checker checker(name, ref.GetDims(), options_.tolerance);
+        checker.Feed(ref.Data<float>(), out.Data<float>(), ref.GetElementNum());
+        checker.Finish(report);
+        return true;
+    }
+
+    bool WriteDump(const host_graph::TensorMap& npu) const {
+        npy_io::NpzWriter writer;
+        if (!writer.Open(options_.dumpPath, options_.compress)) {
+            return false;
+        }
+        bool ok = true;
+        for (const auto& ref : outputs_) {
+            const HostTensor& tensor = npu.at(ref);
+            ok = writer.Add(graph_.GetNode(ref.node).name, "<f4", tensor.GetDims(), tensor.GetData(),
+                            tensor.GetByteSize()) && ok;
+        }
+        return writer.Close() && ok;
+    }
+
+    host_graph::Graph graph_;
+    const host_graph::KernelRegistry& registry_;
+    host_graph::Executor executor_;
+    DumpOptions options_;
+    std::string modelName_;
+    std::vector<int> layers_;
+    std::vector<TensorRef> outputs_;
+    std::shared_ptr<hiai::AiModelMngerClient> client_;
+    std::vector<std::shared_ptr<hiai::AiTensor>> inputTensors_;
+    std::vector<std::shared_ptr<hiai::AiTensor>> outputTensors_;
+};
+
+inline void PrintResult(const DumpResult& result) {
+    ALOGI("[LAYER_DUMP] %zu layers, %.2f MB dumped: npu %.3f ms, reference %.3f ms, compare %.3f ms, "
+          "write wait %.3f ms\n", result.layers.size(), result.dumpBytes / 1048576.0, result.npuMs,
+          result.referenceMs, result.compareMs, result.writeWaitMs);
+    for (const auto& layer : result.layers) {
+        char chained[64] = "-";
+        char isolated[64] = "-";
+        if (layer.hasChained) {
+            snprintf(chained, sizeof(chained), "%s cos %.6f max %.3g", layer.chained.passed ? "ok  " : "FAIL",
+                     layer.chained.total.GetCosine(), layer.chained.total.maxAbs);
+        }
+        if (layer.hasIsolated) {
+            snprintf(isolated, sizeof(isolated), "%s cos %.6f max %.3g", layer.isolated.passed ? "ok  " : "FAIL",
+                     layer.isolated.total.GetCosine(), layer.isolated.total.maxAbs);
+        }
+        ALOGI("[LAYER_DUMP] %-32s %-24s chained %-34s isolated %-34s%s\n", layer.name.c_str(), layer.type.c_str(),
+              chained, isolated, layer.reanchored ? " (no host kernel)" : "");
+    }
+    if (result.firstChainedFailure >= 0) {
+        ALOGI("[LAYER_DUMP] outputs diverge from %s\n", result.layers[result.firstChainedFailure].name.c_str());
+    }
+    if (result.firstIsolatedFailure >= 0) {
+        const LayerResult& layer = result.layers[result.firstIsolatedFailure];
+        ALOGI("[LAYER_DUMP] first layer failing on its own inputs: %s(%s)\n", layer.name.c_str(), layer.type.c_str());
+        accuracy_check::PrintReport(layer.isolated);
+    }
+}
+}
+
+#endif //BUILD_IR_MODEL_LAYER_DUMP_H
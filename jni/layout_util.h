@@ -0,0 +1,501 @@
+#ifndef BUILD_IR_MODEL_LAYOUT_UTIL_H
+#define BUILD_IR_MODEL_LAYOUT_UTIL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "host_graph.h"
+#include "log_util.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// FP32 layout conversion between NCHW, NHWC, CHWN, HWCN and the channel-blocked NC1HWC0 (C0 = 16),
+// NC1HWC0_C04 / NC4HW4 (C0 = 4) and NC8HW8 (C0 = 8). Every format maps element (n, c, h, w) to
+//
+//     n * sN + (c / C0) * sC1 + (c % C0) * sC0 + h * sH + w * sW
+//
+// with C0 = 1 for the plain ones, so any pair is one strided copy of the logical [N, C, H, W] box. The channel
+// is split as c = ch * Cmax + cm * Cmin + cl for the larger and smaller C0 of the pair (4, 8 and 16 divide each
+// other), which keeps every sub-axis linear in both formats. StridedCopy walks the box in destination order and,
+// when the source-contiguous and destination-contiguous axes differ, transposes 32x32 cache blocks of those two
+// axes with 4x4 register shuffles. Padding channels of a blocked destination are zeroed.
+//
+//     layout_util::Shape4 shape;
+//     shape.n = 1; shape.c = 3; shape.h = 1080; shape.w = 1920;
+//     layout_util::Convert(camera.data(), ge::FORMAT_NHWC, static_cast<float*>(tensor->GetBuffer()),
+//                          ge::FORMAT_NCHW, shape);
+//
+// The graph helpers at the end decide when a Permute is needed at all, see ConvertFormat and SimplifyPermutes.
+namespace layout_util {
+const int64_t BLOCK = 32;
+const int64_t MIN_TASK_ELEMENTS = 1 << 14;
+
+struct Shape4 {
+    int64_t n = 1;
+    int64_t c = 1;
+    int64_t h = 1;
+    int64_t w = 1;
+};
+
+// Channel block of the packed formats, 1 for the plain ones and 0 for formats this file does not handle.
+inline int64_t GetC0(ge::Format format) {
+    switch (format) {
+        case ge::FORMAT_NCHW:
+        case ge::FORMAT_NHWC:
+        case ge::FORMAT_CHWN:
+        case ge::FORMAT_HWCN:
+            return 1;
+        case ge::FORMAT_NC1HWC0_C04:
+        case ge::FORMAT_NC4HW4:
+            return 4;
+        case ge::FORMAT_NC8HW8:
+            return 8;
+        case ge::FORMAT_NC1HWC0:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+// Position of N, C, H and W in the dims of a plain format, e.g. {0, 3, 1, 2} for NHWC.
+inline std::vector<int64_t> GetAxes(ge::Format format) {
+    switch (format) {
+        case ge::FORMAT_NHWC:
+            return {0, 3, 1, 2};
+        case ge::FORMAT_CHWN:
+            return {3, 0, 1, 2};
+        case ge::FORMAT_HWCN:
+            return {3, 2, 0, 1};
+        default:
+            return {0, 1, 2, 3};
+    }
+}
+
+// Dims of the buffer: the permuted [N, C, H, W] for plain formats, [N, C1, H, W, C0] for blocked ones.
+inline std::vector<int64_t> GetDims(ge::Format format, const Shape4& shape) {
+    int64_t c0 = GetC0(format);
+    if (c0 > 1) {
+        return {shape.n, (shape.c + c0 - 1) / c0, shape.h, shape.w, c0};
+    }
+    std::vector<int64_t> axes = GetAxes(format);
+    std::vector<int64_t> dims(4);
+    dims[axes[0]] = shape.n;
+    dims[axes[1]] = shape.c;
+    dims[axes[2]] = shape.h;
+    dims[axes[3]] = shape.w;
+    return dims;
+}
+
+// Elements of the buffer, including the zero padding of the last channel block.
+inline size_t GetElementNum(ge::Format format, const Shape4& shape) {
+    std::vector<int64_t> dims = GetDims(format, shape);
+    return static_cast<size_t>(std::accumulate(dims.begin(), dims.end(), int64_t(1), std::multiplies<int64_t>()));
+}
+
+namespace detail {
+// Element strides of n, c / C0, c % C0, h and w.
+struct Strides {
+    int64_t c0 = 1;
+    int64_t n = 0;
+    int64_t c1 = 0;
+    int64_t cBlock = 0;
+    int64_t h = 0;
+    int64_t w = 0;
+};
+
+inline Strides GetStrides(ge::Format format, const Shape4& shape) {
+    Strides s;
+    s.c0 = GetC0(format);
+    std::vector<int64_t> dims = GetDims(format, shape);
+    std::vector<int64_t> dense(dims.size(), 1);
+    for (size_t i = dims.size() - 1; i > 0; i--) {
+        dense[i - 1] = dense[i] * dims[i];
+    }
+    if (s.c0 > 1) {
+        s.n = dense[0];
+        s.c1 = dense[1];
+        s.h = dense[2];
+        s.w = dense[3];
+        s.cBlock = 1;
+        return s;
+    }
+    std::vector<int64_t> axes = GetAxes(format);
+    s.n = dense[axes[0]];
+    s.c1 = dense[axes[1]];
+    s.h = dense[axes[2]];
+    s.w = dense[axes[3]];
+    return s;
+}
+
+inline int64_t Offset(const Strides& s, int64_t c) {
+    return c / s.c0 * s.c1 + c % s.c0 * s.cBlock;
+}
+
+// Strides of ch, cm and cl in c = ch * cMax + cm * cMin + cl.
+inline void SplitChannel(const Strides& s, int64_t cMax, int64_t cMin, int64_t split[3]) {
+    if (s.c0 == 1) {
+        split[0] = s.c1 * cMax;
+        split[1] = s.c1 * cMin;
+        split[2] = s.c1;
+    } else if (s.c0 == cMax) {
+        split[0] = s.c1;
+        split[1] = s.cBlock * cMin;
+        split[2] = s.cBlock;
+    } else {
+        split[0] = s.c1 * (cMax / cMin);
+        split[1] = s.c1;
+        split[2] = s.cBlock;
+    }
+}
+
+// src rows i (stride srcStride) of 4 contiguous values -> dst rows j (stride dstStride) of 4 contiguous values.
+inline void Transpose4x4(const float* src, int64_t srcStride, float* dst, int64_t dstStride) {
+    using namespace simd_util;
+    Float4 r0 = Load4(src);
+    Float4 r1 = Load4(src + srcStride);
+    Float4 r2 = Load4(src + 2 * srcStride);
+    Float4 r3 = Load4(src + 3 * srcStride);
+    simd_util::Transpose4x4(r0, r1, r2, r3);
+    Store4(dst, r0);
+    Store4(dst + dstStride, r1);
+    Store4(dst + 2 * dstStride, r2);
+    Store4(dst + 3 * dstStride, r3);
+}
+
+// dst[j * dstJ + i * dstI] = src[i * srcI + j * srcJ] over a rows x cols block; the 4x4 path needs srcJ and
+// dstI to be 1. Fewer than 4 columns (interleaved RGB and the like) are split plane by plane so the stores stay
+// contiguous.
+inline void TransposeBlock(const float* src, int64_t srcI, int64_t srcJ, float* dst, int64_t dstI, int64_t dstJ,
+                           int64_t rows, int64_t cols) {
+    if (cols < 4 && dstI == 1) {
+        for (int64_t j = 0; j < cols; j++) {
+            const float* in = src + j * srcJ;
+            float* out = dst + j * dstJ;
+            for (int64_t i = 0; i < rows; i++) {
+                out[i] = in[i * srcI];
+            }
+        }
+        return;
+    }
+    int64_t i = 0;
+    if (srcJ == 1 && dstI == 1) {
+        for (; i + 4 <= rows; i += 4) {
+            int64_t j = 0;
+            for (; j + 4 <= cols; j += 4) {
+                Transpose4x4(src + i * srcI + j, srcI, dst + j * dstJ + i, dstJ);
+            }
+            for (; j < cols; j++) {
+                for (int64_t k = i; k < i + 4; k++) {
+                    dst[j * dstJ + k] = src[k * srcI + j];
+                }
+            }
+        }
+    }
+    for (; i < rows; i++) {
+        for (int64_t j = 0; j < cols; j++) {
+            dst[j * dstJ + i * dstI] = src[i * srcI + j * srcJ];
+        }
+    }
+}
+}
+
+// Copies the box `dims` from src to dst, both addressed with their own element strides per axis. Unit axes are
+// dropped and axes contiguous in both buffers merged; the box is then walked in destination order.
+inline void StridedCopy(const float* src, const std::vector<int64_t>& srcStrides, float* dst,
+                        const std::vector<int64_t>& dstStrides, const std::vector<int64_t>& dims, int threadNum = 0) {
+    std::vector<size_t> order(dims.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return dstStrides[a] > dstStrides[b]; });
+    std::vector<int64_t> d;
+    std::vector<int64_t> ss;
+    std::vector<int64_t> ds;
+    for (size_t axis : order) {
+        if (dims[axis] == 0) {
+            return;
+        }
+        if (dims[axis] == 1) {
+            continue;
+        }
+        if (!d.empty() && ss.back() == srcStrides[axis] * dims[axis] && ds.back() == dstStrides[axis] * dims[axis]) {
+            d.back() *= dims[axis];
+            ss.back() = srcStrides[axis];
+            ds.back() = dstStrides[axis];
+            continue;
+        }
+        d.push_back(dims[axis]);
+        ss.push_back(srcStrides[axis]);
+        ds.push_back(dstStrides[axis]);
+    }
+    if (d.empty()) {
+        *dst = *src;
+        return;
+    }
+    size_t b = d.size() - 1;  // destination-contiguous axis
+    size_t a = static_cast<size_t>(std::min_element(ss.begin(), ss.end()) - ss.begin());  // source-contiguous
+    if (ss[b] == ss[a]) {
+        a = b;
+    }
+    // outer axes: everything but a and b, decoded from a flat index; a row copy also keeps the next axis as an
+    // inner loop so short rows (a pixel's channels) do not pay for the decode each
+    std::vector<size_t> outerAxes;
+    for (size_t i = 0; i < d.size(); i++) {
+        if (i != a && i != b) {
+            outerAxes.push_back(i);
+        }
+    }
+    int64_t rowCount = 1;
+    int64_t rowSrcStride = 0;
+    int64_t rowDstStride = 0;
+    if (a == b && !outerAxes.empty()) {
+        rowCount = d[outerAxes.back()];
+        rowSrcStride = ss[outerAxes.back()];
+        rowDstStride = ds[outerAxes.back()];
+        outerAxes.pop_back();
+    }
+    int64_t outer = 1;
+    for (size_t axis : outerAxes) {
+        outer *= d[axis];
+    }
+    auto base = [&](int64_t index, int64_t& srcOffset, int64_t& dstOffset) {
+        srcOffset = 0;
+        dstOffset = 0;
+        for (size_t k = outerAxes.size(); k > 0; k--) {
+            size_t axis = outerAxes[k - 1];
+            int64_t coord = index % d[axis];
+            index /= d[axis];
+            srcOffset += coord * ss[axis];
+            dstOffset += coord * ds[axis];
+        }
+    };
+    if (a == b) {
+        int64_t len = d[b];
+        parallel_util::ParallelFor(0, static_cast<size_t>(outer), [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                int64_t srcOffset = 0;
+                int64_t dstOffset = 0;
+                base(static_cast<int64_t>(t), srcOffset, dstOffset);
+                for (int64_t r = 0; r < rowCount; r++) {
+                    const float* in = src + srcOffset + r * rowSrcStride;
+                    float* out = dst + dstOffset + r * rowDstStride;
+                    if (ss[b] == 1 && ds[b] == 1) {
+                        std::memcpy(out, in, static_cast<size_t>(len) * sizeof(float));
+                        continue;
+                    }
+                    for (int64_t i = 0; i < len; i++) {
+                        out[i * ds[b]] = in[i * ss[b]];
+                    }
+                }
+            }
+        }, threadNum, static_cast<size_t>(std::max<int64_t>(1, MIN_TASK_ELEMENTS / (len * rowCount))));
+        return;
+    }
+    // i runs along b (contiguous in dst), j along a (contiguous in src); one task per BLOCK rows of i
+    int64_t rowBlocks = (d[b] + BLOCK - 1) / BLOCK;
+    parallel_util::ParallelFor(0, static_cast<size_t>(outer * rowBlocks), [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            int64_t srcOffset = 0;
+            int64_t dstOffset = 0;
+            base(static_cast<int64_t>(t) / rowBlocks, srcOffset, dstOffset);
+            int64_t i0 = static_cast<int64_t>(t) % rowBlocks * BLOCK;
+            int64_t rows = std::min(BLOCK, d[b] - i0);
+            for (int64_t j0 = 0; j0 < d[a]; j0 += BLOCK) {
+                detail::TransposeBlock(src + srcOffset + i0 * ss[b] + j0 * ss[a], ss[b], ss[a],
+                                       dst + dstOffset + i0 * ds[b] + j0 * ds[a], ds[b], ds[a], rows,
+                                       std::min(BLOCK, d[a] - j0));
+            }
+        }
+    }, threadNum, static_cast<size_t>(std::max<int64_t>(1, MIN_TASK_ELEMENTS / (BLOCK * d[a]))));
+}
+
+// y = x with its dims reordered, y.dims[i] = x.dims[order[i]].
+inline void Permute(const float* x, const std::vector<int64_t>& dims, const std::vector<int64_t>& order, float* y,
+                    int threadNum = 0) {
+    std::vector<int64_t> xStrides(dims.size(), 1);
+    for (size_t i = dims.size(); i > 1; i--) {
+        xStrides[i - 2] = xStrides[i - 1] * dims[i - 1];
+    }
+    std::vector<int64_t> yDims(dims.size());
+    std::vector<int64_t> srcStrides(dims.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        yDims[i] = dims[order[i]];
+        srcStrides[i] = xStrides[order[i]];
+    }
+    std::vector<int64_t> yStrides(dims.size(), 1);
+    for (size_t i = dims.size(); i > 1; i--) {
+        yStrides[i - 2] = yStrides[i - 1] * yDims[i - 1];
+    }
+    StridedCopy(x, srcStrides, y, yStrides, yDims, threadNum);
+}
+
+// Converts x in format `from` to y in format `to`; y holds GetElementNum(to, shape) floats. False for formats
+// GetC0 does not know.
+inline bool Convert(const float* x, ge::Format from, float* y, ge::Format to, const Shape4& shape, int threadNum = 0) {
+    if (GetC0(from) == 0 || GetC0(to) == 0) {
+        ALOGE("[LAYOUT] can not convert format %d to %d.\n", static_cast<int>(from), static_cast<int>(to));
+        return false;
+    }
+    detail::Strides dst = detail::GetStrides(to, shape);
+    // zero padding of the last destination block
+    auto zeroPadding = [&]() {
+        int64_t paddedChannels = (shape.c + dst.c0 - 1) / dst.c0 * dst.c0;
+        const float zero = 0.0f;
+        StridedCopy(&zero, {0, 0, 0, 0}, y + detail::Offset(dst, shape.c), {dst.n, dst.cBlock, dst.h, dst.w},
+                    {shape.n, paddedChannels - shape.c, shape.h, shape.w}, threadNum);
+    };
+    if (from == to || (GetC0(from) == GetC0(to) && GetC0(from) > 1)) {
+        // the copy carries the source padding along
+        std::memcpy(y, x, GetElementNum(to, shape) * sizeof(float));
+        zeroPadding();
+        return true;
+    }
+    detail::Strides src = detail::GetStrides(from, shape);
+    int64_t cMax = std::max(src.c0, dst.c0);
+    int64_t cMin = std::min(src.c0, dst.c0);
+    int64_t srcSplit[3];
+    int64_t dstSplit[3];
+    detail::SplitChannel(src, cMax, cMin, srcSplit);
+    detail::SplitChannel(dst, cMax, cMin, dstSplit);
+    // whole Cmax blocks, then the whole Cmin blocks and the single channels left over; each range is a box in
+    // both layouts
+    auto copyChannels = [&](int64_t c, int64_t ch, int64_t cm, int64_t cl) {
+        StridedCopy(x + detail::Offset(src, c), {src.n, srcSplit[0], srcSplit[1], srcSplit[2], src.h, src.w},
+                    y + detail::Offset(dst, c), {dst.n, dstSplit[0], dstSplit[1], dstSplit[2], dst.h, dst.w},
+                    {shape.n, ch, cm, cl, shape.h, shape.w}, threadNum);
+    };
+    int64_t c = shape.c / cMax * cMax;
+    copyChannels(0, shape.c / cMax, cMax / cMin, cMin);
+    copyChannels(c, 1, (shape.c - c) / cMin, cMin);
+    c += (shape.c - c) / cMin * cMin;
+    copyChannels(c, 1, 1, shape.c - c);
+    zeroPadding();
+    return true;
+}
+
+// Permute order turning a tensor of plain format `from` into `to`; false when either one is blocked.
+inline bool GetPermuteOrder(ge::Format from, ge::Format to, std::vector<int64_t>& order) {
+    if (GetC0(from) != 1 || GetC0(to) != 1) {
+        return false;
+    }
+    std::vector<int64_t> fromAxes = GetAxes(from);
+    std::vector<int64_t> toAxes = GetAxes(to);
+    order.assign(4, 0);
+    for (size_t logical = 0; logical < 4; logical++) {
+        order[toAxes[logical]] = fromAxes[logical];
+    }
+    return true;
+}
+
+// True when the permutation only moves unit axes, so the data is already in the permuted order and a Reshape
+// would do, e.g. NHWC -> NCHW of a single-channel frame.
+inline bool KeepsDataOrder(const std::vector<int64_t>& dims, const std::vector<int64_t>& order) {
+    int64_t last = -1;
+    for (int64_t axis : order) {
+        if (axis < 0 || axis >= static_cast<int64_t>(dims.size())) {
+            return false;
+        }
+        if (dims[axis] == 1) {
+            continue;
+        }
+        if (axis < last) {
+            return false;
+        }
+        last = axis;
+    }
+    return true;
+}
+
+// Returns the tensor to consume instead of x in format `from` when the graph works in `to`: x itself when the
+// formats match, a Reshape when x has a known shape and the permutation only moves unit axes, a Permute
+// otherwise.
+inline host_graph::TensorRef ConvertFormat(host_graph::Graph& graph, const host_graph::TensorRef& x,
+                                           ge::Format from, ge::Format to, const std::string& name) {
+    std::vector<int64_t> order;
+    if (from == to || !GetPermuteOrder(from, to, order)) {
+        if (from != to) {
+            ALOGE("[LAYOUT] %s: no Permute from format %d to %d.\n", name.c_str(), static_cast<int>(from),
+                  static_cast<int>(to));
+        }
+        return x;
+    }
+    if (graph.HasOutputDesc(x)) {
+        std::vector<int64_t> dims = graph.GetNode(x.node).outputDescs[x.index].GetShape().GetDims();
+        if (dims.size() == order.size() && KeepsDataOrder(dims, order)) {
+            std::vector<int32_t> shape;
+            for (int64_t axis : order) {
+                shape.push_back(static_cast<int32_t>(dims[axis]));
+            }
+            auto shapeRef = graph.AddConst(name + "_shape", ge::TensorDesc(ge::Shape({4}), ge::FORMAT_NCHW,
+                                           ge::DT_INT32), shape.data(), shape.size() * sizeof(int32_t));
+            return graph.AddNode(hiai::op::Reshape(name), "Reshape").Input("x", x).Input("shape", shapeRef).Output();
+        }
+    }
+    return graph.AddNode(hiai::op::Permute(name), "Permute").Input("x", x).Attr("order", order).Output();
+}
+
+// Folds Permute -> Permute into one Permute of the first one's input and bypasses a Permute whose order is
+// the identity, consumers and graph outputs then read its input. Bypassed and folded-away nodes stay in the
+// node list but are no longer reachable from the outputs. Returns the number of Permutes removed from the path.
+inline int SimplifyPermutes(host_graph::Graph& graph) {
+    using host_graph::TensorRef;
+    std::vector<host_graph::Node>& nodes = graph.MutableNodes();
+    int removed = 0;
+    for (size_t index = 0; index < nodes.size(); index++) {
+        host_graph::Node& node = nodes[index];
+        if (node.type != "Permute" || node.inputs.empty()) {
+            continue;
+        }
+        std::vector<int64_t> order = node.GetInts("order", {0});
+        const host_graph::Node& producer = nodes[node.inputs[0].node];
+        if (producer.type == "Permute" && node.inputs[0].index == 0 && !producer.inputs.empty()) {
+            std::vector<int64_t> first = producer.GetInts("order", {0});
+            if (first.size() == order.size()) {
+                for (auto& axis : order) {
+                    axis = first[axis];
+                }
+                TensorRef source = producer.inputs[0];
+                node.inputs[0] = source;
+                host_graph::Connect(node, node.inputNames[0], nodes[source.node], source.index);
+                node.op.SetAttr("order", ge::AttrValue::CreateFrom<ge::AttrValue::LIST_INT>(order));
+                node.attrs["order"].ints = order;
+                removed++;
+            }
+        }
+        bool identity = true;
+        for (size_t i = 0; i < order.size(); i++) {
+            identity = identity && order[i] == static_cast<int64_t>(i);
+        }
+        if (!identity) {
+            continue;
+        }
+        TensorRef self;
+        self.node = static_cast<int>(index);
+        TensorRef source = node.inputs[0];
+        for (auto& consumer : nodes) {
+            for (size_t i = 0; i < consumer.inputs.size(); i++) {
+                if (consumer.inputs[i].node == self.node && consumer.inputs[i].index == 0) {
+                    consumer.inputs[i] = source;
+                    host_graph::Connect(consumer, consumer.inputNames[i], nodes[source.node], source.index);
+                }
+            }
+        }
+        std::vector<TensorRef> outputs = graph.GetOutputs();
+        for (auto& output : outputs) {
+            if (output.node == self.node && output.index == 0) {
+                output = source;
+            }
+        }
+        graph.SetOutputs(outputs);
+        removed++;
+    }
+    if (removed > 0) {
+        ALOGI("[LAYOUT] %d Permute nodes folded or bypassed.\n", removed);
+    }
+    return removed;
+}
+}
+
+#endif //BUILD_IR_MODEL_LAYOUT_UTIL_H
@@ -0,0 +1,24 @@
+#ifndef BUILD_IR_MODEL_LOG_UTIL_H
+#define BUILD_IR_MODEL_LOG_UTIL_H
+
+#include <cstdio>
+
+#define LOG_TAG "NNN_TEST"
+
+#ifdef __ANDROID__
+#include <android/log.h>
+
+#define ALOGE(...) \
+    __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__); \
+    printf(__VA_ARGS__)
+
+#define ALOGI(...) \
+    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__); \
+    printf(__VA_ARGS__)
+#else
+// host builds of the host_* utilities only print
+#define ALOGE(...) printf(__VA_ARGS__)
+#define ALOGI(...) printf(__VA_ARGS__)
+#endif
+
+#endif //BUILD_IR_MODEL_LOG_UTIL_H
@@ -0,0 +1,105 @@
+#ifndef BUILD_IR_MODEL_MAPPED_FILE_H
+#define BUILD_IR_MODEL_MAPPED_FILE_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "log_util.h"
+
+// Read-only mmapped files and CRC-32, shared by the om and irpb loaders.
+namespace om_model {
+// CRC-32 (IEEE), hardware accelerated when the CPU has the ARMv8 CRC extension.
+inline uint32_t Crc32(const void* data, size_t size, uint32_t crc = 0) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#if defined(__ARM_FEATURE_CRC32)
+    for (; size >= 8; size -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        crc = __crc32d(crc, v);
+    }
+    for (; size > 0; size--, p++) {
+        crc = __crc32b(crc, *p);
+    }
+#else
+    static const std::array<uint32_t, 256> table = []() {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    for (; size > 0; size--, p++) {
+        crc = table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+    }
+#endif
+    return ~crc;
+}
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+        }
+    }
+
+    // randomAccess: the file is read at scattered offsets (embedding tables), so the kernel should neither read
+    // it ahead nor load it up front; by default it is read front to back once.
+    bool Open(const std::string& path, bool randomAccess = false) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            ALOGE("[MAPPED_FILE] open %s failed.\n", path.c_str());
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ALOGE("[MAPPED_FILE] %s is empty.\n", path.c_str());
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            ALOGE("[MAPPED_FILE] mmap %s failed.\n", path.c_str());
+            return false;
+        }
+        // advice values are not flags, each one takes its own call
+        if (randomAccess) {
+            madvise(data, st.st_size, MADV_RANDOM);
+        } else {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+            madvise(data, st.st_size, MADV_WILLNEED);
+        }
+        data_ = data;
+        size_ = static_cast<size_t>(st.st_size);
+        return true;
+    }
+
+    const void* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+
+private:
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
+}
+
+#endif //BUILD_IR_MODEL_MAPPED_FILE_H
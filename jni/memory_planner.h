@@ -0,0 +1,235 @@
+#ifndef BUILD_IR_MODEL_MEMORY_PLANNER_H
+#define BUILD_IR_MODEL_MEMORY_PLANNER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "host_executor.h"
+#include "host_graph.h"
+#include "log_util.h"
+
+// Static memory planning for the intermediate activations of the host executor. Lifetimes come from the node
+// order (producer step to last consumer step), every tensor gets an offset into one arena with greedy-by-size
+// best fit placement, and the output of an elementwise op reuses its input buffer when that input dies there.
+// Shapes have to be known, run shape_inference::InferShapes first:
+//
+//     memory_planner::MemoryPlan plan;
+//     memory_planner::PlanMemory(graph, memory_planner::PlanOptions(), plan);
+//     memory_planner::Arena arena(plan);
+//     executor.Run(inputs, outputs, arena.Bind(plan, graph));
+//
+// Data, Const and graph outputs are not planned: inputs and weights are owned by the caller, graph outputs
+// escape the run. Tensors whose size is unknown are left to the kernels.
+namespace memory_planner {
+using host_graph::Graph;
+using host_graph::HostTensor;
+using host_graph::Node;
+using host_graph::TensorRef;
+
+struct TensorUsage {
+    TensorRef ref;
+    size_t bytes = 0;
+    int first = 0;       // step of the producer
+    int last = 0;        // step of the last consumer
+    int inPlaceOf = -1;  // index of the usage whose buffer this one takes over
+    size_t offset = 0;
+};
+
+struct MemoryPlan {
+    std::vector<TensorUsage> tensors;
+    size_t arenaBytes = 0;
+    // one buffer per tensor
+    size_t naiveBytes = 0;
+    // largest sum of simultaneously live tensors, no placement can beat it
+    size_t lowerBoundBytes = 0;
+    int inPlaceNum = 0;
+};
+
+struct PlanOptions {
+    size_t alignment = 64;
+    // kernels whose output may alias their first input, they read each element before writing it
+    std::set<std::string> inPlaceTypes{"Activation", "Sqrt", "FakeQuantWithMinMaxVarsPerChannel", "Softmax",
+                                       "LogSoftmax", "L2Normalize", "LayerNorm"};
+};
+
+inline size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Assigns offsets to `tensors`, which only need bytes/first/last/inPlaceOf set; returns the arena size.
+// Aliased tensors are merged into one buffer spanning the union of their lifetimes. Buffers are placed from
+// the largest down, each into the smallest gap between already placed buffers with overlapping lifetimes.
+inline size_t AssignOffsets(std::vector<TensorUsage>& tensors, size_t alignment) {
+    struct Buffer {
+        size_t bytes = 0;
+        int first = 0;
+        int last = 0;
+        size_t offset = 0;
+    };
+    std::vector<int> owner(tensors.size());
+    std::vector<Buffer> buffers;
+    for (size_t i = 0; i < tensors.size(); i++) {
+        const TensorUsage& tensor = tensors[i];
+        if (tensor.inPlaceOf >= 0) {
+            owner[i] = owner[tensor.inPlaceOf];
+            Buffer& buffer = buffers[owner[i]];
+            buffer.bytes = std::max(buffer.bytes, AlignUp(tensor.bytes, alignment));
+            buffer.first = std::min(buffer.first, tensor.first);
+            buffer.last = std::max(buffer.last, tensor.last);
+            continue;
+        }
+        owner[i] = static_cast<int>(buffers.size());
+        Buffer buffer;
+        buffer.bytes = AlignUp(tensor.bytes, alignment);
+        buffer.first = tensor.first;
+        buffer.last = tensor.last;
+        buffers.push_back(buffer);
+    }
+
+    std::vector<int> order(buffers.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&buffers](int a, int b) {
+        return buffers[a].bytes > buffers[b].bytes;
+    });
+    // placed buffers sorted by offset
+    std::vector<int> placed;
+    size_t arenaBytes = 0;
+    for (int index : order) {
+        Buffer& buffer = buffers[index];
+        size_t bestOffset = SIZE_MAX;
+        size_t bestGap = SIZE_MAX;
+        size_t cursor = 0;
+        for (int other : placed) {
+            const Buffer& p = buffers[other];
+            if (p.last < buffer.first || buffer.last < p.first) {
+                continue;
+            }
+            if (p.offset >= cursor + buffer.bytes && p.offset - cursor < bestGap) {
+                bestGap = p.offset - cursor;
+                bestOffset = cursor;
+            }
+            cursor = std::max(cursor, p.offset + p.bytes);
+        }
+        buffer.offset = bestOffset != SIZE_MAX ? bestOffset : cursor;
+        arenaBytes = std::max(arenaBytes, buffer.offset + buffer.bytes);
+        placed.insert(std::upper_bound(placed.begin(), placed.end(), index, [&buffers](int a, int b) {
+            return buffers[a].offset < buffers[b].offset;
+        }), index);
+    }
+    for (size_t i = 0; i < tensors.size(); i++) {
+        tensors[i].offset = buffers[owner[i]].offset;
+    }
+    return arenaBytes;
+}
+
+// Plans the outputs of `nodes` (all nodes by default), which are run in the given order.
+inline bool PlanMemory(const Graph& graph, const PlanOptions& options, MemoryPlan& plan,
+                       const std::vector<int>& nodes = {}) {
+    plan = MemoryPlan();
+    std::vector<int> steps = nodes;
+    if (steps.empty()) {
+        for (size_t i = 0; i < graph.GetNodes().size(); i++) {
+            steps.push_back(static_cast<int>(i));
+        }
+    }
+    std::set<TensorRef> escaping(graph.GetOutputs().begin(), graph.GetOutputs().end());
+    std::map<TensorRef, int> usageOf;
+    for (size_t step = 0; step < steps.size(); step++) {
+        const Node& node = graph.GetNode(steps[step]);
+        for (const auto& input : node.inputs) {
+            auto it = usageOf.find(input);
+            if (it != usageOf.end()) {
+                plan.tensors[it->second].last = static_cast<int>(step);
+            }
+        }
+        if (node.type == "Data" || node.type == "Const") {
+            continue;
+        }
+        for (size_t i = 0; i < node.outputDescs.size(); i++) {
+            TensorRef ref = host_graph::Executor::Ref(steps[step], static_cast<int>(i));
+            const ge::TensorDesc& desc = node.outputDescs[i];
+            std::vector<int64_t> dims = host_graph::GetDescDims(desc);
+            if (escaping.count(ref) != 0 || std::any_of(dims.begin(), dims.end(), [](int64_t d) { return d < 0; })) {
+                continue;
+            }
+            TensorUsage usage;
+            usage.ref = ref;
+            usage.bytes = HostTensor::GetElementNum(dims) * host_graph::GetDataTypeSize(desc.GetDataType());
+            usage.first = usage.last = static_cast<int>(step);
+            usageOf[ref] = static_cast<int>(plan.tensors.size());
+            plan.tensors.push_back(usage);
+        }
+    }
+
+    // In place: the first input of an elementwise op dies at that op and has the output's size. Chains such as
+    // conv -> relu -> sqrt collapse into one buffer.
+    for (size_t t = 0; t < plan.tensors.size(); t++) {
+        TensorUsage& tensor = plan.tensors[t];
+        const Node& node = graph.GetNode(tensor.ref.node);
+        if (tensor.ref.index != 0 || node.inputs.empty() || options.inPlaceTypes.count(node.type) == 0) {
+            continue;
+        }
+        auto it = usageOf.find(node.inputs[0]);
+        if (it == usageOf.end()) {
+            continue;
+        }
+        const TensorUsage& input = plan.tensors[it->second];
+        if (input.last == tensor.first && input.bytes == tensor.bytes &&
+            std::count(node.inputs.begin(), node.inputs.end(), node.inputs[0]) == 1) {
+            tensor.inPlaceOf = it->second;
+            plan.inPlaceNum++;
+        }
+    }
+
+    std::vector<size_t> live(steps.size() + 1, 0);
+    for (const auto& tensor : plan.tensors) {
+        plan.naiveBytes += tensor.bytes;
+        for (int step = tensor.first; step <= tensor.last; step++) {
+            // an in-place output starts where its input ends, count the shared step once
+            if (tensor.inPlaceOf < 0 || step != tensor.first) {
+                live[step] += tensor.bytes;
+            }
+        }
+    }
+    plan.lowerBoundBytes = *std::max_element(live.begin(), live.end());
+    plan.arenaBytes = AssignOffsets(plan.tensors, options.alignment);
+    return true;
+}
+
+inline void PrintPlan(const MemoryPlan& plan) {
+    ALOGI("[MEMORY_PLAN] %zu tensors, %d in place: arena %.2f MB, naive %.2f MB (%.1fx), live lower bound %.2f MB\n",
+          plan.tensors.size(), plan.inPlaceNum, plan.arenaBytes / 1048576.0, plan.naiveBytes / 1048576.0,
+          plan.arenaBytes > 0 ? static_cast<double>(plan.naiveBytes) / plan.arenaBytes : 0.0,
+          plan.lowerBoundBytes / 1048576.0);
+}
+
+// Backing storage of a plan. Bind() returns the planned tensors as views for Executor::Run.
+class Arena {
+public:
+    explicit Arena(const MemoryPlan& plan) : storage_(std::make_shared<std::vector<uint8_t>>(plan.arenaBytes)) {}
+
+    host_graph::TensorMap Bind(const MemoryPlan& plan, const Graph& graph) const {
+        host_graph::TensorMap tensors;
+        for (const auto& tensor : plan.tensors) {
+            const ge::TensorDesc& desc = graph.GetNode(tensor.ref.node).outputDescs[tensor.ref.index];
+            tensors[tensor.ref] = HostTensor::View(storage_->data() + tensor.offset, host_graph::GetDescDims(desc),
+                                                   desc.GetDataType(), storage_);
+        }
+        return tensors;
+    }
+
+    size_t GetByteSize() const { return storage_->size(); }
+
+private:
+    std::shared_ptr<std::vector<uint8_t>> storage_;
+};
+}
+
+#endif //BUILD_IR_MODEL_MEMORY_PLANNER_H
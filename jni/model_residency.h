@@ -0,0 +1,459 @@
+#ifndef BUILD_IR_MODEL_MODEL_RESIDENCY_H
+#define BUILD_IR_MODEL_MODEL_RESIDENCY_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HiAiModelManagerService.h"
+#include "log_util.h"
+
+// Lazy loading with LRU residency for bundles that do not fit on the NPU at once. Models are registered up
+// front, loaded on their first Process() and unloaded least-recently-used first whenever the resident set
+// would exceed the device memory budget. Prefetch() loads models that are known to come next in the
+// background.
+//
+// The manager only talks to a ModelBackend, so the policy can be exercised on a Linux host with
+// SimulatedModelBackend (see bench_model_residency.cpp); HiaiModelBackend is the device implementation.
+namespace model_residency {
+using VecAiTensor = std::vector<std::shared_ptr<hiai::AiTensor>>;
+
+class ModelBackend {
+public:
+    virtual ~ModelBackend() = default;
+    // Loads the model and reports the device memory it holds.
+    virtual bool Load(const std::string& name, const std::string& path, size_t* deviceBytes) = 0;
+    virtual bool Unload(const std::string& name) = 0;
+    virtual bool Process(const std::string& name, VecAiTensor& inputs, VecAiTensor& outputs) = 0;
+    // IO tensors stay valid across unload/reload, they are created on the first load.
+    virtual bool GetTensors(const std::string& name, VecAiTensor* inputs, VecAiTensor* outputs) = 0;
+};
+
+// One AiModelMngerClient per model: UnLoadModel() drops every model of a client, so this is the only way
+// to evict a single model. Device memory is estimated as om size + IO tensor sizes. The prefetch thread loads
+// while the caller runs other models, so models_ is only touched under mutex_; the device calls themselves run
+// outside it.
+class HiaiModelBackend : public ModelBackend {
+public:
+    bool Load(const std::string& name, const std::string& path, size_t* deviceBytes) override {
+        auto client = std::make_shared<hiai::AiModelMngerClient>();
+        if (client->Init(nullptr) != hiai::AI_SUCCESS) {
+            ALOGE("[RESIDENCY] %s: client init failed.\n", name.c_str());
+            return false;
+        }
+        auto builder = std::make_shared<hiai::AiModelBuilder>(client);
+        hiai::MemBuffer* buffer = builder->InputMemBufferCreate(path);
+        if (buffer == nullptr) {
+            ALOGE("[RESIDENCY] %s: cannot read %s.\n", name.c_str(), path.c_str());
+            return false;
+        }
+        auto desc = std::make_shared<hiai::AiModelDescription>(name + ".om",
+                                                               hiai::AiModelDescription_Frequency_HIGH,
+                                                               hiai::HIAI_FRAMEWORK_NONE,
+                                                               hiai::HIAI_MODELTYPE_ONLINE,
+                                                               hiai::AiModelDescription_DeviceType_NPU);
+        desc->SetModelBuffer(buffer->GetMemBufferData(), buffer->GetMemBufferSize());
+        std::vector<std::shared_ptr<hiai::AiModelDescription>> modelDescs{desc};
+        size_t modelBytes = buffer->GetMemBufferSize();
+        int ret = client->Load(modelDescs);
+        builder->MemBufferDestroy(buffer);
+        if (ret != hiai::AI_SUCCESS) {
+            ALOGE("[RESIDENCY] %s: load failed, ret=%d.\n", name.c_str(), ret);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        Model& model = models_[name];
+        if (model.inputs.empty() && !CreateTensors(client, name, model)) {
+            client->UnLoadModel();
+            return false;
+        }
+        model.client = client;
+        *deviceBytes = modelBytes + model.ioBytes;
+        return true;
+    }
+
+    bool Unload(const std::string& name) override {
+        std::shared_ptr<hiai::AiModelMngerClient> client;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = models_.find(name);
+            if (it == models_.end() || it->second.client == nullptr) {
+                return false;
+            }
+            client.swap(it->second.client);
+        }
+        return client->UnLoadModel() == hiai::AI_SUCCESS;
+    }
+
+    bool Process(const std::string& name, VecAiTensor& inputs, VecAiTensor& outputs) override {
+        std::shared_ptr<hiai::AiModelMngerClient> client;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = models_.find(name);
+            if (it == models_.end() || it->second.client == nullptr) {
+                return false;
+            }
+            client = it->second.client;
+        }
+        hiai::AiContext context;
+        context.AddPara("model_name", name + ".om");
+        int istamp;
+        return client->Process(context, inputs, outputs, 1000, istamp) == hiai::AI_SUCCESS;
+    }
+
+    bool GetTensors(const std::string& name, VecAiTensor* inputs, VecAiTensor* outputs) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = models_.find(name);
+        if (it == models_.end() || it->second.inputs.empty()) {
+            return false;
+        }
+        *inputs = it->second.inputs;
+        *outputs = it->second.outputs;
+        return true;
+    }
+
+private:
+    struct Model {
+        std::shared_ptr<hiai::AiModelMngerClient> client;
+        VecAiTensor inputs;
+        VecAiTensor outputs;
+        size_t ioBytes = 0;
+    };
+
+    bool CreateTensors(const std::shared_ptr<hiai::AiModelMngerClient>& client, const std::string& name,
+                       Model& model) {
+        std::vector<hiai::TensorDimension> inputDims;
+        std::vector<hiai::TensorDimension> outputDims;
+        if (client->GetModelIOTensorDim(name + ".om", inputDims, outputDims) != hiai::AI_SUCCESS) {
+            ALOGE("[RESIDENCY] %s: get IO tensor dims failed.\n", name.c_str());
+            return false;
+        }
+        for (auto& dim : inputDims) {
+            auto tensor = std::make_shared<hiai::AiTensor>();
+            tensor->Init(&dim);
+            model.ioBytes += tensor->GetSize();
+            model.inputs.push_back(tensor);
+        }
+        for (auto& dim : outputDims) {
+            auto tensor = std::make_shared<hiai::AiTensor>();
+            tensor->Init(&dim);
+            model.ioBytes += tensor->GetSize();
+            model.outputs.push_back(tensor);
+        }
+        return true;
+    }
+
+    std::map<std::string, Model> models_;
+    std::mutex mutex_;
+};
+
+// Host stand-in for the model service: "loading" sleeps for a time proportional to the model size.
+class SimulatedModelBackend : public ModelBackend {
+public:
+    explicit SimulatedModelBackend(double loadMsPerMB = 10.0, double processMs = 1.0)
+        : loadMsPerMB_(loadMsPerMB), processMs_(processMs) {}
+
+    void SetModelSize(const std::string& path, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sizes_[path] = bytes;
+    }
+
+    bool Load(const std::string& name, const std::string& path, size_t* deviceBytes) override {
+        size_t bytes = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = sizes_.find(path);
+            if (it != sizes_.end()) {
+                bytes = it->second;
+            }
+        }
+        SleepMs(loadMsPerMB_ * bytes / (1024.0 * 1024.0));
+        std::lock_guard<std::mutex> lock(mutex_);
+        loaded_[name] = true;
+        loadCount_++;
+        *deviceBytes = bytes;
+        return true;
+    }
+
+    bool Unload(const std::string& name) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loaded_[name] = false;
+        return true;
+    }
+
+    bool Process(const std::string& name, VecAiTensor&, VecAiTensor&) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!loaded_[name]) {
+                ALOGE("[RESIDENCY] simulated Process on unloaded model %s.\n", name.c_str());
+                return false;
+            }
+        }
+        SleepMs(processMs_);
+        return true;
+    }
+
+    bool GetTensors(const std::string&, VecAiTensor* inputs, VecAiTensor* outputs) override {
+        inputs->clear();
+        outputs->clear();
+        return true;
+    }
+
+    int GetLoadCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return loadCount_;
+    }
+
+private:
+    static void SleepMs(double ms) {
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(ms * 1000)));
+    }
+
+    double loadMsPerMB_;
+    double processMs_;
+    std::map<std::string, size_t> sizes_;
+    std::map<std::string, bool> loaded_;
+    std::mutex mutex_;
+    int loadCount_ = 0;
+};
+
+struct ResidencyStats {
+    int hits = 0;
+    int misses = 0;
+    int prefetches = 0;
+    int evictions = 0;
+    double loadMs = 0;      // total time spent in backend Load
+    double stallMs = 0;     // time Process() waited for a model to become resident
+    size_t residentBytes = 0;
+    size_t peakBytes = 0;
+};
+
+class ResidencyManager {
+public:
+    ResidencyManager(const std::shared_ptr<ModelBackend>& backend, size_t budgetBytes)
+        : backend_(backend), budgetBytes_(budgetBytes) {
+        prefetchThread_ = std::thread([this]() { PrefetchLoop(); });
+    }
+
+    ~ResidencyManager() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cond_.notify_all();
+        prefetchThread_.join();
+        for (auto& entry : models_) {
+            if (entry.second.state == RESIDENT) {
+                backend_->Unload(entry.first);
+            }
+        }
+    }
+
+    void Register(const std::string& name, const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        models_[name].path = path;
+    }
+
+    void SetBudget(size_t budgetBytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        budgetBytes_ = budgetBytes;
+        EvictFor(0, "", lock);
+    }
+
+    // Loads the model if needed, then runs it. The model can not be evicted while it runs.
+    bool Process(const std::string& name, VecAiTensor& inputs, VecAiTensor& outputs) {
+        if (!Acquire(name)) {
+            return false;
+        }
+        bool ret = backend_->Process(name, inputs, outputs);
+        std::lock_guard<std::mutex> lock(mutex_);
+        models_[name].inUse--;
+        return ret;
+    }
+
+    bool GetTensors(const std::string& name, VecAiTensor* inputs, VecAiTensor* outputs) {
+        if (!backend_->GetTensors(name, inputs, outputs)) {
+            // tensors are created by the first load
+            if (!Acquire(name)) {
+                return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                models_[name].inUse--;
+            }
+            return backend_->GetTensors(name, inputs, outputs);
+        }
+        return true;
+    }
+
+    // Hint that these models are about to be used; they are loaded in the background in the given order.
+    void Prefetch(const std::vector<std::string>& names) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& name : names) {
+                if (models_.count(name) != 0 && models_[name].state == NOT_LOADED) {
+                    prefetchQueue_.push_back(name);
+                }
+            }
+        }
+        cond_.notify_all();
+    }
+
+    bool IsResident(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return models_.count(name) != 0 && models_[name].state == RESIDENT;
+    }
+
+    ResidencyStats GetStats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void PrintStats() {
+        ResidencyStats stats = GetStats();
+        ALOGI("[RESIDENCY] hits %d, misses %d, prefetches %d, evictions %d, load %.3f ms, stall %.3f ms, "
+              "resident %.2f MB, peak %.2f MB, budget %.2f MB\n", stats.hits, stats.misses, stats.prefetches,
+              stats.evictions, stats.loadMs, stats.stallMs, stats.residentBytes / 1048576.0,
+              stats.peakBytes / 1048576.0, budgetBytes_ / 1048576.0);
+    }
+
+private:
+    enum State { NOT_LOADED, LOADING, RESIDENT };
+
+    struct Model {
+        std::string path;
+        State state = NOT_LOADED;
+        size_t bytes = 0;
+        int inUse = 0;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    static double NowMs() {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Makes the model resident and pins it (inUse++).
+    bool Acquire(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = models_.find(name);
+        if (it == models_.end()) {
+            ALOGE("[RESIDENCY] model %s is not registered.\n", name.c_str());
+            return false;
+        }
+        Model& model = it->second;
+        double start = NowMs();
+        if (model.state == RESIDENT) {
+            stats_.hits++;
+        } else {
+            stats_.misses++;
+            // a model loaded by the prefetcher can be evicted again before we get the lock back
+            while (model.state != RESIDENT) {
+                if (model.state == LOADING) {
+                    cond_.wait(lock);
+                } else if (!LoadLocked(name, lock)) {
+                    return false;
+                }
+            }
+            stats_.stallMs += NowMs() - start;
+        }
+        model.inUse++;
+        lru_.erase(model.lruPos);
+        lru_.push_front(name);
+        model.lruPos = lru_.begin();
+        return true;
+    }
+
+    // Called with the lock held; the lock is released during the backend load.
+    bool LoadLocked(const std::string& name, std::unique_lock<std::mutex>& lock) {
+        Model& model = models_[name];
+        model.state = LOADING;
+        // on a reload the size is known, make room before the device allocates
+        EvictFor(model.bytes, name, lock);
+        std::string path = model.path;
+        lock.unlock();
+        size_t bytes = 0;
+        double start = NowMs();
+        bool ok = backend_->Load(name, path, &bytes);
+        double loadMs = NowMs() - start;
+        lock.lock();
+        stats_.loadMs += loadMs;
+        if (!ok) {
+            model.state = NOT_LOADED;
+            cond_.notify_all();
+            return false;
+        }
+        model.bytes = bytes;
+        model.state = RESIDENT;
+        lru_.push_front(name);
+        model.lruPos = lru_.begin();
+        stats_.residentBytes += bytes;
+        stats_.peakBytes = std::max(stats_.peakBytes, stats_.residentBytes);
+        EvictFor(0, name, lock);
+        cond_.notify_all();
+        return true;
+    }
+
+    // Unloads least-recently-used idle models until `extra` more bytes fit in the budget. `keep` is never
+    // evicted. If everything else is pinned the budget is exceeded rather than failing the request.
+    void EvictFor(size_t extra, const std::string& keep, std::unique_lock<std::mutex>&) {
+        auto it = lru_.end();
+        while (stats_.residentBytes + extra > budgetBytes_ && it != lru_.begin()) {
+            --it;
+            Model& victim = models_[*it];
+            if (*it == keep || victim.inUse > 0 || victim.state != RESIDENT) {
+                continue;
+            }
+            std::string name = *it;
+            it = lru_.erase(it);
+            backend_->Unload(name);
+            victim.state = NOT_LOADED;
+            stats_.residentBytes -= victim.bytes;
+            stats_.evictions++;
+        }
+        if (stats_.residentBytes + extra > budgetBytes_) {
+            ALOGI("[RESIDENCY] budget exceeded: %zu bytes needed, budget %zu.\n", stats_.residentBytes + extra,
+                  budgetBytes_);
+        }
+    }
+
+    void PrefetchLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cond_.wait(lock, [this]() { return stop_ || !prefetchQueue_.empty(); });
+            if (stop_) {
+                return;
+            }
+            std::string name = prefetchQueue_.front();
+            prefetchQueue_.pop_front();
+            if (models_[name].state != NOT_LOADED) {
+                continue;
+            }
+            stats_.prefetches++;
+            LoadLocked(name, lock);
+        }
+    }
+
+    std::shared_ptr<ModelBackend> backend_;
+    size_t budgetBytes_;
+    std::map<std::string, Model> models_;
+    // most recently used first
+    std::list<std::string> lru_;
+    std::deque<std::string> prefetchQueue_;
+    ResidencyStats stats_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stop_ = false;
+    std::thread prefetchThread_;
+};
+}
+
+#endif //BUILD_IR_MODEL_MODEL_RESIDENCY_H
@@ -0,0 +1,758 @@
+#ifndef BUILD_IR_MODEL_NPY_IO_H
+#define BUILD_IR_MODEL_NPY_IO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "graph/types.h"
+#include "log_util.h"
+#include "mapped_file.h"
+
+// NumPy .npy / .npz tensor files, so that dumps carry their shape and dtype and the Python golden tooling reads
+// them with np.load directly.
+//
+//     npy_io::WriteNpy<float>("/data/local/tmp/output/out.npy", {1, 3, 224, 224}, data);
+//     npy_io::NpyArray array;
+//     npy_io::ReadNpy("input.npy", array);       // mmapped, array.Data<float>() points into the file
+//
+//     npy_io::NpyWriter frames;                 // multi-frame capture, shape becomes [n, 1, 16, 32, 32]
+//     frames.Open("frames.npy", "<f4", {1, 16, 32, 32});
+//     frames.Append(frame, bytes);
+//
+// Npz archives are written and read stored (np.savez) or deflated (np.savez_compressed). Only little endian,
+// C order arrays are supported.
+namespace npy_io {
+struct NpyHeader {
+    std::string descr;
+    bool fortranOrder = false;
+    std::vector<int64_t> shape;
+    // offset of the data from the start of the file
+    size_t dataOffset = 0;
+
+    size_t GetElementNum() const {
+        size_t num = 1;
+        for (auto dim : shape) {
+            num *= static_cast<size_t>(dim);
+        }
+        return num;
+    }
+};
+
+// Item size of a descr such as "<f4" or "|u1", 0 when unsupported.
+inline size_t GetItemSize(const std::string& descr) {
+    if (descr.size() < 3 || (descr[0] != '<' && descr[0] != '|')) {
+        return 0;
+    }
+    int size = atoi(descr.c_str() + 2);
+    return std::strchr("fiub", descr[1]) != nullptr && size > 0 && size <= 8 ? static_cast<size_t>(size) : 0;
+}
+
+inline const char* GetDescr(ge::DataType dataType) {
+    switch (dataType) {
+        case ge::DT_FLOAT: return "<f4";
+        case ge::DT_FLOAT16: return "<f2";
+        case ge::DT_DOUBLE: return "<f8";
+        case ge::DT_INT8: return "|i1";
+        case ge::DT_UINT8: return "|u1";
+        case ge::DT_INT16: return "<i2";
+        case ge::DT_UINT16: return "<u2";
+        case ge::DT_INT32: return "<i4";
+        case ge::DT_UINT32: return "<u4";
+        case ge::DT_INT64: return "<i8";
+        case ge::DT_UINT64: return "<u8";
+        case ge::DT_BOOL: return "|b1";
+        default: return nullptr;
+    }
+}
+
+template<typename T> inline const char* DescrOf();
+template<> inline const char* DescrOf<float>() { return "<f4"; }
+template<> inline const char* DescrOf<double>() { return "<f8"; }
+template<> inline const char* DescrOf<int8_t>() { return "|i1"; }
+template<> inline const char* DescrOf<uint8_t>() { return "|u1"; }
+template<> inline const char* DescrOf<int16_t>() { return "<i2"; }
+template<> inline const char* DescrOf<uint16_t>() { return "<u2"; }
+template<> inline const char* DescrOf<int32_t>() { return "<i4"; }
+template<> inline const char* DescrOf<uint32_t>() { return "<u4"; }
+template<> inline const char* DescrOf<int64_t>() { return "<i8"; }
+template<> inline const char* DescrOf<bool>() { return "|b1"; }
+
+inline float HalfToFloat(uint16_t h) {
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // subnormal half, normal float
+        exponent = 113;
+        while ((mantissa & 0x400) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+const char NPY_MAGIC[] = "\x93NUMPY";
+const size_t NPY_MAGIC_SIZE = 6;
+const size_t NPY_ALIGNMENT = 64;
+
+// Version 1.0 header, or 2.0 once the dict does not fit 64 KB. The dict is padded with spaces so that the data
+// starts 64 byte aligned, or to exactly `totalSize` bytes when given (room for a growing shape).
+inline std::string BuildHeader(const std::string& descr, const std::vector<int64_t>& shape, size_t totalSize = 0) {
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (size_t i = 0; i < shape.size(); i++) {
+        dict += std::to_string(shape[i]) + (shape.size() == 1 ? "," : (i + 1 < shape.size() ? ", " : ""));
+    }
+    dict += "), }";
+    size_t prefix = NPY_MAGIC_SIZE + 2 + 2;
+    if (prefix + dict.size() + 1 > 65535) {
+        prefix += 2;
+    }
+    size_t size = totalSize != 0 ? totalSize : (prefix + dict.size() + 1 + NPY_ALIGNMENT - 1) / NPY_ALIGNMENT *
+                                               NPY_ALIGNMENT;
+    if (size < prefix + dict.size() + 1) {
+        return "";
+    }
+    dict.append(size - prefix - dict.size() - 1, ' ');
+    dict += '\n';
+    std::string header(NPY_MAGIC, NPY_MAGIC_SIZE);
+    uint32_t dictSize = static_cast<uint32_t>(dict.size());
+    header += static_cast<char>(prefix == 10 ? 1 : 2);
+    header += '\0';
+    for (size_t i = 0; i < prefix - NPY_MAGIC_SIZE - 2; i++) {
+        header += static_cast<char>((dictSize >> (8 * i)) & 0xff);
+    }
+    return header + dict;
+}
+
+// `size` may cover only the beginning of the file, the header is all that is read.
+inline bool ParseHeader(const uint8_t* data, size_t size, NpyHeader& header) {
+    if (size < 10 || memcmp(data, NPY_MAGIC, NPY_MAGIC_SIZE) != 0 || data[6] < 1 || data[6] > 3) {
+        ALOGE("[NPY] not an npy file.\n");
+        return false;
+    }
+    size_t prefix = data[6] == 1 ? 10 : 12;
+    if (size < prefix) {
+        return false;
+    }
+    size_t dictSize = data[8] | (data[9] << 8);
+    if (prefix == 12) {
+        dictSize |= (static_cast<size_t>(data[10]) << 16) | (static_cast<size_t>(data[11]) << 24);
+    }
+    if (size < prefix + dictSize) {
+        ALOGE("[NPY] truncated header.\n");
+        return false;
+    }
+    std::string dict(reinterpret_cast<const char*>(data) + prefix, dictSize);
+    auto value = [&dict](const std::string& key) -> std::string {
+        size_t pos = dict.find("'" + key + "'");
+        pos = pos == std::string::npos ? pos : dict.find(':', pos);
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos = dict.find_first_not_of(' ', pos + 1);
+        if (pos == std::string::npos) {
+            return "";
+        }
+        size_t end = dict[pos] == '(' ? dict.find(')', pos) + 1 :
+                     dict[pos] == '\'' ? dict.find('\'', pos + 1) + 1 : dict.find_first_of(",}", pos);
+        return dict.substr(pos, end - pos);
+    };
+    std::string descr = value("descr");
+    std::string shape = value("shape");
+    if (descr.size() < 3 || shape.empty() || shape[0] != '(') {
+        ALOGE("[NPY] bad header %s.\n", dict.c_str());
+        return false;
+    }
+    header.descr = descr.substr(1, descr.size() - 2);
+    header.fortranOrder = value("fortran_order") == "True";
+    header.shape.clear();
+    for (const char* p = shape.c_str() + 1; *p != '\0' && *p != ')';) {
+        char* end = nullptr;
+        long long dim = strtoll(p, &end, 10);
+        if (end == p) {
+            p++;
+            continue;
+        }
+        header.shape.push_back(dim);
+        p = end;
+    }
+    header.dataOffset = prefix + dictSize;
+    return true;
+}
+
+// Reads only the header of an .npy file, e.g. to learn its shape.
+inline bool ReadNpyHeader(const std::string& path, NpyHeader& header) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        ALOGE("[NPY] open %s failed.\n", path.c_str());
+        return false;
+    }
+    std::vector<uint8_t> buffer(12);
+    bool ok = fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (ok) {
+        size_t dictSize = buffer[8] | (buffer[9] << 8) | (buffer[6] == 1 ? 0 : (buffer[10] << 16 | buffer[11] << 24));
+        size_t prefix = buffer[6] == 1 ? 10 : 12;
+        buffer.resize(std::max<size_t>(prefix + dictSize, buffer.size()));
+        ok = fread(buffer.data() + 12, 1, buffer.size() - 12, file) == buffer.size() - 12;
+    }
+    fclose(file);
+    return ok && ParseHeader(buffer.data(), buffer.size(), header);
+}
+
+// An array read from a file: a view into the mmapped .npy / stored .npz member, or an inflated copy.
+class NpyArray {
+public:
+    const NpyHeader& GetHeader() const { return header_; }
+    const std::vector<int64_t>& GetShape() const { return header_.shape; }
+    const std::string& GetDescr() const { return header_.descr; }
+    const void* GetData() const { return data_; }
+    size_t GetByteSize() const { return bytes_; }
+    size_t GetElementNum() const { return header_.GetElementNum(); }
+    // Keeps the data alive, e.g. for a HostTensor view of it.
+    const std::shared_ptr<void>& GetHolder() const { return holder_; }
+
+    template<typename T>
+    const T* Data() const {
+        return header_.descr == DescrOf<T>() ? static_cast<const T*>(data_) : nullptr;
+    }
+
+    // Converts elements [begin, begin + count) of any supported dtype to float32, so that large arrays can be
+    // converted chunk by chunk.
+    bool ToFloat(size_t begin, size_t count, float* out) const {
+        const std::string& d = header_.descr;
+        if (d == "<f4") {
+            memcpy(out, static_cast<const float*>(data_) + begin, count * sizeof(float));
+        } else if (d == "<f2") {
+            const uint16_t* src = static_cast<const uint16_t*>(data_) + begin;
+            for (size_t i = 0; i < count; i++) {
+                out[i] = HalfToFloat(src[i]);
+            }
+        } else if (d == "<f8") {
+            Convert<double>(begin, count, out);
+        } else if (d == "|i1") {
+            Convert<int8_t>(begin, count, out);
+        } else if (d == "|u1" || d == "|b1") {
+            Convert<uint8_t>(begin, count, out);
+        } else if (d == "<i2") {
+            Convert<int16_t>(begin, count, out);
+        } else if (d == "<u2") {
+            Convert<uint16_t>(begin, count, out);
+        } else if (d == "<i4") {
+            Convert<int32_t>(begin, count, out);
+        } else if (d == "<u4") {
+            Convert<uint32_t>(begin, count, out);
+        } else if (d == "<i8") {
+            Convert<int64_t>(begin, count, out);
+        } else if (d == "<u8") {
+            Convert<uint64_t>(begin, count, out);
+        } else {
+            ALOGE("[NPY] can not convert %s to float.\n", d.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool ToFloat(std::vector<float>& out) const {
+        out.resize(GetElementNum());
+        return ToFloat(0, out.size(), out.data());
+    }
+
+    // Parses an in-memory .npy, `holder` keeps the memory alive.
+    bool Reset(const uint8_t* data, size_t size, std::shared_ptr<void> holder) {
+        NpyHeader header;
+        if (!ParseHeader(data, size, header)) {
+            return false;
+        }
+        size_t itemSize = GetItemSize(header.descr);
+        size_t bytes = header.GetElementNum() * itemSize;
+        if (itemSize == 0 || header.fortranOrder || header.dataOffset + bytes > size) {
+            ALOGE("[NPY] unsupported descr %s, fortran order or truncated data.\n", header.descr.c_str());
+            return false;
+        }
+        header_ = header;
+        data_ = data + header.dataOffset;
+        bytes_ = bytes;
+        holder_ = holder;
+        // members of a foreign .npz are not aligned, the kernels expect naturally aligned elements
+        if (reinterpret_cast<uintptr_t>(data_) % itemSize != 0) {
+            auto copy = std::make_shared<std::vector<uint8_t>>(static_cast<const uint8_t*>(data_),
+                                                               static_cast<const uint8_t*>(data_) + bytes);
+            data_ = copy->data();
+            holder_ = copy;
+        }
+        return true;
+    }
+
+private:
+    template<typename T>
+    void Convert(size_t begin, size_t count, float* out) const {
+        const T* src = static_cast<const T*>(data_) + begin;
+        for (size_t i = 0; i < count; i++) {
+            out[i] = static_cast<float>(src[i]);
+        }
+    }
+
+    NpyHeader header_;
+    const void* data_ = nullptr;
+    size_t bytes_ = 0;
+    std::shared_ptr<void> holder_;
+};
+
+inline bool ReadNpy(const std::string& path, NpyArray& array, bool randomAccess = false) {
+    auto file = std::make_shared<om_model::MappedFile>();
+    if (!file->Open(path, randomAccess)) {
+        return false;
+    }
+    const uint8_t* data = static_cast<const uint8_t*>(file->GetData());
+    return array.Reset(data, file->GetSize(), file);
+}
+
+inline bool WriteNpy(const std::string& path, const std::string& descr, const std::vector<int64_t>& shape,
+                     const void* data, size_t bytes) {
+    std::string header = BuildHeader(descr, shape);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        ALOGE("[NPY] open %s failed.\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+              fwrite(data, 1, bytes, file) == bytes;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        ALOGE("[NPY] write %s failed.\n", path.c_str());
+    }
+    return ok;
+}
+
+template<typename T>
+bool WriteNpy(const std::string& path, const std::vector<int64_t>& shape, const T* data) {
+    size_t num = 1;
+    for (auto dim : shape) {
+        num *= static_cast<size_t>(dim);
+    }
+    return WriteNpy(path, DescrOf<T>(), shape, data, num * sizeof(T));
+}
+
+// Streams frames of one shape into an .npy whose first dimension is the frame count. The header has room for
+// any count and is rewritten on Flush() / Close(), so a capture cut short is still a valid file holding the
+// frames flushed so far.
+class NpyWriter {
+public:
+    NpyWriter() = default;
+    NpyWriter(const NpyWriter&) = delete;
+    NpyWriter& operator=(const NpyWriter&) = delete;
+
+    ~NpyWriter() { Close(); }
+
+    bool Open(const std::string& path, const std::string& descr, const std::vector<int64_t>& frameShape) {
+        Close();
+        file_ = fopen(path.c_str(), "wb");
+        if (file_ == nullptr) {
+            ALOGE("[NPY] open %s failed.\n", path.c_str());
+            return false;
+        }
+        descr_ = descr;
+        frameShape_ = frameShape;
+        frameBytes_ = GetItemSize(descr);
+        for (auto dim : frameShape) {
+            frameBytes_ *= static_cast<size_t>(dim);
+        }
+        std::vector<int64_t> widest = frameShape;
+        widest.insert(widest.begin(), INT64_MAX);
+        headerSize_ = BuildHeader(descr, widest).size();
+        frames_ = 0;
+        return WriteHeader();
+    }
+
+    bool Append(const void* frame, size_t bytes) {
+        if (file_ == nullptr || bytes != frameBytes_) {
+            ALOGE("[NPY] frame of %zu bytes, expected %zu.\n", bytes, frameBytes_);
+            return false;
+        }
+        if (fwrite(frame, 1, bytes, file_) != bytes) {
+            return false;
+        }
+        frames_++;
+        return true;
+    }
+
+    bool Flush() {
+        if (file_ == nullptr || !WriteHeader()) {
+            return false;
+        }
+        return fseek(file_, 0, SEEK_END) == 0 && fflush(file_) == 0;
+    }
+
+    bool Close() {
+        if (file_ == nullptr) {
+            return true;
+        }
+        bool ok = WriteHeader();
+        ok = fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+    int64_t GetFrameNum() const { return frames_; }
+
+private:
+    bool WriteHeader() {
+        std::vector<int64_t> shape = frameShape_;
+        shape.insert(shape.begin(), frames_);
+        std::string header = BuildHeader(descr_, shape, headerSize_);
+        return fseek(file_, 0, SEEK_SET) == 0 && fwrite(header.data(), 1, header.size(), file_) == header.size();
+    }
+
+    FILE* file_ = nullptr;
+    std::string descr_;
+    std::vector<int64_t> frameShape_;
+    size_t frameBytes_ = 0;
+    size_t headerSize_ = 0;
+    int64_t frames_ = 0;
+};
+
+namespace detail {
+inline void Put16(std::string& out, uint32_t v) {
+    out += static_cast<char>(v & 0xff);
+    out += static_cast<char>((v >> 8) & 0xff);
+}
+
+inline void Put32(std::string& out, uint32_t v) {
+    Put16(out, v & 0xffff);
+    Put16(out, v >> 16);
+}
+
+inline uint32_t Get16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+inline uint32_t Get32(const uint8_t* p) { return Get16(p) | (Get16(p + 2) << 16); }
+inline uint64_t Get64(const uint8_t* p) { return Get32(p) | (static_cast<uint64_t>(Get32(p + 4)) << 32); }
+
+const uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+const uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+const uint32_t ZIP_END_OF_CENTRAL = 0x06054b50;
+const uint32_t ZIP_STORED = 0;
+const uint32_t ZIP_DEFLATED = 8;
+}
+
+// .npz archives in the layout of np.savez, or np.savez_compressed with `compress`. Members are named
+// <name>.npy. Stored members are padded so that their data is 64 byte aligned for readers that mmap it.
+class NpzWriter {
+public:
+    NpzWriter() = default;
+    NpzWriter(const NpzWriter&) = delete;
+    NpzWriter& operator=(const NpzWriter&) = delete;
+
+    ~NpzWriter() { Close(); }
+
+    // `level` is the zlib level of compressed members, dumps favour speed.
+    bool Open(const std::string& path, bool compress = false, int level = 1) {
+        Close();
+        file_ = fopen(path.c_str(), "wb");
+        compress_ = compress;
+        level_ = level;
+        offset_ = 0;
+        central_.clear();
+        entries_ = 0;
+        if (file_ == nullptr) {
+            ALOGE("[NPY] open %s failed.\n", path.c_str());
+        }
+        return file_ != nullptr;
+    }
+
+    bool Add(const std::string& name, const std::string& descr, const std::vector<int64_t>& shape, const void* data,
+             size_t bytes) {
+        if (file_ == nullptr) {
+            return false;
+        }
+        std::string header = BuildHeader(descr, shape);
+        std::string member = name + ".npy";
+        uint64_t size = header.size() + bytes;
+        uint32_t crc = om_model::Crc32(data, bytes, om_model::Crc32(header.data(), header.size()));
+        std::vector<uint8_t> deflated;
+        if (compress_ && !Deflate(header, data, bytes, deflated)) {
+            ALOGE("[NPY] deflate %s failed.\n", member.c_str());
+            return false;
+        }
+        uint64_t stored = compress_ ? deflated.size() : size;
+        if (size >= 0xffffffffu || offset_ + stored >= 0xffffffffu) {
+            ALOGE("[NPY] %s does not fit a non zip64 archive.\n", member.c_str());
+            return false;
+        }
+        uint32_t method = compress_ ? detail::ZIP_DEFLATED : detail::ZIP_STORED;
+        std::string local;
+        detail::Put32(local, detail::ZIP_LOCAL_HEADER);
+        AppendCommon(local, method, crc, static_cast<uint32_t>(stored), static_cast<uint32_t>(size), member);
+        local += member;
+        if (!compress_) {
+            // pad the local extra field so that the array data is 64 byte aligned
+            size_t extra = NPY_ALIGNMENT - (offset_ + local.size() + 4 + header.size()) % NPY_ALIGNMENT + 4;
+            detail::Put16(local, ZIP_ALIGNMENT_EXTRA);
+            detail::Put16(local, static_cast<uint32_t>(extra - 4));
+            local.append(extra - 4, '\0');
+            local[28] = static_cast<char>(extra & 0xff);
+            local[29] = static_cast<char>(extra >> 8);
+        }
+        detail::Put32(central_, detail::ZIP_CENTRAL_HEADER);
+        detail::Put16(central_, 20);
+        AppendCommon(central_, method, crc, static_cast<uint32_t>(stored), static_cast<uint32_t>(size), member);
+        // comment length, disk, internal / external attributes, local header offset
+        detail::Put16(central_, 0);
+        detail::Put16(central_, 0);
+        detail::Put16(central_, 0);
+        detail::Put32(central_, 0);
+        detail::Put32(central_, static_cast<uint32_t>(offset_));
+        central_ += member;
+
+        bool ok = fwrite(local.data(), 1, local.size(), file_) == local.size();
+        if (compress_) {
+            ok = ok && fwrite(deflated.data(), 1, deflated.size(), file_) == deflated.size();
+        } else {
+            ok = ok && fwrite(header.data(), 1, header.size(), file_) == header.size() &&
+                 fwrite(data, 1, bytes, file_) == bytes;
+        }
+        offset_ += local.size() + stored;
+        entries_++;
+        return ok;
+    }
+
+    template<typename T>
+    bool Add(const std::string& name, const std::vector<int64_t>& shape, const T* data) {
+        size_t num = 1;
+        for (auto dim : shape) {
+            num *= static_cast<size_t>(dim);
+        }
+        return Add(name, DescrOf<T>(), shape, data, num * sizeof(T));
+    }
+
+    // Writes the central directory.
+    bool Close() {
+        if (file_ == nullptr) {
+            return true;
+        }
+        std::string end;
+        detail::Put32(end, detail::ZIP_END_OF_CENTRAL);
+        detail::Put16(end, 0);
+        detail::Put16(end, 0);
+        detail::Put16(end, entries_);
+        detail::Put16(end, entries_);
+        detail::Put32(end, static_cast<uint32_t>(central_.size()));
+        detail::Put32(end, static_cast<uint32_t>(offset_));
+        detail::Put16(end, 0);
+        bool ok = fwrite(central_.data(), 1, central_.size(), file_) == central_.size() &&
+                  fwrite(end.data(), 1, end.size(), file_) == end.size();
+        ok = fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        return ok;
+    }
+
+private:
+    // extra field id Android's zipalign uses for padding
+    static const uint32_t ZIP_ALIGNMENT_EXTRA = 0xd935;
+
+    // the fields shared by local and central headers: version needed, flags, method, time, date, crc, sizes,
+    // name length, extra length
+    static void AppendCommon(std::string& out, uint32_t method, uint32_t crc, uint32_t compressedSize,
+                             uint32_t size, const std::string& name) {
+        detail::Put16(out, 20);
+        detail::Put16(out, 0);
+        detail::Put16(out, method);
+        detail::Put16(out, 0);
+        detail::Put16(out, (1 << 5) | 1); // 1980-01-01
+        detail::Put32(out, crc);
+        detail::Put32(out, compressedSize);
+        detail::Put32(out, size);
+        detail::Put16(out, static_cast<uint32_t>(name.size()));
+        detail::Put16(out, 0);
+    }
+
+    // raw deflate of the .npy header followed by the data
+    bool Deflate(const std::string& header, const void* data, size_t bytes, std::vector<uint8_t>& out) const {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (deflateInit2(&stream, level_, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        out.resize(deflateBound(&stream, static_cast<uLong>(header.size() + bytes)));
+        stream.next_out = out.data();
+        stream.avail_out = static_cast<uInt>(out.size());
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(header.data()));
+        stream.avail_in = static_cast<uInt>(header.size());
+        int ret = deflate(&stream, Z_NO_FLUSH);
+        stream.next_in = static_cast<Bytef*>(const_cast<void*>(data));
+        stream.avail_in = static_cast<uInt>(bytes);
+        ret = ret == Z_OK ? deflate(&stream, Z_FINISH) : ret;
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return ret == Z_STREAM_END;
+    }
+
+    FILE* file_ = nullptr;
+    bool compress_ = false;
+    int level_ = 1;
+    uint64_t offset_ = 0;
+    std::string central_;
+    uint32_t entries_ = 0;
+};
+
+// Reads .npz archives written by np.savez (stored) or np.savez_compressed (deflated), including the zip64
+// extra fields numpy emits.
+class NpzReader {
+public:
+    bool Open(const std::string& path) {
+        file_ = std::make_shared<om_model::MappedFile>();
+        members_.clear();
+        if (!file_->Open(path)) {
+            return false;
+        }
+        const uint8_t* data = static_cast<const uint8_t*>(file_->GetData());
+        size_t size = file_->GetSize();
+        // the end of central directory record is followed by at most a 64 KB comment
+        size_t end = SIZE_MAX;
+        for (size_t pos = size >= 22 ? size - 22 : 0; size >= 22 && pos + 65557 >= size; pos--) {
+            if (detail::Get32(data + pos) == detail::ZIP_END_OF_CENTRAL) {
+                end = pos;
+                break;
+            }
+            if (pos == 0) {
+                break;
+            }
+        }
+        if (end == SIZE_MAX) {
+            ALOGE("[NPY] %s is not a zip archive.\n", path.c_str());
+            return false;
+        }
+        size_t entries = detail::Get16(data + end + 10);
+        size_t pos = detail::Get32(data + end + 16);
+        for (size_t i = 0; i < entries; i++) {
+            if (pos + 46 > size || detail::Get32(data + pos) != detail::ZIP_CENTRAL_HEADER) {
+                ALOGE("[NPY] %s: bad central directory.\n", path.c_str());
+                return false;
+            }
+            Member member;
+            member.method = detail::Get16(data + pos + 10);
+            member.crc = detail::Get32(data + pos + 16);
+            member.compressedSize = detail::Get32(data + pos + 20);
+            member.size = detail::Get32(data + pos + 24);
+            size_t nameLength = detail::Get16(data + pos + 28);
+            size_t extraLength = detail::Get16(data + pos + 30);
+            size_t commentLength = detail::Get16(data + pos + 32);
+            member.localOffset = detail::Get32(data + pos + 42);
+            std::string name(reinterpret_cast<const char*>(data) + pos + 46, nameLength);
+            ReadZip64Extra(data + pos + 46 + nameLength, extraLength, member);
+            members_[name] = member;
+            pos += 46 + nameLength + extraLength + commentLength;
+        }
+        return true;
+    }
+
+    // Member names without the .npy suffix, which is also how Get() takes them.
+    std::vector<std::string> GetNames() const {
+        std::vector<std::string> names;
+        for (const auto& member : members_) {
+            const std::string& name = member.first;
+            bool npy = name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0;
+            names.push_back(npy ? name.substr(0, name.size() - 4) : name);
+        }
+        return names;
+    }
+
+    bool Get(const std::string& name, NpyArray& array) const {
+        auto it = members_.find(name + ".npy");
+        if (it == members_.end()) {
+            it = members_.find(name);
+        }
+        if (it == members_.end()) {
+            ALOGE("[NPY] no member %s.\n", name.c_str());
+            return false;
+        }
+        const Member& member = it->second;
+        const uint8_t* data = static_cast<const uint8_t*>(file_->GetData());
+        size_t local = static_cast<size_t>(member.localOffset);
+        if (local + 30 > file_->GetSize() || detail::Get32(data + local) != detail::ZIP_LOCAL_HEADER) {
+            ALOGE("[NPY] %s: bad local header.\n", name.c_str());
+            return false;
+        }
+        size_t offset = local + 30 + detail::Get16(data + local + 26) + detail::Get16(data + local + 28);
+        if (offset + member.compressedSize > file_->GetSize()) {
+            ALOGE("[NPY] %s: truncated member.\n", name.c_str());
+            return false;
+        }
+        if (member.method == detail::ZIP_STORED) {
+            return array.Reset(data + offset, static_cast<size_t>(member.size), file_);
+        }
+        if (member.method != detail::ZIP_DEFLATED) {
+            ALOGE("[NPY] %s: compression method %u is not supported.\n", name.c_str(), member.method);
+            return false;
+        }
+        auto inflated = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(member.size));
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            return false;
+        }
+        stream.next_in = const_cast<Bytef*>(data + offset);
+        stream.avail_in = static_cast<uInt>(member.compressedSize);
+        stream.next_out = inflated->data();
+        stream.avail_out = static_cast<uInt>(inflated->size());
+        int ret = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+        if (ret != Z_STREAM_END || stream.total_out != member.size ||
+            om_model::Crc32(inflated->data(), inflated->size()) != member.crc) {
+            ALOGE("[NPY] %s: inflate failed.\n", name.c_str());
+            return false;
+        }
+        return array.Reset(inflated->data(), inflated->size(), inflated);
+    }
+
+private:
+    struct Member {
+        uint32_t method = 0;
+        uint32_t crc = 0;
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+        uint64_t localOffset = 0;
+    };
+
+    // Only the fields saturated to 0xffffffff in the fixed part are present, in this order.
+    static void ReadZip64Extra(const uint8_t* extra, size_t length, Member& member) {
+        for (size_t pos = 0; pos + 4 <= length;) {
+            uint32_t id = detail::Get16(extra + pos);
+            size_t fieldLength = detail::Get16(extra + pos + 2);
+            if (id == 0x0001) {
+                const uint8_t* p = extra + pos + 4;
+                const uint8_t* end = p + fieldLength;
+                for (uint64_t* field : {&member.size, &member.compressedSize, &member.localOffset}) {
+                    if (*field == 0xffffffffu && p + 8 <= end) {
+                        *field = detail::Get64(p);
+                        p += 8;
+                    }
+                }
+            }
+            pos += 4 + fieldLength;
+        }
+    }
+
+    std::shared_ptr<om_model::MappedFile> file_;
+    std::map<std::string, Member> members_;
+};
+}
+
+#endif //BUILD_IR_MODEL_NPY_IO_H
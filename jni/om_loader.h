@@ -0,0 +1,190 @@
+#ifndef BUILD_IR_MODEL_OM_LOADER_H
+#define BUILD_IR_MODEL_OM_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "mapped_file.h"
+#include "test_util.h"
+#include "parallel_util.h"
+
+// Pipelined replacement for om_model::LoadSync. Model files are mmapped and checksummed by a pool of reader
+// threads while the calling thread hands the already read models to the service in batches, so file I/O and
+// device load overlap instead of running back to back.
+namespace om_model {
+struct LoadOptions {
+    // <= 0 uses one reader per core
+    int readThreads = 0;
+    // models handed to client->Load() at once, 0 loads everything in one call like LoadSync
+    size_t batchSize = 4;
+    bool verifyChecksum = false;
+    // model name -> expected CRC-32 of the om file, only checked when verifyChecksum is set
+    std::map<std::string, uint32_t> checksums;
+};
+
+struct ModelLoadStat {
+    std::string name;
+    size_t bytes = 0;
+    uint32_t checksum = 0;
+    double readMs = 0;  // mmap + page-in + checksum
+    double queueMs = 0; // read done -> handed to Load()
+    double loadMs = 0;  // client->Load() of the batch the model was in
+    int batch = -1;
+};
+
+inline double NowMs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+inline void PrintLoadStats(const std::vector<ModelLoadStat>& stats, double totalMs) {
+    ALOGI("[OM_LOADER] %-24s %10s %10s %10s %10s %6s\n", "model", "MB", "read(ms)", "queue(ms)", "load(ms)", "batch");
+    for (const auto& stat : stats) {
+        ALOGI("[OM_LOADER] %-24s %10.2f %10.3f %10.3f %10.3f %6d\n", stat.name.c_str(),
+              stat.bytes / 1024.0 / 1024.0, stat.readMs, stat.queueMs, stat.loadMs, stat.batch);
+    }
+    ALOGI("[OM_LOADER] %zu models loaded in %.3f ms.\n", stats.size(), totalMs);
+}
+
+inline int LoadParallel(std::vector<std::string>& names,
+                        std::vector<std::string>& modelPaths,
+                        std::shared_ptr<hiai::AiModelMngerClient>& client,
+                        const LoadOptions& options = LoadOptions(),
+                        std::vector<ModelLoadStat>* stats = nullptr) {
+    const size_t num = modelPaths.size();
+    if (names.size() != num) {
+        ALOGE("[OM_LOADER] %zu names for %zu model files.\n", names.size(), num);
+        return FAILED;
+    }
+    double start = NowMs();
+    std::vector<ModelLoadStat> modelStats(num);
+    std::vector<std::unique_ptr<MappedFile>> files(num);
+    std::vector<double> readDone(num, 0);
+    std::deque<size_t> ready;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+
+    auto reader = [&]() {
+        for (size_t i = next++; i < num && !failed; i = next++) {
+            double begin = NowMs();
+            std::unique_ptr<MappedFile> file(new MappedFile());
+            bool ok = file->Open(modelPaths[i]);
+            uint32_t checksum = ok ? Crc32(file->GetData(), file->GetSize()) : 0;
+            if (ok && options.verifyChecksum) {
+                auto expected = options.checksums.find(names[i]);
+                if (expected != options.checksums.end() && expected->second != checksum) {
+                    ALOGE("[OM_LOADER] %s checksum mismatch: %08x != %08x.\n", modelPaths[i].c_str(), checksum,
+                          expected->second);
+                    ok = false;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            modelStats[i].name = names[i];
+            modelStats[i].bytes = ok ? file->GetSize() : 0;
+            modelStats[i].checksum = checksum;
+            modelStats[i].readMs = NowMs() - begin;
+            readDone[i] = NowMs();
+            if (ok) {
+                files[i] = std::move(file);
+                ready.push_back(i);
+            } else {
+                failed = true;
+            }
+            cond.notify_one();
+        }
+    };
+
+    int threadNum = options.readThreads > 0 ? options.readThreads : parallel_util::GetThreadNum();
+    std::vector<std::thread> readers;
+    for (int t = 0; t < std::min<int>(threadNum, static_cast<int>(num)); t++) {
+        readers.emplace_back(reader);
+    }
+
+    const size_t batchSize = options.batchSize == 0 ? num : options.batchSize;
+    size_t loaded = 0;
+    int batchIndex = 0;
+    int ret = SUCCESS;
+    while (loaded < num && ret == SUCCESS) {
+        std::vector<size_t> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // wait for a full batch, or for the remaining tail
+            cond.wait(lock, [&]() {
+                return failed || ready.size() >= std::min(batchSize, num - loaded);
+            });
+            if (failed) {
+                ret = FAILED;
+                break;
+            }
+            while (!ready.empty() && batch.size() < batchSize) {
+                batch.push_back(ready.front());
+                ready.pop_front();
+            }
+        }
+        std::vector<std::shared_ptr<hiai::AiModelDescription>> modelDescs;
+        double handOff = NowMs();
+        for (size_t i : batch) {
+            g_modelNameMap[names[i]] = static_cast<int>(i);
+            auto desc = std::make_shared<hiai::AiModelDescription>(names[i] + ".om",
+                                                                   hiai::AiModelDescription_Frequency_HIGH,
+                                                                   hiai::HIAI_FRAMEWORK_NONE,
+                                                                   hiai::HIAI_MODELTYPE_ONLINE,
+                                                                   hiai::AiModelDescription_DeviceType_NPU);
+            desc->SetModelBuffer(files[i]->GetData(), static_cast<uint32_t>(files[i]->GetSize()));
+            modelDescs.push_back(desc);
+            modelStats[i].queueMs = handOff - readDone[i];
+        }
+        double loadStart = NowMs();
+        if (client->Load(modelDescs) != SUCCESS) {
+            ALOGE("[OM_LOADER] Load batch %d failed.\n", batchIndex);
+            ret = FAILED;
+        }
+        double loadMs = NowMs() - loadStart;
+        for (size_t i : batch) {
+            modelStats[i].loadMs = loadMs;
+            modelStats[i].batch = batchIndex;
+            files[i].reset();
+        }
+        loaded += batch.size();
+        batchIndex++;
+    }
+    failed = failed || ret != SUCCESS;
+    for (auto& thread : readers) {
+        thread.join();
+    }
+    PrintLoadStats(modelStats, NowMs() - start);
+    if (stats != nullptr) {
+        *stats = modelStats;
+    }
+    return ret;
+}
+
+inline std::shared_ptr<hiai::AiModelMngerClient> LoadModelParallel(std::vector<std::string>& names,
+                                                                   std::vector<std::string>& modelPaths,
+                                                                   VecVecAiTensor& modelsInputs,
+                                                                   VecVecAiTensor& modelsOutputs,
+                                                                   std::vector<bool>& aipps,
+                                                                   const LoadOptions& options = LoadOptions(),
+                                                                   std::vector<ModelLoadStat>* stats = nullptr) {
+    std::shared_ptr<hiai::AiModelMngerClient> client = CreateModelClient();
+    if (client == nullptr) {
+        return nullptr;
+    }
+    if (LoadParallel(names, modelPaths, client, options, stats) != SUCCESS) {
+        ALOGE("[OM_LOADER] LoadParallel Failed.\n");
+        return nullptr;
+    }
+    if (CreateModelTensors(client, names, modelsInputs, modelsOutputs, aipps) != SUCCESS) {
+        return nullptr;
+    }
+    return client;
+}
+}
+
+#endif //BUILD_IR_MODEL_OM_LOADER_H
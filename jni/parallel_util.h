@@ -0,0 +1,44 @@
+#ifndef BUILD_IR_MODEL_PARALLEL_UTIL_H
+#define BUILD_IR_MODEL_PARALLEL_UTIL_H
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace parallel_util {
+inline int GetThreadNum() {
+    unsigned int num = std::thread::hardware_concurrency();
+    return num == 0 ? 1 : static_cast<int>(num);
+}
+
+// Splits [begin, end) into at most threadNum contiguous chunks of at least minChunk items and calls
+// func(chunkBegin, chunkEnd) for each of them. The calling thread runs the first chunk itself.
+inline void ParallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& func,
+                        int threadNum = 0, size_t minChunk = 1) {
+    if (end <= begin) {
+        return;
+    }
+    if (threadNum <= 0) {
+        threadNum = GetThreadNum();
+    }
+    size_t total = end - begin;
+    minChunk = std::max<size_t>(minChunk, 1);
+    size_t chunks = std::min<size_t>(threadNum, (total + minChunk - 1) / minChunk);
+    if (chunks <= 1) {
+        func(begin, end);
+        return;
+    }
+    size_t step = (total + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    for (size_t chunkBegin = begin + step; chunkBegin < end; chunkBegin += step) {
+        workers.emplace_back(func, chunkBegin, std::min(end, chunkBegin + step));
+    }
+    func(begin, begin + step);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+}
+
+#endif //BUILD_IR_MODEL_PARALLEL_UTIL_H
@@ -0,0 +1,427 @@
+#ifndef BUILD_IR_MODEL_QUANT_CALIBRATION_H
+#define BUILD_IR_MODEL_QUANT_CALIBRATION_H
+
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "graph_partition.h"
+#include "host_executor.h"
+#include "host_graph.h"
+#include "weight_quant.h"
+
+// Post-training INT8 calibration. A representative dataset is run through the FP32 host kernels, the inputs
+// of every Convolution/ConvolutionDepthwise/FullyConnection are profiled and turned into x_quant_scale /
+// x_quant_offset, and the nodes are rewritten into their Quantized* variants with INT8 filters and INT32 bias.
+//
+//     quant_calibration::Calibrator calibrator(graph, host_kernel::GetBuiltinKernels());
+//     calibrator.Calibrate(dataset);
+//     quant_calibration::QuantizeGraph(graph, calibrator.GetParams(), graph_partition::DefaultCapabilityTable(),
+//                                      graph_partition::GetRomVersion());
+//
+// Nodes are only rewritten when the capability table allows the Quantized op on the ROM, which is what
+// HiaiIrBuild::IsSupportQuantize checks internally.
+namespace quant_calibration {
+using host_graph::HostTensor;
+using host_graph::Node;
+using host_graph::TensorRef;
+
+enum CalibrationMethod {
+    MIN_MAX = 0,
+    PERCENTILE = 1,
+    KL_DIVERGENCE = 2,
+};
+
+struct CalibrationOptions {
+    CalibrationMethod method = KL_DIVERGENCE;
+    int bins = 2048;
+    // PERCENTILE keeps this share of the values inside the range, split evenly between both tails
+    float percentile = 99.99f;
+};
+
+// INT8 affine quantization as used by the Quantized* ops: q = round(x / scale) + offset, q in [-128, 127].
+struct QuantParam {
+    float scale = 1.0f;
+    int64_t offset = 0;
+    float min = 0;
+    float max = 0;
+};
+
+class Histogram {
+public:
+    // A constant tensor (e.g. 6.0 everywhere after ReLU6) has high == low; its range is widened by a step
+    // relative to its magnitude, low + FLT_MIN would round back to low.
+    void Reset(float low, float high, int bins) {
+        low_ = low;
+        high_ = high > low ? high : low + std::max(std::fabs(low) * FLT_EPSILON, FLT_MIN);
+        counts_.assign(bins, 0);
+    }
+
+    // Values outside the range, and NaNs, go to the first / last bin. The position is clamped as a float so
+    // the int conversion never overflows.
+    void Add(const float* data, size_t num, bool absolute) {
+        const int last = static_cast<int>(counts_.size()) - 1;
+        const float scale = counts_.size() / (high_ - low_);
+        for (size_t i = 0; i < num; i++) {
+            float v = absolute ? std::fabs(data[i]) : data[i];
+            float position = (v - low_) * scale;
+            int bin = position >= static_cast<float>(last) ? last : (position > 0 ? static_cast<int>(position) : 0);
+            counts_[bin]++;
+        }
+    }
+
+    const std::vector<double>& GetCounts() const { return counts_; }
+    float GetBinWidth() const { return (high_ - low_) / counts_.size(); }
+    float GetLow() const { return low_; }
+
+private:
+    float low_ = 0;
+    float high_ = 0;
+    std::vector<double> counts_;
+};
+
+struct ActivationStat {
+    std::string name;
+    float min = FLT_MAX;
+    float max = -FLT_MAX;
+    Histogram values;   // signed values over [min, max], for PERCENTILE
+    Histogram absolute; // |x| over [0, max(|min|, |max|)], for KL_DIVERGENCE
+};
+
+// Threshold minimizing KL(P || Q) between the reference distribution P (clipped at the threshold) and its
+// quantization Q to `targetBins` levels, as in TensorRT's entropy calibration.
+inline float KlThreshold(const std::vector<double>& hist, float binWidth, int targetBins) {
+    const int num = static_cast<int>(hist.size());
+    if (num <= targetBins) {
+        return num * binWidth;
+    }
+    double total = 0;
+    for (double v : hist) {
+        total += v;
+    }
+    int best = num;
+    double bestKl = DBL_MAX;
+    std::vector<double> p(num);
+    std::vector<double> q(num);
+    double outliers = total;
+    for (int i = 0; i < targetBins; i++) {
+        outliers -= hist[i];
+    }
+    for (int i = targetBins; i <= num; i++) {
+        // outliers == sum(hist[i:])
+        std::copy(hist.begin(), hist.begin() + i, p.begin());
+        p[i - 1] += outliers;
+        std::fill(q.begin(), q.begin() + i, 0.0);
+        for (int j = 0; j < targetBins; j++) {
+            int start = j * i / targetBins;
+            int end = (j + 1) * i / targetBins;
+            double sum = 0;
+            int nonZero = 0;
+            for (int k = start; k < end; k++) {
+                sum += hist[k];
+                nonZero += hist[k] != 0;
+            }
+            for (int k = start; k < end && nonZero > 0; k++) {
+                q[k] = hist[k] != 0 ? sum / nonZero : 0;
+            }
+        }
+        double pSum = 0;
+        double qSum = 0;
+        for (int k = 0; k < i; k++) {
+            pSum += p[k];
+            qSum += q[k];
+        }
+        double kl = 0;
+        for (int k = 0; k < i && pSum > 0 && qSum > 0; k++) {
+            if (p[k] == 0) {
+                continue;
+            }
+            double pk = p[k] / pSum;
+            double qk = q[k] == 0 ? 1e-10 : q[k] / qSum;
+            kl += pk * std::log(pk / qk);
+        }
+        // ties keep the wider range: all the mass of a constant tensor is in its last bin, every threshold
+        // scores 0 and the narrowest one would clip the whole tensor
+        if (kl <= bestKl) {
+            bestKl = kl;
+            best = i;
+        }
+        if (i < num) {
+            outliers -= hist[i];
+        }
+    }
+    return (best + 0.5f) * binWidth;
+}
+
+inline QuantParam AsymmetricParam(float low, float high) {
+    QuantParam param;
+    low = std::min(low, 0.0f);
+    high = std::max(high, 0.0f);
+    param.min = low;
+    param.max = high;
+    param.scale = high > low ? (high - low) / 255.0f : 1.0f;
+    param.offset = static_cast<int64_t>(std::round(-128.0f - low / param.scale));
+    param.offset = std::min<int64_t>(std::max<int64_t>(param.offset, -128), 127);
+    return param;
+}
+
+inline QuantParam SymmetricParam(float threshold) {
+    QuantParam param;
+    param.min = -threshold;
+    param.max = threshold;
+    param.scale = threshold > 0 ? threshold / 127.0f : 1.0f;
+    return param;
+}
+
+inline QuantParam ComputeQuantParam(const ActivationStat& stat, const CalibrationOptions& options) {
+    if (options.method == MIN_MAX || stat.min > stat.max) {
+        return AsymmetricParam(stat.min, stat.max);
+    }
+    if (options.method == PERCENTILE) {
+        const std::vector<double>& counts = stat.values.GetCounts();
+        double total = 0;
+        for (double v : counts) {
+            total += v;
+        }
+        double tail = total * (100.0 - options.percentile) / 200.0;
+        size_t lo = 0;
+        for (double acc = 0; lo + 1 < counts.size() && acc + counts[lo] <= tail; lo++) {
+            acc += counts[lo];
+        }
+        size_t hi = counts.size() - 1;
+        for (double acc = 0; hi > lo && acc + counts[hi] <= tail; hi--) {
+            acc += counts[hi];
+        }
+        float width = stat.values.GetBinWidth();
+        return AsymmetricParam(stat.values.GetLow() + lo * width, stat.values.GetLow() + (hi + 1) * width);
+    }
+    // Non-negative tensors (after ReLU) use all 256 levels, the others are symmetric.
+    bool nonNegative = stat.min >= 0;
+    float threshold = KlThreshold(stat.absolute.GetCounts(), stat.absolute.GetBinWidth(), nonNegative ? 255 : 127);
+    return nonNegative ? AsymmetricParam(0, threshold) : SymmetricParam(threshold);
+}
+
+inline bool IsQuantizable(const Node& node) {
+    return node.type == "Convolution" || node.type == "ConvolutionDepthwise" || node.type == "FullyConnection";
+}
+
+class Calibrator {
+public:
+    Calibrator(const host_graph::Graph& graph, const host_graph::KernelRegistry& registry,
+               const CalibrationOptions& options = CalibrationOptions())
+        : graph_(graph), executor_(graph, registry), options_(options) {
+        for (const auto& node : graph_.GetNodes()) {
+            if (IsQuantizable(node) && !node.inputs.empty()) {
+                stats_[node.inputs[0]].name = graph_.GetNode(node.inputs[0].node).name;
+            }
+        }
+    }
+
+    // `dataset` holds one set of graph inputs per sample. MIN_MAX takes one pass, the histogram based
+    // methods a second one over the ranges found by the first.
+    bool Calibrate(const std::vector<std::vector<HostTensor>>& dataset) {
+        if (!RunPass(dataset, [](ActivationStat& stat, const HostTensor& tensor) {
+            const float* data = tensor.Data<float>();
+            for (size_t i = 0; i < tensor.GetElementNum(); i++) {
+                stat.min = std::min(stat.min, data[i]);
+                stat.max = std::max(stat.max, data[i]);
+            }
+        })) {
+            return false;
+        }
+        if (options_.method != MIN_MAX) {
+            for (auto& entry : stats_) {
+                ActivationStat& stat = entry.second;
+                stat.values.Reset(stat.min, stat.max, options_.bins);
+                stat.absolute.Reset(0, std::max(std::fabs(stat.min), std::fabs(stat.max)), options_.bins);
+            }
+            if (!RunPass(dataset, [](ActivationStat& stat, const HostTensor& tensor) {
+                stat.values.Add(tensor.Data<float>(), tensor.GetElementNum(), false);
+                stat.absolute.Add(tensor.Data<float>(), tensor.GetElementNum(), true);
+            })) {
+                return false;
+            }
+        }
+        params_.clear();
+        for (const auto& entry : stats_) {
+            params_[entry.first] = ComputeQuantParam(entry.second, options_);
+        }
+        return true;
+    }
+
+    const std::map<TensorRef, QuantParam>& GetParams() const { return params_; }
+    const std::map<TensorRef, ActivationStat>& GetStats() const { return stats_; }
+
+    void Print() const {
+        ALOGI("[CALIBRATION] %-32s %12s %12s %12s %12s %8s\n", "tensor", "min", "max", "clip_min", "clip_max",
+              "offset");
+        for (const auto& entry : params_) {
+            const ActivationStat& stat = stats_.at(entry.first);
+            const QuantParam& param = entry.second;
+            ALOGI("[CALIBRATION] %-32s %12.5f %12.5f %12.5f %12.5f %8lld\n", stat.name.c_str(), stat.min, stat.max,
+                  param.min, param.max, static_cast<long long>(param.offset));
+        }
+    }
+
+private:
+    template<typename Func>
+    bool RunPass(const std::vector<std::vector<HostTensor>>& dataset, Func collect) {
+        std::vector<int> nodes(graph_.GetNodes().size());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i] = static_cast<int>(i);
+        }
+        const auto& dataNodes = graph_.GetInputs();
+        for (const auto& sample : dataset) {
+            if (sample.size() != dataNodes.size()) {
+                ALOGE("[CALIBRATION] expect %zu inputs, got %zu.\n", dataNodes.size(), sample.size());
+                return false;
+            }
+            host_graph::TensorMap tensors;
+            for (size_t i = 0; i < sample.size(); i++) {
+                tensors[host_graph::Executor::Ref(dataNodes[i], 0)] = sample[i];
+            }
+            if (!executor_.Run(nodes, tensors)) {
+                return false;
+            }
+            for (auto& entry : stats_) {
+                const HostTensor& tensor = tensors[entry.first];
+                if (tensor.GetDataType() != ge::DT_FLOAT) {
+                    ALOGE("[CALIBRATION] %s is not a float tensor.\n", entry.second.name.c_str());
+                    return false;
+                }
+                collect(entry.second, tensor);
+            }
+        }
+        return true;
+    }
+
+    const host_graph::Graph& graph_;
+    host_graph::Executor executor_;
+    CalibrationOptions options_;
+    std::map<TensorRef, ActivationStat> stats_;
+    std::map<TensorRef, QuantParam> params_;
+};
+
+namespace detail {
+inline void CopyAttrs(const Node& node, host_graph::NodeBuilder& builder) {
+    for (const char* key : {"strides", "dilations", "pads"}) {
+        if (node.HasAttr(key)) {
+            builder.Attr(key, node.GetInts(key));
+        }
+    }
+    for (const char* key : {"pad_mode", "data_format"}) {
+        if (node.HasAttr(key)) {
+            builder.Attr(key, node.GetString(key));
+        }
+    }
+    for (const char* key : {"groups", "num_output", "axis"}) {
+        if (node.HasAttr(key)) {
+            builder.Attr(key, node.GetInt(key));
+        }
+    }
+    if (node.HasAttr("transpose")) {
+        builder.Attr("transpose", node.GetBool("transpose"));
+    }
+}
+
+inline ge::Operator CreateQuantizedOp(const Node& node) {
+    if (node.type == "Convolution") {
+        return hiai::op::QuantizedConvolution(node.name);
+    }
+    if (node.type == "ConvolutionDepthwise") {
+        return hiai::op::QuantizedConvolutionDepthwise(node.name);
+    }
+    return hiai::op::QuantizedFullyConnection(node.name);
+}
+}
+
+// Rewrites every calibrated Convolution/ConvolutionDepthwise/FullyConnection whose Quantized variant is
+// supported on `romVersion`. Filters and bias must be Const nodes that no other node reads. Returns the number
+// of rewritten nodes; the weight quantization error of each of them is appended to `errors`.
+inline int QuantizeGraph(host_graph::Graph& graph, const std::map<TensorRef, QuantParam>& params,
+                         const graph_partition::CapabilityTable& table, const std::string& romVersion,
+                         std::vector<weight_quant::LayerQuantError>* errors = nullptr) {
+    std::vector<std::vector<int>> consumers = graph.GetConsumers();
+    std::vector<weight_quant::LayerQuantError> layerErrors;
+    int rewritten = 0;
+    for (size_t index = 0; index < graph.GetNodes().size(); index++) {
+        const Node& node = graph.GetNode(static_cast<int>(index));
+        if (!IsQuantizable(node) || node.inputs.size() < 2) {
+            continue;
+        }
+        Node quantized = node;
+        quantized.type = "Quantized" + node.type;
+        if (!table.IsSupported(quantized, romVersion)) {
+            ALOGI("[QUANTIZE] %s: %s is not supported on ROM %s, kept in float.\n", node.name.c_str(),
+                  quantized.type.c_str(), romVersion.c_str());
+            continue;
+        }
+        auto param = params.find(node.inputs[0]);
+        bool isFc = node.type == "FullyConnection";
+        int biasIndex = node.FindInput(isFc ? "b" : "bias");
+        TensorRef filterRef = node.inputs[1];
+        const Node& filter = graph.GetNode(filterRef.node);
+        bool constWeights = filter.type == "Const" && consumers[filterRef.node].size() == 1 &&
+                            filter.outputDescs[0].GetDataType() == ge::DT_FLOAT;
+        if (biasIndex >= 0) {
+            const Node& bias = graph.GetNode(node.inputs[biasIndex].node);
+            constWeights = constWeights && bias.type == "Const" && consumers[node.inputs[biasIndex].node].size() == 1;
+        }
+        if (param == params.end() || !constWeights || (isFc && node.GetBool("transpose"))) {
+            ALOGI("[QUANTIZE] %s: not calibrated or weights are not private float Consts, kept in float.\n",
+                  node.name.c_str());
+            continue;
+        }
+
+        ge::TensorDesc filterDesc = filter.outputDescs[0];
+        weight_quant::QuantizedWeight filterData;
+        weight_quant::LayerQuantError error;
+        if (!weight_quant::QuantizeWeights(node.name, reinterpret_cast<const float*>(filter.constData.data()),
+                                           host_graph::GetDescDims(filterDesc), weight_quant::WeightQuantOptions(),
+                                           filterData, &error)) {
+            continue;
+        }
+        layerErrors.push_back(error);
+        const std::vector<float>& scales = filterData.scales;
+        size_t channels = scales.size();
+        filterDesc.SetDataType(ge::DT_INT8);
+        graph.SetConst(filterRef.node, filterDesc, filterData.data.data(), filterData.data.size());
+        if (biasIndex >= 0) {
+            int biasNode = node.inputs[biasIndex].node;
+            ge::TensorDesc biasDesc = graph.GetNode(biasNode).outputDescs[0];
+            const float* bias = reinterpret_cast<const float*>(graph.GetNode(biasNode).constData.data());
+            std::vector<int32_t> biasData(channels);
+            for (size_t c = 0; c < channels; c++) {
+                biasData[c] = static_cast<int32_t>(std::round(bias[c] / (param->second.scale * scales[c])));
+            }
+            biasDesc.SetDataType(ge::DT_INT32);
+            graph.SetConst(biasNode, biasDesc, biasData.data(), biasData.size() * sizeof(int32_t));
+        }
+
+        Node original = node;
+        auto builder = graph.ReplaceNode(static_cast<int>(index), detail::CreateQuantizedOp(original),
+                                         quantized.type);
+        builder.Input("x", original.inputs[0]).Input(isFc ? "w" : "filter", filterRef);
+        if (biasIndex >= 0) {
+            builder.Input(isFc ? "b" : "bias", original.inputs[biasIndex]);
+        }
+        detail::CopyAttrs(original, builder);
+        builder.Attr("x_quant_type", 1)
+            .Attr(isFc ? "w_quant_type" : "filter_quant_type", 1)
+            .Attr("x_quant_scale", param->second.scale)
+            .Attr("x_quant_offset", param->second.offset)
+            .Attr(isFc ? "w_quant_scales" : "filter_quant_scales", scales);
+        rewritten++;
+    }
+    weight_quant::PrintLayerErrors(layerErrors);
+    if (errors != nullptr) {
+        errors->insert(errors->end(), layerErrors.begin(), layerErrors.end());
+    }
+    ALOGI("[QUANTIZE] %d nodes rewritten to INT8.\n", rewritten);
+    return rewritten;
+}
+}
+
+#endif //BUILD_IR_MODEL_QUANT_CALIBRATION_H
@@ -0,0 +1,1143 @@
+#ifndef BUILD_IR_MODEL_SHAPE_INFERENCE_H
+#define BUILD_IR_MODEL_SHAPE_INFERENCE_H
+
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "host_graph.h"
+#include "host_kernel/nn.h"
+#include "host_kernel/resize.h"
+#include "log_util.h"
+
+// Host side shape and dtype inference over host_graph::Graph. Output TensorDescs are propagated in one pass
+// over the node order (which is topological), so a shape mismatch is reported with the offending node in
+// milliseconds instead of failing a HiaiIrBuild compile:
+//
+//     shape_inference::InferResult result;
+//     if (!shape_inference::InferShapes(graph, shape_inference::GetBuiltinInferFuncs(), &result)) {
+//         // result.nodeName / result.message describe the first inconsistency
+//     }
+//
+// Output descs set by hand with NodeBuilder::OutputDesc are checked against the inferred ones. Ops without an
+// infer function keep their hand-set descs if any, otherwise their outputs (and everything downstream) stay
+// unknown; that is reported but is not an error. Values of small int tensors (Const, Shape) are tracked too,
+// so shape-like inputs such as Reshape's `shape` or ConvTranspose's `output_shape` resolve.
+namespace shape_inference {
+using host_graph::Graph;
+using host_graph::Node;
+using host_graph::TensorRef;
+using Dims = std::vector<int64_t>;
+
+class InferContext {
+public:
+    InferContext(const Node& node, const std::vector<const ge::TensorDesc*>& inputs,
+                 const std::vector<const Dims*>& values)
+        : node_(node), inputs_(inputs), values_(values) {}
+
+    const Node& GetNode() const { return node_; }
+    size_t GetInputNum() const { return inputs_.size(); }
+
+    // Index of a named input, -1 when it is not connected.
+    int FindInput(const std::string& name) const { return node_.FindInput(name); }
+
+    // Like FindInput, but a missing input is an error.
+    bool GetInput(const std::string& name, int& index) {
+        index = FindInput(name);
+        return index >= 0 || Error("input %s is not connected", name.c_str());
+    }
+
+    Dims GetDims(int index) const { return inputs_[index]->GetShape().GetDims(); }
+    ge::DataType GetDataType(int index) const { return inputs_[index]->GetDataType(); }
+    ge::Format GetFormat(int index) const { return inputs_[index]->GetFormat(); }
+
+    // Value of an int input that is known on the host (a Const or a folded Shape).
+    bool GetValue(int index, Dims& value) {
+        if (values_[index] == nullptr) {
+            return Error("input %s must be a constant", node_.inputNames[index].c_str());
+        }
+        value = *values_[index];
+        return true;
+    }
+
+    void SetOutput(size_t index, const Dims& dims, ge::DataType dataType) {
+        if (outputs_.size() <= index) {
+            outputs_.resize(index + 1);
+        }
+        ge::Format format = inputs_.empty() ? ge::FORMAT_NCHW : inputs_[0]->GetFormat();
+        outputs_[index] = ge::TensorDesc(ge::Shape(dims), format, dataType);
+    }
+
+    void SetOutputValue(size_t index, const Dims& value) { outputValues_[index] = value; }
+
+    bool Error(const char* format, ...) {
+        char buffer[512];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        message_ = buffer;
+        return false;
+    }
+
+    const std::vector<ge::TensorDesc>& GetOutputs() const { return outputs_; }
+    const std::map<size_t, Dims>& GetOutputValues() const { return outputValues_; }
+    const std::string& GetMessage() const { return message_; }
+
+private:
+    const Node& node_;
+    const std::vector<const ge::TensorDesc*>& inputs_;
+    const std::vector<const Dims*>& values_;
+    std::vector<ge::TensorDesc> outputs_;
+    std::map<size_t, Dims> outputValues_;
+    std::string message_;
+};
+
+using InferFunc = std::function<bool(InferContext& context)>;
+
+class InferRegistry {
+public:
+    void Register(const std::string& type, const InferFunc& func) { funcs_[type] = func; }
+
+    const InferFunc* Find(const std::string& type) const {
+        auto it = funcs_.find(type);
+        return it == funcs_.end() ? nullptr : &it->second;
+    }
+
+private:
+    std::map<std::string, InferFunc> funcs_;
+};
+
+struct InferResult {
+    int inferred = 0;
+    // nodes without an infer function, or fed by one
+    std::vector<std::string> unknown;
+    // first inconsistency
+    std::string nodeName;
+    std::string nodeType;
+    std::string message;
+};
+
+inline std::string DimsToString(const Dims& dims) {
+    std::string text = "[";
+    for (size_t i = 0; i < dims.size(); i++) {
+        text += (i == 0 ? "" : ", ") + std::to_string(dims[i]);
+    }
+    return text + "]";
+}
+
+inline int64_t ElementNum(const Dims& dims) {
+    int64_t num = 1;
+    for (auto dim : dims) {
+        num *= dim;
+    }
+    return num;
+}
+
+// Values of int Consts with at most this many elements are tracked.
+const size_t MAX_TRACKED_VALUE_NUM = 64;
+
+inline bool ReadConstValue(const Node& node, Dims& value) {
+    if (node.outputDescs.empty()) {
+        return false;
+    }
+    ge::DataType dataType = node.outputDescs[0].GetDataType();
+    size_t elementSize = host_graph::GetDataTypeSize(dataType);
+    size_t num = node.constData.size() / elementSize;
+    if ((dataType != ge::DT_INT32 && dataType != ge::DT_INT64) || num > MAX_TRACKED_VALUE_NUM) {
+        return false;
+    }
+    value.resize(num);
+    for (size_t i = 0; i < num; i++) {
+        value[i] = dataType == ge::DT_INT32 ? reinterpret_cast<const int32_t*>(node.constData.data())[i] :
+                   reinterpret_cast<const int64_t*>(node.constData.data())[i];
+    }
+    return true;
+}
+
+// Returns false at the first node whose inputs, attributes and outputs do not fit together; the error is
+// logged and, when given, described in `result`. Inferred descs are stored in Node::outputDescs.
+inline bool InferShapes(Graph& graph, const InferRegistry& registry, InferResult* result = nullptr) {
+    InferResult local;
+    InferResult& out = result != nullptr ? *result : local;
+    out = InferResult();
+    std::vector<Node>& nodes = graph.MutableNodes();
+    std::vector<bool> known(nodes.size(), false);
+    std::map<TensorRef, Dims> values;
+    auto fail = [&](const Node& node, const std::string& message) {
+        out.nodeName = node.name;
+        out.nodeType = node.type;
+        out.message = message;
+        ALOGE("[SHAPE_INFER] %s(%s): %s.\n", node.name.c_str(), node.type.c_str(), message.c_str());
+        return false;
+    };
+    for (size_t n = 0; n < nodes.size(); n++) {
+        Node& node = nodes[n];
+        if (node.type == "Data" || node.type == "Const") {
+            known[n] = !node.outputDescs.empty();
+            Dims value;
+            if (node.type == "Const" && ReadConstValue(node, value)) {
+                values[host_graph::Executor::Ref(static_cast<int>(n), 0)] = value;
+            }
+            continue;
+        }
+        const InferFunc* func = registry.Find(node.type);
+        bool inputsKnown = true;
+        std::vector<const ge::TensorDesc*> inputs;
+        std::vector<const Dims*> inputValues;
+        for (const auto& input : node.inputs) {
+            const Node& producer = nodes[input.node];
+            if (!known[input.node] || input.index >= static_cast<int>(producer.outputDescs.size())) {
+                inputsKnown = false;
+                break;
+            }
+            inputs.push_back(&producer.outputDescs[input.index]);
+            auto it = values.find(input);
+            inputValues.push_back(it == values.end() ? nullptr : &it->second);
+        }
+        if (func == nullptr || !inputsKnown) {
+            // hand-set descs are trusted for ops we can not infer
+            known[n] = !node.outputDescs.empty();
+            if (!known[n]) {
+                out.unknown.push_back(node.name);
+            }
+            continue;
+        }
+        InferContext context(node, inputs, inputValues);
+        if (!(*func)(context)) {
+            return fail(node, context.GetMessage());
+        }
+        const std::vector<ge::TensorDesc>& inferred = context.GetOutputs();
+        for (size_t i = 0; i < node.outputDescs.size() && i < inferred.size(); i++) {
+            Dims expected = node.outputDescs[i].GetShape().GetDims();
+            Dims actual = inferred[i].GetShape().GetDims();
+            if (expected != actual || node.outputDescs[i].GetDataType() != inferred[i].GetDataType()) {
+                return fail(node, "output " + std::to_string(i) + " is declared as " + DimsToString(expected) +
+                                  " dtype " + std::to_string(node.outputDescs[i].GetDataType()) + " but infers to " +
+                                  DimsToString(actual) + " dtype " + std::to_string(inferred[i].GetDataType()));
+            }
+        }
+        node.outputDescs = inferred;
+        for (const auto& value : context.GetOutputValues()) {
+            values[host_graph::Executor::Ref(static_cast<int>(n), static_cast<int>(value.first))] = value.second;
+        }
+        known[n] = true;
+        out.inferred++;
+    }
+    if (!out.unknown.empty()) {
+        ALOGI("[SHAPE_INFER] %zu nodes left unknown, first %s.\n", out.unknown.size(), out.unknown[0].c_str());
+    }
+    return true;
+}
+
+namespace detail {
+inline bool NormalizeAxis(InferContext& context, int64_t& axis, size_t rank) {
+    int64_t r = static_cast<int64_t>(rank);
+    if (axis < -r || axis >= r) {
+        return context.Error("axis %lld is out of range for rank %zu", static_cast<long long>(axis), rank);
+    }
+    axis = axis < 0 ? axis + r : axis;
+    return true;
+}
+
+inline bool Require4D(InferContext& context, int index) {
+    Dims dims = context.GetDims(index);
+    return dims.size() == 4 || context.Error("input %s must be 4D, got %s",
+                                             context.GetNode().inputNames[index].c_str(), DimsToString(dims).c_str());
+}
+}
+
+inline bool InferSameAsInput(InferContext& context) {
+    if (context.GetInputNum() == 0) {
+        return context.Error("no input");
+    }
+    context.SetOutput(0, context.GetDims(0), context.GetDataType(0));
+    return true;
+}
+
+// Numpy broadcasting between x1 and x2; comparison ops yield DT_BOOL.
+inline bool InferBroadcast(InferContext& context, bool boolOutput) {
+    if (context.GetInputNum() != 2) {
+        return context.Error("expects 2 inputs, got %zu", context.GetInputNum());
+    }
+    if (context.GetDataType(0) != context.GetDataType(1)) {
+        return context.Error("x1 and x2 have different dtypes %d and %d", context.GetDataType(0),
+                             context.GetDataType(1));
+    }
+    Dims a = context.GetDims(0);
+    Dims b = context.GetDims(1);
+    Dims dims(std::max(a.size(), b.size()));
+    for (size_t i = 0; i < dims.size(); i++) {
+        int64_t da = i < dims.size() - a.size() ? 1 : a[i - (dims.size() - a.size())];
+        int64_t db = i < dims.size() - b.size() ? 1 : b[i - (dims.size() - b.size())];
+        if (da != db && da != 1 && db != 1) {
+            return context.Error("%s and %s do not broadcast", DimsToString(a).c_str(), DimsToString(b).c_str());
+        }
+        dims[i] = da == 1 ? db : da;
+    }
+    context.SetOutput(0, dims, boolOutput ? ge::DT_BOOL : context.GetDataType(0));
+    return true;
+}
+
+inline bool InferEltwise(InferContext& context) {
+    for (size_t i = 1; i < context.GetInputNum(); i++) {
+        if (context.GetDims(i) != context.GetDims(0)) {
+            return context.Error("input %zu is %s, input 0 is %s", i, DimsToString(context.GetDims(i)).c_str(),
+                                 DimsToString(context.GetDims(0)).c_str());
+        }
+    }
+    return InferSameAsInput(context);
+}
+
+// Convolution, ConvolutionDepthwise and their quantized variants: x [N, C, H, W], filter [Co, C / groups, Kh, Kw].
+inline bool InferConvolution(InferContext& context) {
+    int x = 0;
+    int filter = 0;
+    if (!context.GetInput("x", x) || !context.GetInput("filter", filter) || !detail::Require4D(context, x) ||
+        !detail::Require4D(context, filter)) {
+        return false;
+    }
+    const Node& node = context.GetNode();
+    Dims xDims = context.GetDims(x);
+    Dims wDims = context.GetDims(filter);
+    host_kernel::ConvParam param;
+    if (!host_kernel::GetConvParam(node, xDims[2], xDims[3], wDims[2], wDims[3], param)) {
+        return context.Error("strides and dilations must be 2 positive values, pads 4 values");
+    }
+    bool depthwise = node.type.find("Depthwise") != std::string::npos;
+    int64_t groups = depthwise ? xDims[1] : node.GetInt("groups", 1);
+    if (groups <= 0 || wDims[0] % groups != 0 || wDims[1] * groups != xDims[1]) {
+        return context.Error("input channels %lld do not match filter %s with %lld groups",
+                             static_cast<long long>(xDims[1]), DimsToString(wDims).c_str(),
+                             static_cast<long long>(groups));
+    }
+    int bias = context.FindInput("bias");
+    if (bias >= 0 && ElementNum(context.GetDims(bias)) != wDims[0]) {
+        return context.Error("bias %s does not have %lld elements", DimsToString(context.GetDims(bias)).c_str(),
+                             static_cast<long long>(wDims[0]));
+    }
+    int64_t oh = host_kernel::ConvOutSize(xDims[2], wDims[2], param.strideH, param.dilationH, param.padTop,
+                                          param.padBottom);
+    int64_t ow = host_kernel::ConvOutSize(xDims[3], wDims[3], param.strideW, param.dilationW, param.padLeft,
+                                          param.padRight);
+    if (oh <= 0 || ow <= 0) {
+        return context.Error("kernel %lldx%lld does not fit the padded input %s", static_cast<long long>(wDims[2]),
+                             static_cast<long long>(wDims[3]), DimsToString(xDims).c_str());
+    }
+    context.SetOutput(0, {xDims[0], wDims[0], oh, ow}, ge::DT_FLOAT);
+    return true;
+}
+
+// x [N, Ci, H, W], filter [Ci, Co / groups, Kh, Kw]. With output_shape the transposed convolution of the
+// output has to give back H x W; without it the output size follows from the pads.
+inline bool InferConvTranspose(InferContext& context) {
+    int x = 0;
+    int filter = 0;
+    if (!context.GetInput("x", x) || !context.GetInput("filter", filter) || !detail::Require4D(context, x) ||
+        !detail::Require4D(context, filter)) {
+        return false;
+    }
+    const Node& node = context.GetNode();
+    Dims xDims = context.GetDims(x);
+    Dims wDims = context.GetDims(filter);
+    int64_t groups = node.GetInt("groups", 1);
+    if (groups <= 0 || wDims[0] != xDims[1] || wDims[0] % groups != 0) {
+        return context.Error("input channels %lld do not match filter %s with %lld groups",
+                             static_cast<long long>(xDims[1]), DimsToString(wDims).c_str(),
+                             static_cast<long long>(groups));
+    }
+    Dims outDims{xDims[0], wDims[1] * groups, 0, 0};
+    int outputShape = context.FindInput("output_shape");
+    if (outputShape >= 0) {
+        Dims value;
+        if (!context.GetValue(outputShape, value)) {
+            return false;
+        }
+        if (value.size() != 4 || value[0] != outDims[0] || value[1] != outDims[1]) {
+            return context.Error("output_shape %s does not match batch %lld and output channels %lld",
+                                 DimsToString(value).c_str(), static_cast<long long>(outDims[0]),
+                                 static_cast<long long>(outDims[1]));
+        }
+        outDims = value;
+    }
+    host_kernel::ConvParam param;
+    if (!host_kernel::GetConvParam(node, outDims[2], outDims[3], wDims[2], wDims[3], param)) {
+        return context.Error("strides and dilations must be 2 positive values, pads 4 values");
+    }
+    std::string padMode = node.GetString("pad_mode", "SPECIFIC");
+    if (outputShape < 0) {
+        if (padMode == "SAME") {
+            outDims[2] = xDims[2] * param.strideH;
+            outDims[3] = xDims[3] * param.strideW;
+        } else {
+            outDims[2] = (xDims[2] - 1) * param.strideH - param.padTop - param.padBottom +
+                         (wDims[2] - 1) * param.dilationH + 1;
+            outDims[3] = (xDims[3] - 1) * param.strideW - param.padLeft - param.padRight +
+                         (wDims[3] - 1) * param.dilationW + 1;
+        }
+        if (outDims[2] <= 0 || outDims[3] <= 0) {
+            return context.Error("output size %s is not positive", DimsToString(outDims).c_str());
+        }
+    } else {
+        // pads were resolved against the output size, which is what SAME needs
+        int64_t h = host_kernel::ConvOutSize(outDims[2], wDims[2], param.strideH, param.dilationH, param.padTop,
+                                             param.padBottom);
+        int64_t w = host_kernel::ConvOutSize(outDims[3], wDims[3], param.strideW, param.dilationW, param.padLeft,
+                                             param.padRight);
+        if (h != xDims[2] || w != xDims[3]) {
+            return context.Error("output_shape %s convolves back to %lldx%lld, not to the input %lldx%lld",
+                                 DimsToString(outDims).c_str(), static_cast<long long>(h),
+                                 static_cast<long long>(w), static_cast<long long>(xDims[2]),
+                                 static_cast<long long>(xDims[3]));
+        }
+    }
+    int bias = context.FindInput("bias");
+    if (bias >= 0 && ElementNum(context.GetDims(bias)) != outDims[1]) {
+        return context.Error("bias %s does not have %lld elements", DimsToString(context.GetDims(bias)).c_str(),
+                             static_cast<long long>(outDims[1]));
+    }
+    context.SetOutput(0, outDims, ge::DT_FLOAT);
+    return true;
+}
+
+// Mirrors host_kernel::RunFullyConnection: x is flattened from axis 1, w is [num_output, K...].
+inline bool InferFullyConnection(InferContext& context) {
+    int x = 0;
+    int w = 0;
+    if (!context.GetInput("x", x) || !context.GetInput("w", w)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    Dims wDims = context.GetDims(w);
+    if (xDims.size() < 2 || wDims.empty()) {
+        return context.Error("x %s or w %s has too few dims", DimsToString(xDims).c_str(),
+                             DimsToString(wDims).c_str());
+    }
+    int64_t n = xDims[0];
+    int64_t k = n > 0 ? ElementNum(xDims) / n : 0;
+    int64_t m = context.GetNode().GetInt("num_output", wDims[0]);
+    if (m <= 0 || ElementNum(wDims) != m * k) {
+        return context.Error("w %s is not [num_output %lld, %lld]", DimsToString(wDims).c_str(),
+                             static_cast<long long>(m), static_cast<long long>(k));
+    }
+    int b = context.FindInput("b");
+    if (b >= 0 && ElementNum(context.GetDims(b)) != m) {
+        return context.Error("b %s does not have %lld elements", DimsToString(context.GetDims(b)).c_str(),
+                             static_cast<long long>(m));
+    }
+    context.SetOutput(0, xDims.size() == 2 ? Dims{n, m} : Dims{n, m, 1, 1}, ge::DT_FLOAT);
+    return true;
+}
+
+// pad_mode 0 uses `pad` [top, bottom, left, right] with ceil_mode, 5 is VALID and 6 is SAME.
+inline bool InferPooling(InferContext& context) {
+    if (!detail::Require4D(context, 0)) {
+        return false;
+    }
+    const Node& node = context.GetNode();
+    Dims xDims = context.GetDims(0);
+    if (node.GetBool("global_pooling")) {
+        context.SetOutput(0, {xDims[0], xDims[1], 1, 1}, context.GetDataType(0));
+        return true;
+    }
+    Dims window = node.GetInts("window", {1, 1});
+    Dims stride = node.GetInts("stride", {1, 1});
+    Dims pad = node.GetInts("pad", {0, 0, 0, 0});
+    if (window.size() != 2 || stride.size() != 2 || pad.size() != 4 || stride[0] <= 0 || stride[1] <= 0) {
+        return context.Error("bad window, stride or pad");
+    }
+    int64_t padMode = node.GetInt("pad_mode", 0);
+    bool ceilMode = node.GetInt("ceil_mode", 0) != 0;
+    Dims outDims{xDims[0], xDims[1], 0, 0};
+    for (int i = 0; i < 2; i++) {
+        int64_t in = xDims[2 + i];
+        if (padMode == 6) {
+            outDims[2 + i] = (in + stride[i] - 1) / stride[i];
+        } else if (padMode == 5) {
+            outDims[2 + i] = (in - window[i] + stride[i]) / stride[i];
+        } else {
+            int64_t span = in + pad[2 * i] + pad[2 * i + 1] - window[i];
+            outDims[2 + i] = (ceilMode ? (span + stride[i] - 1) / stride[i] : span / stride[i]) + 1;
+        }
+        if (outDims[2 + i] <= 0) {
+            return context.Error("window %s does not fit the input %s", DimsToString(window).c_str(),
+                                 DimsToString(xDims).c_str());
+        }
+    }
+    context.SetOutput(0, outDims, context.GetDataType(0));
+    return true;
+}
+
+// LSTM: x [T, B, X], w_x [4H, X] -> h [T, B, H], h_t / c_t [1, B, H]. See host_kernel::LstmKernel.
+inline bool InferLstm(InferContext& context) {
+    int x = 0;
+    int wx = 0;
+    if (!context.GetInput("x", x) || !context.GetInput("w_x", wx)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    Dims wDims = context.GetDims(wx);
+    if (xDims.size() != 3 || wDims.size() != 2 || wDims[0] % 4 != 0 || wDims[1] != xDims[2]) {
+        return context.Error("x %s and w_x %s are not [T, B, X] and [4H, X]", DimsToString(xDims).c_str(),
+                             DimsToString(wDims).c_str());
+    }
+    int64_t hidden = wDims[0] / 4;
+    context.SetOutput(0, {xDims[0], xDims[1], hidden}, ge::DT_FLOAT);
+    context.SetOutput(1, {1, xDims[1], hidden}, ge::DT_FLOAT);
+    context.SetOutput(2, {1, xDims[1], hidden}, ge::DT_FLOAT);
+    return true;
+}
+
+// BidirectionLSTM: x [T, B, X], w_fw / w_bw [X + H, 4H] -> y_fw, y_bw [T, B, H] and four [B, H] states.
+inline bool InferBidirectionLstm(InferContext& context) {
+    int x = 0;
+    int w = 0;
+    if (!context.GetInput("x", x) || !context.GetInput("w_fw", w)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    Dims wDims = context.GetDims(w);
+    if (xDims.size() != 3 || wDims.size() != 2 || wDims[1] % 4 != 0 || wDims[0] != xDims[2] + wDims[1] / 4) {
+        return context.Error("x %s and w_fw %s are not [T, B, X] and [X + H, 4H]", DimsToString(xDims).c_str(),
+                             DimsToString(wDims).c_str());
+    }
+    int64_t hidden = wDims[1] / 4;
+    context.SetOutput(0, {xDims[0], xDims[1], hidden}, ge::DT_FLOAT);
+    context.SetOutput(1, {xDims[0], xDims[1], hidden}, ge::DT_FLOAT);
+    for (size_t i = 2; i < 6; i++) {
+        context.SetOutput(i, {xDims[1], hidden}, ge::DT_FLOAT);
+    }
+    return true;
+}
+
+// LayerNorm: y has the shape of x, the optional mean / variance keep the dims before begin_norm_axis and are 1
+// from there on.
+inline bool InferLayerNorm(InferContext& context) {
+    Dims dims = context.GetDims(0);
+    int64_t axis = context.GetNode().GetInt("begin_norm_axis", 0);
+    if (!detail::NormalizeAxis(context, axis, dims.size())) {
+        return false;
+    }
+    context.SetOutput(0, dims, context.GetDataType(0));
+    std::fill(dims.begin() + axis, dims.end(), 1);
+    context.SetOutput(1, dims, ge::DT_FLOAT);
+    context.SetOutput(2, dims, ge::DT_FLOAT);
+    return true;
+}
+
+// ResizeBilinear(V2) / ResizeNearestNeighbor: x [N, C, H, W], size is the constant [out_h, out_w].
+inline bool InferResize(InferContext& context) {
+    int x = 0;
+    int size = 0;
+    Dims value;
+    if (!context.GetInput("x", x) || !context.GetInput("size", size) || !detail::Require4D(context, x) ||
+        !context.GetValue(size, value)) {
+        return false;
+    }
+    if (value.size() != 2 || value[0] <= 0 || value[1] <= 0) {
+        return context.Error("size %s is not a positive [height, width]", DimsToString(value).c_str());
+    }
+    Dims xDims = context.GetDims(x);
+    context.SetOutput(0, {xDims[0], xDims[1], value[0], value[1]}, context.GetDataType(x));
+    return true;
+}
+
+// Interp: x [N, C, H, W], the output size comes from the attributes, see host_kernel::InterpOutSize.
+inline bool InferInterp(InferContext& context) {
+    int x = 0;
+    if (!context.GetInput("x", x) || !detail::Require4D(context, x)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    int64_t oh = 0;
+    int64_t ow = 0;
+    if (!host_kernel::InterpOutSize(host_kernel::GetInterpParam(context.GetNode()), xDims[2], xDims[3], oh, ow)) {
+        return context.Error("factors and pads do not give a positive output for %s", DimsToString(xDims).c_str());
+    }
+    context.SetOutput(0, {xDims[0], xDims[1], oh, ow}, context.GetDataType(x));
+    return true;
+}
+
+// `shape` replaces dims [axis, axis + num_axes) of x (all of them by default); 0 copies the input dim and a
+// single -1 is inferred from the element count.
+inline bool InferReshape(InferContext& context) {
+    int x = 0;
+    int shape = 0;
+    Dims value;
+    if (!context.GetInput("x", x) || !context.GetInput("shape", shape) || !context.GetValue(shape, value)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    int64_t axis = context.GetNode().GetInt("axis", 0);
+    int64_t numAxes = context.GetNode().GetInt("num_axes", -1);
+    if (axis < 0) {
+        axis += static_cast<int64_t>(xDims.size()) + 1;
+    }
+    int64_t end = numAxes < 0 ? static_cast<int64_t>(xDims.size()) : axis + numAxes;
+    if (axis < 0 || axis > end || end > static_cast<int64_t>(xDims.size())) {
+        return context.Error("axis %lld / num_axes %lld do not fit %s", static_cast<long long>(axis),
+                             static_cast<long long>(numAxes), DimsToString(xDims).c_str());
+    }
+    Dims dims(xDims.begin(), xDims.begin() + axis);
+    int inferred = -1;
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == 0 && axis + static_cast<int64_t>(i) < static_cast<int64_t>(xDims.size())) {
+            dims.push_back(xDims[axis + i]);
+        } else if (value[i] == -1 && inferred < 0) {
+            inferred = static_cast<int>(dims.size());
+            dims.push_back(1);
+        } else if (value[i] <= 0) {
+            return context.Error("bad shape %s", DimsToString(value).c_str());
+        } else {
+            dims.push_back(value[i]);
+        }
+    }
+    dims.insert(dims.end(), xDims.begin() + end, xDims.end());
+    int64_t num = ElementNum(dims);
+    if (inferred >= 0 && num > 0 && ElementNum(xDims) % num == 0) {
+        dims[inferred] = ElementNum(xDims) / num;
+    }
+    if (ElementNum(dims) != ElementNum(xDims)) {
+        return context.Error("can not reshape %s to %s", DimsToString(xDims).c_str(), DimsToString(value).c_str());
+    }
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+// ConcatD (concat_dim) and the compatible Concat (axis).
+inline bool InferConcat(InferContext& context) {
+    if (context.GetInputNum() == 0) {
+        return context.Error("no input");
+    }
+    const Node& node = context.GetNode();
+    Dims dims = context.GetDims(0);
+    int64_t axis = node.HasAttr("concat_dim") ? node.GetInt("concat_dim") : node.GetInt("axis", 1);
+    if (!detail::NormalizeAxis(context, axis, dims.size())) {
+        return false;
+    }
+    for (size_t i = 1; i < context.GetInputNum(); i++) {
+        Dims other = context.GetDims(i);
+        bool match = other.size() == dims.size() && context.GetDataType(i) == context.GetDataType(0);
+        for (size_t d = 0; match && d < dims.size(); d++) {
+            match = static_cast<int64_t>(d) == axis || other[d] == dims[d];
+        }
+        if (!match) {
+            return context.Error("input %zu %s does not concat with %s on axis %lld", i,
+                                 DimsToString(other).c_str(), DimsToString(context.GetDims(0)).c_str(),
+                                 static_cast<long long>(axis));
+        }
+        dims[axis] += other[axis];
+    }
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferPack(InferContext& context) {
+    if (!InferEltwise(context)) {
+        return false;
+    }
+    Dims dims = context.GetDims(0);
+    int64_t axis = context.GetNode().GetInt("axis", 0);
+    int64_t rank = static_cast<int64_t>(dims.size()) + 1;
+    if (axis < -rank || axis >= rank) {
+        return context.Error("axis %lld is out of range", static_cast<long long>(axis));
+    }
+    axis = axis < 0 ? axis + rank : axis;
+    dims.insert(dims.begin() + axis, static_cast<int64_t>(context.GetInputNum()));
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferSplit(InferContext& context) {
+    Dims dims = context.GetDims(0);
+    int64_t axis = context.GetNode().GetInt("split_dim", 0);
+    int64_t num = context.GetNode().GetInt("num_split", 1);
+    if (!detail::NormalizeAxis(context, axis, dims.size())) {
+        return false;
+    }
+    if (num <= 0 || dims[axis] % num != 0) {
+        return context.Error("dim %lld of %s does not split into %lld", static_cast<long long>(axis),
+                             DimsToString(dims).c_str(), static_cast<long long>(num));
+    }
+    dims[axis] /= num;
+    for (int64_t i = 0; i < num; i++) {
+        context.SetOutput(static_cast<size_t>(i), dims, context.GetDataType(0));
+    }
+    return true;
+}
+
+// TensorFlow semantics, including ellipsis, new axis and shrink masks.
+inline bool InferStridedSlice(InferContext& context) {
+    int x = 0;
+    int beginIndex = 0;
+    int endIndex = 0;
+    int stridesIndex = 0;
+    Dims begin;
+    Dims end;
+    Dims strides;
+    if (!context.GetInput("x", x) || !context.GetInput("begin", beginIndex) || !context.GetInput("end", endIndex) ||
+        !context.GetInput("strides", stridesIndex) || !context.GetValue(beginIndex, begin) ||
+        !context.GetValue(endIndex, end) || !context.GetValue(stridesIndex, strides)) {
+        return false;
+    }
+    if (begin.size() != end.size() || begin.size() != strides.size()) {
+        return context.Error("begin, end and strides have different lengths");
+    }
+    const Node& node = context.GetNode();
+    int64_t beginMask = node.GetInt("begin_mask");
+    int64_t endMask = node.GetInt("end_mask");
+    int64_t ellipsisMask = node.GetInt("ellipsis_mask");
+    int64_t newAxisMask = node.GetInt("new_axis_mask");
+    int64_t shrinkMask = node.GetInt("shrink_axis_mask");
+    Dims xDims = context.GetDims(x);
+    size_t consumed = 0;
+    for (size_t i = 0; i < begin.size(); i++) {
+        consumed += ((newAxisMask | ellipsisMask) >> i & 1) ? 0 : 1;
+    }
+    if (consumed > xDims.size()) {
+        return context.Error("%zu sliced axes for %s", consumed, DimsToString(xDims).c_str());
+    }
+    bool hasEllipsis = ellipsisMask != 0;
+    Dims dims;
+    size_t d = 0;
+    for (size_t i = 0; i < begin.size(); i++) {
+        if (ellipsisMask >> i & 1) {
+            for (size_t e = 0; e < xDims.size() - consumed; e++) {
+                dims.push_back(xDims[d++]);
+            }
+            continue;
+        }
+        if (newAxisMask >> i & 1) {
+            dims.push_back(1);
+            continue;
+        }
+        int64_t size = xDims[d++];
+        int64_t stride = strides[i];
+        if (stride == 0) {
+            return context.Error("stride %zu is 0", i);
+        }
+        int64_t b = begin[i] < 0 ? begin[i] + size : begin[i];
+        int64_t e = end[i] < 0 ? end[i] + size : end[i];
+        if (shrinkMask >> i & 1) {
+            if (b < 0 || b >= size) {
+                return context.Error("shrinking index %lld is out of %lld", static_cast<long long>(begin[i]),
+                                     static_cast<long long>(size));
+            }
+            continue;
+        }
+        if (stride > 0) {
+            b = (beginMask >> i & 1) ? 0 : std::min(std::max<int64_t>(b, 0), size);
+            e = (endMask >> i & 1) ? size : std::min(std::max<int64_t>(e, 0), size);
+            dims.push_back(std::max<int64_t>(0, (e - b + stride - 1) / stride));
+        } else {
+            b = (beginMask >> i & 1) ? size - 1 : std::min(std::max<int64_t>(b, -1), size - 1);
+            e = (endMask >> i & 1) ? -1 : std::min(std::max<int64_t>(e, -1), size - 1);
+            dims.push_back(std::max<int64_t>(0, (b - e - stride - 1) / -stride));
+        }
+    }
+    // axes past the spec are taken whole, unless an ellipsis already did
+    while (!hasEllipsis && d < xDims.size()) {
+        dims.push_back(xDims[d++]);
+    }
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+inline bool InferSlice(InferContext& context) {
+    int x = 0;
+    int offsetsIndex = 0;
+    int sizeIndex = 0;
+    Dims offsets;
+    Dims size;
+    if (!context.GetInput("x", x) || !context.GetInput("offsets", offsetsIndex) ||
+        !context.GetInput("size", sizeIndex) || !context.GetValue(offsetsIndex, offsets) ||
+        !context.GetValue(sizeIndex, size)) {
+        return false;
+    }
+    Dims xDims = context.GetDims(x);
+    if (offsets.size() != xDims.size() || size.size() != xDims.size()) {
+        return context.Error("offsets and size must have %zu values", xDims.size());
+    }
+    Dims dims(xDims.size());
+    for (size_t i = 0; i < dims.size(); i++) {
+        dims[i] = size[i] == -1 ? xDims[i] - offsets[i] : size[i];
+        if (offsets[i] < 0 || dims[i] < 0 || offsets[i] + dims[i] > xDims[i]) {
+            return context.Error("slice %s + %s exceeds %s", DimsToString(offsets).c_str(),
+                                 DimsToString(size).c_str(), DimsToString(xDims).c_str());
+        }
+    }
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+inline bool InferPermute(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    Dims order = context.GetNode().GetInts("order", {0});
+    std::vector<bool> used(xDims.size(), false);
+    if (order.size() != xDims.size()) {
+        return context.Error("order %s does not match rank %zu", DimsToString(order).c_str(), xDims.size());
+    }
+    Dims dims(xDims.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        int64_t axis = order[i];
+        if (!detail::NormalizeAxis(context, axis, xDims.size()) || used[axis]) {
+            return context.Error("order %s is not a permutation", DimsToString(order).c_str());
+        }
+        used[axis] = true;
+        dims[i] = xDims[axis];
+    }
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferFlatten(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    if (xDims.empty()) {
+        return context.Error("scalar input");
+    }
+    context.SetOutput(0, {xDims[0], ElementNum(xDims) / std::max<int64_t>(xDims[0], 1)}, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferSqueeze(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    Dims axes = context.GetNode().GetInts("axis");
+    std::vector<bool> squeeze(xDims.size(), axes.empty());
+    for (auto axis : axes) {
+        if (!detail::NormalizeAxis(context, axis, xDims.size())) {
+            return false;
+        }
+        if (xDims[axis] != 1) {
+            return context.Error("dim %lld of %s is not 1", static_cast<long long>(axis), DimsToString(xDims).c_str());
+        }
+        squeeze[axis] = true;
+    }
+    Dims dims;
+    for (size_t i = 0; i < xDims.size(); i++) {
+        if (!squeeze[i] || xDims[i] != 1) {
+            dims.push_back(xDims[i]);
+        }
+    }
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferExpandDims(InferContext& context) {
+    int x = 0;
+    int axisIndex = 0;
+    Dims value;
+    if (!context.GetInput("x", x) || !context.GetInput("axis", axisIndex) || !context.GetValue(axisIndex, value)) {
+        return false;
+    }
+    Dims dims = context.GetDims(x);
+    int64_t rank = static_cast<int64_t>(dims.size()) + 1;
+    if (value.size() != 1 || value[0] < -rank || value[0] >= rank) {
+        return context.Error("bad axis %s", DimsToString(value).c_str());
+    }
+    dims.insert(dims.begin() + (value[0] < 0 ? value[0] + rank : value[0]), 1);
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+// Pad / PadV2 / MirrorPad: paddings is a constant [rank, 2].
+inline bool InferPad(InferContext& context) {
+    int x = 0;
+    int paddingsIndex = 0;
+    Dims paddings;
+    if (!context.GetInput("x", x) || !context.GetInput("paddings", paddingsIndex) ||
+        !context.GetValue(paddingsIndex, paddings)) {
+        return false;
+    }
+    Dims dims = context.GetDims(x);
+    if (paddings.size() != 2 * dims.size()) {
+        return context.Error("paddings must be [%zu, 2]", dims.size());
+    }
+    for (size_t i = 0; i < dims.size(); i++) {
+        dims[i] += paddings[2 * i] + paddings[2 * i + 1];
+        if (paddings[2 * i] < 0 || paddings[2 * i + 1] < 0) {
+            return context.Error("negative paddings %s", DimsToString(paddings).c_str());
+        }
+    }
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+inline bool InferTile(InferContext& context) {
+    int x = 0;
+    int multiplesIndex = 0;
+    Dims multiples;
+    if (!context.GetInput("x", x) || !context.GetInput("multiples", multiplesIndex) ||
+        !context.GetValue(multiplesIndex, multiples)) {
+        return false;
+    }
+    Dims dims = context.GetDims(x);
+    if (multiples.size() != dims.size()) {
+        return context.Error("multiples %s do not match rank %zu", DimsToString(multiples).c_str(), dims.size());
+    }
+    for (size_t i = 0; i < dims.size(); i++) {
+        dims[i] *= multiples[i];
+    }
+    context.SetOutput(0, dims, context.GetDataType(x));
+    return true;
+}
+
+// ReduceSum / ReduceMean / ReduceMax / ReduceMin take the axes as a constant input, ReduceProdD as an attr.
+inline bool InferReduce(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    Dims axes = context.GetNode().GetInts("axes");
+    int axesIndex = context.FindInput("axes");
+    if (axesIndex >= 0 && !context.GetValue(axesIndex, axes)) {
+        return false;
+    }
+    std::vector<bool> reduced(xDims.size(), axes.empty());
+    for (auto axis : axes) {
+        if (!detail::NormalizeAxis(context, axis, xDims.size())) {
+            return false;
+        }
+        reduced[axis] = true;
+    }
+    bool keepDims = context.GetNode().GetBool("keep_dims");
+    Dims dims;
+    for (size_t i = 0; i < xDims.size(); i++) {
+        if (!reduced[i]) {
+            dims.push_back(xDims[i]);
+        } else if (keepDims) {
+            dims.push_back(1);
+        }
+    }
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferMatMul(InferContext& context) {
+    Dims a = context.GetDims(0);
+    Dims b = context.GetDims(1);
+    const Node& node = context.GetNode();
+    bool batch = node.type == "BatchMatMul";
+    bool transA = node.GetBool(batch ? "adj_x1" : "transpose_x1");
+    bool transB = node.GetBool(batch ? "adj_x2" : "transpose_x2");
+    if (a.size() < 2 || b.size() < 2 || (!batch && (a.size() != 2 || b.size() != 2)) ||
+        a.size() != b.size() || !std::equal(a.begin(), a.end() - 2, b.begin())) {
+        return context.Error("can not multiply %s and %s", DimsToString(a).c_str(), DimsToString(b).c_str());
+    }
+    size_t r = a.size();
+    int64_t m = transA ? a[r - 1] : a[r - 2];
+    int64_t k = transA ? a[r - 2] : a[r - 1];
+    int64_t kb = transB ? b[r - 1] : b[r - 2];
+    int64_t n = transB ? b[r - 2] : b[r - 1];
+    if (k != kb) {
+        return context.Error("inner dims of %s and %s differ", DimsToString(a).c_str(), DimsToString(b).c_str());
+    }
+    Dims dims(a.begin(), a.end() - 2);
+    dims.push_back(m);
+    dims.push_back(n);
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline bool InferCast(InferContext& context) {
+    const Node& node = context.GetNode();
+    int64_t dstType = node.HasAttr("dst_dtype") ? node.GetInt("dst_dtype") : node.GetInt("DstT", -1);
+    if (dstType < 0) {
+        return context.Error("dst_dtype is not set");
+    }
+    context.SetOutput(0, context.GetDims(0), static_cast<ge::DataType>(dstType));
+    return true;
+}
+
+// TopK: values and int32 indices with the last dimension replaced by the constant k.
+inline bool InferTopK(InferContext& context) {
+    int x = 0;
+    int k = 0;
+    Dims value;
+    if (!context.GetInput("x", x) || !context.GetInput("k", k) || !context.GetValue(k, value)) {
+        return false;
+    }
+    Dims dims = context.GetDims(x);
+    if (dims.empty() || value.size() != 1 || value[0] < 1 || value[0] > dims.back()) {
+        return context.Error("k %s does not fit %s", DimsToString(value).c_str(), DimsToString(dims).c_str());
+    }
+    dims.back() = value[0];
+    context.SetOutput(0, dims, context.GetDataType(x));
+    context.SetOutput(1, dims, ge::DT_INT32);
+    return true;
+}
+
+// ArgMaxExt2: x with the constant axis removed, or kept as 1 with keep_dims.
+inline bool InferArgMax(InferContext& context) {
+    int x = 0;
+    int axisIndex = 0;
+    Dims value;
+    if (!context.GetInput("x", x) || !context.GetInput("axis", axisIndex) || !context.GetValue(axisIndex, value)) {
+        return false;
+    }
+    Dims dims = context.GetDims(x);
+    if (value.size() != 1) {
+        return context.Error("axis must be a scalar, got %s", DimsToString(value).c_str());
+    }
+    int64_t axis = value[0];
+    if (!detail::NormalizeAxis(context, axis, dims.size())) {
+        return false;
+    }
+    if (context.GetNode().GetBool("keep_dims")) {
+        dims[axis] = 1;
+    } else {
+        dims.erase(dims.begin() + axis);
+    }
+    context.SetOutput(0, dims, static_cast<ge::DataType>(context.GetNode().GetInt("output_type", ge::DT_INT32)));
+    return true;
+}
+
+// Gather / GatherV2D: x.dims[:axis] + indices.dims + x.dims[axis + 1:].
+inline bool InferGather(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    Dims indicesDims = context.GetDims(1);
+    int64_t axis = context.GetNode().GetInt("axis", 0);
+    if (!detail::NormalizeAxis(context, axis, xDims.size())) {
+        return false;
+    }
+    Dims dims(xDims.begin(), xDims.begin() + axis);
+    dims.insert(dims.end(), indicesDims.begin(), indicesDims.end());
+    dims.insert(dims.end(), xDims.begin() + axis + 1, xDims.end());
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+// GatherNd: indices.dims[:-1] + x.dims[depth:] with depth = indices.dims[-1].
+inline bool InferGatherNd(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    Dims indicesDims = context.GetDims(1);
+    if (indicesDims.empty() || indicesDims.back() < 1 || indicesDims.back() > static_cast<int64_t>(xDims.size())) {
+        return context.Error("indices %s do not fit x %s", DimsToString(indicesDims).c_str(),
+                             DimsToString(xDims).c_str());
+    }
+    Dims dims(indicesDims.begin(), indicesDims.end() - 1);
+    dims.insert(dims.end(), xDims.begin() + indicesDims.back(), xDims.end());
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+// ScatterNd: the constant shape, float like x.
+inline bool InferScatterNd(InferContext& context) {
+    int shape = 0;
+    Dims value;
+    if (!context.GetInput("shape", shape) || !context.GetValue(shape, value)) {
+        return false;
+    }
+    context.SetOutput(0, value, ge::DT_FLOAT);
+    return true;
+}
+
+// The only op with a value output: lets Shape -> Reshape chains resolve.
+inline bool InferShape(InferContext& context) {
+    Dims xDims = context.GetDims(0);
+    context.SetOutput(0, {static_cast<int64_t>(xDims.size())}, ge::DT_INT32);
+    context.SetOutputValue(0, xDims);
+    return true;
+}
+
+// DepthToSpace / SpaceToDepth, data_format defaults to NHWC.
+inline bool InferSpaceDepth(InferContext& context) {
+    if (!detail::Require4D(context, 0)) {
+        return false;
+    }
+    const Node& node = context.GetNode();
+    int64_t block = node.GetInt("block_size", 0);
+    bool nchw = node.GetString("data_format", "NHWC") == "NCHW";
+    bool toSpace = node.type == "DepthToSpace";
+    Dims dims = context.GetDims(0);
+    int c = nchw ? 1 : 3;
+    int h = nchw ? 2 : 1;
+    if (block <= 0 || (toSpace && dims[c] % (block * block) != 0) ||
+        (!toSpace && (dims[h] % block != 0 || dims[h + 1] % block != 0))) {
+        return context.Error("block_size %lld does not divide %s", static_cast<long long>(block),
+                             DimsToString(dims).c_str());
+    }
+    dims[c] = toSpace ? dims[c] / (block * block) : dims[c] * block * block;
+    dims[h] = toSpace ? dims[h] * block : dims[h] / block;
+    dims[h + 1] = toSpace ? dims[h + 1] * block : dims[h + 1] / block;
+    context.SetOutput(0, dims, context.GetDataType(0));
+    return true;
+}
+
+inline void RegisterBuiltinInferFuncs(InferRegistry& registry) {
+    for (const char* type : {"Activation", "Sqrt", "Square", "Rsqrt", "Exp", "Expm1", "Log", "Log1p", "Neg",
+                             "Reciprocal", "Floor", "Ceil", "Round", "Rint", "Sign", "Sin", "Cos", "Tan", "Sinh",
+                             "Cosh", "Asin", "Acos", "Atan", "Asinh", "Acosh", "Atanh", "LogicalNot", "Softmax",
+                             "LogSoftmax", "LRN", "BNInference", "Scale", "BiasAdd", "PRelu", "HardSwish",
+                             "ClipByValue", "L2Normalize", "InstanceNorm", "Threshold", "StopGradient",
+                             "FakeQuantWithMinMaxVars", "FakeQuantWithMinMaxVarsPerChannel", "ShuffleChannel",
+                             "ShuffleChannelV2", "ChannelAxpy"}) {
+        registry.Register(type, InferSameAsInput);
+    }
+    for (const char* type : {"Add", "Sub", "Mul", "RealDiv", "Maximum", "Minimum", "Pow", "Power", "FloorDiv",
+                             "FloorMod", "SquaredDifference"}) {
+        registry.Register(type, [](InferContext& context) { return InferBroadcast(context, false); });
+    }
+    for (const char* type : {"Equal", "NotEqual", "Greater", "GreaterEqual", "Less", "LessEqual", "LogicalAnd",
+                             "LogicalOr", "LogicalXor"}) {
+        registry.Register(type, [](InferContext& context) { return InferBroadcast(context, true); });
+    }
+    registry.Register("Eltwise", InferEltwise);
+    for (const char* type : {"Convolution", "ConvolutionDepthwise", "QuantizedConvolution",
+                             "QuantizedConvolutionDepthwise"}) {
+        registry.Register(type, InferConvolution);
+    }
+    registry.Register("ConvTranspose", InferConvTranspose);
+    registry.Register("FullyConnection", InferFullyConnection);
+    registry.Register("QuantizedFullyConnection", InferFullyConnection);
+    registry.Register("PoolingD", InferPooling);
+    for (const char* type : {"ResizeBilinear", "ResizeBilinearV2", "ResizeNearestNeighbor"}) {
+        registry.Register(type, InferResize);
+    }
+    registry.Register("Interp", InferInterp);
+    registry.Register("LSTM", InferLstm);
+    registry.Register("BidirectionLSTM", InferBidirectionLstm);
+    registry.Register("LayerNorm", InferLayerNorm);
+    registry.Register("Reshape", InferReshape);
+    registry.Register("ConcatD", InferConcat);
+    registry.Register("Concat", InferConcat);
+    registry.Register("Pack", InferPack);
+    registry.Register("SplitD", InferSplit);
+    registry.Register("StridedSlice", InferStridedSlice);
+    registry.Register("Slice", InferSlice);
+    registry.Register("Permute", InferPermute);
+    registry.Register("Flatten", InferFlatten);
+    registry.Register("Squeeze", InferSqueeze);
+    registry.Register("ExpandDims", InferExpandDims);
+    for (const char* type : {"Pad", "PadV2", "MirrorPad"}) {
+        registry.Register(type, InferPad);
+    }
+    registry.Register("Tile", InferTile);
+    for (const char* type : {"ReduceSum", "ReduceMean", "ReduceMax", "ReduceMin", "ReduceProdD"}) {
+        registry.Register(type, InferReduce);
+    }
+    registry.Register("MatMul", InferMatMul);
+    registry.Register("BatchMatMul", InferMatMul);
+    registry.Register("CastT", InferCast);
+    registry.Register("Cast", InferCast);
+    registry.Register("Shape", InferShape);
+    registry.Register("TopK", InferTopK);
+    registry.Register("ArgMaxExt2", InferArgMax);
+    registry.Register("Gather", InferGather);
+    registry.Register("GatherV2D", InferGather);
+    registry.Register("GatherNd", InferGatherNd);
+    registry.Register("ScatterNd", InferScatterNd);
+    registry.Register("DepthToSpace", InferSpaceDepth);
+    registry.Register("SpaceToDepth", InferSpaceDepth);
+}
+
+inline const InferRegistry& GetBuiltinInferFuncs() {
+    static InferRegistry registry = []() {
+        InferRegistry builtin;
+        RegisterBuiltinInferFuncs(builtin);
+        return builtin;
+    }();
+    return registry;
+}
+}
+
+#endif //BUILD_IR_MODEL_SHAPE_INFERENCE_H
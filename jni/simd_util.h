@@ -0,0 +1,192 @@
+#ifndef BUILD_IR_MODEL_SIMD_UTIL_H
+#define BUILD_IR_MODEL_SIMD_UTIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SIMD_UTIL_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_UTIL_SSE 1
+#endif
+
+// 4-lane float helpers shared by the host kernels. NEON is the production path (arm64-v8a),
+// SSE2 keeps the same code fast when the kernels are run on an x86 host, and the scalar
+// fallback keeps everything portable.
+namespace simd_util {
+#if defined(SIMD_UTIL_NEON)
+using Float4 = float32x4_t;
+
+inline Float4 Load4(const float* p) { return vld1q_f32(p); }
+inline void Store4(float* p, Float4 v) { vst1q_f32(p, v); }
+inline Float4 Set4(float v) { return vdupq_n_f32(v); }
+inline Float4 Add4(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+inline Float4 Sub4(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+inline Float4 Mul4(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+inline Float4 Max4(Float4 a, Float4 b) { return vmaxq_f32(a, b); }
+inline Float4 Min4(Float4 a, Float4 b) { return vminq_f32(a, b); }
+// a * b + c
+inline Float4 Fma4(Float4 a, Float4 b, Float4 c) {
+#if defined(__aarch64__)
+    return vfmaq_f32(c, a, b);
+#else
+    return vmlaq_f32(c, a, b);
+#endif
+}
+inline Float4 Div4(Float4 a, Float4 b) {
+#if defined(__aarch64__)
+    return vdivq_f32(a, b);
+#else
+    Float4 r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+#endif
+}
+inline float ReduceSum4(Float4 v) {
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+inline float ReduceMax4(Float4 v) {
+    float32x2_t m = vmax_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpmax_f32(m, m), 0);
+}
+// Floor4 and Pow2i4 (2^n for integral n) are the building blocks of Exp4.
+inline Float4 Floor4(Float4 x) {
+    Float4 t = vcvtq_f32_s32(vcvtq_s32_f32(x));
+    uint32x4_t mask = vcgtq_f32(t, x);
+    return vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(mask, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+}
+inline Float4 Pow2i4(Float4 n) {
+    int32x4_t e = vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+    return vreinterpretq_f32_s32(e);
+}
+inline void Transpose4x4(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+    float32x4x2_t t01 = vtrnq_f32(r0, r1);
+    float32x4x2_t t23 = vtrnq_f32(r2, r3);
+    r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+    r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+    r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+    r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+#elif defined(SIMD_UTIL_SSE)
+using Float4 = __m128;
+
+inline Float4 Load4(const float* p) { return _mm_loadu_ps(p); }
+inline void Store4(float* p, Float4 v) { _mm_storeu_ps(p, v); }
+inline Float4 Set4(float v) { return _mm_set1_ps(v); }
+inline Float4 Add4(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+inline Float4 Sub4(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+inline Float4 Mul4(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+inline Float4 Max4(Float4 a, Float4 b) { return _mm_max_ps(a, b); }
+inline Float4 Min4(Float4 a, Float4 b) { return _mm_min_ps(a, b); }
+inline Float4 Fma4(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline Float4 Div4(Float4 a, Float4 b) { return _mm_div_ps(a, b); }
+inline float ReduceSum4(Float4 v) {
+    Float4 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+inline float ReduceMax4(Float4 v) {
+    Float4 m = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+}
+inline Float4 Floor4(Float4 x) {
+    Float4 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+inline Float4 Pow2i4(Float4 n) {
+    __m128i e = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23);
+    return _mm_castsi128_ps(e);
+}
+inline void Transpose4x4(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+}
+#else
+struct Float4 {
+    float v[4];
+};
+
+inline Float4 Load4(const float* p) { Float4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline void Store4(float* p, Float4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline Float4 Set4(float x) { return Float4{{x, x, x, x}}; }
+#define SIMD_UTIL_SCALAR_OP(name, expr) \
+    inline Float4 name(Float4 a, Float4 b) { \
+        Float4 r; \
+        for (int i = 0; i < 4; i++) { \
+            r.v[i] = (expr); \
+        } \
+        return r; \
+    }
+SIMD_UTIL_SCALAR_OP(Add4, a.v[i] + b.v[i])
+SIMD_UTIL_SCALAR_OP(Sub4, a.v[i] - b.v[i])
+SIMD_UTIL_SCALAR_OP(Mul4, a.v[i] * b.v[i])
+SIMD_UTIL_SCALAR_OP(Div4, a.v[i] / b.v[i])
+SIMD_UTIL_SCALAR_OP(Max4, std::max(a.v[i], b.v[i]))
+SIMD_UTIL_SCALAR_OP(Min4, std::min(a.v[i], b.v[i]))
+#undef SIMD_UTIL_SCALAR_OP
+inline Float4 Fma4(Float4 a, Float4 b, Float4 c) { return Add4(Mul4(a, b), c); }
+inline float ReduceSum4(Float4 v) { return (v.v[0] + v.v[1]) + (v.v[2] + v.v[3]); }
+inline float ReduceMax4(Float4 v) { return std::max(std::max(v.v[0], v.v[1]), std::max(v.v[2], v.v[3])); }
+inline Float4 Floor4(Float4 x) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = std::floor(x.v[i]);
+    }
+    return r;
+}
+inline Float4 Pow2i4(Float4 n) {
+    Float4 r;
+    for (int i = 0; i < 4; i++) {
+        r.v[i] = std::ldexp(1.0f, static_cast<int>(n.v[i]));
+    }
+    return r;
+}
+inline void Transpose4x4(Float4& r0, Float4& r1, Float4& r2, Float4& r3) {
+    Float4* rows[4] = {&r0, &r1, &r2, &r3};
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            std::swap(rows[i]->v[j], rows[j]->v[i]);
+        }
+    }
+}
+#endif
+
+inline Float4 Abs4(Float4 x) {
+    return Max4(x, Sub4(Set4(0.0f), x));
+}
+
+// Cephes-style exp, relative error below 2e-7 on [-87, 88].
+inline Float4 Exp4(Float4 x) {
+    x = Min4(Max4(x, Set4(-87.0f)), Set4(88.0f));
+    Float4 n = Floor4(Fma4(x, Set4(1.44269504088896341f), Set4(0.5f)));
+    x = Sub4(x, Mul4(n, Set4(0.693359375f)));
+    x = Sub4(x, Mul4(n, Set4(-2.12194440e-4f)));
+    Float4 p = Set4(1.9875691500e-4f);
+    p = Fma4(p, x, Set4(1.3981999507e-3f));
+    p = Fma4(p, x, Set4(8.3334519073e-3f));
+    p = Fma4(p, x, Set4(4.1665795894e-2f));
+    p = Fma4(p, x, Set4(1.6666665459e-1f));
+    p = Fma4(p, x, Set4(5.0000001201e-1f));
+    p = Fma4(p, Mul4(x, x), Add4(x, Set4(1.0f)));
+    return Mul4(p, Pow2i4(n));
+}
+
+// 1 / (1 + e^-x); saturates to 0 / 1 through the clamp of Exp4.
+inline Float4 Sigmoid4(Float4 x) {
+    return Div4(Set4(1.0f), Add4(Set4(1.0f), Exp4(Sub4(Set4(0.0f), x))));
+}
+
+// (1 - e^-2x) / (1 + e^-2x), absolute error below 2e-7.
+inline Float4 Tanh4(Float4 x) {
+    Float4 e = Exp4(Mul4(x, Set4(-2.0f)));
+    return Div4(Sub4(Set4(1.0f), e), Add4(Set4(1.0f), e));
+}
+}
+
+#endif //BUILD_IR_MODEL_SIMD_UTIL_H
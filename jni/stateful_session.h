@@ -0,0 +1,214 @@
+#ifndef BUILD_IR_MODEL_STATEFUL_SESSION_H
+#define BUILD_IR_MODEL_STATEFUL_SESSION_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "HiAiModelManagerService.h"
+#include "log_util.h"
+
+// Streaming inference for models that carry state between calls (SVDF state_in / state_out, LSTM h_0 / c_0 and
+// h_t / c_t exported as graph IO). A StateBinding ties an output to the input that receives it on the next
+// Run(). When the two AiTensors have the same dimensions and size the session swaps the shared_ptrs instead of
+// copying: the input slot takes the buffer the NPU just wrote, the output slot gets the stale one to overwrite.
+// Because of that the tensor objects behind GetInputs() / GetOutputs() move between runs, so always go through
+// the session to read outputs or fill the next chunk:
+//
+//     stateful_session::StatefulSession session(stateful_session::ClientProcess(client, "kws.om"), inputs,
+//                                               outputs);
+//     session.Bind(1, 1, "svdf_state");
+//     for (each 10 ms hop) {
+//         FillTensorWithData(session.GetInputs()[0], features);
+//         session.Run();
+//         ... session.GetOutputs()[0] ...
+//     }
+//     session.Reset();  // end of utterance
+//
+// Snapshot() / Restore() save and roll back the carried state, e.g. to re-run a hop after a false trigger.
+namespace stateful_session {
+using VecAiTensor = std::vector<std::shared_ptr<hiai::AiTensor>>;
+using ProcessFunc = std::function<bool(VecAiTensor& inputs, VecAiTensor& outputs)>;
+
+// Runs `modelName` on an AiModelMngerClient, with the same context RunModel() uses.
+inline ProcessFunc ClientProcess(const std::shared_ptr<hiai::AiModelMngerClient>& client,
+                                 const std::string& modelName) {
+    return [client, modelName](VecAiTensor& inputs, VecAiTensor& outputs) {
+        hiai::AiContext context;
+        context.AddPara("model_name", modelName);
+        int istamp = 0;
+        int ret = client->Process(context, inputs, outputs, 1000, istamp);
+        if (ret != hiai::AI_SUCCESS) {
+            ALOGE("[SESSION] %s: process failed, ret=%d.\n", modelName.c_str(), ret);
+            return false;
+        }
+        return true;
+    };
+}
+
+struct StateBinding {
+    size_t output = 0;
+    size_t input = 0;
+    std::string name;
+};
+
+// Contents of the bound state inputs, in binding order.
+using StateSnapshot = std::vector<std::vector<uint8_t>>;
+
+struct SessionStat {
+    uint64_t runs = 0;
+    uint64_t swaps = 0;
+    uint64_t copies = 0;
+    uint64_t bytesCopied = 0;
+};
+
+class StatefulSession {
+public:
+    StatefulSession(const ProcessFunc& process, const VecAiTensor& inputs, const VecAiTensor& outputs)
+        : process_(process), inputs_(inputs), outputs_(outputs) {}
+
+    // Output `output` feeds input `input` on the next run. The state input is zeroed when bound; false if the
+    // indices are out of range, the sizes differ or the input already receives another state.
+    bool Bind(size_t output, size_t input, const std::string& name) {
+        StateBinding binding;
+        binding.output = output;
+        binding.input = input;
+        binding.name = name;
+        if (binding.output >= outputs_.size() || binding.input >= inputs_.size()) {
+            ALOGE("[SESSION] %s: output %zu / input %zu out of range.\n", binding.name.c_str(), binding.output,
+                  binding.input);
+            return false;
+        }
+        if (outputs_[binding.output]->GetSize() != inputs_[binding.input]->GetSize()) {
+            ALOGE("[SESSION] %s: output %zu has %u bytes, input %zu has %u.\n", binding.name.c_str(),
+                  binding.output, outputs_[binding.output]->GetSize(), binding.input,
+                  inputs_[binding.input]->GetSize());
+            return false;
+        }
+        for (const Bound& bound : bindings_) {
+            if (bound.binding.input == binding.input) {
+                ALOGE("[SESSION] %s: input %zu is already bound to %s.\n", binding.name.c_str(), binding.input,
+                      bound.binding.name.c_str());
+                return false;
+            }
+        }
+        Bound bound;
+        bound.binding = binding;
+        bound.swap = CanSwap(binding);
+        bindings_.push_back(bound);
+        // an output feeding two inputs is copied for all of them, a swap would leave the second one stale
+        for (Bound& other : bindings_) {
+            if (other.binding.output == binding.output && &other != &bindings_.back()) {
+                other.swap = false;
+                bindings_.back().swap = false;
+            }
+        }
+        std::memset(inputs_[binding.input]->GetBuffer(), 0, inputs_[binding.input]->GetSize());
+        ALOGI("[SESSION] %s: output %zu -> input %zu by %s, %u bytes.\n", binding.name.c_str(), binding.output,
+              binding.input, bindings_.back().swap ? "swap" : "copy", inputs_[binding.input]->GetSize());
+        return true;
+    }
+
+    // One Process() call, then the state outputs become the state inputs of the next one.
+    bool Run() {
+        if (!process_(inputs_, outputs_)) {
+            return false;
+        }
+        stat_.runs++;
+        for (const Bound& bound : bindings_) {
+            std::shared_ptr<hiai::AiTensor>& out = outputs_[bound.binding.output];
+            std::shared_ptr<hiai::AiTensor>& in = inputs_[bound.binding.input];
+            if (bound.swap) {
+                std::swap(out, in);
+                stat_.swaps++;
+            } else {
+                std::memcpy(in->GetBuffer(), out->GetBuffer(), in->GetSize());
+                stat_.copies++;
+                stat_.bytesCopied += in->GetSize();
+            }
+        }
+        return true;
+    }
+
+    // Zeroes the state, or restores the one given to SetResetState().
+    void Reset() {
+        if (!resetState_.empty()) {
+            Restore(resetState_);
+            return;
+        }
+        for (const Bound& bound : bindings_) {
+            std::memset(inputs_[bound.binding.input]->GetBuffer(), 0, inputs_[bound.binding.input]->GetSize());
+        }
+    }
+
+    void SetResetState(const StateSnapshot& state) { resetState_ = state; }
+
+    StateSnapshot Snapshot() const {
+        StateSnapshot snapshot;
+        for (const Bound& bound : bindings_) {
+            const auto& tensor = inputs_[bound.binding.input];
+            const uint8_t* data = static_cast<const uint8_t*>(tensor->GetBuffer());
+            snapshot.emplace_back(data, data + tensor->GetSize());
+        }
+        return snapshot;
+    }
+
+    bool Restore(const StateSnapshot& snapshot) {
+        if (snapshot.size() != bindings_.size()) {
+            ALOGE("[SESSION] snapshot has %zu states, the session binds %zu.\n", snapshot.size(), bindings_.size());
+            return false;
+        }
+        for (size_t i = 0; i < bindings_.size(); i++) {
+            const auto& tensor = inputs_[bindings_[i].binding.input];
+            if (snapshot[i].size() != tensor->GetSize()) {
+                ALOGE("[SESSION] %s: snapshot has %zu bytes, the input %u.\n", bindings_[i].binding.name.c_str(),
+                      snapshot[i].size(), tensor->GetSize());
+                return false;
+            }
+        }
+        for (size_t i = 0; i < bindings_.size(); i++) {
+            std::memcpy(inputs_[bindings_[i].binding.input]->GetBuffer(), snapshot[i].data(), snapshot[i].size());
+        }
+        return true;
+    }
+
+    // Current tensors; state slots change identity after each Run() when they are swapped.
+    VecAiTensor& GetInputs() { return inputs_; }
+    VecAiTensor& GetOutputs() { return outputs_; }
+
+    SessionStat GetStat() const { return stat_; }
+
+private:
+    struct Bound {
+        StateBinding binding;
+        bool swap = false;
+    };
+
+    // AIPP inputs carry their own preprocessing parameters and must stay in place.
+    bool CanSwap(const StateBinding& binding) const {
+        const auto& out = outputs_[binding.output];
+        const auto& in = inputs_[binding.input];
+        if (dynamic_cast<hiai::AippTensor*>(in.get()) != nullptr ||
+            dynamic_cast<hiai::AippTensor*>(out.get()) != nullptr) {
+            return false;
+        }
+        hiai::TensorDimension outDims = out->GetTensorDimension();
+        hiai::TensorDimension inDims = in->GetTensorDimension();
+        return outDims.GetNumber() == inDims.GetNumber() && outDims.GetChannel() == inDims.GetChannel() &&
+               outDims.GetHeight() == inDims.GetHeight() && outDims.GetWidth() == inDims.GetWidth();
+    }
+
+    ProcessFunc process_;
+    VecAiTensor inputs_;
+    VecAiTensor outputs_;
+    std::vector<Bound> bindings_;
+    StateSnapshot resetState_;
+    SessionStat stat_;
+};
+}
+
+#endif //BUILD_IR_MODEL_STATEFUL_SESSION_H
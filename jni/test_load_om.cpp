@@ -1,44 +1,32 @@
 #include "test_util.h"
 #include "check.h"
+#include "om_loader.h"
 
 using namespace std;
 using namespace test_case;
 using namespace test_util;
 using namespace om_model;
 namespace test_case {
-bool CheckResult() {
-    return true;
-}
-
-void Test(const TestCase& test) {
+// Runs one model of the bundle loaded by LoadModelParallel.
+void Test(const TestCase& test, std::shared_ptr<hiai::AiModelMngerClient>& client, string& name,
+          VecAiTensor& inputs, VecAiTensor& outputs) {
     cout << "============= CaseName: " << test.caseName << endl;
-    std::vector<std::string> names{test.caseName};
-    std::vector<std::string> modelPaths{test.caseName + ".om"};
-    VecVecAiTensor modelsInputs;
-    VecVecAiTensor modelsOutputs;
-    std::vector<bool> useAipps{false};
-
-    auto client = LoadModelSync(names, modelPaths, modelsInputs, modelsOutputs, useAipps);
-    if (client == nullptr) {
-        cerr << "ERROR: Load " << test.caseName << " failed." << endl;
-        return;
-    }
     if (test.inputFromFile) {
-        FillTensorFromFile<float>(modelsInputs[0][0], test.caseName + ".bin");
+        FillTensorFromNpy(inputs[0], test.caseName + ".npy");
     } else {
-        FillTensorWithData<float>(modelsInputs[0][0]);
+        FillTensorWithData<float>(inputs[0]);
     }
-    if (Process(client, names[0], modelsInputs[0], modelsOutputs[0]) != SUCCESS) {
-        cerr << "ERROR: run " << names[0] << " failed." << endl;
+    if (Process(client, name, inputs, outputs) != SUCCESS) {
+        cerr << "ERROR: run " << name << " failed." << endl;
         return;
     }
-    PrintTensorData<float>(modelsInputs[0][0], 0, 32);
+    PrintTensorData<float>(inputs[0], 0, 32);
     int i = 0;
-    for (const shared_ptr<hiai::AiTensor>& tensor : modelsOutputs[0]) {
+    for (const shared_ptr<hiai::AiTensor>& tensor : outputs) {
         PrintTensorData<float>(tensor, 0, 32);
-        SaveTensorData<float>(tensor, "/data/local/tmp/output/output_" + to_string(i++) + ".bin");
+        SaveTensorNpy<float>(tensor, "/data/local/tmp/output/output_" + to_string(i++) + ".npy");
     }
-    cout << "-------------" << test.caseName << " -------- " << CheckResult() << endl;
+    cout << "-------------" << test.caseName << " -------- " << CheckOutputs(test, outputs) << endl;
 }
 }
 
@@ -47,10 +35,24 @@ int main(int argc, char* argv[]) {
     TestCase caseList[] = {
         {"sqrt_ir", nullptr, false},
     };
+    // every case model is read and loaded up front, file reads overlapping the device loads
+    std::vector<std::string> names;
+    std::vector<std::string> modelPaths;
     for (const TestCase& tc : caseList) {
-        Test(tc);
+        names.push_back(tc.caseName);
+        modelPaths.push_back(tc.caseName + ".om");
+    }
+    VecVecAiTensor modelsInputs;
+    VecVecAiTensor modelsOutputs;
+    std::vector<bool> useAipps(names.size(), false);
+    auto client = LoadModelParallel(names, modelPaths, modelsInputs, modelsOutputs, useAipps);
+    if (client == nullptr) {
+        cerr << "ERROR: Load models failed." << endl;
+        return 1;
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        Test(caseList[i], client, names[i], modelsInputs[i], modelsOutputs[i]);
     }
     ALOGE("=========== ALL DONE ===========\n");
     return 0;
 }
-
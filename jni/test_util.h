@@ -1,7 +1,9 @@
 #ifndef BUILD_IR_MODEL_TEST_UTIL_H
 #define BUILD_IR_MODEL_TEST_UTIL_H
 
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <unistd.h>
@@ -14,9 +16,12 @@
 #include <unordered_map>
 #include <array>
 #include <sstream>
-#include <android/log.h>
+#include <sys/select.h>
 #include <sys/system_properties.h>
+#include <sys/time.h>
 
+#include "accuracy_check.h"
+#include "dump_writer.h"
 #include "hiai_ir_build.h"
 #include "HiAiModelManagerService.h"
 #include "graph/buffer.h"
@@ -26,15 +31,11 @@
 #include "graph/operator_hiai_reg.h"
 #include "graph/compatible/operator_reg.h"
 #include "graph/compatible/all_ops.h"
-
-#define LOG_TAG "NNN_TEST"
-#define ALOGE(...) \
-    __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__); \
-    printf(__VA_ARGS__)
-
-#define ALOGI(...) \
-    __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__); \
-    printf(__VA_ARGS__)
+#include "host_kernel/top_k.h"
+#include "irpb_loader.h"
+#include "layout_util.h"
+#include "log_util.h"
+#include "npy_io.h"
 
 static const int SUCCESS = 0;
 static const int FAILED = -1;
@@ -138,6 +139,35 @@ void FillTensorWithData(std::shared_ptr<hiai::AiTensor>& tensor, const std::vect
     (void)memcpy(tensor->GetBuffer(), data.data(), data.size() * sizeof(T));
 }
 
+// Fills an NCHW float tensor from data laid out in `format`, e.g. NHWC camera frames, without a Permute in the
+// graph or a naive per-element transpose.
+bool FillTensorWithLayout(std::shared_ptr<hiai::AiTensor>& tensor, const std::vector<float>& data, ge::Format format) {
+    auto dims = tensor->GetTensorDimension();
+    layout_util::Shape4 shape;
+    shape.n = dims.GetNumber();
+    shape.c = dims.GetChannel();
+    shape.h = dims.GetHeight();
+    shape.w = dims.GetWidth();
+    size_t num = layout_util::GetElementNum(ge::FORMAT_NCHW, shape);
+    if (num * sizeof(float) != tensor->GetSize() || layout_util::GetElementNum(format, shape) != data.size()) {
+        ALOGE("tensor size(%u) or data.size(%zu) does not match format %d.\n", tensor->GetSize(), data.size(),
+              static_cast<int>(format));
+        return false;
+    }
+    return layout_util::Convert(data.data(), format, static_cast<float*>(tensor->GetBuffer()), ge::FORMAT_NCHW,
+                                shape);
+}
+
+std::vector<float> RandomUniform(size_t num, float low, float high, unsigned int seed) {
+    std::default_random_engine engine(seed);
+    std::uniform_real_distribution<float> uniform(low, high);
+    std::vector<float> data(num);
+    for (auto& v : data) {
+        v = uniform(engine);
+    }
+    return data;
+}
+
 template<typename T>
 void FillTensorWithData(std::shared_ptr<hiai::AiTensor>& tensor) {
     std::default_random_engine engine(time(nullptr));
@@ -169,6 +199,108 @@ int Prod(const std::vector<int64_t>& list) {
     return prod;
 }
 
+// The NCHW shape of the tensor, or a flat one when it is not an NCHW tensor of T.
+template<typename T>
+std::vector<int64_t> GetNpyShape(const std::shared_ptr<hiai::AiTensor>& tensor) {
+    auto dims = tensor->GetTensorDimension();
+    std::vector<int64_t> shape = {dims.GetNumber(), dims.GetChannel(), dims.GetHeight(), dims.GetWidth()};
+    if (static_cast<size_t>(Prod(shape)) * sizeof(T) != tensor->GetSize()) {
+        shape = {static_cast<int64_t>(tensor->GetSize() / sizeof(T))};
+    }
+    return shape;
+}
+
+// Saves the tensor as .npy with its NCHW shape, np.load gets the layout without any side information.
+template<typename T>
+bool SaveTensorNpy(const std::shared_ptr<hiai::AiTensor>& tensor, const std::string& path) {
+    return npy_io::WriteNpy(path, npy_io::DescrOf<T>(), GetNpyShape<T>(tensor), tensor->GetBuffer(),
+                            tensor->GetSize());
+}
+
+// Top k of every batch item of an output tensor ([N, C, H, W] read as N rows of C * H * W scores) straight from
+// its buffer, for heads where TopK / ArgMax is not available on the device or not worth the extra op. dataType
+// is HIAI_DATATYPE_FLOAT32 or HIAI_DATATYPE_FLOAT16; values / indices get N * k entries, best first when sorted.
+bool TopKFromTensor(const std::shared_ptr<hiai::AiTensor>& tensor, hiai::HIAI_DataType dataType, int64_t k,
+                    bool sorted, std::vector<float>& values, std::vector<int32_t>& indices) {
+    auto dims = tensor->GetTensorDimension();
+    int64_t rows = dims.GetNumber();
+    int64_t num = static_cast<int64_t>(dims.GetChannel()) * dims.GetHeight() * dims.GetWidth();
+    size_t elementSize = dataType == hiai::HIAI_DATATYPE_FLOAT16 ? sizeof(uint16_t) : sizeof(float);
+    if ((dataType != hiai::HIAI_DATATYPE_FLOAT32 && dataType != hiai::HIAI_DATATYPE_FLOAT16) ||
+        static_cast<size_t>(rows * num) * elementSize != tensor->GetSize() || k < 1 || k > num) {
+        ALOGE("TopKFromTensor: data type %d, size %u, k %lld do not fit %lld x %lld.\n", static_cast<int>(dataType),
+              tensor->GetSize(), static_cast<long long>(k), static_cast<long long>(rows), static_cast<long long>(num));
+        return false;
+    }
+    values.resize(static_cast<size_t>(rows * k));
+    indices.resize(static_cast<size_t>(rows * k));
+    if (dataType == hiai::HIAI_DATATYPE_FLOAT16) {
+        host_kernel::TopKHalf(static_cast<const uint16_t*>(tensor->GetBuffer()), rows, num, k, sorted, values.data(),
+                              indices.data());
+    } else {
+        host_kernel::TopK(static_cast<const float*>(tensor->GetBuffer()), rows, num, k, sorted, values.data(),
+                          indices.data());
+    }
+    return true;
+}
+
+// Fills a float tensor from an .npy of any numeric dtype with the same number of elements.
+bool FillTensorFromNpy(std::shared_ptr<hiai::AiTensor>& tensor, const std::string& path) {
+    npy_io::NpyArray array;
+    if (!npy_io::ReadNpy(path, array)) {
+        return false;
+    }
+    size_t num = tensor->GetSize() / sizeof(float);
+    if (array.GetElementNum() != num) {
+        ALOGE("%s holds %zu elements, the tensor %zu.\n", path.c_str(), array.GetElementNum(), num);
+        return false;
+    }
+    if (array.Data<float>() != nullptr) {
+        (void)memcpy(tensor->GetBuffer(), array.GetData(), array.GetByteSize());
+        return true;
+    }
+    std::vector<float> value;
+    if (!array.ToFloat(value)) {
+        return false;
+    }
+    FillTensorWithData<float>(tensor, value);
+    return true;
+}
+
+// Compares the outputs of a case fed from <caseName>.npy with <caseName>_golden_<i>.npy. Cases fed with random
+// data have no reference and are not checked. AiTensor keeps no data type, so an output is taken for float32 only
+// when its size is four bytes per element of its dims; other outputs fail the check.
+bool CheckOutputs(const test_case::TestCase& test, const std::vector<std::shared_ptr<hiai::AiTensor>>& outputs,
+                  const accuracy_check::Tolerance& tolerance = accuracy_check::GetTolerance(ge::DT_FLOAT16)) {
+    if (!test.inputFromFile) {
+        ALOGI("[ACCURACY] %s runs on random input, outputs are not checked.\n", test.caseName.c_str());
+        return true;
+    }
+    bool passed = true;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        std::string golden = test.caseName + "_golden_" + std::to_string(i) + ".npy";
+        npy_io::NpyArray ref;
+        if (!npy_io::ReadNpy(golden, ref)) {
+            ALOGE("[ACCURACY] no reference %s for output %zu.\n", golden.c_str(), i);
+            passed = false;
+            continue;
+        }
+        hiai::TensorDimension dims = outputs[i]->GetTensorDimension();
+        size_t num = static_cast<size_t>(dims.GetNumber()) * dims.GetChannel() * dims.GetHeight() * dims.GetWidth();
+        if (num == 0 || outputs[i]->GetSize() != num * sizeof(float)) {
+            ALOGE("[ACCURACY] output %zu has %u bytes for %zu elements, only float32 outputs are compared.\n", i,
+                  outputs[i]->GetSize(), num);
+            passed = false;
+            continue;
+        }
+        accuracy_check::Report report;
+        const float* out = static_cast<const float*>(outputs[i]->GetBuffer());
+        passed = accuracy_check::CheckTensor(golden, out, num, ref, tolerance, report) && passed;
+        accuracy_check::PrintReport(report);
+    }
+    return passed;
+}
+
 void SetConstData(hiai::op::Const& constOp, const hiai::TensorDesc& wDesc, uint8_t* data, size_t dataSize) {
     hiai::TensorPtr weight = std::make_shared<hiai::Tensor>();
     weight->SetTensorDesc(wDesc);
@@ -197,24 +329,99 @@ void SetConvTranspose(string& name, hiai::op::ConvTranspose& deconv, hiai::op::C
 }
 
 namespace ir_model {
+// The first Process() after Load pays for lazy device initialization and is always reported on its own.
+// Warm-up runs after it are not counted either: a fixed number of them, or with autoSteadyState until the
+// coefficient of variation of the last `window` runs drops below cvThreshold.
+struct WarmupOptions {
+    int warmupRuns = 0;
+    bool autoSteadyState = false;
+    int window = 10;
+    double cvThreshold = 0.05;
+    int maxWarmupRuns = 200;
+};
+
+// Float outputs of every timed run appended as frames to <dir>/<model>_output_<i>.npy by a background writer,
+// after the time is taken. Warm-up runs are not dumped.
+struct OutputDump {
+    dump_writer::DumpWriter* writer = nullptr;
+    std::string dir = ".";
+};
+
+struct RunStat {
+    double coldStartMs = 0;   // Init + Load, filled by Build
+    double firstMs = 0;       // first Process() after Load
+    int warmupRuns = 0;
+    bool steady = false;      // steady state detected (autoSteadyState only)
+    double warmupCv = 0;      // cv of the last window when warm-up ended
+    std::vector<double> timesMs;
+    double avgMs = 0;
+    double minMs = 0;
+    double maxMs = 0;
+    double stdMs = 0;
+};
+
+// Coefficient of variation over a sliding window, O(1) per sample.
+class SlidingCv {
+public:
+    explicit SlidingCv(int window) : window_(static_cast<size_t>(std::max(window, 2))) {}
+
+    void Push(double v) {
+        values_.push_back(v);
+        sum_ += v;
+        sumSq_ += v * v;
+        if (values_.size() > window_) {
+            double old = values_[values_.size() - window_ - 1];
+            sum_ -= old;
+            sumSq_ -= old * old;
+        }
+    }
+
+    bool IsFull() const { return values_.size() >= window_; }
+
+    double Get() const {
+        size_t n = std::min(values_.size(), window_);
+        if (n < 2) {
+            return 0;
+        }
+        double mean = sum_ / n;
+        double var = std::max(sumSq_ / n - mean * mean, 0.0);
+        return mean > 0 ? std::sqrt(var) / mean : 0;
+    }
+
+private:
+    size_t window_;
+    std::vector<double> values_;
+    double sum_ = 0;
+    double sumSq_ = 0;
+};
+
+void PrintRunStat(const RunStat& stat) {
+    ALOGI("[cold start] %.3f ms, [first inference] %.3f ms, [time to first result] %.3f ms\n", stat.coldStartMs,
+          stat.firstMs, stat.coldStartMs + stat.firstMs);
+    ALOGI("[warm-up] %d runs, steady %d, cv %.4f\n", stat.warmupRuns, stat.steady, stat.warmupCv);
+    ALOGI("[steady state] [total] %zu, [avg] %.3f ms, [max] %.3f ms, [min] %.3f ms, [std] %.3f ms\n",
+          stat.timesMs.size(), stat.avgMs, stat.maxMs, stat.minMs, stat.stdMs);
+}
+
 bool RunModel(const std::shared_ptr<hiai::AiModelMngerClient>& client,
               const std::string& modelName,
               std::vector<std::shared_ptr<hiai::AiTensor>>* inputTensors,
               std::vector<std::shared_ptr<hiai::AiTensor>>* outputTensors,
-              int repeats = 1, float sleepMSAfterProcess = 0) {
+              int repeats = 1, float sleepMSAfterProcess = 0,
+              const WarmupOptions& warmup = WarmupOptions(), RunStat* runStat = nullptr,
+              const OutputDump& dump = OutputDump()) {
     hiai::AiContext context;
     string key = "model_name";
     const string& value = modelName;
     context.AddPara(key, value);
 
-    vector<double> inferenceTime(repeats, 0);
     struct timeval tpstart, tpend;
     int istamp;
     struct timeval delay;
     delay.tv_sec = 0;
     delay.tv_usec = sleepMSAfterProcess * 1000; // ms
 
-    for (int i = 0; i < repeats; i++) {
+    auto runOnce = [&](double* ms) {
         gettimeofday(&tpstart, nullptr);
         int retCode = client->Process(context, *inputTensors, *outputTensors, 1000, istamp);
         if (retCode) {
@@ -222,30 +429,72 @@ bool RunModel(const std::shared_ptr<hiai::AiModelMngerClient>& client,
             return false;
         }
         gettimeofday(&tpend, nullptr);
-        double timeUse = 1000000 * (tpend.tv_sec - tpstart.tv_sec) + tpend.tv_usec - tpstart.tv_usec;
-        inferenceTime[i] = timeUse;
+        *ms = (1000000 * (tpend.tv_sec - tpstart.tv_sec) + tpend.tv_usec - tpstart.tv_usec) / 1000.0;
         if (sleepMSAfterProcess > 0) {
             select(0, nullptr, nullptr, nullptr, &delay);
         }
+        return true;
+    };
+
+    RunStat localStat;
+    RunStat& stat = runStat != nullptr ? *runStat : localStat;
+    if (!runOnce(&stat.firstMs)) {
+        return false;
+    }
+    SlidingCv cv(warmup.window);
+    int maxWarmupRuns = warmup.autoSteadyState ? std::max(warmup.maxWarmupRuns, warmup.warmupRuns)
+                                               : warmup.warmupRuns;
+    stat.warmupRuns = 0;
+    stat.steady = false;
+    while (stat.warmupRuns < maxWarmupRuns) {
+        if (warmup.autoSteadyState && stat.warmupRuns >= warmup.warmupRuns && cv.IsFull() &&
+            cv.Get() <= warmup.cvThreshold) {
+            stat.steady = true;
+            break;
+        }
+        double ms;
+        if (!runOnce(&ms)) {
+            return false;
+        }
+        cv.Push(ms);
+        stat.warmupRuns++;
+    }
+    stat.warmupCv = cv.Get();
+    if (warmup.autoSteadyState && !stat.steady) {
+        ALOGI("steady state not reached after %d warm-up runs, cv %.4f\n", stat.warmupRuns, stat.warmupCv);
     }
 
-    ALOGI("Show inference time start:\n");
-    double count = 0;
-    double min = 99999;
-    double max = 0;
-    for (int i = 0; i < inferenceTime.size(); ++i) {
-        inferenceTime[i] /= 1000;
-        count += inferenceTime[i];
-        if (inferenceTime[i] > max) {
-            max = inferenceTime[i];
+    stat.timesMs.assign(repeats, 0);
+    for (int i = 0; i < repeats; i++) {
+        if (!runOnce(&stat.timesMs[i])) {
+            return false;
         }
-        if (inferenceTime[i] < min) {
-            min = inferenceTime[i];
+        for (size_t j = 0; dump.writer != nullptr && j < outputTensors->size(); j++) {
+            const auto& tensor = (*outputTensors)[j];
+            std::string path = dump.dir + "/" + modelName + "_output_" + std::to_string(j) + ".npy";
+            dump.writer->AppendNpyFrame(path, "<f4", test_util::GetNpyShape<float>(tensor),
+                                        tensor->GetBuffer(), tensor->GetSize());
         }
-        ALOGI("index: %d, time: %.3f ms\n", i, inferenceTime[i]);
     }
-    ALOGI("[total] %lu, [avg] %.3f ms, [max] %.3f ms, [min] %.3f ms\nShow inference time end.\n ", inferenceTime.size(),
-          count / inferenceTime.size(), max, min);
+
+    ALOGI("Show inference time start:\n");
+    double count = 0;
+    double sumSq = 0;
+    stat.minMs = repeats > 0 ? stat.timesMs[0] : 0;
+    stat.maxMs = 0;
+    for (size_t i = 0; i < stat.timesMs.size(); ++i) {
+        count += stat.timesMs[i];
+        sumSq += stat.timesMs[i] * stat.timesMs[i];
+        stat.maxMs = std::max(stat.maxMs, stat.timesMs[i]);
+        stat.minMs = std::min(stat.minMs, stat.timesMs[i]);
+        ALOGI("index: %zu, time: %.3f ms\n", i, stat.timesMs[i]);
+    }
+    if (repeats > 0) {
+        stat.avgMs = count / repeats;
+        stat.stdMs = std::sqrt(std::max(sumSq / repeats - stat.avgMs * stat.avgMs, 0.0));
+    }
+    PrintRunStat(stat);
+    ALOGI("Show inference time end.\n");
     return true;
 }
 
@@ -253,13 +502,12 @@ std::shared_ptr<hiai::AiModelMngerClient> Build(
     const std::string& modelName,
     ge::Model& irModel,
     std::vector<std::shared_ptr<hiai::AiTensor>>* inputTensors,
-    std::vector<std::shared_ptr<hiai::AiTensor>>* outputTensors) {
+    std::vector<std::shared_ptr<hiai::AiTensor>>* outputTensors,
+    RunStat* runStat = nullptr) {
     domi::HiaiIrBuild irBuild;
     domi::ModelBufferData omModelBuf;
 
-    ge::Buffer buffer;
-    irModel.Save(buffer);
-    test_util::WriteFile(buffer.GetData(), buffer.GetSize(), modelName + ".irpb");
+    SaveIrpb(irModel, modelName + ".irpb");
     if (!irBuild.CreateModelBuff(irModel, omModelBuf)) {
         ALOGE("ERROR: build alloc om failed.\n");
         return nullptr;
@@ -269,6 +517,8 @@ std::shared_ptr<hiai::AiModelMngerClient> Build(
         ALOGE("ERROR: build ir model failed.\n");
         return nullptr;
     }
+    struct timeval loadStart, loadEnd;
+    gettimeofday(&loadStart, nullptr);
     auto client = std::make_shared<hiai::AiModelMngerClient>();
     int retCode = client->Init(nullptr);
     if (retCode != hiai::AI_SUCCESS) {
@@ -284,6 +534,11 @@ std::shared_ptr<hiai::AiModelMngerClient> Build(
         ALOGE("ERROR: hiai::AiModelMngerClient load model failed.\n");
         return nullptr;
     }
+    gettimeofday(&loadEnd, nullptr);
+    if (runStat != nullptr) {
+        runStat->coldStartMs = (1000000 * (loadEnd.tv_sec - loadStart.tv_sec) + loadEnd.tv_usec - loadStart.tv_usec) /
+                               1000.0;
+    }
     std::vector<hiai::TensorDimension> inputDims;
     std::vector<hiai::TensorDimension> outputDims;
     retCode = client->GetModelIOTensorDim(modelName, inputDims, outputDims);
@@ -410,11 +665,7 @@ int LoadSync(std::vector<std::string>& names,
     return SUCCESS;
 }
 
-std::shared_ptr<hiai::AiModelMngerClient> LoadModelSync(std::vector<std::string>& names,
-                                                        std::vector<std::string>& modelPaths,
-                                                        VecVecAiTensor& modelsInputs,
-                                                        VecVecAiTensor& modelsOutputs,
-                                                        std::vector<bool>& aipps) {
+std::shared_ptr<hiai::AiModelMngerClient> CreateModelClient() {
     std::shared_ptr<hiai::AiModelMngerClient> clientSync = std::make_shared<hiai::AiModelMngerClient>();
     if (clientSync == nullptr) {
         ALOGE("[HIAI_DEMO_SYNC] Model Manager Client make_shared error.");
@@ -425,12 +676,14 @@ std::shared_ptr<hiai::AiModelMngerClient> LoadModelSync(std::vector<std::string>
         ALOGE("[HIAI_DEMO_SYNC] Model Manager Init Failed.");
         return nullptr;
     }
-    ret = LoadSync(names, modelPaths, clientSync);
-    if (ret != SUCCESS) {
-        ALOGE("[HIAI_DEMO_ASYNC] LoadSync Failed.");
-        return nullptr;
-    }
+    return clientSync;
+}
 
+int CreateModelTensors(std::shared_ptr<hiai::AiModelMngerClient>& client,
+                       std::vector<std::string>& names,
+                       VecVecAiTensor& modelsInputs,
+                       VecVecAiTensor& modelsOutputs,
+                       std::vector<bool>& aipps) {
     modelsInputs.clear();
     modelsOutputs.clear();
     for (size_t i = 0; i < names.size(); ++i) {
@@ -438,22 +691,42 @@ std::shared_ptr<hiai::AiModelMngerClient> LoadModelSync(std::vector<std::string>
         bool isUseAipp = !aipps.empty() && aipps[i];
         ALOGI("[HIAI_DEMO_SYNC] Get model %s IO Tensor. Use AIPP %d", modelName.c_str(), isUseAipp);
         std::vector<hiai::TensorDimension> inputDims, outputDims;
-        ret = clientSync->GetModelIOTensorDim(std::string(modelName) + std::string(".om"), inputDims, outputDims);
+        int ret = client->GetModelIOTensorDim(std::string(modelName) + std::string(".om"), inputDims, outputDims);
         if (ret != SUCCESS) {
             ALOGE("[HIAI_DEMO_SYNC] Get Model IO Tensor Dimension failed,ret is %d.", ret);
-            return nullptr;
+            return FAILED;
         }
         if (inputDims.empty()) {
             ALOGE("[HIAI_DEMO_SYNC] inputDims is empty.");
-            return nullptr;
+            return FAILED;
         }
         if (UpdateTensorVec(modelName, modelsInputs, inputDims, isUseAipp) != SUCCESS) {
-            return nullptr;
+            return FAILED;
         }
         if (UpdateTensorVec(modelName, modelsOutputs, outputDims, false) != SUCCESS) {
-            return nullptr;
+            return FAILED;
         }
     }
+    return SUCCESS;
+}
+
+std::shared_ptr<hiai::AiModelMngerClient> LoadModelSync(std::vector<std::string>& names,
+                                                        std::vector<std::string>& modelPaths,
+                                                        VecVecAiTensor& modelsInputs,
+                                                        VecVecAiTensor& modelsOutputs,
+                                                        std::vector<bool>& aipps) {
+    std::shared_ptr<hiai::AiModelMngerClient> clientSync = CreateModelClient();
+    if (clientSync == nullptr) {
+        return nullptr;
+    }
+    int ret = LoadSync(names, modelPaths, clientSync);
+    if (ret != SUCCESS) {
+        ALOGE("[HIAI_DEMO_ASYNC] LoadSync Failed.");
+        return nullptr;
+    }
+    if (CreateModelTensors(clientSync, names, modelsInputs, modelsOutputs, aipps) != SUCCESS) {
+        return nullptr;
+    }
     return clientSync;
 }
 
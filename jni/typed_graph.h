@@ -0,0 +1,545 @@
+#ifndef BUILD_IR_MODEL_TYPED_GRAPH_H
+#define BUILD_IR_MODEL_TYPED_GRAPH_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "host_graph.h"
+
+// Compile-time checked graph construction on top of host_graph::Graph. Each op is described once by a spec
+// listing its inputs with their TensorType dtype sets and its attributes with the REG_OP defaults; tensors
+// carry their dtype as a type. A missing required input or attribute, an input or attribute the op does not
+// have, or a dtype outside the TensorType set is a compile error instead of a BuildIRModel failure:
+//
+//     typed_graph::Graph g(graph);
+//     auto x = g.Data<ge::DT_FLOAT>("data", {1, 8, 864, 480});
+//     auto y = g.Op<typed_graph::spec::ConvTranspose>("deconv")
+//         .In<tag::output_shape>(shape).In<tag::filter>(filter).In<tag::x>(x)
+//         .Attr<tag::strides>({2, 2})
+//         .Attr<tag::pad_mode>("SAME")
+//         .Finish();
+//
+// Attribute values are staged in the builder and written once per op in Finish(). Values equal to the REG_OP
+// default are not written to the ge::Operator at all, the default registered by its constructor already
+// holds; the DDK has no bulk attribute API, so skipping redundant AttrValue/SetAttr churn is what batching
+// buys here.
+namespace typed_graph {
+template<ge::DataType DT>
+struct Tensor {
+    host_graph::TensorRef ref;
+};
+
+template<ge::DataType... DTs>
+struct DTypes {};
+
+template<ge::DataType DT, typename Set>
+struct Contains;
+
+template<ge::DataType DT>
+struct Contains<DT, DTypes<>> {
+    static constexpr bool value = false;
+};
+
+template<ge::DataType DT, ge::DataType Head, ge::DataType... Tail>
+struct Contains<DT, DTypes<Head, Tail...>> {
+    static constexpr bool value = DT == Head || Contains<DT, DTypes<Tail...>>::value;
+};
+
+template<typename... Ts>
+struct List {};
+
+#define TYPED_GRAPH_TAG(name) \
+    struct name { \
+        static const char* Name() { return #name; } \
+    };
+
+// Input and attribute names; one tag serves every op that has an input or attribute of that name.
+namespace tag {
+TYPED_GRAPH_TAG(x)
+TYPED_GRAPH_TAG(x1)
+TYPED_GRAPH_TAG(x2)
+TYPED_GRAPH_TAG(filter)
+TYPED_GRAPH_TAG(bias)
+TYPED_GRAPH_TAG(w)
+TYPED_GRAPH_TAG(b)
+TYPED_GRAPH_TAG(size)
+TYPED_GRAPH_TAG(shape)
+TYPED_GRAPH_TAG(output_shape)
+TYPED_GRAPH_TAG(strides)
+TYPED_GRAPH_TAG(dilations)
+TYPED_GRAPH_TAG(pads)
+TYPED_GRAPH_TAG(pad_mode)
+TYPED_GRAPH_TAG(groups)
+TYPED_GRAPH_TAG(data_format)
+TYPED_GRAPH_TAG(offset_x)
+TYPED_GRAPH_TAG(mode)
+TYPED_GRAPH_TAG(coef)
+TYPED_GRAPH_TAG(negative_slope)
+TYPED_GRAPH_TAG(num_output)
+TYPED_GRAPH_TAG(transpose)
+TYPED_GRAPH_TAG(axis)
+TYPED_GRAPH_TAG(num_axes)
+TYPED_GRAPH_TAG(align_corners)
+TYPED_GRAPH_TAG(half_pixel_centers)
+TYPED_GRAPH_TAG(x_quant_type)
+TYPED_GRAPH_TAG(filter_quant_type)
+TYPED_GRAPH_TAG(w_quant_type)
+TYPED_GRAPH_TAG(x_quant_scale)
+TYPED_GRAPH_TAG(x_quant_offset)
+TYPED_GRAPH_TAG(filter_quant_scales)
+TYPED_GRAPH_TAG(w_quant_scales)
+TYPED_GRAPH_TAG(global_pooling)
+TYPED_GRAPH_TAG(window)
+TYPED_GRAPH_TAG(pad)
+TYPED_GRAPH_TAG(stride)
+TYPED_GRAPH_TAG(ceil_mode)
+TYPED_GRAPH_TAG(data_mode)
+}
+
+// Defaults of optional attributes, spelled as types so that specs stay declarative.
+template<int64_t V>
+struct IntValue {
+    static int64_t Get() { return V; }
+};
+
+template<bool V>
+struct BoolValue {
+    static bool Get() { return V; }
+};
+
+template<int Num, int Den = 1>
+struct FloatValue {
+    static float Get() { return static_cast<float>(Num) / Den; }
+};
+
+template<int64_t... Vs>
+struct IntsValue {
+    static std::vector<int64_t> Get() { return {Vs...}; }
+};
+
+template<int... Vs>
+struct FloatsValue {
+    static std::vector<float> Get() { return {static_cast<float>(Vs)...}; }
+};
+
+#define TYPED_GRAPH_STR(name, value) \
+    struct name { \
+        static std::string Get() { return value; } \
+    };
+
+TYPED_GRAPH_STR(StrNCHW, "NCHW")
+TYPED_GRAPH_STR(StrSpecific, "SPECIFIC")
+TYPED_GRAPH_STR(StrSame, "SAME")
+
+template<typename Tag, typename Types>
+struct Input {
+    using tag = Tag;
+    using types = Types;
+    static constexpr bool required = true;
+};
+
+template<typename Tag, typename Types>
+struct OptionalInput {
+    using tag = Tag;
+    using types = Types;
+    static constexpr bool required = false;
+};
+
+template<typename Tag, typename Value>
+struct RequiredAttr {
+    using tag = Tag;
+    using value_type = Value;
+    static constexpr bool required = true;
+    static bool IsDefault(const Value&) { return false; }
+};
+
+template<typename Tag, typename Value, typename Default>
+struct Attr {
+    using tag = Tag;
+    using value_type = Value;
+    static constexpr bool required = false;
+    static bool IsDefault(const Value& value) { return value == static_cast<Value>(Default::Get()); }
+};
+
+// Output dtype rules: the dtype of input I, or a fixed one.
+template<int I>
+struct SameAs {
+    template<int Index, ge::DataType In, ge::DataType Current>
+    struct Apply {
+        static constexpr ge::DataType value = Index == I ? In : Current;
+    };
+    static constexpr ge::DataType initial = ge::DT_UNDEFINED;
+};
+
+template<ge::DataType DT>
+struct Fixed {
+    template<int Index, ge::DataType In, ge::DataType Current>
+    struct Apply {
+        static constexpr ge::DataType value = DT;
+    };
+    static constexpr ge::DataType initial = DT;
+};
+
+namespace detail {
+// Stands in for the entry of an unknown name; accepts any value so that only the static_assert fires.
+struct NotFound {
+    using types = DTypes<>;
+    using value_type = NotFound;
+    template<typename T>
+    NotFound(const T&) {}
+    static bool IsDefault(const NotFound&) { return true; }
+};
+
+template<typename Tag, typename Entries, int Index = 0>
+struct Find;
+
+template<typename Tag, int Index>
+struct Find<Tag, List<>, Index> {
+    static constexpr int value = -1;
+    using type = NotFound;
+};
+
+template<typename Tag, typename Head, typename... Tail, int Index>
+struct Find<Tag, List<Head, Tail...>, Index> {
+    static constexpr bool match = std::is_same<Tag, typename Head::tag>::value;
+    static constexpr int value = match ? Index : Find<Tag, List<Tail...>, Index + 1>::value;
+    using type = typename std::conditional<match, Head, typename Find<Tag, List<Tail...>, Index + 1>::type>::type;
+};
+
+// 0 for unknown names, so that the static_asserts below report them instead of a negative shift
+template<int Index>
+struct Bit {
+    static constexpr uint64_t value = Index < 0 ? 0 : uint64_t(1) << (Index < 0 ? 0 : Index);
+};
+
+template<typename Entries, int Index = 0>
+struct RequiredMask;
+
+template<int Index>
+struct RequiredMask<List<>, Index> {
+    static constexpr uint64_t value = 0;
+};
+
+template<typename Head, typename... Tail, int Index>
+struct RequiredMask<List<Head, Tail...>, Index> {
+    static constexpr uint64_t value = (Head::required ? (uint64_t(1) << Index) : 0) |
+                                      RequiredMask<List<Tail...>, Index + 1>::value;
+};
+
+template<typename Entries>
+struct Size;
+
+template<typename... Ts>
+struct Size<List<Ts...>> {
+    static constexpr size_t value = sizeof...(Ts);
+};
+
+inline ge::AttrValue CreateAttr(int64_t value) { return ge::AttrValue::CreateFrom<ge::AttrValue::INT>(value); }
+inline ge::AttrValue CreateAttr(bool value) { return ge::AttrValue::CreateFrom<ge::AttrValue::BOOL>(value); }
+inline ge::AttrValue CreateAttr(float value) { return ge::AttrValue::CreateFrom<ge::AttrValue::FLOAT>(value); }
+inline ge::AttrValue CreateAttr(const std::string& value) {
+    return ge::AttrValue::CreateFrom<ge::AttrValue::STR>(value);
+}
+inline ge::AttrValue CreateAttr(const std::vector<int64_t>& value) {
+    return ge::AttrValue::CreateFrom<ge::AttrValue::LIST_INT>(value);
+}
+inline ge::AttrValue CreateAttr(const std::vector<float>& value) {
+    return ge::AttrValue::CreateFrom<ge::AttrValue::LIST_FLOAT>(value);
+}
+
+inline ge::AttrValue CreateAttr(const NotFound&) { return ge::AttrValue(); }
+inline void SetHostAttr(host_graph::Attr&, const NotFound&) {}
+inline void SetHostAttr(host_graph::Attr& attr, int64_t value) { attr.ints = {value}; }
+inline void SetHostAttr(host_graph::Attr& attr, bool value) { attr.ints = {value ? 1 : 0}; }
+inline void SetHostAttr(host_graph::Attr& attr, float value) { attr.floats = {value}; }
+inline void SetHostAttr(host_graph::Attr& attr, const std::string& value) { attr.str = value; }
+inline void SetHostAttr(host_graph::Attr& attr, const std::vector<int64_t>& value) { attr.ints = value; }
+inline void SetHostAttr(host_graph::Attr& attr, const std::vector<float>& value) { attr.floats = value; }
+
+struct StagedAttr {
+    const char* name;
+    bool isDefault;
+    host_graph::Attr host;
+    // only built for values that differ from the default
+    std::shared_ptr<ge::AttrValue> value;
+};
+
+struct OpState {
+    host_graph::Graph* graph = nullptr;
+    std::string name;
+    // indexed by spec input order
+    std::vector<std::pair<const char*, host_graph::TensorRef>> inputs;
+    std::vector<StagedAttr> attrs;
+};
+}
+
+template<typename Spec, uint64_t InMask = 0, uint64_t AttrMask = 0,
+         ge::DataType OutDT = Spec::Output::initial>
+class OpBuilder {
+public:
+    using Inputs = typename Spec::Inputs;
+    using Attrs = typename Spec::Attrs;
+    static_assert(detail::Size<Inputs>::value <= 64 && detail::Size<Attrs>::value <= 64, "too many entries");
+
+    explicit OpBuilder(detail::OpState&& state) : state_(std::move(state)) {}
+
+    template<typename Tag, ge::DataType DT>
+    OpBuilder<Spec, InMask | detail::Bit<detail::Find<Tag, Inputs>::value>::value, AttrMask,
+              Spec::Output::template Apply<detail::Find<Tag, Inputs>::value, DT, OutDT>::value>
+    In(const Tensor<DT>& src) {
+        using Entry = detail::Find<Tag, Inputs>;
+        static_assert(Entry::value >= 0, "the op has no input of this name");
+        static_assert(Entry::value < 0 || Contains<DT, typename Entry::type::types>::value,
+                      "dtype is not in the TensorType of this input");
+        static_assert(Entry::value < 0 || (InMask & detail::Bit<Entry::value>::value) == 0, "input set twice");
+        state_.inputs[Entry::value] = std::make_pair(Tag::Name(), src.ref);
+        return OpBuilder<Spec, InMask | detail::Bit<Entry::value>::value, AttrMask,
+                         Spec::Output::template Apply<Entry::value, DT, OutDT>::value>(std::move(state_));
+    }
+
+    template<typename Tag>
+    OpBuilder<Spec, InMask, AttrMask | detail::Bit<detail::Find<Tag, Attrs>::value>::value, OutDT>
+    Attr(const typename detail::Find<Tag, Attrs>::type::value_type& value) {
+        using Entry = detail::Find<Tag, Attrs>;
+        static_assert(Entry::value >= 0, "the op has no attribute of this name");
+        static_assert(Entry::value < 0 || (AttrMask & detail::Bit<Entry::value>::value) == 0, "attribute set twice");
+        detail::StagedAttr staged;
+        staged.name = Tag::Name();
+        staged.isDefault = Entry::type::IsDefault(value);
+        detail::SetHostAttr(staged.host, value);
+        if (!staged.isDefault) {
+            staged.value = std::make_shared<ge::AttrValue>(detail::CreateAttr(value));
+        }
+        state_.attrs.push_back(std::move(staged));
+        return OpBuilder<Spec, InMask, AttrMask | detail::Bit<Entry::value>::value, OutDT>(std::move(state_));
+    }
+
+    // Creates the operator, wires the inputs in REG_OP order and writes the attributes in one go.
+    Tensor<OutDT> Finish() {
+        static_assert((InMask & detail::RequiredMask<Inputs>::value) == detail::RequiredMask<Inputs>::value,
+                      "a required input is not set");
+        static_assert((AttrMask & detail::RequiredMask<Attrs>::value) == detail::RequiredMask<Attrs>::value,
+                      "a required attribute is not set");
+        static_assert(OutDT != ge::DT_UNDEFINED, "output dtype depends on an input that is not set");
+        typename Spec::Op op(state_.name);
+        for (auto& attr : state_.attrs) {
+            if (!attr.isDefault) {
+                op.SetAttr(attr.name, std::move(*attr.value));
+            }
+        }
+        host_graph::NodeBuilder builder = state_.graph->AddNode(op, Spec::Type());
+        for (const auto& input : state_.inputs) {
+            if (input.first != nullptr) {
+                builder.Input(input.first, input.second);
+            }
+        }
+        host_graph::Node& node = state_.graph->MutableNode(builder.GetNodeIndex());
+        for (auto& attr : state_.attrs) {
+            node.attrs[attr.name] = std::move(attr.host);
+        }
+        Tensor<OutDT> out;
+        out.ref = builder.Output();
+        return out;
+    }
+
+private:
+    detail::OpState state_;
+};
+
+class Graph {
+public:
+    explicit Graph(host_graph::Graph& graph) : graph_(graph) {}
+
+    template<ge::DataType DT>
+    Tensor<DT> Data(const std::string& name, const std::vector<int64_t>& dims, ge::Format format = ge::FORMAT_NCHW) {
+        Tensor<DT> tensor;
+        tensor.ref = graph_.AddData(name, ge::TensorDesc(ge::Shape(dims), format, DT));
+        return tensor;
+    }
+
+    // The element type of `values` has to match the dtype of the Const.
+    template<ge::DataType DT, typename T>
+    Tensor<DT> Const(const std::string& name, const std::vector<int64_t>& dims, const std::vector<T>& values,
+                     ge::Format format = ge::FORMAT_NCHW) {
+        static_assert(sizeof(T) == (DT == ge::DT_INT8 || DT == ge::DT_UINT8 || DT == ge::DT_BOOL ? 1 :
+                                    DT == ge::DT_FLOAT16 || DT == ge::DT_INT16 ? 2 :
+                                    DT == ge::DT_INT64 || DT == ge::DT_DOUBLE ? 8 : 4),
+                      "element size does not match the dtype");
+        Tensor<DT> tensor;
+        tensor.ref = graph_.AddConst(name, ge::TensorDesc(ge::Shape(dims), format, DT), values.data(),
+                                     values.size() * sizeof(T));
+        return tensor;
+    }
+
+    template<typename Spec>
+    OpBuilder<Spec> Op(const std::string& name) {
+        detail::OpState state;
+        state.graph = &graph_;
+        state.name = name;
+        state.inputs.resize(detail::Size<typename Spec::Inputs>::value,
+                            std::make_pair(static_cast<const char*>(nullptr), host_graph::TensorRef()));
+        state.attrs.reserve(detail::Size<typename Spec::Attrs>::value);
+        return OpBuilder<Spec>(std::move(state));
+    }
+
+    template<ge::DataType... DTs>
+    void SetOutputs(const Tensor<DTs>&... outputs) {
+        graph_.SetOutputs({outputs.ref...});
+    }
+
+private:
+    host_graph::Graph& graph_;
+};
+
+// Specs of the ops used in this project, transcribed from graph/op/*.h. Inputs are listed in REG_OP order.
+namespace spec {
+using ge::DT_BOOL;
+using ge::DT_FLOAT;
+using ge::DT_INT8;
+using ge::DT_INT32;
+using ge::DT_INT64;
+using Ints = std::vector<int64_t>;
+using Floats = std::vector<float>;
+
+#define TYPED_GRAPH_CONV_ATTRS(padMode) \
+    RequiredAttr<tag::strides, Ints>, Attr<tag::dilations, Ints, IntsValue<1, 1>>, \
+    Attr<tag::pads, Ints, IntsValue<0, 0, 0, 0>>, Attr<tag::pad_mode, std::string, padMode>
+
+#define TYPED_GRAPH_QUANT_ATTRS(wType, wScales) \
+    Attr<tag::x_quant_type, int64_t, IntValue<0>>, Attr<tag::wType, int64_t, IntValue<0>>, \
+    Attr<tag::x_quant_scale, float, FloatValue<1>>, Attr<tag::x_quant_offset, int64_t, IntValue<0>>, \
+    Attr<tag::wScales, Floats, FloatsValue<>>
+
+struct Activation {
+    using Op = hiai::op::Activation;
+    static const char* Type() { return "Activation"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_INT8, DT_INT32, DT_FLOAT, DT_BOOL, DT_INT64>>>;
+    using Attrs = List<Attr<tag::mode, int64_t, IntValue<1>>, Attr<tag::coef, float, FloatValue<0>>,
+                       Attr<tag::negative_slope, float, FloatValue<0>>>;
+    using Output = SameAs<0>;
+};
+
+struct Add {
+    using Op = hiai::op::Add;
+    static const char* Type() { return "Add"; }
+    using Inputs = List<Input<tag::x1, DTypes<DT_FLOAT>>, Input<tag::x2, DTypes<DT_FLOAT>>>;
+    using Attrs = List<>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct Sqrt {
+    using Op = hiai::op::Sqrt;
+    static const char* Type() { return "Sqrt"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>>;
+    using Attrs = List<>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct Softmax {
+    using Op = hiai::op::Softmax;
+    static const char* Type() { return "Softmax"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>>;
+    using Attrs = List<Attr<tag::axis, int64_t, IntValue<0>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct Convolution {
+    using Op = hiai::op::Convolution;
+    static const char* Type() { return "Convolution"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::filter, DTypes<DT_FLOAT>>,
+                        OptionalInput<tag::bias, DTypes<DT_FLOAT>>>;
+    using Attrs = List<TYPED_GRAPH_CONV_ATTRS(StrSpecific), Attr<tag::groups, int64_t, IntValue<1>>,
+                       Attr<tag::data_format, std::string, StrNCHW>, Attr<tag::offset_x, int64_t, IntValue<0>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct ConvolutionDepthwise {
+    using Op = hiai::op::ConvolutionDepthwise;
+    static const char* Type() { return "ConvolutionDepthwise"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::filter, DTypes<DT_FLOAT>>,
+                        OptionalInput<tag::bias, DTypes<DT_FLOAT>>>;
+    using Attrs = List<TYPED_GRAPH_CONV_ATTRS(StrSame), Attr<tag::data_format, std::string, StrNCHW>,
+                       Attr<tag::offset_x, int64_t, IntValue<0>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct QuantizedConvolution {
+    using Op = hiai::op::QuantizedConvolution;
+    static const char* Type() { return "QuantizedConvolution"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::filter, DTypes<DT_FLOAT, DT_INT8>>,
+                        OptionalInput<tag::bias, DTypes<DT_FLOAT, DT_INT32>>>;
+    using Attrs = List<TYPED_GRAPH_CONV_ATTRS(StrSpecific), Attr<tag::groups, int64_t, IntValue<1>>,
+                       Attr<tag::data_format, std::string, StrNCHW>,
+                       TYPED_GRAPH_QUANT_ATTRS(filter_quant_type, filter_quant_scales)>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct ConvTranspose {
+    using Op = hiai::op::ConvTranspose;
+    static const char* Type() { return "ConvTranspose"; }
+    using Inputs = List<OptionalInput<tag::output_shape, DTypes<DT_INT32>>, Input<tag::filter, DTypes<DT_FLOAT>>,
+                        Input<tag::x, DTypes<DT_FLOAT>>, OptionalInput<tag::bias, DTypes<DT_FLOAT>>>;
+    using Attrs = List<TYPED_GRAPH_CONV_ATTRS(StrSpecific), Attr<tag::groups, int64_t, IntValue<1>>,
+                       Attr<tag::data_format, std::string, StrNCHW>, Attr<tag::offset_x, int64_t, IntValue<0>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct FullyConnection {
+    using Op = hiai::op::FullyConnection;
+    static const char* Type() { return "FullyConnection"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::w, DTypes<DT_FLOAT>>,
+                        OptionalInput<tag::b, DTypes<DT_FLOAT, DT_INT32>>>;
+    using Attrs = List<RequiredAttr<tag::num_output, int64_t>, Attr<tag::transpose, bool, BoolValue<false>>,
+                       Attr<tag::axis, int64_t, IntValue<1>>, Attr<tag::offset_x, int64_t, IntValue<0>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct QuantizedFullyConnection {
+    using Op = hiai::op::QuantizedFullyConnection;
+    static const char* Type() { return "QuantizedFullyConnection"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::w, DTypes<DT_FLOAT, DT_INT8>>,
+                        OptionalInput<tag::b, DTypes<DT_FLOAT, DT_INT32>>>;
+    using Attrs = List<RequiredAttr<tag::num_output, int64_t>, Attr<tag::transpose, bool, BoolValue<false>>,
+                       Attr<tag::axis, int64_t, IntValue<1>>, TYPED_GRAPH_QUANT_ATTRS(w_quant_type, w_quant_scales)>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct PoolingD {
+    using Op = hiai::op::PoolingD;
+    static const char* Type() { return "PoolingD"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>>;
+    using Attrs = List<Attr<tag::mode, int64_t, IntValue<0>>, Attr<tag::pad_mode, int64_t, IntValue<0>>,
+                       Attr<tag::global_pooling, bool, BoolValue<false>>, Attr<tag::window, Ints, IntsValue<1, 1>>,
+                       Attr<tag::pad, Ints, IntsValue<0, 0, 0, 0>>, Attr<tag::stride, Ints, IntsValue<1, 1>>,
+                       Attr<tag::ceil_mode, int64_t, IntValue<0>>, Attr<tag::data_mode, int64_t, IntValue<1>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct ResizeBilinearV2 {
+    using Op = hiai::op::ResizeBilinearV2;
+    static const char* Type() { return "ResizeBilinearV2"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT>>, Input<tag::size, DTypes<DT_INT32>>>;
+    using Attrs = List<Attr<tag::align_corners, bool, BoolValue<false>>,
+                       Attr<tag::half_pixel_centers, bool, BoolValue<false>>>;
+    using Output = Fixed<DT_FLOAT>;
+};
+
+struct Reshape {
+    using Op = hiai::op::Reshape;
+    static const char* Type() { return "Reshape"; }
+    using Inputs = List<Input<tag::x, DTypes<DT_FLOAT, DT_INT32, DT_INT64, DT_BOOL>>,
+                        Input<tag::shape, DTypes<DT_INT32, DT_INT64>>>;
+    using Attrs = List<Attr<tag::axis, int64_t, IntValue<0>>, Attr<tag::num_axes, int64_t, IntValue<-1>>>;
+    using Output = SameAs<0>;
+};
+
+#undef TYPED_GRAPH_CONV_ATTRS
+#undef TYPED_GRAPH_QUANT_ATTRS
+}
+}
+
+#endif //BUILD_IR_MODEL_TYPED_GRAPH_H
@@ -0,0 +1,320 @@
+#ifndef BUILD_IR_MODEL_WEIGHT_QUANT_H
+#define BUILD_IR_MODEL_WEIGHT_QUANT_H
+
+#include <cfloat>
+#include <cmath>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "log_util.h"
+#include "parallel_util.h"
+#include "simd_util.h"
+
+// Offline per-channel weight quantization for the Quantized* ops. Ranges are nudged exactly like
+// FakeQuantWithMinMaxVarsPerChannel (and TensorFlow's FakeQuant ops) so that weights trained with fake
+// quantization round-trip bit exactly. Output channels are quantized in parallel with SIMD and the result is
+// packed channel major, the filter / w layout of QuantizedConvolution, QuantizedConvolutionDepthwise and
+// QuantizedFullyConnection.
+namespace weight_quant {
+struct NudgedRange {
+    float min = 0;
+    float max = 0;
+    float scale = 1.0f;
+    int32_t zeroPoint = 0;
+    int32_t quantMin = 0;
+    int32_t quantMax = 255;
+};
+
+// Quantized values are in [quantMin, quantMax] = [narrowRange ? 1 : 0, 2^numBits - 1], the zero point is
+// rounded to an integer and the float range shifted so that 0.0f is exactly representable.
+inline NudgedRange Nudge(float min, float max, int numBits, bool narrowRange) {
+    NudgedRange range;
+    range.quantMin = narrowRange ? 1 : 0;
+    range.quantMax = (1 << numBits) - 1;
+    float quantMin = static_cast<float>(range.quantMin);
+    float quantMax = static_cast<float>(range.quantMax);
+    range.scale = max > min ? (max - min) / (quantMax - quantMin) : 1.0f;
+    float zeroPoint = quantMin - min / range.scale;
+    if (zeroPoint < quantMin) {
+        range.zeroPoint = range.quantMin;
+    } else if (zeroPoint > quantMax) {
+        range.zeroPoint = range.quantMax;
+    } else {
+        range.zeroPoint = static_cast<int32_t>(std::floor(zeroPoint + 0.5f));
+    }
+    range.min = (quantMin - range.zeroPoint) * range.scale;
+    range.max = (quantMax - range.zeroPoint) * range.scale;
+    return range;
+}
+
+// Reference for FakeQuantWithMinMaxVarsPerChannel: x is [..., channels], min / max are [channels].
+inline void FakeQuantPerChannel(const float* x, size_t outer, size_t channels, const float* min, const float* max,
+                                int numBits, bool narrowRange, float* y) {
+    for (size_t c = 0; c < channels; c++) {
+        NudgedRange range = Nudge(min[c], max[c], numBits, narrowRange);
+        float invScale = 1.0f / range.scale;
+        for (size_t i = 0; i < outer; i++) {
+            float v = std::min(std::max(x[i * channels + c], range.min), range.max) - range.min;
+            y[i * channels + c] = std::floor(v * invScale + 0.5f) * range.scale + range.min;
+        }
+    }
+}
+
+struct WeightQuantOptions {
+    // 2..8, values are stored as int8 either way
+    int numBits = 8;
+    // [-127, 127] instead of [-128, 127], keeps the range symmetric
+    bool narrowRange = true;
+    // axis of the output channels in the source tensor, moved to the front when packing
+    int channelAxis = 0;
+    // source axis of every packed axis, e.g. HwioToOihw(); perm[0] is the channel axis and overrides channelAxis.
+    // Empty keeps the other axes in source order.
+    std::vector<int> perm;
+    int threadNum = 0;
+};
+
+// Packs an HWIO (TensorFlow) filter as OIHW.
+inline std::vector<int> HwioToOihw() {
+    return {3, 2, 0, 1};
+}
+
+struct QuantizedWeight {
+    std::vector<int64_t> dims;
+    std::vector<int8_t> data;
+    std::vector<float> scales;
+};
+
+struct LayerQuantError {
+    std::string name;
+    std::vector<int64_t> dims;
+    size_t channels = 0;
+    float maxAbsError = 0;
+    double rmse = 0;
+    double sqnrDb = 0;    // 10 * log10(|w|^2 / |w - dequant(q)|^2), infinite for exact layers
+    int worstChannel = -1; // lowest SQNR
+    double ms = 0;
+};
+
+namespace detail {
+struct ChannelResult {
+    double errorSq = 0;
+    double signalSq = 0;
+    float maxAbsError = 0;
+};
+
+// Copies channel c of weight into dst, the other axes in the order of perm[1, rank).
+inline void GatherChannel(const float* weight, const std::vector<int64_t>& dims, const std::vector<int>& perm,
+                          size_t c, float* dst) {
+    const size_t rank = dims.size();
+    std::vector<size_t> strides(rank, 1);
+    for (size_t i = rank - 1; i > 0; i--) {
+        strides[i - 1] = strides[i] * static_cast<size_t>(dims[i]);
+    }
+    const float* base = weight + c * strides[perm[0]];
+    if (rank == 1) {
+        *dst = *base;
+        return;
+    }
+    // the last packed axis is copied as a strided row, the ones before it are counted like an odometer
+    const size_t rowLen = static_cast<size_t>(dims[perm[rank - 1]]);
+    const size_t rowStride = strides[perm[rank - 1]];
+    std::vector<size_t> counter(rank, 0);
+    size_t offset = 0;
+    while (true) {
+        const float* src = base + offset;
+        for (size_t j = 0; j < rowLen; j++) {
+            dst[j] = src[j * rowStride];
+        }
+        dst += rowLen;
+        size_t k = rank - 1;
+        for (; k > 1; k--) {
+            size_t axis = static_cast<size_t>(perm[k - 1]);
+            offset += strides[axis];
+            if (++counter[k - 1] < static_cast<size_t>(dims[axis])) {
+                break;
+            }
+            offset -= counter[k - 1] * strides[axis];
+            counter[k - 1] = 0;
+        }
+        if (k == 1) {
+            return;
+        }
+    }
+}
+
+inline float AbsMax(const float* src, size_t num) {
+    simd_util::Float4 acc = simd_util::Set4(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= num; i += 4) {
+        acc = simd_util::Max4(acc, simd_util::Abs4(simd_util::Load4(src + i)));
+    }
+    float absMax = simd_util::ReduceMax4(acc);
+    for (; i < num; i++) {
+        absMax = std::max(absMax, std::fabs(src[i]));
+    }
+    return absMax;
+}
+
+// q - zeroPoint is stored, which is the plain int8 value once the zero point is 2^(numBits - 1).
+inline ChannelResult QuantizeChannel(const float* src, size_t num, const NudgedRange& range, int8_t* dst) {
+    using namespace simd_util;
+    ChannelResult result;
+    const float invScale = 1.0f / range.scale;
+    const Float4 vMin = Set4(range.min);
+    const Float4 vMax = Set4(range.max);
+    const Float4 vInv = Set4(invScale);
+    const Float4 vScale = Set4(range.scale);
+    const Float4 vHalf = Set4(0.5f);
+    Float4 errorSq = Set4(0.0f);
+    Float4 signalSq = Set4(0.0f);
+    Float4 maxError = Set4(0.0f);
+    const size_t block = 64;
+    float levels[block];
+    for (size_t begin = 0; begin < num; begin += block) {
+        size_t count = std::min(block, num - begin);
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            Float4 x = Load4(src + begin + i);
+            // floor((clamp(x) - min) / scale + 0.5) - zeroPoint, min / scale == quantMin - zeroPoint
+            Float4 shifted = Sub4(Min4(Max4(x, vMin), vMax), vMin);
+            Float4 q = Add4(Floor4(Fma4(shifted, vInv, vHalf)), Set4(range.quantMin - range.zeroPoint));
+            Store4(levels + i, q);
+            Float4 error = Sub4(Mul4(q, vScale), x);
+            errorSq = Fma4(error, error, errorSq);
+            signalSq = Fma4(x, x, signalSq);
+            maxError = Max4(maxError, Abs4(error));
+        }
+        for (; i < count; i++) {
+            float x = src[begin + i];
+            float shifted = std::min(std::max(x, range.min), range.max) - range.min;
+            float q = std::floor(shifted * invScale + 0.5f) + (range.quantMin - range.zeroPoint);
+            levels[i] = q;
+            float error = q * range.scale - x;
+            result.errorSq += error * error;
+            result.signalSq += x * x;
+            result.maxAbsError = std::max(result.maxAbsError, std::fabs(error));
+        }
+        for (i = 0; i < count; i++) {
+            dst[begin + i] = static_cast<int8_t>(static_cast<int32_t>(levels[i]));
+        }
+    }
+    result.errorSq += ReduceSum4(errorSq);
+    result.signalSq += ReduceSum4(signalSq);
+    result.maxAbsError = std::max(result.maxAbsError, ReduceMax4(maxError));
+    return result;
+}
+}
+
+// Quantizes `weight` per output channel. Without channelMin / channelMax the range of each channel is its
+// absolute maximum; given ranges (e.g. the min / max inputs of a FakeQuantWithMinMaxVarsPerChannel) are made
+// symmetric, the Quantized* ops have no per channel offset. options.perm packs other filter layouts, e.g. HWIO
+// as OIHW. `error` is optional.
+inline bool QuantizeWeights(const std::string& name, const float* weight, const std::vector<int64_t>& dims,
+                            const WeightQuantOptions& options, QuantizedWeight& out, LayerQuantError* error = nullptr,
+                            const float* channelMin = nullptr, const float* channelMax = nullptr) {
+    const int axis = options.perm.empty() ? options.channelAxis : options.perm[0];
+    if (axis < 0 || axis >= static_cast<int>(dims.size()) || options.numBits < 2 || options.numBits > 8) {
+        ALOGE("[WEIGHT_QUANT] %s: bad channel axis %d or num_bits %d.\n", name.c_str(), axis, options.numBits);
+        return false;
+    }
+    std::vector<int> perm = options.perm;
+    if (perm.empty()) {
+        perm.push_back(axis);
+        for (int i = 0; i < static_cast<int>(dims.size()); i++) {
+            if (i != axis) {
+                perm.push_back(i);
+            }
+        }
+    }
+    std::vector<bool> seen(dims.size(), false);
+    for (int p : perm) {
+        if (perm.size() != dims.size() || p < 0 || p >= static_cast<int>(dims.size()) || seen[p]) {
+            ALOGE("[WEIGHT_QUANT] %s: perm is not a permutation of %zu axes.\n", name.c_str(), dims.size());
+            return false;
+        }
+        seen[p] = true;
+    }
+    struct timeval start, end;
+    gettimeofday(&start, nullptr);
+    size_t perChannel = 1;
+    // a channel is one contiguous block when the packed order of the axes that are not 1 is their source order
+    bool contiguous = true;
+    int lastAxis = -1;
+    out.dims.clear();
+    for (int p : perm) {
+        out.dims.push_back(dims[p]);
+        if (p != axis) {
+            perChannel *= static_cast<size_t>(dims[p]);
+        }
+        if (dims[p] != 1 || p == axis) {
+            contiguous = contiguous && p > lastAxis;
+            lastAxis = p;
+        }
+    }
+    const size_t channels = static_cast<size_t>(dims[axis]);
+    out.data.resize(channels * perChannel);
+    out.scales.resize(channels);
+    std::vector<detail::ChannelResult> results(channels);
+
+    const float half = static_cast<float>(1 << (options.numBits - 1));
+    size_t minChunk = std::max<size_t>(1, (1 << 14) / std::max<size_t>(perChannel, 1));
+    parallel_util::ParallelFor(0, channels, [&](size_t begin, size_t finish) {
+        std::vector<float> gathered(contiguous ? 0 : perChannel);
+        for (size_t c = begin; c < finish; c++) {
+            const float* src = weight + c * perChannel;
+            if (!contiguous) {
+                detail::GatherChannel(weight, dims, perm, c, gathered.data());
+                src = gathered.data();
+            }
+            float absMax = channelMin != nullptr && channelMax != nullptr ?
+                           std::max(std::fabs(channelMin[c]), std::fabs(channelMax[c])) :
+                           detail::AbsMax(src, perChannel);
+            // a range whose zero point lands exactly on 2^(numBits - 1): [-a, a] for the narrow range,
+            // [-a, a * (half - 1) / half] for the full one
+            float a = absMax > 0 ? absMax : 1.0f;
+            NudgedRange range = Nudge(-a, options.narrowRange ? a : a * (half - 1) / half, options.numBits,
+                                      options.narrowRange);
+            out.scales[c] = range.scale;
+            results[c] = detail::QuantizeChannel(src, perChannel, range, out.data.data() + c * perChannel);
+        }
+    }, options.threadNum, minChunk);
+    gettimeofday(&end, nullptr);
+
+    if (error != nullptr) {
+        LayerQuantError& layer = *error;
+        layer = LayerQuantError();
+        layer.name = name;
+        layer.dims = dims;
+        layer.channels = channels;
+        double errorSq = 0;
+        double signalSq = 0;
+        double worstSqnr = DBL_MAX;
+        for (size_t c = 0; c < channels; c++) {
+            errorSq += results[c].errorSq;
+            signalSq += results[c].signalSq;
+            layer.maxAbsError = std::max(layer.maxAbsError, results[c].maxAbsError);
+            double sqnr = results[c].errorSq > 0 ? results[c].signalSq / results[c].errorSq : DBL_MAX;
+            if (sqnr < worstSqnr) {
+                worstSqnr = sqnr;
+                layer.worstChannel = static_cast<int>(c);
+            }
+        }
+        layer.rmse = std::sqrt(errorSq / std::max<size_t>(channels * perChannel, 1));
+        layer.sqnrDb = errorSq > 0 ? 10.0 * std::log10(signalSq / errorSq) : INFINITY;
+        layer.ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+    }
+    return true;
+}
+
+inline void PrintLayerErrors(const std::vector<LayerQuantError>& layers) {
+    ALOGI("[WEIGHT_QUANT] %-32s %10s %12s %12s %10s %8s %10s\n", "layer", "channels", "max_abs_err", "rmse",
+          "sqnr(dB)", "worst", "time(ms)");
+    for (const auto& layer : layers) {
+        ALOGI("[WEIGHT_QUANT] %-32s %10zu %12.6f %12.6f %10.2f %8d %10.3f\n", layer.name.c_str(), layer.channels,
+              layer.maxAbsError, layer.rmse, layer.sqnrDb, layer.worstChannel, layer.ms);
+    }
+}
+}
+
+#endif //BUILD_IR_MODEL_WEIGHT_QUANT_H